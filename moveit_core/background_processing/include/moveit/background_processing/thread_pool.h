@@ -0,0 +1,100 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, MoveIt maintainers
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread.hpp>
+#include <deque>
+#include <memory>
+#include <vector>
+
+namespace moveit
+{
+namespace tools
+{
+/** \brief A fixed set of worker threads that cooperatively run jobs.
+
+    The workers are created once and reused for all jobs, so data kept per thread (e.g. thread local caches or
+    per-thread collision managers) persists across jobs. A job is run by all workers at once; it typically distributes
+    its work among them through a shared counter. */
+class ThreadPool : private boost::noncopyable
+{
+public:
+  /** \brief The signature of jobs: the argument is the index of the worker running it */
+  typedef boost::function<void(unsigned int)> Job;
+
+  /** \brief Constructor. Creates \e threads workers, one per hardware thread if \e threads is 0. */
+  explicit ThreadPool(unsigned int threads = 0);
+
+  /** \brief Waits for the submitted jobs to finish and stops the workers. */
+  ~ThreadPool();
+
+  /** \brief Get the number of worker threads */
+  unsigned int getThreadCount() const
+  {
+    return threads_.size();
+  }
+
+  /** \brief Run \e job on all workers and wait until all of them returned.
+
+      Calls from different threads share the workers: each worker runs the jobs in the order they were submitted, so
+      it takes up a job as soon as it returned from the previous ones. A worker runs one job at a time, so data kept
+      per worker index needs no locking. If called from one of the workers of this pool (nested parallelism), \e job
+      is run once in the calling thread with the index of that worker instead. */
+  void run(const Job& job);
+
+  /** \brief Get the pool shared within the process, with one worker per hardware thread */
+  static ThreadPool& getGlobal();
+
+private:
+  /** \brief A job submitted by run(), with the state its caller waits on */
+  struct Run;
+
+  void workerThread(unsigned int index);
+
+  std::vector<std::unique_ptr<boost::thread>> threads_;
+
+  boost::mutex lock_;
+  boost::condition_variable job_condition_;
+
+  /** \brief The submitted runs not all workers took up yet, in the order of submission; protected by lock_ */
+  std::deque<Run*> runs_;
+  /** \brief The sequence number of the next submitted run; runs are numbered consecutively */
+  std::size_t next_sequence_;
+  bool stop_;
+};
+}  // namespace tools
+}  // namespace moveit
@@ -0,0 +1,146 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, MoveIt maintainers
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/background_processing/thread_pool.h>
+#include <ros/console.h>
+
+namespace moveit
+{
+namespace tools
+{
+namespace
+{
+/** \brief The pool the calling thread is a worker of, if any, and its index in that pool */
+thread_local const ThreadPool* WORKER_OF = nullptr;
+thread_local unsigned int WORKER_INDEX = 0;
+}  // namespace
+
+struct ThreadPool::Run
+{
+  const Job* job_;
+  std::size_t sequence_;
+  /** \brief The number of workers that took up the job */
+  std::size_t started_;
+  /** \brief The number of workers that did not return from the job yet */
+  std::size_t running_;
+  /** \brief Notified when \e running_ drops to zero */
+  boost::condition_variable done_condition_;
+};
+
+ThreadPool::ThreadPool(unsigned int threads) : next_sequence_(0), stop_(false)
+{
+  if (threads == 0)
+    threads = std::max(1u, boost::thread::hardware_concurrency());
+  for (unsigned int i = 0; i < threads; ++i)
+    threads_.emplace_back(new boost::thread(boost::bind(&ThreadPool::workerThread, this, i)));
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    boost::mutex::scoped_lock slock(lock_);
+    stop_ = true;
+    job_condition_.notify_all();
+  }
+  for (std::unique_ptr<boost::thread>& thread : threads_)
+    thread->join();
+}
+
+void ThreadPool::workerThread(unsigned int index)
+{
+  WORKER_OF = this;
+  WORKER_INDEX = index;
+  boost::unique_lock<boost::mutex> ulock(lock_);
+  // the sequence number of the next run for this worker
+  std::size_t next = 0;
+  while (true)
+  {
+    while (next == next_sequence_ && !stop_)
+      job_condition_.wait(ulock);
+    if (next == next_sequence_)
+      return;
+
+    // runs leave the queue once all workers took them up, so this worker's next run is still queued
+    Run& run = *runs_[next - runs_.front()->sequence_];
+    ++next;
+    if (++run.started_ == threads_.size())
+      runs_.pop_front();
+    const Job& job = *run.job_;
+
+    // make sure we are unlocked while we run the job
+    ulock.unlock();
+    try
+    {
+      job(index);
+    }
+    catch (std::exception& ex)
+    {
+      ROS_ERROR_NAMED("thread_pool", "Exception caught while running a job: %s", ex.what());
+    }
+    ulock.lock();
+
+    if (--run.running_ == 0)
+      run.done_condition_.notify_all();
+  }
+}
+
+void ThreadPool::run(const Job& job)
+{
+  // the workers of this pool may be busy with the job that called us
+  if (WORKER_OF == this)
+  {
+    job(WORKER_INDEX);
+    return;
+  }
+
+  Run run;
+  run.job_ = &job;
+  run.started_ = 0;
+  run.running_ = threads_.size();
+  boost::unique_lock<boost::mutex> ulock(lock_);
+  run.sequence_ = next_sequence_++;
+  runs_.push_back(&run);
+  job_condition_.notify_all();
+  while (run.running_ > 0)
+    run.done_condition_.wait(ulock);
+}
+
+ThreadPool& ThreadPool::getGlobal()
+{
+  static ThreadPool pool;
+  return pool;
+}
+
+}  // end of namespace tools
+}  // end of namespace moveit
@@ -42,6 +42,7 @@
 #include <moveit_msgs/LinkPadding.h>
 #include <moveit_msgs/LinkScale.h>
 #include <moveit/collision_detection/world.h>
+#include <boost/function.hpp>
 
 namespace collision_detection
 {
@@ -110,6 +111,29 @@ public:
   virtual void checkCollision(const CollisionRequest& req, CollisionResult& res, const moveit::core::RobotState& state,
                               const AllowedCollisionMatrix& acm) const;
 
+  /** \brief Check a batch of states for collisions of the robot with itself or the world, in parallel.
+   *  Allowed collisions specified by the allowed collision matrix are taken into account.
+   *  @param req A CollisionRequest object that is used for every state
+   *  @param results Filled with one CollisionResult per state
+   *  @param states The kinematic states to check, with up to date collision body transforms
+   *  @param acm The allowed collision matrix
+   *  @param first_collision_only If true, states after the first colliding one may remain unchecked (with empty
+   *  results)
+   *  @return The index of the first colliding state, -1 if no state is in collision */
+  int checkCollisionBatch(const CollisionRequest& req, std::vector<CollisionResult>& results,
+                          const std::vector<const moveit::core::RobotState*>& states, const AllowedCollisionMatrix& acm,
+                          bool first_collision_only = false) const;
+
+  /** \brief Like checkCollisionBatch(), but only self collisions are checked */
+  int checkSelfCollisionBatch(const CollisionRequest& req, std::vector<CollisionResult>& results,
+                              const std::vector<const moveit::core::RobotState*>& states,
+                              const AllowedCollisionMatrix& acm, bool first_collision_only = false) const;
+
+  /** \brief Like checkCollisionBatch(), but only collisions between the robot and the world are checked */
+  int checkRobotCollisionBatch(const CollisionRequest& req, std::vector<CollisionResult>& results,
+                               const std::vector<const moveit::core::RobotState*>& states,
+                               const AllowedCollisionMatrix& acm, bool first_collision_only = false) const;
+
   /** \brief Check whether the robot model is in collision with the world. Any collisions between a robot link
    *  and the world are considered. Self collisions are not checked.
    *  @param req A CollisionRequest object that encapsulates the collision request
@@ -311,6 +335,26 @@ protected:
       @param links the names of the links whose padding or scaling were updated */
   virtual void updatedPaddingOrScaling(const std::vector<std::string>& links);
 
+  /** @brief Signature of the functions checking single states of a batch */
+  using BatchCheckFn = boost::function<void(const CollisionRequest& req, CollisionResult& res,
+                                            const moveit::core::RobotState& state, const AllowedCollisionMatrix& acm)>;
+
+  /** @brief Create the function a worker thread of the batch checks uses for its states.
+      Every worker creates its own function, which needs to be safe to call concurrently with the functions of the other
+      workers. The default implementation calls the regular (const) collision checks of this class, which is suitable
+      for thread-safe implementations. Derived classes can override this, e.g. to check with a copy of their managers.
+      @param self Whether self collisions are checked
+      @param robot Whether collisions of the robot with the world are checked
+      @param worker The index of the worker of moveit::tools::ThreadPool::getGlobal() that uses the function. A worker
+      runs one batch at a time, so data kept per worker can be reused across batches. */
+  virtual BatchCheckFn createBatchCheckFn(bool self, bool robot, unsigned int worker) const;
+
+  /** @brief Bundles the different batch check functions into a single function */
+  int checkCollisionBatchHelper(const CollisionRequest& req, std::vector<CollisionResult>& results,
+                                const std::vector<const moveit::core::RobotState*>& states,
+                                const AllowedCollisionMatrix& acm, bool first_collision_only, bool self,
+                                bool robot) const;
+
   /** @brief The kinematic model corresponding to this collision model*/
   moveit::core::RobotModelConstPtr robot_model_;
 
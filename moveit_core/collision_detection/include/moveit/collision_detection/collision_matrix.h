@@ -40,10 +40,13 @@
 #include <moveit/macros/class_forward.h>
 #include <moveit_msgs/AllowedCollisionMatrix.h>
 #include <boost/function.hpp>
+#include <cstdint>
 #include <iostream>
+#include <memory>
 #include <vector>
 #include <string>
 #include <map>
+#include <unordered_map>
 
 namespace collision_detection
 {
@@ -72,6 +75,7 @@ enum Type
 using DecideContactFn = boost::function<bool(collision_detection::Contact&)>;
 
 MOVEIT_CLASS_FORWARD(AllowedCollisionMatrix);  // Defines AllowedCollisionMatrixPtr, ConstPtr, WeakPtr... etc
+MOVEIT_CLASS_FORWARD(CompiledAllowedCollisionMatrix);
 
 /** @class AllowedCollisionMatrix
  *  @brief Definition of a structure for the allowed collision matrix. All elements in the collision world are referred
@@ -92,7 +96,9 @@ public:
   AllowedCollisionMatrix(const moveit_msgs::AllowedCollisionMatrix& msg);
 
   /** @brief Copy constructor */
-  AllowedCollisionMatrix(const AllowedCollisionMatrix& acm) = default;
+  AllowedCollisionMatrix(const AllowedCollisionMatrix& acm);
+
+  AllowedCollisionMatrix& operator=(const AllowedCollisionMatrix& acm);
 
   /** @brief Get the type of the allowed collision between two elements. Return true if the entry is included in the
    * collision matrix.
@@ -269,11 +275,118 @@ public:
   /** @brief Print the allowed collision matrix */
   void print(std::ostream& out) const;
 
+  /** @brief Get the matrix compiled for constant time queries between the links of \e robot_model and the other
+   *  elements known to this matrix.
+   *
+   *  The compiled matrix is cached until this matrix is modified or a different robot model is passed.
+   *  This function may be called concurrently from multiple threads. */
+  CompiledAllowedCollisionMatrixConstPtr getCompiled(const moveit::core::RobotModelConstPtr& robot_model) const;
+
 private:
+  /** @brief Drop the cached compiled matrix after a modification */
+  void invalidateCompiled()
+  {
+    std::atomic_store(&compiled_, CompiledAllowedCollisionMatrixConstPtr());
+  }
+
   std::map<std::string, std::map<std::string, AllowedCollision::Type> > entries_;
   std::map<std::string, std::map<std::string, DecideContactFn> > allowed_contacts_;
 
   std::map<std::string, AllowedCollision::Type> default_entries_;
   std::map<std::string, DecideContactFn> default_allowed_contacts_;
+
+  /** @brief Cache of getCompiled(), only accessed through std::atomic_load() / std::atomic_store() */
+  mutable CompiledAllowedCollisionMatrixConstPtr compiled_;
+};
+
+/** @class CompiledAllowedCollisionMatrix
+ *  @brief Snapshot of an AllowedCollisionMatrix in which all elements are referred to by integer indices.
+ *
+ *  The links of the robot model use their link index, the other elements of the matrix (e.g. world objects or
+ *  attached bodies) follow. Whether collisions between two elements are always or never allowed is stored in bit
+ *  matrices, the predicates of conditionally allowed pairs in a sparse table, so queries take constant time. */
+class CompiledAllowedCollisionMatrix
+{
+public:
+  /** @brief Compile \e acm for the links of \e robot_model and all names known to \e acm */
+  CompiledAllowedCollisionMatrix(const AllowedCollisionMatrix& acm,
+                                 const moveit::core::RobotModelConstPtr& robot_model);
+
+  /** @brief The robot model whose links are indexed by their link index */
+  const moveit::core::RobotModelConstPtr& getRobotModel() const
+  {
+    return robot_model_;
+  }
+
+  /** @brief Get the number of indexed elements */
+  std::size_t getSize() const
+  {
+    return names_.size();
+  }
+
+  /** @brief Get the name of the element with index \e index */
+  const std::string& getName(int index) const
+  {
+    return names_[index];
+  }
+
+  /** @brief Get the index of the element named \e name. Returns -1 if the element is unknown, in which case the
+   *  AllowedCollisionMatrix this matrix was compiled from needs to be queried instead. */
+  int getIndex(const std::string& name) const
+  {
+    auto it = indices_.find(name);
+    return it == indices_.end() ? -1 : it->second;
+  }
+
+  /** @brief Get the type of the allowed collision between two indexed elements. Return false if there is neither an
+   *  entry nor a default entry for the pair, with the same semantics as AllowedCollisionMatrix::getAllowedCollision() */
+  bool getAllowedCollision(int index1, int index2, AllowedCollision::Type& allowed_collision) const
+  {
+    if (!getBit(found_, index1, index2))
+      return false;
+    if (getBit(allowed_, index1, index2))
+      allowed_collision = AllowedCollision::ALWAYS;
+    else if (getBit(conditional_, index1, index2))
+      allowed_collision = AllowedCollision::CONDITIONAL;
+    else
+      allowed_collision = AllowedCollision::NEVER;
+    return true;
+  }
+
+  /** @brief Get the predicate of a conditionally allowed pair of indexed elements, nullptr if there is none */
+  const DecideContactFn* getAllowedContactFn(int index1, int index2) const;
+
+private:
+  bool getBit(const std::vector<uint64_t>& bits, int index1, int index2) const
+  {
+    return (bits[index1 * words_per_row_ + (index2 >> 6)] >> (index2 & 63)) & 1;
+  }
+
+  void setBit(std::vector<uint64_t>& bits, int index1, int index2)
+  {
+    bits[index1 * words_per_row_ + (index2 >> 6)] |= uint64_t(1) << (index2 & 63);
+    bits[index2 * words_per_row_ + (index1 >> 6)] |= uint64_t(1) << (index1 & 63);
+  }
+
+  std::size_t getPairKey(int index1, int index2) const
+  {
+    return index1 < index2 ? index1 * names_.size() + index2 : index2 * names_.size() + index1;
+  }
+
+  moveit::core::RobotModelConstPtr robot_model_;
+
+  std::vector<std::string> names_;
+  std::unordered_map<std::string, int> indices_;
+
+  /** @brief Number of 64 bit words per row of the bit matrices */
+  std::size_t words_per_row_;
+
+  /** @brief Bit matrices: the pair has an (default) entry, the entry is ALWAYS, the entry is CONDITIONAL */
+  std::vector<uint64_t> found_;
+  std::vector<uint64_t> allowed_;
+  std::vector<uint64_t> conditional_;
+
+  /** @brief The predicates of the CONDITIONAL pairs, see getPairKey() */
+  std::unordered_map<std::size_t, DecideContactFn> allowed_contacts_;
 };
 }  // namespace collision_detection
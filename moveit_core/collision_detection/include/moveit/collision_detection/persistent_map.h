@@ -0,0 +1,334 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, MoveIt maintainers
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace collision_detection
+{
+/** \brief An ordered map whose copies share their structure.
+ *
+ * The entries are kept in a treap of reference counted nodes. Copying the map only copies the pointer to the root, so
+ * it takes constant time. A modification copies the nodes on the path to the modified entry that are still shared
+ * with other maps, so it takes logarithmic time and memory, and leaves all copies untouched. Nodes that are referenced
+ * by this map only are modified in place.
+ *
+ * Iterators are invalidated by any modification of the map. */
+template <typename Key, typename Value, typename Compare = std::less<Key>>
+class PersistentMap
+{
+public:
+  using key_type = Key;
+  using mapped_type = Value;
+  using value_type = std::pair<const Key, Value>;
+
+private:
+  struct Node;
+  using NodePtr = std::shared_ptr<Node>;
+
+  struct Node
+  {
+    Node(const Key& key, std::size_t priority) : value(key, Value()), priority(priority)
+    {
+    }
+
+    value_type value;
+    std::size_t priority;
+    NodePtr left;
+    NodePtr right;
+  };
+
+public:
+  /** \brief In-order iterator over the entries of the map */
+  class const_iterator
+  {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = typename PersistentMap::value_type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const value_type*;
+    using reference = const value_type&;
+
+    const_iterator() = default;
+
+    reference operator*() const
+    {
+      return stack_.back()->value;
+    }
+
+    pointer operator->() const
+    {
+      return &stack_.back()->value;
+    }
+
+    const_iterator& operator++()
+    {
+      const Node* node = stack_.back()->right.get();
+      stack_.pop_back();
+      pushLeftmost(node);
+      return *this;
+    }
+
+    const_iterator operator++(int)
+    {
+      const_iterator copy(*this);
+      ++(*this);
+      return copy;
+    }
+
+    bool operator==(const const_iterator& other) const
+    {
+      if (stack_.empty() || other.stack_.empty())
+        return stack_.empty() && other.stack_.empty();
+      return stack_.back() == other.stack_.back();
+    }
+
+    bool operator!=(const const_iterator& other) const
+    {
+      return !(*this == other);
+    }
+
+  private:
+    friend class PersistentMap;
+
+    void pushLeftmost(const Node* node)
+    {
+      for (; node; node = node->left.get())
+        stack_.push_back(node);
+    }
+
+    // the nodes that remain to be visited after going down to the current one; the current node is at the back
+    std::vector<const Node*> stack_;
+  };
+
+  PersistentMap() : size_(0)
+  {
+  }
+
+  const_iterator begin() const
+  {
+    const_iterator it;
+    it.pushLeftmost(root_.get());
+    return it;
+  }
+
+  const_iterator end() const
+  {
+    return const_iterator();
+  }
+
+  const_iterator find(const Key& key) const
+  {
+    const_iterator it;
+    const Node* node = root_.get();
+    while (node)
+    {
+      if (compare_(key, node->value.first))
+      {
+        it.stack_.push_back(node);
+        node = node->left.get();
+      }
+      else if (compare_(node->value.first, key))
+        node = node->right.get();
+      else
+      {
+        it.stack_.push_back(node);
+        return it;
+      }
+    }
+    return end();
+  }
+
+  std::size_t size() const
+  {
+    return size_;
+  }
+
+  bool empty() const
+  {
+    return size_ == 0;
+  }
+
+  /** \brief Get the value for \e key, for modification. Returns nullptr if there is no such entry. */
+  Value* findMutable(const Key& key)
+  {
+    if (find(key) == end())
+      return nullptr;
+    NodePtr* node = &root_;
+    while (true)
+    {
+      makeUnique(*node);
+      if (compare_(key, (*node)->value.first))
+        node = &(*node)->left;
+      else if (compare_((*node)->value.first, key))
+        node = &(*node)->right;
+      else
+        return &(*node)->value.second;
+    }
+  }
+
+  /** \brief Get the value for \e key, for modification. A default constructed value is inserted if there is no such
+   * entry. */
+  Value& operator[](const Key& key)
+  {
+    return insert(root_, key, hasher_(key));
+  }
+
+  /** \brief Remove the entry for \e key. Returns false if there was no such entry. */
+  bool erase(const Key& key)
+  {
+    if (find(key) == end())
+      return false;
+    NodePtr* node = &root_;
+    while (true)
+    {
+      makeUnique(*node);
+      if (compare_(key, (*node)->value.first))
+        node = &(*node)->left;
+      else if (compare_((*node)->value.first, key))
+        node = &(*node)->right;
+      else
+        break;
+    }
+    NodePtr left = std::move((*node)->left);
+    NodePtr right = std::move((*node)->right);
+    *node = merge(std::move(left), std::move(right));
+    --size_;
+    return true;
+  }
+
+  void clear()
+  {
+    root_.reset();
+    size_ = 0;
+  }
+
+  /** \brief Call \e fn(node, entry) for the nodes of the map, in pre-order. \e node identifies the node storing
+   * \e entry, and is the same in all maps sharing that node. The children of a node are only visited if \e fn returns
+   * true. */
+  template <typename Fn>
+  void visitNodes(const Fn& fn) const
+  {
+    std::vector<const Node*> stack;
+    if (root_)
+      stack.push_back(root_.get());
+    while (!stack.empty())
+    {
+      const Node* node = stack.back();
+      stack.pop_back();
+      if (!fn(static_cast<const void*>(node), node->value))
+        continue;
+      if (node->right)
+        stack.push_back(node->right.get());
+      if (node->left)
+        stack.push_back(node->left.get());
+    }
+  }
+
+private:
+  // make sure the node pointed to by node is referenced only by this map
+  static void makeUnique(NodePtr& node)
+  {
+    if (node.use_count() > 1)
+      node = std::make_shared<Node>(*node);
+  }
+
+  Value& insert(NodePtr& node, const Key& key, std::size_t priority)
+  {
+    if (!node)
+    {
+      node = std::make_shared<Node>(key, priority);
+      ++size_;
+      return node->value.second;
+    }
+    makeUnique(node);
+    if (compare_(key, node->value.first))
+    {
+      Value& value = insert(node->left, key, priority);
+      if (node->left->priority > node->priority)
+      {
+        // rotate right
+        NodePtr left = std::move(node->left);
+        node->left = std::move(left->right);
+        left->right = std::move(node);
+        node = std::move(left);
+      }
+      return value;
+    }
+    if (compare_(node->value.first, key))
+    {
+      Value& value = insert(node->right, key, priority);
+      if (node->right->priority > node->priority)
+      {
+        // rotate left
+        NodePtr right = std::move(node->right);
+        node->right = std::move(right->left);
+        right->left = std::move(node);
+        node = std::move(right);
+      }
+      return value;
+    }
+    return node->value.second;
+  }
+
+  // join two treaps, all keys in a being smaller than those in b
+  static NodePtr merge(NodePtr a, NodePtr b)
+  {
+    if (!a)
+      return b;
+    if (!b)
+      return a;
+    if (a->priority > b->priority)
+    {
+      makeUnique(a);
+      a->right = merge(std::move(a->right), std::move(b));
+      return a;
+    }
+    makeUnique(b);
+    b->left = merge(std::move(a), std::move(b->left));
+    return b;
+  }
+
+  NodePtr root_;
+  std::size_t size_;
+  Compare compare_;
+  std::hash<Key> hasher_;
+};
+}  // namespace collision_detection
@@ -37,6 +37,7 @@
 #pragma once
 
 #include <moveit/macros/class_forward.h>
+#include <moveit/collision_detection/persistent_map.h>
 
 #include <string>
 #include <vector>
@@ -64,7 +65,8 @@ public:
 
   /** \brief A copy constructor.
    * \e other should not be changed while the copy constructor is running
-   * This does copy on write and should be quick. */
+   * This does copy on write and takes constant time: the two worlds share all their objects
+   * until one of them modifies an object. */
   World(const World& other);
 
   virtual ~World();
@@ -118,8 +120,8 @@ public:
   /** \brief Get a particular object */
   ObjectConstPtr getObject(const std::string& object_id) const;
 
-  /** iterator over the objects in the world. */
-  using const_iterator = std::map<std::string, ObjectPtr>::const_iterator;
+  /** iterator over the objects in the world. Invalidated by any change to the world. */
+  using const_iterator = PersistentMap<std::string, ObjectPtr>::const_iterator;
   /** iterator pointing to first change */
   const_iterator begin() const
   {
@@ -204,6 +206,34 @@ public:
    * the memory is freed. */
   void clearObjects();
 
+  /** \brief Memory held by one or more worlds, and how much of it they share */
+  struct MemoryUsage
+  {
+    /** \brief Number of distinct objects */
+    std::size_t objects = 0;
+    /** \brief Number of distinct objects that are part of more than one world */
+    std::size_t shared_objects = 0;
+    /** \brief Number of distinct shapes */
+    std::size_t shapes = 0;
+    /** \brief Number of distinct shapes that are part of more than one world */
+    std::size_t shared_shapes = 0;
+    /** \brief Estimated memory of the distinct shapes, in bytes */
+    std::size_t shape_bytes = 0;
+    /** \brief Estimated memory of the distinct shapes that are part of more than one world, in bytes */
+    std::size_t shared_shape_bytes = 0;
+    /** \brief Number of distinct nodes of the object maps */
+    std::size_t map_nodes = 0;
+    /** \brief Number of distinct nodes of the object maps that are part of more than one world */
+    std::size_t shared_map_nodes = 0;
+  };
+
+  /** \brief Get the memory held by this world */
+  MemoryUsage getMemoryUsage() const;
+
+  /** \brief Get the memory held by a set of worlds, e.g. the worlds of a planning scene and its parents.
+   * Objects, shapes and map nodes are counted once no matter how many of the worlds contain them. */
+  static MemoryUsage getMemoryUsage(const std::vector<const World*>& worlds);
+
   enum ActionBits
   {
     UNINITIALIZED = 0,
@@ -285,8 +315,8 @@ private:
   virtual void addToObjectInternal(const ObjectPtr& obj, const shapes::ShapeConstPtr& shape,
                                    const Eigen::Isometry3d& pose);
 
-  /** The objects maintained in the world */
-  std::map<std::string, ObjectPtr> objects_;
+  /** The objects maintained in the world. Copies of the world share the map structure. */
+  PersistentMap<std::string, ObjectPtr> objects_;
 
   /** Wrapper for a callback function to call when something changes in the world */
   class Observer
@@ -35,6 +35,8 @@
 /* Author: Ioan Sucan, Jens Petit */
 
 #include <moveit/collision_detection/collision_env.h>
+#include <moveit/background_processing/thread_pool.h>
+#include <atomic>
 #include <limits>
 
 static inline bool validateScale(double scale)
@@ -304,4 +306,72 @@ void CollisionEnv::checkCollision(const CollisionRequest& req, CollisionResult&
     checkRobotCollision(req, res, state, acm);
 }
 
+int CollisionEnv::checkCollisionBatch(const CollisionRequest& req, std::vector<CollisionResult>& results,
+                                      const std::vector<const moveit::core::RobotState*>& states,
+                                      const AllowedCollisionMatrix& acm, bool first_collision_only) const
+{
+  return checkCollisionBatchHelper(req, results, states, acm, first_collision_only, true, true);
+}
+
+int CollisionEnv::checkSelfCollisionBatch(const CollisionRequest& req, std::vector<CollisionResult>& results,
+                                          const std::vector<const moveit::core::RobotState*>& states,
+                                          const AllowedCollisionMatrix& acm, bool first_collision_only) const
+{
+  return checkCollisionBatchHelper(req, results, states, acm, first_collision_only, true, false);
+}
+
+int CollisionEnv::checkRobotCollisionBatch(const CollisionRequest& req, std::vector<CollisionResult>& results,
+                                           const std::vector<const moveit::core::RobotState*>& states,
+                                           const AllowedCollisionMatrix& acm, bool first_collision_only) const
+{
+  return checkCollisionBatchHelper(req, results, states, acm, first_collision_only, false, true);
+}
+
+CollisionEnv::BatchCheckFn CollisionEnv::createBatchCheckFn(bool self, bool robot, unsigned int /*worker*/) const
+{
+  return [this, self, robot](const CollisionRequest& req, CollisionResult& res, const moveit::core::RobotState& state,
+                             const AllowedCollisionMatrix& acm) {
+    if (self)
+      checkSelfCollision(req, res, state, acm);
+    if (robot && (!self || !res.collision || (req.contacts && res.contacts.size() < req.max_contacts)))
+      checkRobotCollision(req, res, state, acm);
+  };
+}
+
+int CollisionEnv::checkCollisionBatchHelper(const CollisionRequest& req, std::vector<CollisionResult>& results,
+                                            const std::vector<const moveit::core::RobotState*>& states,
+                                            const AllowedCollisionMatrix& acm, bool first_collision_only, bool self,
+                                            bool robot) const
+{
+  results.clear();
+  results.resize(states.size());
+
+  // the workers claim the states in increasing order, so all states before first_collision have been checked
+  std::atomic<std::size_t> next(0);
+  std::atomic<std::size_t> first_collision(states.size());
+  auto check_states = [&](const BatchCheckFn& check) {
+    for (std::size_t i = next++; i < states.size(); i = next++)
+    {
+      if (first_collision_only && i > first_collision)
+        break;
+      check(req, results[i], *states[i], acm);
+      if (results[i].collision)
+      {
+        std::size_t first = first_collision;
+        while (i < first && !first_collision.compare_exchange_weak(first, i))
+          ;
+      }
+    }
+  };
+
+  // with few states, the overhead of distributing them is not worth it
+  moveit::tools::ThreadPool& pool = moveit::tools::ThreadPool::getGlobal();
+  if (states.size() < 2 * pool.getThreadCount())
+    check_states(CollisionEnv::createBatchCheckFn(self, robot, 0));
+  else
+    pool.run([&](unsigned int worker) { check_states(createBatchCheckFn(self, robot, worker)); });
+
+  return first_collision < states.size() ? static_cast<int>(first_collision) : -1;
+}
+
 }  // end of namespace collision_detection
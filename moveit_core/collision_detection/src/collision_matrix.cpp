@@ -44,6 +44,25 @@ AllowedCollisionMatrix::AllowedCollisionMatrix()
 {
 }
 
+AllowedCollisionMatrix::AllowedCollisionMatrix(const AllowedCollisionMatrix& acm)
+  : entries_(acm.entries_)
+  , allowed_contacts_(acm.allowed_contacts_)
+  , default_entries_(acm.default_entries_)
+  , default_allowed_contacts_(acm.default_allowed_contacts_)
+  , compiled_(std::atomic_load(&acm.compiled_))
+{
+}
+
+AllowedCollisionMatrix& AllowedCollisionMatrix::operator=(const AllowedCollisionMatrix& acm)
+{
+  entries_ = acm.entries_;
+  allowed_contacts_ = acm.allowed_contacts_;
+  default_entries_ = acm.default_entries_;
+  default_allowed_contacts_ = acm.default_allowed_contacts_;
+  compiled_ = std::atomic_load(&acm.compiled_);
+  return *this;
+}
+
 AllowedCollisionMatrix::AllowedCollisionMatrix(const std::vector<std::string>& names, bool allowed)
 {
   for (std::size_t i = 0; i < names.size(); ++i)
@@ -114,6 +133,7 @@ bool AllowedCollisionMatrix::hasEntry(const std::string& name1, const std::strin
 
 void AllowedCollisionMatrix::setEntry(const std::string& name1, const std::string& name2, bool allowed)
 {
+  invalidateCompiled();
   const AllowedCollision::Type v = allowed ? AllowedCollision::ALWAYS : AllowedCollision::NEVER;
   entries_[name1][name2] = entries_[name2][name1] = v;
 
@@ -136,12 +156,14 @@ void AllowedCollisionMatrix::setEntry(const std::string& name1, const std::strin
 
 void AllowedCollisionMatrix::setEntry(const std::string& name1, const std::string& name2, const DecideContactFn& fn)
 {
+  invalidateCompiled();
   entries_[name1][name2] = entries_[name2][name1] = AllowedCollision::CONDITIONAL;
   allowed_contacts_[name1][name2] = allowed_contacts_[name2][name1] = fn;
 }
 
 void AllowedCollisionMatrix::removeEntry(const std::string& name)
 {
+  invalidateCompiled();
   entries_.erase(name);
   allowed_contacts_.erase(name);
   for (auto& entry : entries_)
@@ -152,6 +174,7 @@ void AllowedCollisionMatrix::removeEntry(const std::string& name)
 
 void AllowedCollisionMatrix::removeEntry(const std::string& name1, const std::string& name2)
 {
+  invalidateCompiled();
   auto jt = entries_.find(name1);
   if (jt != entries_.end())
   {
@@ -210,6 +233,7 @@ void AllowedCollisionMatrix::setEntry(const std::string& name, bool allowed)
 
 void AllowedCollisionMatrix::setEntry(bool allowed)
 {
+  invalidateCompiled();
   const AllowedCollision::Type v = allowed ? AllowedCollision::ALWAYS : AllowedCollision::NEVER;
   for (auto& entry : entries_)
     for (auto& it2 : entry.second)
@@ -218,6 +242,7 @@ void AllowedCollisionMatrix::setEntry(bool allowed)
 
 void AllowedCollisionMatrix::setDefaultEntry(const std::string& name, bool allowed)
 {
+  invalidateCompiled();
   const AllowedCollision::Type v = allowed ? AllowedCollision::ALWAYS : AllowedCollision::NEVER;
   default_entries_[name] = v;
   default_allowed_contacts_.erase(name);
@@ -225,6 +250,7 @@ void AllowedCollisionMatrix::setDefaultEntry(const std::string& name, bool allow
 
 void AllowedCollisionMatrix::setDefaultEntry(const std::string& name, const DecideContactFn& fn)
 {
+  invalidateCompiled();
   default_entries_[name] = AllowedCollision::CONDITIONAL;
   default_allowed_contacts_[name] = fn;
 }
@@ -307,6 +333,7 @@ bool AllowedCollisionMatrix::getAllowedCollision(const std::string& name1, const
 
 void AllowedCollisionMatrix::clear()
 {
+  invalidateCompiled();
   entries_.clear();
   allowed_contacts_.clear();
   default_entries_.clear();
@@ -409,4 +436,61 @@ void AllowedCollisionMatrix::print(std::ostream& out) const
   }
 }
 
+CompiledAllowedCollisionMatrixConstPtr
+AllowedCollisionMatrix::getCompiled(const moveit::core::RobotModelConstPtr& robot_model) const
+{
+  CompiledAllowedCollisionMatrixConstPtr compiled = std::atomic_load(&compiled_);
+  if (!compiled || compiled->getRobotModel() != robot_model)
+  {
+    // concurrent callers may compile the same matrix; each of them gets a consistent result
+    compiled = std::make_shared<const CompiledAllowedCollisionMatrix>(*this, robot_model);
+    std::atomic_store(&compiled_, compiled);
+  }
+  return compiled;
+}
+
+CompiledAllowedCollisionMatrix::CompiledAllowedCollisionMatrix(const AllowedCollisionMatrix& acm,
+                                                               const moveit::core::RobotModelConstPtr& robot_model)
+  : robot_model_(robot_model)
+{
+  // the robot links come first, ordered by link index
+  names_ = robot_model_->getLinkModelNames();
+  std::vector<std::string> entry_names;
+  acm.getAllEntryNames(entry_names);
+  for (const std::string& name : entry_names)
+    if (!robot_model_->hasLinkModel(name))
+      names_.push_back(name);
+  for (std::size_t i = 0; i < names_.size(); ++i)
+    indices_[names_[i]] = i;
+
+  words_per_row_ = (names_.size() + 63) / 64;
+  found_.resize(names_.size() * words_per_row_, 0);
+  allowed_ = found_;
+  conditional_ = found_;
+
+  for (std::size_t i = 0; i < names_.size(); ++i)
+    for (std::size_t j = i + 1; j < names_.size(); ++j)
+    {
+      AllowedCollision::Type type;
+      if (!acm.getAllowedCollision(names_[i], names_[j], type))
+        continue;
+      setBit(found_, i, j);
+      if (type == AllowedCollision::ALWAYS)
+        setBit(allowed_, i, j);
+      else if (type == AllowedCollision::CONDITIONAL)
+      {
+        setBit(conditional_, i, j);
+        DecideContactFn fn;
+        if (acm.getAllowedCollision(names_[i], names_[j], fn))
+          allowed_contacts_[getPairKey(i, j)] = fn;
+      }
+    }
+}
+
+const DecideContactFn* CompiledAllowedCollisionMatrix::getAllowedContactFn(int index1, int index2) const
+{
+  auto it = allowed_contacts_.find(getPairKey(index1, index2));
+  return it == allowed_contacts_.end() ? nullptr : &it->second;
+}
+
 }  // end of namespace collision_detection
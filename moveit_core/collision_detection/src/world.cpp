@@ -36,18 +36,51 @@
 
 #include <moveit/collision_detection/world.h>
 #include <geometric_shapes/check_isometry.h>
+#include <geometric_shapes/shapes.h>
+#include <octomap/octomap.h>
 #include <boost/algorithm/string/predicate.hpp>
 #include <ros/console.h>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace collision_detection
 {
+namespace
+{
+// estimate the memory held by a shape
+std::size_t estimateShapeBytes(const shapes::Shape& shape)
+{
+  switch (shape.type)
+  {
+    case shapes::MESH:
+    {
+      const shapes::Mesh& mesh = static_cast<const shapes::Mesh&>(shape);
+      std::size_t bytes = sizeof(shapes::Mesh) + mesh.vertex_count * 3 * sizeof(double) +
+                          mesh.triangle_count * 3 * sizeof(unsigned int);
+      if (mesh.triangle_normals)
+        bytes += mesh.triangle_count * 3 * sizeof(double);
+      if (mesh.vertex_normals)
+        bytes += mesh.vertex_count * 3 * sizeof(double);
+      return bytes;
+    }
+    case shapes::OCTREE:
+    {
+      const shapes::OcTree& octree = static_cast<const shapes::OcTree&>(shape);
+      return sizeof(shapes::OcTree) + (octree.octree ? octree.octree->memoryUsage() : 0);
+    }
+    default:
+      // primitives only store a few dimensions
+      return sizeof(shapes::Box);
+  }
+}
+}  // namespace
+
 World::World()
 {
 }
 
-World::World(const World& other)
+World::World(const World& other) : objects_(other.objects_)
 {
-  objects_ = other.objects_;
 }
 
 World::~World()
@@ -142,7 +175,7 @@ bool World::hasObject(const std::string& object_id) const
 bool World::knowsTransform(const std::string& name) const
 {
   // Check object names first
-  std::map<std::string, ObjectPtr>::const_iterator it = objects_.find(name);
+  const_iterator it = objects_.find(name);
   if (it != objects_.end())
     // only accept object name as frame if it is associated to a unique shape
     return !it->second->shape_poses_.empty();
@@ -173,7 +206,7 @@ const Eigen::Isometry3d& World::getTransform(const std::string& name, bool& fram
   // assume found
   frame_found = true;
 
-  std::map<std::string, ObjectPtr>::const_iterator it = objects_.find(name);
+  const_iterator it = objects_.find(name);
   if (it != objects_.end())
   {
     if (!it->second->shape_poses_.empty())
@@ -202,18 +235,18 @@ const Eigen::Isometry3d& World::getTransform(const std::string& name, bool& fram
 bool World::moveShapeInObject(const std::string& object_id, const shapes::ShapeConstPtr& shape,
                               const Eigen::Isometry3d& pose)
 {
-  auto it = objects_.find(object_id);
-  if (it != objects_.end())
+  ObjectPtr* obj = objects_.findMutable(object_id);
+  if (obj)
   {
-    unsigned int n = it->second->shapes_.size();
+    unsigned int n = (*obj)->shapes_.size();
     for (unsigned int i = 0; i < n; ++i)
-      if (it->second->shapes_[i] == shape)
+      if ((*obj)->shapes_[i] == shape)
       {
-        ensureUnique(it->second);
+        ensureUnique(*obj);
         ASSERT_ISOMETRY(pose)  // unsanitized input, could contain a non-isometry
-        it->second->shape_poses_[i] = pose;
+        (*obj)->shape_poses_[i] = pose;
 
-        notify(it->second, MOVE_SHAPE);
+        notify(*obj, MOVE_SHAPE);
         return true;
       }
   }
@@ -222,42 +255,42 @@ bool World::moveShapeInObject(const std::string& object_id, const shapes::ShapeC
 
 bool World::moveObject(const std::string& object_id, const Eigen::Isometry3d& transform)
 {
-  auto it = objects_.find(object_id);
-  if (it == objects_.end())
+  if (objects_.find(object_id) == objects_.end())
     return false;
   if (transform.isApprox(Eigen::Isometry3d::Identity()))
     return true;  // object already at correct location
-  ensureUnique(it->second);
-  for (size_t i = 0, n = it->second->shapes_.size(); i < n; ++i)
+  ObjectPtr& obj = *objects_.findMutable(object_id);
+  ensureUnique(obj);
+  for (size_t i = 0, n = obj->shapes_.size(); i < n; ++i)
   {
     ASSERT_ISOMETRY(transform)  // unsanitized input, could contain a non-isometry
-    it->second->shape_poses_[i] = transform * it->second->shape_poses_[i];
+    obj->shape_poses_[i] = transform * obj->shape_poses_[i];
   }
-  notify(it->second, MOVE_SHAPE);
+  notify(obj, MOVE_SHAPE);
   return true;
 }
 
 bool World::removeShapeFromObject(const std::string& object_id, const shapes::ShapeConstPtr& shape)
 {
-  auto it = objects_.find(object_id);
-  if (it != objects_.end())
+  ObjectPtr* obj = objects_.findMutable(object_id);
+  if (obj)
   {
-    unsigned int n = it->second->shapes_.size();
+    unsigned int n = (*obj)->shapes_.size();
     for (unsigned int i = 0; i < n; ++i)
-      if (it->second->shapes_[i] == shape)
+      if ((*obj)->shapes_[i] == shape)
       {
-        ensureUnique(it->second);
-        it->second->shapes_.erase(it->second->shapes_.begin() + i);
-        it->second->shape_poses_.erase(it->second->shape_poses_.begin() + i);
+        ensureUnique(*obj);
+        (*obj)->shapes_.erase((*obj)->shapes_.begin() + i);
+        (*obj)->shape_poses_.erase((*obj)->shape_poses_.begin() + i);
 
-        if (it->second->shapes_.empty())
+        if ((*obj)->shapes_.empty())
         {
-          notify(it->second, DESTROY);
-          objects_.erase(it);
+          notify(*obj, DESTROY);
+          objects_.erase(object_id);
         }
         else
         {
-          notify(it->second, REMOVE_SHAPE);
+          notify(*obj, REMOVE_SHAPE);
         }
         return true;
       }
@@ -267,11 +300,11 @@ bool World::removeShapeFromObject(const std::string& object_id, const shapes::Sh
 
 bool World::removeObject(const std::string& object_id)
 {
-  auto it = objects_.find(object_id);
+  const_iterator it = objects_.find(object_id);
   if (it != objects_.end())
   {
     notify(it->second, DESTROY);
-    objects_.erase(it);
+    objects_.erase(object_id);
     return true;
   }
   return false;
@@ -285,8 +318,8 @@ void World::clearObjects()
 
 bool World::setSubframesOfObject(const std::string& object_id, const moveit::core::FixedTransformsMap& subframe_poses)
 {
-  auto obj_pair = objects_.find(object_id);
-  if (obj_pair == objects_.end())
+  ObjectPtr* obj = objects_.findMutable(object_id);
+  if (!obj)
   {
     return false;
   }
@@ -294,10 +327,52 @@ bool World::setSubframesOfObject(const std::string& object_id, const moveit::cor
   {
     ASSERT_ISOMETRY(t.second)  // unsanitized input, could contain a non-isometry
   }
-  obj_pair->second->subframe_poses_ = subframe_poses;
+  ensureUnique(*obj);
+  (*obj)->subframe_poses_ = subframe_poses;
   return true;
 }
 
+World::MemoryUsage World::getMemoryUsage() const
+{
+  return getMemoryUsage(std::vector<const World*>(1, this));
+}
+
+World::MemoryUsage World::getMemoryUsage(const std::vector<const World*>& worlds)
+{
+  MemoryUsage usage;
+
+  // the number of worlds each node, object and shape is part of
+  std::unordered_map<const void*, std::size_t> node_worlds;
+  std::unordered_map<const Object*, std::size_t> object_worlds;
+  std::unordered_map<const shapes::Shape*, std::size_t> shape_worlds;
+
+  for (const World* world : worlds)
+  {
+    std::unordered_set<const Object*> objects;
+    std::unordered_set<const shapes::Shape*> shapes;
+    world->objects_.visitNodes([&](const void* node, const std::pair<const std::string, ObjectPtr>& entry) {
+      if (++node_worlds[node] == 2)
+        ++usage.shared_map_nodes;
+      if (objects.insert(entry.second.get()).second && ++object_worlds[entry.second.get()] == 2)
+        ++usage.shared_objects;
+      for (const shapes::ShapeConstPtr& shape : entry.second->shapes_)
+        if (shapes.insert(shape.get()).second && ++shape_worlds[shape.get()] == 2)
+        {
+          ++usage.shared_shapes;
+          usage.shared_shape_bytes += estimateShapeBytes(*shape);
+        }
+      return true;
+    });
+  }
+
+  usage.map_nodes = node_worlds.size();
+  usage.objects = object_worlds.size();
+  usage.shapes = shape_worlds.size();
+  for (const std::pair<const shapes::Shape* const, std::size_t>& shape : shape_worlds)
+    usage.shape_bytes += estimateShapeBytes(*shape.first);
+  return usage;
+}
+
 World::ObserverHandle World::addObserver(const ObserverCallbackFn& callback)
 {
   auto o = new Observer(callback);
@@ -320,7 +395,7 @@ void World::removeObserver(ObserverHandle observer_handle)
 
 void World::notifyAll(Action action)
 {
-  for (std::map<std::string, ObjectPtr>::const_iterator it = objects_.begin(); it != objects_.end(); ++it)
+  for (const_iterator it = objects_.begin(); it != objects_.end(); ++it)
     notify(it->second, action);
 }
 
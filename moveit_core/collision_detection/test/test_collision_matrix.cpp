@@ -0,0 +1,105 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, MoveIt maintainers
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <gtest/gtest.h>
+#include <moveit/collision_detection/collision_matrix.h>
+#include <moveit/utils/robot_model_test_utils.h>
+
+using namespace collision_detection;
+
+static bool allowIfDeep(Contact& contact)
+{
+  return contact.depth > 0.1;
+}
+
+/** \brief The compiled matrix answers every query like the matrix it was compiled from */
+TEST(CompiledAllowedCollisionMatrix, MatchesAllowedCollisionMatrix)
+{
+  moveit::core::RobotModelConstPtr robot_model = moveit::core::loadTestingRobotModel("panda");
+  const std::vector<std::string>& links = robot_model->getLinkModelNames();
+
+  AllowedCollisionMatrix acm(links, false);
+  acm.setEntry("panda_link0", "panda_link1", true);
+  acm.setEntry("panda_hand", "panda_leftfinger", true);
+  acm.setEntry("panda_hand", "box", DecideContactFn(&allowIfDeep));
+  acm.setEntry("box", "panda_link0", true);
+  acm.setDefaultEntry("sphere", false);
+  acm.setDefaultEntry("panda_rightfinger", true);
+
+  CompiledAllowedCollisionMatrixConstPtr compiled = acm.getCompiled(robot_model);
+  ASSERT_TRUE(compiled);
+  EXPECT_EQ(compiled.get(), acm.getCompiled(robot_model).get());
+  EXPECT_EQ(compiled->getIndex("panda_link3"), robot_model->getLinkModel("panda_link3")->getLinkIndex());
+  EXPECT_GE(compiled->getIndex("box"), static_cast<int>(links.size()));
+  EXPECT_EQ(compiled->getIndex("unknown"), -1);
+
+  std::vector<std::string> names = links;
+  names.push_back("box");
+  for (const std::string& name1 : names)
+    for (const std::string& name2 : names)
+    {
+      if (name1 == name2)
+        continue;
+      AllowedCollision::Type type, compiled_type;
+      bool found = acm.getAllowedCollision(name1, name2, type);
+      bool compiled_found =
+          compiled->getAllowedCollision(compiled->getIndex(name1), compiled->getIndex(name2), compiled_type);
+      ASSERT_EQ(found, compiled_found) << name1 << " - " << name2;
+      if (found)
+        EXPECT_EQ(type, compiled_type) << name1 << " - " << name2;
+    }
+
+  const int hand = compiled->getIndex("panda_hand");
+  const int box = compiled->getIndex("box");
+  const DecideContactFn* fn = compiled->getAllowedContactFn(box, hand);
+  ASSERT_NE(fn, nullptr);
+  Contact contact;
+  contact.depth = 0.2;
+  EXPECT_TRUE((*fn)(contact));
+  EXPECT_EQ(compiled->getAllowedContactFn(hand, compiled->getIndex("panda_link0")), nullptr);
+
+  // modifications invalidate the compiled matrix
+  acm.setEntry("panda_link0", "panda_link1", false);
+  CompiledAllowedCollisionMatrixConstPtr recompiled = acm.getCompiled(robot_model);
+  AllowedCollision::Type type;
+  ASSERT_TRUE(recompiled->getAllowedCollision(recompiled->getIndex("panda_link0"), recompiled->getIndex("panda_link1"),
+                                              type));
+  EXPECT_EQ(type, AllowedCollision::NEVER);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
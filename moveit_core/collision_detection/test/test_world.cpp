@@ -38,6 +38,8 @@
 #include <moveit/collision_detection/world.h>
 #include <geometric_shapes/shapes.h>
 #include <boost/bind.hpp>
+#include <map>
+#include <random>
 
 TEST(World, AddRemoveShape)
 {
@@ -365,6 +367,130 @@ TEST(World, TrackChanges)
   EXPECT_EQ(4, ta3.cnt_);
 }
 
+TEST(World, CopyOnWrite)
+{
+  collision_detection::World world;
+  shapes::ShapePtr ball(new shapes::Sphere(1.0));
+  shapes::ShapePtr box(new shapes::Box(1, 2, 3));
+  for (int i = 0; i < 100; ++i)
+    world.addToObject("obj" + std::to_string(i), ball, Eigen::Isometry3d::Identity());
+
+  collision_detection::World copy(world);
+  EXPECT_EQ(world.size(), copy.size());
+  // the copy shares all objects
+  EXPECT_EQ(world.getObject("obj5"), copy.getObject("obj5"));
+
+  copy.moveShapeInObject("obj5", ball, Eigen::Isometry3d(Eigen::Translation3d(0, 0, 1)));
+  copy.addToObject("obj7", box, Eigen::Isometry3d::Identity());
+  copy.setSubframesOfObject("obj8", moveit::core::FixedTransformsMap{ { "tip", Eigen::Isometry3d::Identity() } });
+  copy.removeObject("obj9");
+  copy.addToObject("new", box, Eigen::Isometry3d::Identity());
+
+  // the original world is not changed
+  EXPECT_EQ(100u, world.size());
+  EXPECT_TRUE(world.hasObject("obj9"));
+  EXPECT_FALSE(world.hasObject("new"));
+  EXPECT_TRUE(world.getObject("obj5")->shape_poses_[0].isApprox(Eigen::Isometry3d::Identity()));
+  EXPECT_EQ(1u, world.getObject("obj7")->shapes_.size());
+  EXPECT_TRUE(world.getObject("obj8")->subframe_poses_.empty());
+
+  EXPECT_EQ(100u, copy.size());
+  EXPECT_FALSE(copy.hasObject("obj9"));
+  EXPECT_TRUE(copy.hasObject("new"));
+  EXPECT_FALSE(copy.getObject("obj5")->shape_poses_[0].isApprox(Eigen::Isometry3d::Identity()));
+  EXPECT_EQ(2u, copy.getObject("obj7")->shapes_.size());
+  EXPECT_EQ(1u, copy.getObject("obj8")->subframe_poses_.size());
+
+  // unchanged objects are still shared
+  EXPECT_EQ(world.getObject("obj6"), copy.getObject("obj6"));
+  EXPECT_NE(world.getObject("obj5"), copy.getObject("obj5"));
+
+  // iteration is ordered by id
+  std::vector<std::string> ids;
+  for (const std::pair<const std::string, collision_detection::World::ObjectPtr>& object : copy)
+    ids.push_back(object.first);
+  EXPECT_EQ(copy.getObjectIds(), ids);
+  EXPECT_TRUE(std::is_sorted(ids.begin(), ids.end()));
+}
+
+TEST(World, MemoryUsage)
+{
+  collision_detection::World world;
+  shapes::ShapePtr ball(new shapes::Sphere(1.0));
+  for (int i = 0; i < 50; ++i)
+    world.addToObject("obj" + std::to_string(i), shapes::ShapePtr(new shapes::Box(1, 2, 3)),
+                      Eigen::Isometry3d::Identity());
+
+  collision_detection::World::MemoryUsage usage = world.getMemoryUsage();
+  EXPECT_EQ(50u, usage.objects);
+  EXPECT_EQ(50u, usage.shapes);
+  EXPECT_EQ(50u, usage.map_nodes);
+  EXPECT_EQ(0u, usage.shared_objects);
+  EXPECT_EQ(0u, usage.shared_shapes);
+  EXPECT_GT(usage.shape_bytes, 0u);
+
+  collision_detection::World copy(world);
+  copy.addToObject("obj0", ball, Eigen::Isometry3d::Identity());
+  copy.addToObject("new", ball, Eigen::Isometry3d::Identity());
+
+  usage = collision_detection::World::getMemoryUsage({ &world, &copy });
+  EXPECT_EQ(52u, usage.objects);  // obj0 was copied, "new" was added
+  EXPECT_EQ(49u, usage.shared_objects);
+  EXPECT_EQ(51u, usage.shapes);
+  EXPECT_EQ(50u, usage.shared_shapes);  // the box of obj0 is part of both versions of obj0
+  EXPECT_LT(usage.shared_map_nodes, usage.map_nodes);
+  EXPECT_LE(usage.shared_shape_bytes, usage.shape_bytes);
+}
+
+TEST(PersistentMap, CompareToMap)
+{
+  std::mt19937 generator(42);
+  std::uniform_int_distribution<int> key_distribution(0, 200);
+  std::uniform_int_distribution<int> operation(0, 2);
+
+  std::vector<collision_detection::PersistentMap<int, int>> versions(1);
+  std::vector<std::map<int, int>> expected(1);
+  for (int i = 0; i < 5000; ++i)
+  {
+    // continue from a random earlier version, which must not be changed by this
+    const std::size_t base = std::uniform_int_distribution<std::size_t>(0, versions.size() - 1)(generator);
+    collision_detection::PersistentMap<int, int> map(versions[base]);
+    std::map<int, int> reference(expected[base]);
+
+    const int key = key_distribution(generator);
+    switch (operation(generator))
+    {
+      case 0:
+        map[key] = i;
+        reference[key] = i;
+        break;
+      case 1:
+        EXPECT_EQ(reference.erase(key) > 0, map.erase(key));
+        break;
+      default:
+        if (int* value = map.findMutable(key))
+          *value = -i;
+        if (reference.count(key))
+          reference[key] = -i;
+    }
+    versions.push_back(map);
+    expected.push_back(reference);
+  }
+
+  for (std::size_t i = 0; i < versions.size(); ++i)
+  {
+    ASSERT_EQ(expected[i].size(), versions[i].size());
+    EXPECT_TRUE(std::equal(expected[i].begin(), expected[i].end(), versions[i].begin()));
+    for (int key = 0; key <= 200; ++key)
+    {
+      auto it = versions[i].find(key);
+      ASSERT_EQ(expected[i].count(key) > 0, it != versions[i].end());
+      if (it != versions[i].end())
+        EXPECT_EQ(expected[i][key], it->second);
+    }
+  }
+}
+
 int main(int argc, char** argv)
 {
   testing::InitGoogleTest(&argc, argv);
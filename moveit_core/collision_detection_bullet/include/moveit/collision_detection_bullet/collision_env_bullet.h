@@ -39,6 +39,7 @@
 #include <moveit/collision_detection/collision_env.h>
 #include <moveit/collision_detection_bullet/bullet_integration/bullet_discrete_bvh_manager.h>
 #include <moveit/collision_detection_bullet/bullet_integration/bullet_cast_bvh_manager.h>
+#include <boost/thread/mutex.hpp>
 
 namespace collision_detection
 {
@@ -98,16 +99,22 @@ protected:
   void addAttachedOjects(const moveit::core::RobotState& state,
                          std::vector<collision_detection_bullet::CollisionObjectWrapperPtr>& cows) const;
 
+  /** \brief Check the states of a batch with a copy of the manager owned by each worker thread, which is kept for
+   *   the following batches until the manager changes */
+  BatchCheckFn createBatchCheckFn(bool self, bool robot, unsigned int worker) const override;
+
   /** \brief Bundles the different checkSelfCollision functions into a single function */
   void checkSelfCollisionHelper(const CollisionRequest& req, CollisionResult& res,
-                                const moveit::core::RobotState& state, const AllowedCollisionMatrix* acm) const;
+                                const moveit::core::RobotState& state, const AllowedCollisionMatrix* acm,
+                                const collision_detection_bullet::BulletDiscreteBVHManagerPtr& manager) const;
 
   void checkRobotCollisionHelperCCD(const CollisionRequest& req, CollisionResult& res,
                                     const moveit::core::RobotState& state1, const moveit::core::RobotState& state2,
                                     const AllowedCollisionMatrix* acm) const;
 
   void checkRobotCollisionHelper(const CollisionRequest& req, CollisionResult& res,
-                                 const moveit::core::RobotState& state, const AllowedCollisionMatrix* acm) const;
+                                 const moveit::core::RobotState& state, const AllowedCollisionMatrix* acm,
+                                 const collision_detection_bullet::BulletDiscreteBVHManagerPtr& manager) const;
 
   /** \brief Construts a bullet collision object out of a robot link */
   void addLinkAsCollisionObject(const urdf::LinkSharedPtr& link);
@@ -117,6 +124,14 @@ protected:
     new collision_detection_bullet::BulletDiscreteBVHManager()
   };
 
+  /** \brief The copies of \e manager_ used by the workers of the batch checks, by worker index; null if the worker
+   *   did not clone the current manager yet */
+  mutable std::vector<collision_detection_bullet::BulletDiscreteBVHManagerPtr> worker_managers_;
+  mutable boost::mutex worker_managers_lock_;
+
+  /** \brief Drop the copies of the manager of the workers after it changed */
+  void resetWorkerManagers();
+
   /** \brief Handles continuous robot world collision checks */
   mutable collision_detection_bullet::BulletCastBVHManagerPtr manager_CCD_{
     new collision_detection_bullet::BulletCastBVHManager()
@@ -96,60 +96,60 @@ CollisionEnvBullet::~CollisionEnvBullet()
 void CollisionEnvBullet::checkSelfCollision(const CollisionRequest& req, CollisionResult& res,
                                             const moveit::core::RobotState& state) const
 {
-  checkSelfCollisionHelper(req, res, state, nullptr);
+  checkSelfCollisionHelper(req, res, state, nullptr, manager_);
 }
 
 void CollisionEnvBullet::checkSelfCollision(const CollisionRequest& req, CollisionResult& res,
                                             const moveit::core::RobotState& state,
                                             const AllowedCollisionMatrix& acm) const
 {
-  checkSelfCollisionHelper(req, res, state, &acm);
+  checkSelfCollisionHelper(req, res, state, &acm, manager_);
 }
 
-void CollisionEnvBullet::checkSelfCollisionHelper(const CollisionRequest& req, CollisionResult& res,
-                                                  const moveit::core::RobotState& state,
-                                                  const AllowedCollisionMatrix* acm) const
+void CollisionEnvBullet::checkSelfCollisionHelper(
+    const CollisionRequest& req, CollisionResult& res, const moveit::core::RobotState& state,
+    const AllowedCollisionMatrix* acm, const collision_detection_bullet::BulletDiscreteBVHManagerPtr& manager) const
 {
   std::vector<collision_detection_bullet::CollisionObjectWrapperPtr> cows;
   addAttachedOjects(state, cows);
 
   if (req.distance)
   {
-    manager_->setContactDistanceThreshold(MAX_DISTANCE_MARGIN);
+    manager->setContactDistanceThreshold(MAX_DISTANCE_MARGIN);
   }
 
   for (const collision_detection_bullet::CollisionObjectWrapperPtr& cow : cows)
   {
-    manager_->addCollisionObject(cow);
-    manager_->setCollisionObjectsTransform(
+    manager->addCollisionObject(cow);
+    manager->setCollisionObjectsTransform(
         cow->getName(), state.getAttachedBody(cow->getName())->getGlobalCollisionBodyTransforms()[0]);
   }
 
   // updating link positions with the current robot state
   for (const std::string& link : active_)
   {
-    manager_->setCollisionObjectsTransform(link, state.getCollisionBodyTransform(link, 0));
+    manager->setCollisionObjectsTransform(link, state.getCollisionBodyTransform(link, 0));
   }
 
-  manager_->contactTest(res, req, acm, true);
+  manager->contactTest(res, req, acm, true);
 
   for (const collision_detection_bullet::CollisionObjectWrapperPtr& cow : cows)
   {
-    manager_->removeCollisionObject(cow->getName());
+    manager->removeCollisionObject(cow->getName());
   }
 }
 
 void CollisionEnvBullet::checkRobotCollision(const CollisionRequest& req, CollisionResult& res,
                                              const moveit::core::RobotState& state) const
 {
-  checkRobotCollisionHelper(req, res, state, nullptr);
+  checkRobotCollisionHelper(req, res, state, nullptr, manager_);
 }
 
 void CollisionEnvBullet::checkRobotCollision(const CollisionRequest& req, CollisionResult& res,
                                              const moveit::core::RobotState& state,
                                              const AllowedCollisionMatrix& acm) const
 {
-  checkRobotCollisionHelper(req, res, state, &acm);
+  checkRobotCollisionHelper(req, res, state, &acm, manager_);
 }
 
 void CollisionEnvBullet::checkRobotCollision(const CollisionRequest& req, CollisionResult& res,
@@ -167,34 +167,59 @@ void CollisionEnvBullet::checkRobotCollision(const CollisionRequest& req, Collis
   checkRobotCollisionHelperCCD(req, res, state1, state2, &acm);
 }
 
-void CollisionEnvBullet::checkRobotCollisionHelper(const CollisionRequest& req, CollisionResult& res,
-                                                   const moveit::core::RobotState& state,
-                                                   const AllowedCollisionMatrix* acm) const
+void CollisionEnvBullet::checkRobotCollisionHelper(
+    const CollisionRequest& req, CollisionResult& res, const moveit::core::RobotState& state,
+    const AllowedCollisionMatrix* acm, const collision_detection_bullet::BulletDiscreteBVHManagerPtr& manager) const
 {
   if (req.distance)
   {
-    manager_->setContactDistanceThreshold(MAX_DISTANCE_MARGIN);
+    manager->setContactDistanceThreshold(MAX_DISTANCE_MARGIN);
   }
 
   std::vector<collision_detection_bullet::CollisionObjectWrapperPtr> attached_cows;
   addAttachedOjects(state, attached_cows);
-  updateTransformsFromState(state, manager_);
+  updateTransformsFromState(state, manager);
 
   for (const collision_detection_bullet::CollisionObjectWrapperPtr& cow : attached_cows)
   {
-    manager_->addCollisionObject(cow);
-    manager_->setCollisionObjectsTransform(
+    manager->addCollisionObject(cow);
+    manager->setCollisionObjectsTransform(
         cow->getName(), state.getAttachedBody(cow->getName())->getGlobalCollisionBodyTransforms()[0]);
   }
 
-  manager_->contactTest(res, req, acm, false);
+  manager->contactTest(res, req, acm, false);
 
   for (const collision_detection_bullet::CollisionObjectWrapperPtr& cow : attached_cows)
   {
-    manager_->removeCollisionObject(cow->getName());
+    manager->removeCollisionObject(cow->getName());
   }
 }
 
+CollisionEnv::BatchCheckFn CollisionEnvBullet::createBatchCheckFn(bool self, bool robot, unsigned int worker) const
+{
+  // the manager is modified during the checks, so every worker uses its own copy
+  collision_detection_bullet::BulletDiscreteBVHManagerPtr manager;
+  {
+    boost::mutex::scoped_lock slock(worker_managers_lock_);
+    if (worker_managers_.size() <= worker)
+      worker_managers_.resize(worker + 1);
+    manager = worker_managers_[worker];
+  }
+  if (!manager)
+  {
+    manager = manager_->clone();
+    boost::mutex::scoped_lock slock(worker_managers_lock_);
+    worker_managers_[worker] = manager;
+  }
+  return [this, manager, self, robot](const CollisionRequest& req, CollisionResult& res,
+                                      const moveit::core::RobotState& state, const AllowedCollisionMatrix& acm) {
+    if (self)
+      checkSelfCollisionHelper(req, res, state, &acm, manager);
+    if (robot && (!self || !res.collision || (req.contacts && res.contacts.size() < req.max_contacts)))
+      checkRobotCollisionHelper(req, res, state, &acm, manager);
+  };
+}
+
 void CollisionEnvBullet::checkRobotCollisionHelperCCD(const CollisionRequest& req, CollisionResult& res,
                                                       const moveit::core::RobotState& state1,
                                                       const moveit::core::RobotState& state2,
@@ -300,8 +325,15 @@ void CollisionEnvBullet::setWorld(const WorldPtr& world)
   getWorld()->notifyObserverAllObjects(observer_handle_, World::CREATE);
 }
 
+void CollisionEnvBullet::resetWorkerManagers()
+{
+  boost::mutex::scoped_lock slock(worker_managers_lock_);
+  worker_managers_.clear();
+}
+
 void CollisionEnvBullet::notifyObjectChange(const ObjectConstPtr& obj, World::Action action)
 {
+  resetWorkerManagers();
   if (action == World::DESTROY)
   {
     manager_->removeCollisionObject(obj->id_);
@@ -343,6 +375,7 @@ void CollisionEnvBullet::addAttachedOjects(const moveit::core::RobotState& state
 
 void CollisionEnvBullet::updatedPaddingOrScaling(const std::vector<std::string>& links)
 {
+  resetWorkerManagers();
   for (const std::string& link : links)
   {
     if (robot_model_->getURDF()->links_.find(link) != robot_model_->getURDF()->links_.end())
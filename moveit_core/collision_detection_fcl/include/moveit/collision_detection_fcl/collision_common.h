@@ -156,6 +156,9 @@ struct CollisionData
   /** \brief Compute \e active_components_only_ based on the joint group specified in \e req_ */
   void enableGroup(const moveit::core::RobotModelConstPtr& robot_model);
 
+  /** \brief Compute \e compiled_acm_ from \e acm_ (if any) for constant time queries in the collision callback */
+  void compileACM(const moveit::core::RobotModelConstPtr& robot_model);
+
   /** \brief The collision request passed by the user */
   const CollisionRequest* req_;
 
@@ -171,6 +174,9 @@ struct CollisionData
   /** \brief The user-specified collision matrix (may be NULL). */
   const AllowedCollisionMatrix* acm_;
 
+  /** \brief Indexed representation of \e acm_, used for all elements it knows (may be NULL). */
+  CompiledAllowedCollisionMatrixConstPtr compiled_acm_;
+
   /** \brief Flag indicating whether collision checking is complete. */
   bool done_;
 };
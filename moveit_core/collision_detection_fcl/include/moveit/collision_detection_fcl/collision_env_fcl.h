@@ -45,6 +45,9 @@
 #include <fcl/broadphase/broadphase.h>
 #endif
 
+#include <atomic>
+#include <cstdint>
+#include <map>
 #include <memory>
 
 namespace collision_detection
@@ -90,7 +93,56 @@ public:
 
   void setWorld(const WorldPtr& world) override;
 
+  /** \brief Enable or disable reusing a broadphase manager of the robot links across checks (enabled by default).
+   *
+   *   When enabled, every thread keeps its own manager of the robot links and only updates the links that moved
+   *   since the previous check of that thread, instead of constructing all robot collision objects for every check. */
+  void setUsePersistentBroadPhase(bool enable);
+
+  /** \brief Check whether the robot links are kept in a persistent broadphase manager */
+  bool getUsePersistentBroadPhase() const
+  {
+    return use_persistent_broadphase_;
+  }
+
+  /** \brief Set the distance below which the continuous collision check between two states reports a collision.
+   *
+   *   The continuous check advances along the segment by steps that are guaranteed not to move any point of the
+   *   robot further than its current distance to the world, so the segment is collision free up to this tolerance.
+   *   Smaller values make the check more exact but require more distance queries close to obstacles. A collision is
+   *   reported with a single contact, between the closest bodies at the first step that got closer than the
+   *   tolerance; its percent_interpolation tells where along the segment that step is. */
+  void setContinuousCollisionTolerance(double tolerance)
+  {
+    ccd_tolerance_ = tolerance;
+  }
+
+  /** \brief Get the distance below which the continuous collision check reports a collision */
+  double getContinuousCollisionTolerance() const
+  {
+    return ccd_tolerance_;
+  }
+
+  /** \brief Compute an upper bound on the distance any point of the robot geometry (including attached bodies)
+   *   travels when linearly interpolating from \e state1 to \e state2 */
+  double getMotionBound(const moveit::core::RobotState& state1, const moveit::core::RobotState& state2) const;
+
 protected:
+  /** \brief The collision objects of the robot links and the broadphase manager they are registered to, which
+   *   are kept across checks of one thread. They are owned by that thread, which keeps the ones of the environments
+   *   it used most recently. */
+  struct RobotBroadPhase
+  {
+    /** \brief Dynamic AABB tree containing the objects in \e link_objects_ */
+    std::unique_ptr<fcl::BroadPhaseCollisionManagerd> manager_;
+
+    /** \brief The collision objects of the link geometries; same order as robot_geoms_, null for missing geometries */
+    std::vector<FCLCollisionObjectPtr> link_objects_;
+
+    /** \brief The collision body transforms the objects in \e link_objects_ were last updated to */
+    EigenSTL::vector_Isometry3d transforms_;
+  };
+
   /** \brief Updates the FCL collision geometry and objects saved in the CollisionRobotFCL members to reflect a new
    *   padding or scaling of the robot links.
    *
@@ -108,6 +160,14 @@ protected:
   void checkRobotCollisionHelper(const CollisionRequest& req, CollisionResult& res,
                                  const moveit::core::RobotState& state, const AllowedCollisionMatrix* acm) const;
 
+  /** \brief Continuous collision check of the robot against the world along the segment from \e state1 to \e state2.
+   *
+   *   Implemented by conservative advancement: the segment is traversed by steps computed from the distance of the
+   *   robot to the world and the motion bound of the segment, so no collision can be missed between two steps. */
+  void checkRobotCollisionHelperCCD(const CollisionRequest& req, CollisionResult& res,
+                                    const moveit::core::RobotState& state1, const moveit::core::RobotState& state2,
+                                    const AllowedCollisionMatrix* acm) const;
+
   /** \brief Construct an FCL collision object from MoveIt's World::Object. */
   void constructFCLObjectWorld(const World::Object* obj, FCLObject& fcl_obj) const;
 
@@ -126,6 +186,15 @@ protected:
    *   \param fcl_obj The newly filled object */
   void constructFCLObjectRobot(const moveit::core::RobotState& state, FCLObject& fcl_obj) const;
 
+  /** \brief Construct the FCL collision objects for the attached bodies of \e state and append them to \e fcl_obj */
+  void constructFCLObjectAttachedBodies(const moveit::core::RobotState& state, FCLObject& fcl_obj) const;
+
+  /** \brief Get the persistent broadphase of the calling thread with the robot links moved to \e state.
+   *
+   *   Only the collision objects of link geometries whose transforms changed since the previous call of the same thread
+   *   are updated in the manager. Attached bodies are not included. */
+  RobotBroadPhase& getRobotBroadPhase(const moveit::core::RobotState& state) const;
+
   /** \brief Prepares for the collision check through constructing an FCL collision object out of the current robot
    *   state and specifying a broadphase collision manager of FCL where the constructed object is registered to. */
   void allocSelfCollisionBroadPhase(const moveit::core::RobotState& state, FCLManager& manager) const;
@@ -150,6 +219,20 @@ protected:
 
   std::map<std::string, FCLObject> fcl_objs_;
 
+  /** \brief Whether the robot links are kept in the persistent broadphases */
+  bool use_persistent_broadphase_ = true;
+
+  /** \brief The distance below which the continuous collision check reports a collision */
+  double ccd_tolerance_ = 1e-3;
+
+  /** \brief Identifies the persistent broadphases of the robot links valid for this environment. It is unique
+   *   among all environments and replaced when the robot geometry changes, which invalidates the broadphases the
+   *   threads keep for this environment. */
+  std::atomic<std::uint64_t> robot_broadphase_generation_;
+
+  /** \brief Invalidate the persistent broadphases of the robot links of all threads */
+  void invalidateRobotBroadPhases();
+
 private:
   /** \brief Callback function executed for each change to the world environment */
   void notifyObjectChange(const ObjectConstPtr& obj, World::Action action);
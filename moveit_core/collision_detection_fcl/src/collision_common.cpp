@@ -52,6 +52,17 @@
 
 namespace collision_detection
 {
+namespace
+{
+/** \brief Index of the element of \e cd in \e acm; links are indexed by their link index, -1 for unknown elements */
+int getCompiledACMIndex(const CompiledAllowedCollisionMatrix& acm, const CollisionGeometryData& cd)
+{
+  if (cd.type == BodyTypes::ROBOT_LINK)
+    return cd.ptr.link->getLinkIndex();
+  return acm.getIndex(cd.getID());
+}
+}  // namespace
+
 bool collisionCallback(fcl::CollisionObjectd* o1, fcl::CollisionObjectd* o2, void* data)
 {
   CollisionData* cdata = reinterpret_cast<CollisionData*>(data);
@@ -87,8 +98,13 @@ bool collisionCallback(fcl::CollisionObjectd* o1, fcl::CollisionObjectd* o2, voi
   bool always_allow_collision = false;
   if (cdata->acm_)
   {
+    // prefer the constant time lookup of the compiled matrix if it knows both elements
+    const int index1 = cdata->compiled_acm_ ? getCompiledACMIndex(*cdata->compiled_acm_, *cd1) : -1;
+    const int index2 = index1 >= 0 ? getCompiledACMIndex(*cdata->compiled_acm_, *cd2) : -1;
+
     AllowedCollision::Type type;
-    bool found = cdata->acm_->getAllowedCollision(cd1->getID(), cd2->getID(), type);
+    bool found = index2 >= 0 ? cdata->compiled_acm_->getAllowedCollision(index1, index2, type) :
+                               cdata->acm_->getAllowedCollision(cd1->getID(), cd2->getID(), type);
     if (found)
     {
       // if we have an entry in the collision matrix, we read it
@@ -104,7 +120,13 @@ bool collisionCallback(fcl::CollisionObjectd* o1, fcl::CollisionObjectd* o2, voi
       }
       else if (type == AllowedCollision::CONDITIONAL)
       {
-        cdata->acm_->getAllowedCollision(cd1->getID(), cd2->getID(), dcf);
+        if (index2 >= 0)
+        {
+          if (const DecideContactFn* fn = cdata->compiled_acm_->getAllowedContactFn(index1, index2))
+            dcf = *fn;
+        }
+        else
+          cdata->acm_->getAllowedCollision(cd1->getID(), cd2->getID(), dcf);
         if (cdata->req_->verbose)
           ROS_DEBUG_NAMED("collision_detection.fcl", "Collision between '%s' and '%s' is conditionally allowed",
                           cd1->getID().c_str(), cd2->getID().c_str());
@@ -936,6 +958,14 @@ void CollisionData::enableGroup(const moveit::core::RobotModelConstPtr& robot_mo
     active_components_only_ = nullptr;
 }
 
+void CollisionData::compileACM(const moveit::core::RobotModelConstPtr& robot_model)
+{
+  if (acm_)
+    compiled_acm_ = acm_->getCompiled(robot_model);
+  else
+    compiled_acm_.reset();
+}
+
 void FCLObject::registerTo(fcl::BroadPhaseCollisionManagerd* manager)
 {
   std::vector<fcl::CollisionObjectd*> collision_objects(collision_objects_.size());
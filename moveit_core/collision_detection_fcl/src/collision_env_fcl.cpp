@@ -39,6 +39,7 @@
 #include <moveit/collision_detection_fcl/collision_common.h>
 
 #include <moveit/collision_detection_fcl/fcl_compat.h>
+#include <geometric_shapes/shape_operations.h>
 
 #if (MOVEIT_FCL_VERSION >= FCL_VERSION_CHECK(0, 6, 0))
 #include <fcl/broadphase/broadphase_dynamic_AABB_tree.h>
@@ -49,8 +50,16 @@ namespace collision_detection
 const std::string CollisionDetectorAllocatorFCL::NAME("FCL");
 constexpr char LOGNAME[] = "collision_detection.fcl";
 
+namespace
+{
+std::atomic<std::uint64_t> next_robot_broadphase_generation(1);
+
+// number of environments a thread keeps the persistent broadphases for
+constexpr std::size_t THREAD_BROADPHASE_COUNT = 8;
+}  // namespace
+
 CollisionEnvFCL::CollisionEnvFCL(const moveit::core::RobotModelConstPtr& model, double padding, double scale)
-  : CollisionEnv(model, padding, scale)
+  : CollisionEnv(model, padding, scale), robot_broadphase_generation_(next_robot_broadphase_generation++)
 {
   const std::vector<const moveit::core::LinkModel*>& links = robot_model_->getLinkModelsWithCollisionGeometry();
   std::size_t index;
@@ -88,7 +97,7 @@ CollisionEnvFCL::CollisionEnvFCL(const moveit::core::RobotModelConstPtr& model,
 
 CollisionEnvFCL::CollisionEnvFCL(const moveit::core::RobotModelConstPtr& model, const WorldPtr& world, double padding,
                                  double scale)
-  : CollisionEnv(model, world, padding, scale)
+  : CollisionEnv(model, world, padding, scale), robot_broadphase_generation_(next_robot_broadphase_generation++)
 {
   const std::vector<const moveit::core::LinkModel*>& links = robot_model_->getLinkModelsWithCollisionGeometry();
   std::size_t index;
@@ -129,10 +138,13 @@ CollisionEnvFCL::~CollisionEnvFCL()
   getWorld()->removeObserver(observer_handle_);
 }
 
-CollisionEnvFCL::CollisionEnvFCL(const CollisionEnvFCL& other, const WorldPtr& world) : CollisionEnv(other, world)
+CollisionEnvFCL::CollisionEnvFCL(const CollisionEnvFCL& other, const WorldPtr& world)
+  : CollisionEnv(other, world), robot_broadphase_generation_(next_robot_broadphase_generation++)
 {
   robot_geoms_ = other.robot_geoms_;
   robot_fcl_objs_ = other.robot_fcl_objs_;
+  use_persistent_broadphase_ = other.use_persistent_broadphase_;
+  ccd_tolerance_ = other.ccd_tolerance_;
 
   auto m = new fcl::DynamicAABBTreeCollisionManagerd();
   // m->tree_init_level = 2;
@@ -190,6 +202,14 @@ void CollisionEnvFCL::constructFCLObjectRobot(const moveit::core::RobotState& st
       fcl_obj.collision_objects_.push_back(FCLCollisionObjectPtr(coll_obj));
     }
 
+  constructFCLObjectAttachedBodies(state, fcl_obj);
+}
+
+void CollisionEnvFCL::constructFCLObjectAttachedBodies(const moveit::core::RobotState& state,
+                                                       FCLObject& fcl_obj) const
+{
+  fcl::Transform3d fcl_tf;
+
   // TODO: Implement a method for caching fcl::CollisionObject's for moveit::core::AttachedBody's
   std::vector<const moveit::core::AttachedBody*> ab;
   state.getAttachedBodies(ab);
@@ -221,6 +241,89 @@ void CollisionEnvFCL::allocSelfCollisionBroadPhase(const moveit::core::RobotStat
   // manager.manager_->update();
 }
 
+CollisionEnvFCL::RobotBroadPhase& CollisionEnvFCL::getRobotBroadPhase(const moveit::core::RobotState& state) const
+{
+  // the broadphases most recently used by this thread, by generation; the ones of destroyed environments or of
+  // replaced generations are never matched again and get replaced eventually
+  struct ThreadBroadPhases
+  {
+    std::uint64_t generations_[THREAD_BROADPHASE_COUNT] = {};
+    std::unique_ptr<RobotBroadPhase> broadphases_[THREAD_BROADPHASE_COUNT];
+    std::size_t next_ = 0;
+  };
+  static thread_local ThreadBroadPhases thread_broadphases;
+
+  const std::uint64_t generation = robot_broadphase_generation_;
+  RobotBroadPhase* broadphase = nullptr;
+  for (std::size_t i = 0; i < THREAD_BROADPHASE_COUNT && !broadphase; ++i)
+    if (thread_broadphases.generations_[i] == generation)
+      broadphase = thread_broadphases.broadphases_[i].get();
+  if (!broadphase)
+  {
+    std::size_t slot = thread_broadphases.next_;
+    thread_broadphases.next_ = (slot + 1) % THREAD_BROADPHASE_COUNT;
+    thread_broadphases.generations_[slot] = generation;
+    thread_broadphases.broadphases_[slot].reset(new RobotBroadPhase());
+    broadphase = thread_broadphases.broadphases_[slot].get();
+  }
+
+  fcl::Transform3d fcl_tf;
+  if (!broadphase->manager_)
+  {
+    // first check of this thread: construct the collision objects of all links
+    broadphase->manager_.reset(new fcl::DynamicAABBTreeCollisionManagerd());
+    broadphase->link_objects_.resize(robot_geoms_.size());
+    broadphase->transforms_.resize(robot_geoms_.size());
+    std::vector<fcl::CollisionObjectd*> objects;
+    for (std::size_t i = 0; i < robot_geoms_.size(); ++i)
+      if (robot_geoms_[i] && robot_geoms_[i]->collision_geometry_)
+      {
+        const CollisionGeometryData& data = *robot_geoms_[i]->collision_geometry_data_;
+        broadphase->transforms_[i] = state.getCollisionBodyTransform(data.ptr.link, data.shape_index);
+        transform2fcl(broadphase->transforms_[i], fcl_tf);
+        auto coll_obj = new fcl::CollisionObjectd(*robot_fcl_objs_[i]);
+        coll_obj->setTransform(fcl_tf);
+        coll_obj->computeAABB();
+        broadphase->link_objects_[i].reset(coll_obj);
+        objects.push_back(coll_obj);
+      }
+    if (!objects.empty())
+      broadphase->manager_->registerObjects(objects);
+    return *broadphase;
+  }
+
+  // only update the links that moved since the previous check of this thread
+  std::vector<fcl::CollisionObjectd*> moved;
+  for (std::size_t i = 0; i < broadphase->link_objects_.size(); ++i)
+    if (broadphase->link_objects_[i])
+    {
+      const CollisionGeometryData& data = *robot_geoms_[i]->collision_geometry_data_;
+      const Eigen::Isometry3d& transform = state.getCollisionBodyTransform(data.ptr.link, data.shape_index);
+      if (transform.matrix() == broadphase->transforms_[i].matrix())
+        continue;
+      broadphase->transforms_[i] = transform;
+      transform2fcl(transform, fcl_tf);
+      broadphase->link_objects_[i]->setTransform(fcl_tf);
+      broadphase->link_objects_[i]->computeAABB();
+      moved.push_back(broadphase->link_objects_[i].get());
+    }
+  if (!moved.empty())
+    broadphase->manager_->update(moved);
+  return *broadphase;
+}
+
+void CollisionEnvFCL::setUsePersistentBroadPhase(bool enable)
+{
+  use_persistent_broadphase_ = enable;
+  invalidateRobotBroadPhases();
+}
+
+void CollisionEnvFCL::invalidateRobotBroadPhases()
+{
+  // threads that still use a broadphase of the previous generation keep it until they replace it
+  robot_broadphase_generation_ = next_robot_broadphase_generation++;
+}
+
 void CollisionEnvFCL::checkSelfCollision(const CollisionRequest& req, CollisionResult& res,
                                          const moveit::core::RobotState& state) const
 {
@@ -237,11 +340,25 @@ void CollisionEnvFCL::checkSelfCollisionHelper(const CollisionRequest& req, Coll
                                                const moveit::core::RobotState& state,
                                                const AllowedCollisionMatrix* acm) const
 {
-  FCLManager manager;
-  allocSelfCollisionBroadPhase(state, manager);
   CollisionData cd(&req, &res, acm);
   cd.enableGroup(getRobotModel());
-  manager.manager_->collide(&cd, &collisionCallback);
+  cd.compileACM(getRobotModel());
+  if (use_persistent_broadphase_)
+  {
+    // the attached bodies are only registered for the duration of this check
+    RobotBroadPhase& broadphase = getRobotBroadPhase(state);
+    FCLObject attached;
+    constructFCLObjectAttachedBodies(state, attached);
+    attached.registerTo(broadphase.manager_.get());
+    broadphase.manager_->collide(&cd, &collisionCallback);
+    attached.unregisterFrom(broadphase.manager_.get());
+  }
+  else
+  {
+    FCLManager manager;
+    allocSelfCollisionBroadPhase(state, manager);
+    manager.manager_->collide(&cd, &collisionCallback);
+  }
   if (req.distance)
   {
     DistanceRequest dreq;
@@ -272,7 +389,7 @@ void CollisionEnvFCL::checkRobotCollision(const CollisionRequest& req, Collision
                                           const moveit::core::RobotState& state1,
                                           const moveit::core::RobotState& state2) const
 {
-  ROS_ERROR_NAMED(LOGNAME, "Continuous collision not implemented");
+  checkRobotCollisionHelperCCD(req, res, state1, state2, nullptr);
 }
 
 void CollisionEnvFCL::checkRobotCollision(const CollisionRequest& req, CollisionResult& res,
@@ -280,18 +397,29 @@ void CollisionEnvFCL::checkRobotCollision(const CollisionRequest& req, Collision
                                           const moveit::core::RobotState& state2,
                                           const AllowedCollisionMatrix& acm) const
 {
-  ROS_ERROR_NAMED(LOGNAME, "Not implemented");
+  checkRobotCollisionHelperCCD(req, res, state1, state2, &acm);
 }
 
 void CollisionEnvFCL::checkRobotCollisionHelper(const CollisionRequest& req, CollisionResult& res,
                                                 const moveit::core::RobotState& state,
                                                 const AllowedCollisionMatrix* acm) const
 {
-  FCLObject fcl_obj;
-  constructFCLObjectRobot(state, fcl_obj);
-
   CollisionData cd(&req, &res, acm);
   cd.enableGroup(getRobotModel());
+  cd.compileACM(getRobotModel());
+
+  FCLObject fcl_obj;
+  if (use_persistent_broadphase_)
+  {
+    const RobotBroadPhase& broadphase = getRobotBroadPhase(state);
+    for (std::size_t i = 0; !cd.done_ && i < broadphase.link_objects_.size(); ++i)
+      if (broadphase.link_objects_[i])
+        manager_->collide(broadphase.link_objects_[i].get(), &cd, &collisionCallback);
+    constructFCLObjectAttachedBodies(state, fcl_obj);
+  }
+  else
+    constructFCLObjectRobot(state, fcl_obj);
+
   for (std::size_t i = 0; !cd.done_ && i < fcl_obj.collision_objects_.size(); ++i)
     manager_->collide(fcl_obj.collision_objects_[i].get(), &cd, &collisionCallback);
 
@@ -308,23 +436,187 @@ void CollisionEnvFCL::checkRobotCollisionHelper(const CollisionRequest& req, Col
   }
 }
 
+void CollisionEnvFCL::checkRobotCollisionHelperCCD(const CollisionRequest& req, CollisionResult& res,
+                                                   const moveit::core::RobotState& state1,
+                                                   const moveit::core::RobotState& state2,
+                                                   const AllowedCollisionMatrix* acm) const
+{
+  const double motion_bound = getMotionBound(state1, state2);
+
+  DistanceRequest dreq;
+  dreq.group_name = req.group_name;
+  dreq.acm = acm;
+  dreq.enable_nearest_points = req.contacts;
+  dreq.enableGroup(getRobotModel());
+
+  // Conservative advancement: while the robot is at distance d from the world, no point of the robot travels
+  // further than d within the next d / motion_bound of the segment, so that part of the segment is collision free.
+  moveit::core::RobotState state(state1);
+  double t = 0.0;
+  double min_distance = std::numeric_limits<double>::max();
+  while (true)
+  {
+    state1.interpolate(state2, t, state);
+    state.updateCollisionBodyTransforms();
+
+    DistanceResult dres;
+    distanceRobot(dreq, dres, state);
+    const double distance = dres.minimum_distance.distance;
+    min_distance = std::min(min_distance, distance);
+    if (distance <= ccd_tolerance_)
+    {
+      // like a time of impact, report the single contact where the robot first got closer than the tolerance
+      res.collision = true;
+      if (req.contacts && req.max_contacts > 0)
+      {
+        const DistanceResultsData& nearest = dres.minimum_distance;
+        const bool swap = nearest.link_names[1] < nearest.link_names[0];
+        Contact contact;
+        contact.body_name_1 = nearest.link_names[swap ? 1 : 0];
+        contact.body_type_1 = nearest.body_types[swap ? 1 : 0];
+        contact.body_name_2 = nearest.link_names[swap ? 0 : 1];
+        contact.body_type_2 = nearest.body_types[swap ? 0 : 1];
+        contact.nearest_points[0] = nearest.nearest_points[swap ? 1 : 0];
+        contact.nearest_points[1] = nearest.nearest_points[swap ? 0 : 1];
+        contact.pos = 0.5 * (contact.nearest_points[0] + contact.nearest_points[1]);
+        contact.normal = swap ? -nearest.normal : nearest.normal;
+        contact.depth = std::max(0.0, -distance);
+        contact.percent_interpolation = t;
+        res.contacts[std::make_pair(contact.body_name_1, contact.body_name_2)].push_back(contact);
+        res.contact_count = 1;
+      }
+      if (req.distance)
+        res.distance = distance;
+      return;
+    }
+    if (t >= 1.0 || motion_bound <= 0.0)
+      break;
+    t = std::min(1.0, t + distance / motion_bound);
+  }
+
+  // the smallest distance found at the advancement steps
+  if (req.distance)
+    res.distance = min_distance;
+}
+
+double CollisionEnvFCL::getMotionBound(const moveit::core::RobotState& state1,
+                                       const moveit::core::RobotState& state2) const
+{
+  // radius of a sphere around the link origin containing the geometry attached to the link, negative without geometry
+  std::vector<double> radius(robot_model_->getLinkModelCount(), -1.0);
+  Eigen::Vector3d center;
+  double shape_radius;
+  for (const moveit::core::LinkModel* link : robot_model_->getLinkModelsWithCollisionGeometry())
+  {
+    const double scale = getLinkScale(link->getName());
+    const double padding = getLinkPadding(link->getName());
+    for (std::size_t i = 0; i < link->getShapes().size(); ++i)
+    {
+      shapes::computeShapeBoundingSphere(link->getShapes()[i].get(), center, shape_radius);
+      radius[link->getLinkIndex()] =
+          std::max(radius[link->getLinkIndex()], (link->getCollisionOriginTransforms()[i] * center).norm() +
+                                                     shape_radius * scale + padding);
+    }
+  }
+  std::vector<const moveit::core::AttachedBody*> attached_bodies;
+  state1.getAttachedBodies(attached_bodies);
+  for (const moveit::core::AttachedBody* body : attached_bodies)
+  {
+    const std::size_t index = body->getAttachedLink()->getLinkIndex();
+    for (std::size_t i = 0; i < body->getShapes().size(); ++i)
+    {
+      shapes::computeShapeBoundingSphere(body->getShapes()[i].get(), center, shape_radius);
+      radius[index] = std::max(radius[index], (body->getFixedTransforms()[i] * center).norm() + shape_radius);
+    }
+  }
+
+  double bound = 0.0;
+  for (const moveit::core::LinkModel* link : robot_model_->getLinkModels())
+  {
+    double r = radius[link->getLinkIndex()];
+    if (r < 0.0)
+      continue;
+    // walk up to the root; r bounds the distance of the geometry to the origin of the current link
+    double link_bound = 0.0;
+    for (const moveit::core::LinkModel* l = link; l; l = l->getParentLinkModel())
+    {
+      const moveit::core::JointModel* jm = l->getParentJointModel();
+      const double* p1 = state1.getJointPositions(jm);
+      const double* p2 = state2.getJointPositions(jm);
+      switch (jm->getType())
+      {
+        case moveit::core::JointModel::REVOLUTE:
+          link_bound += jm->distance(p1, p2) * r;
+          break;
+        case moveit::core::JointModel::PRISMATIC:
+          link_bound += std::abs(p2[0] - p1[0]);
+          r += std::max(std::abs(p1[0]), std::abs(p2[0]));
+          break;
+        case moveit::core::JointModel::PLANAR:
+        {
+          double dtheta = std::abs(std::fmod(p2[2] - p1[2], 2.0 * M_PI));
+          dtheta = std::min(dtheta, 2.0 * M_PI - dtheta);
+          link_bound += std::hypot(p2[0] - p1[0], p2[1] - p1[1]) + dtheta * r;
+          r += std::max(std::hypot(p1[0], p1[1]), std::hypot(p2[0], p2[1]));
+          break;
+        }
+        case moveit::core::JointModel::FLOATING:
+        {
+          const Eigen::Map<const Eigen::Vector3d> t1(p1), t2(p2);
+          const Eigen::Quaterniond q1(p1[6], p1[3], p1[4], p1[5]);
+          const Eigen::Quaterniond q2(p2[6], p2[3], p2[4], p2[5]);
+          link_bound += (t2 - t1).norm() + q1.angularDistance(q2) * r;
+          r += std::max(t1.norm(), t2.norm());
+          break;
+        }
+        default:
+          break;
+      }
+      r += l->getJointOriginTransform().translation().norm();
+    }
+    bound = std::max(bound, link_bound);
+  }
+  return bound;
+}
+
 void CollisionEnvFCL::distanceSelf(const DistanceRequest& req, DistanceResult& res,
                                    const moveit::core::RobotState& state) const
 {
-  FCLManager manager;
-  allocSelfCollisionBroadPhase(state, manager);
   DistanceData drd(&req, &res);
-
-  manager.manager_->distance(&drd, &distanceCallback);
+  if (use_persistent_broadphase_)
+  {
+    RobotBroadPhase& broadphase = getRobotBroadPhase(state);
+    FCLObject attached;
+    constructFCLObjectAttachedBodies(state, attached);
+    attached.registerTo(broadphase.manager_.get());
+    broadphase.manager_->distance(&drd, &distanceCallback);
+    attached.unregisterFrom(broadphase.manager_.get());
+  }
+  else
+  {
+    FCLManager manager;
+    allocSelfCollisionBroadPhase(state, manager);
+    manager.manager_->distance(&drd, &distanceCallback);
+  }
 }
 
 void CollisionEnvFCL::distanceRobot(const DistanceRequest& req, DistanceResult& res,
                                     const moveit::core::RobotState& state) const
 {
+  DistanceData drd(&req, &res);
+
   FCLObject fcl_obj;
-  constructFCLObjectRobot(state, fcl_obj);
+  if (use_persistent_broadphase_)
+  {
+    const RobotBroadPhase& broadphase = getRobotBroadPhase(state);
+    for (std::size_t i = 0; !drd.done && i < broadphase.link_objects_.size(); ++i)
+      if (broadphase.link_objects_[i])
+        manager_->distance(broadphase.link_objects_[i].get(), &drd, &distanceCallback);
+    constructFCLObjectAttachedBodies(state, fcl_obj);
+  }
+  else
+    constructFCLObjectRobot(state, fcl_obj);
 
-  DistanceData drd(&req, &res);
   for (std::size_t i = 0; !drd.done && i < fcl_obj.collision_objects_.size(); ++i)
     manager_->distance(fcl_obj.collision_objects_[i].get(), &drd, &distanceCallback);
 }
@@ -430,6 +722,9 @@ void CollisionEnvFCL::updatedPaddingOrScaling(const std::vector<std::string>& li
     else
       ROS_ERROR_NAMED(LOGNAME, "Updating padding or scaling for unknown link: '%s'", link.c_str());
   }
+
+  // the persistent broadphases still contain the previous geometries
+  invalidateRobotBroadPhases();
 }
 
 }  // end of namespace collision_detection
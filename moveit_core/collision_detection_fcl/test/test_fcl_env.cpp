@@ -49,6 +49,8 @@
 #include <urdf_parser/urdf_parser.h>
 #include <geometric_shapes/shape_operations.h>
 
+#include <thread>
+
 /** \brief Brings the panda robot in user defined home position */
 inline void setToHome(moveit::core::RobotState& panda_state)
 {
@@ -222,6 +224,117 @@ TEST_F(CollisionDetectionEnvTest, PaddingTest)
   ASSERT_FALSE(res.collision);
 }
 
+/** \brief The persistent robot broadphase gives the same results as constructing it for every check. */
+TEST_F(CollisionDetectionEnvTest, PersistentBroadPhase)
+{
+  collision_detection::CollisionEnvFCL rebuilt_env(robot_model_);
+  rebuilt_env.setUsePersistentBroadPhase(false);
+  auto& persistent_env = static_cast<collision_detection::CollisionEnvFCL&>(*c_env_);
+  ASSERT_TRUE(persistent_env.getUsePersistentBroadPhase());
+
+  shapes::ShapeConstPtr shape_ptr(new shapes::Box(0.1, 0.1, 0.1));
+  Eigen::Isometry3d pos{ Eigen::Isometry3d::Identity() };
+  pos.translation() = Eigen::Vector3d(0.43, 0, 0.55);
+  persistent_env.getWorld()->addToObject("box", shape_ptr, pos);
+  rebuilt_env.getWorld()->addToObject("box", shape_ptr, pos);
+
+  // move single joints as well as the whole robot between the checks
+  const moveit::core::JointModel* joint = robot_model_->getJointModel("panda_joint7");
+  for (unsigned int i = 0; i < 100; ++i)
+  {
+    if (i % 10 == 0)
+      robot_state_->setToRandomPositions();
+    else
+    {
+      double value = robot_state_->getJointPositions(joint)[0] + 0.1;
+      robot_state_->setJointPositions(joint, &value);
+    }
+    robot_state_->update();
+
+    collision_detection::CollisionRequest req;
+    collision_detection::CollisionResult persistent_res, rebuilt_res;
+    persistent_env.checkSelfCollision(req, persistent_res, *robot_state_, *acm_);
+    rebuilt_env.checkSelfCollision(req, rebuilt_res, *robot_state_, *acm_);
+    EXPECT_EQ(persistent_res.collision, rebuilt_res.collision);
+
+    persistent_res.clear();
+    rebuilt_res.clear();
+    persistent_env.checkRobotCollision(req, persistent_res, *robot_state_, *acm_);
+    rebuilt_env.checkRobotCollision(req, rebuilt_res, *robot_state_, *acm_);
+    EXPECT_EQ(persistent_res.collision, rebuilt_res.collision);
+  }
+}
+
+/** \brief The persistent broadphases of all threads reflect changes of the padding. */
+TEST_F(CollisionDetectionEnvTest, PersistentBroadPhaseOfThreads)
+{
+  shapes::ShapeConstPtr shape_ptr(new shapes::Box(0.1, 0.1, 0.1));
+  Eigen::Isometry3d pos{ Eigen::Isometry3d::Identity() };
+  pos.translation() = Eigen::Vector3d(0.43, 0, 0.55);
+  c_env_->getWorld()->addToObject("box", shape_ptr, pos);
+
+  const auto in_collision = [this] {
+    collision_detection::CollisionRequest req;
+    collision_detection::CollisionResult res;
+    c_env_->checkRobotCollision(req, res, *robot_state_, *acm_);
+    return res.collision;
+  };
+  // check in the calling thread, which keeps its broadphase, and in short-lived threads
+  const auto expect_collision = [&in_collision](bool expected) {
+    EXPECT_EQ(in_collision(), expected);
+    for (int i = 0; i < 4; ++i)
+    {
+      bool collision = !expected;
+      std::thread thread([&] { collision = in_collision(); });
+      thread.join();
+      EXPECT_EQ(collision, expected);
+    }
+  };
+
+  expect_collision(false);
+  c_env_->setLinkPadding("panda_hand", 0.08);
+  expect_collision(true);
+  c_env_->setLinkPadding("panda_hand", 0.0);
+  expect_collision(false);
+}
+
+/** \brief Checking a batch of states gives the same results as checking them one by one. */
+TEST_F(CollisionDetectionEnvTest, CollisionBatch)
+{
+  shapes::ShapeConstPtr shape_ptr(new shapes::Box(0.1, 0.1, 0.1));
+  Eigen::Isometry3d pos{ Eigen::Isometry3d::Identity() };
+  pos.translation() = Eigen::Vector3d(0.43, 0, 0.55);
+  c_env_->getWorld()->addToObject("box", shape_ptr, pos);
+
+  std::vector<moveit::core::RobotState> states(50, *robot_state_);
+  std::vector<const moveit::core::RobotState*> state_ptrs;
+  for (moveit::core::RobotState& state : states)
+  {
+    state.setToRandomPositions();
+    state.update();
+    state_ptrs.push_back(&state);
+  }
+
+  collision_detection::CollisionRequest req;
+  std::vector<collision_detection::CollisionResult> results;
+  int first = c_env_->checkCollisionBatch(req, results, state_ptrs, *acm_);
+  ASSERT_EQ(results.size(), states.size());
+
+  int expected_first = -1;
+  for (std::size_t i = 0; i < states.size(); ++i)
+  {
+    collision_detection::CollisionResult res;
+    c_env_->checkCollision(req, res, states[i], *acm_);
+    EXPECT_EQ(res.collision, results[i].collision);
+    if (res.collision && expected_first < 0)
+      expected_first = i;
+  }
+  EXPECT_EQ(first, expected_first);
+
+  // stopping at the first collision finds the same state
+  EXPECT_EQ(c_env_->checkCollisionBatch(req, results, state_ptrs, *acm_, true), expected_first);
+}
+
 /** \brief Continuous self collision checks of the robot.
  *
  *  Functionality not supported yet. */
@@ -268,8 +381,8 @@ TEST_F(CollisionDetectionEnvTest, DISABLED_ContinuousCollisionSelf)
 
 /** \brief Two similar robot poses are used as start and end pose of a continuous collision check.
  *
- *  Functionality not supported yet. */
-TEST_F(CollisionDetectionEnvTest, DISABLED_ContinuousCollisionWorld)
+ *  The check reports a single contact, where the robot first gets close to the box between the two poses. */
+TEST_F(CollisionDetectionEnvTest, ContinuousCollisionWorld)
 {
   collision_detection::CollisionRequest req;
   req.contacts = true;
@@ -313,8 +426,20 @@ TEST_F(CollisionDetectionEnvTest, DISABLED_ContinuousCollisionWorld)
 
   c_env_->checkRobotCollision(req, res, state1, state2, *acm_);
   ASSERT_TRUE(res.collision);
-  ASSERT_EQ(res.contact_count, 4u);
+  ASSERT_EQ(res.contact_count, 1u);
+  ASSERT_EQ(res.contacts.size(), 1u);
+  const collision_detection::Contact& contact = res.contacts.begin()->second.front();
+  EXPECT_TRUE(contact.body_name_1 == "box" || contact.body_name_2 == "box");
+  EXPECT_GT(contact.percent_interpolation, 0.0);
+  EXPECT_LT(contact.percent_interpolation, 1.0);
   res.clear();
+
+  // the motion bound covers the displacement of every link between the two states
+  const double bound = static_cast<collision_detection::CollisionEnvFCL*>(c_env_.get())->getMotionBound(state1, state2);
+  for (const moveit::core::LinkModel* link : robot_model_->getLinkModelsWithCollisionGeometry())
+    EXPECT_LE((state2.getGlobalLinkTransform(link).translation() - state1.getGlobalLinkTransform(link).translation())
+                  .norm(),
+              bound);
 }
 
 int main(int argc, char** argv)
@@ -108,6 +108,28 @@ struct PropDistanceFieldVoxel
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 };
 
+/**
+ * \brief The algorithm a \ref PropagationDistanceField uses to update
+ * the distances when obstacle cells are added or removed.
+ */
+enum class PropagationMethod
+{
+  /**
+   * \brief Incremental propagation from the changed cells through
+   * bucket queues.  Efficient for small changes of the obstacles.
+   */
+  BUCKET_QUEUE,
+
+  /**
+   * \brief Exact Euclidean distance transform of the whole grid,
+   * computed by separable passes along the three axes (Felzenszwalb
+   * and Huttenlocher) that run in parallel over slices of the grid.
+   * The cost does not depend on the number of changed cells, which
+   * makes it efficient for dense updates such as octomaps.
+   */
+  SEPARABLE_EDT
+};
+
 /**
  * \brief A DistanceField implementation that uses a vector
  * propagation method.  Distances propagate outward from occupied
@@ -161,10 +183,14 @@ public:
    * \ref PropagationDistanceField description for more information on
    * the implications of this.
    *
+   * @param [in] method The algorithm used to update the distances,
+   * see \ref PropagationMethod.
+   *
    */
   PropagationDistanceField(double size_x, double size_y, double size_z, double resolution, double origin_x,
                            double origin_y, double origin_z, double max_distance,
-                           bool propagate_negative_distances = false);
+                           bool propagate_negative_distances = false,
+                           PropagationMethod method = PropagationMethod::BUCKET_QUEUE);
 
   /**
    * \brief Constructor based on an OcTree and bounding box
@@ -187,10 +213,14 @@ public:
    * and all obstacle cells will be assigned zero distance.  See the
    * \ref PropagationDistanceField description for more information on
    * the implications of this.
+   *
+   * @param [in] method The algorithm used to update the distances,
+   * see \ref PropagationMethod.
    */
   PropagationDistanceField(const octomap::OcTree& octree, const octomap::point3d& bbx_min,
                            const octomap::point3d& bbx_max, double max_distance,
-                           bool propagate_negative_distances = false);
+                           bool propagate_negative_distances = false,
+                           PropagationMethod method = PropagationMethod::BUCKET_QUEUE);
 
   /**
    * \brief Constructor that takes an istream and reads the contents
@@ -211,9 +241,13 @@ public:
    * \ref PropagationDistanceField description for more information on
    * the implications of this.
    *
+   * @param [in] method The algorithm used to update the distances,
+   * see \ref PropagationMethod.
+   *
    * @return
    */
-  PropagationDistanceField(std::istream& stream, double max_distance, bool propagate_negative_distances = false);
+  PropagationDistanceField(std::istream& stream, double max_distance, bool propagate_negative_distances = false,
+                           PropagationMethod method = PropagationMethod::BUCKET_QUEUE);
   /**
    * \brief Empty destructor
    *
@@ -445,6 +479,16 @@ public:
     return max_distance_sq_;
   }
 
+  /**
+   * \brief Gets the algorithm used to update the distances.
+   *
+   * @return The propagation method selected at construction.
+   */
+  PropagationMethod getPropagationMethod() const
+  {
+    return method_;
+  }
+
 private:
   /** Typedef for set of integer indices */
   typedef std::set<Eigen::Vector3i, CompareEigenVector3i, Eigen::aligned_allocator<Eigen::Vector3i>> VoxelSet;
@@ -486,6 +530,26 @@ private:
    */
   void propagateNegative();
 
+  /**
+   * \brief Recomputes the distances of all cells from the obstacle
+   * cells (the cells with zero distance_square_) by an exact
+   * Euclidean distance transform.  Used by the \ref
+   * PropagationMethod::SEPARABLE_EDT method.
+   *
+   */
+  void computeDistanceTransform();
+
+  /**
+   * \brief Computes one of the two distance fields of \ref
+   * computeDistanceTransform.
+   *
+   * @param negative If false, distance_square_ and closest_point_
+   * are computed with respect to obstacle cells; if true,
+   * negative_distance_square_ and closest_negative_point_ are
+   * computed with respect to free cells.
+   */
+  void computeDistanceTransform(bool negative);
+
   /**
    * \brief Determines distance based on actual voxel data
    *
@@ -540,6 +604,8 @@ private:
 
   bool propagate_negative_; /**< \brief Whether or not to propagate negative distances */
 
+  PropagationMethod method_; /**< \brief The algorithm used to update the distances */
+
   VoxelGrid<PropDistanceFieldVoxel>::Ptr voxel_grid_; /**< \brief Actual container for distance data */
 
   /// \brief Structure used to hold propagation frontier
@@ -575,6 +641,10 @@ private:
 
   EigenSTL::vector_Vector3i direction_number_to_direction_; /**< \brief Holds conversion from direction number to
                                                                   integer changes */
+
+  std::vector<int> edt_distance_; /**< \brief Squared distances between the passes of \ref computeDistanceTransform */
+  std::vector<int> edt_closest_;  /**< \brief Cell index of the closest site between the passes of \ref
+                                       computeDistanceTransform */
 };
 
 ////////////////////////// inline functions follow ////////////////////////////////////////
@@ -0,0 +1,250 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, MoveIt maintainers
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <moveit/distance_field/distance_field.h>
+#include <moveit/distance_field/propagation_distance_field.h>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace distance_field
+{
+/**
+ * \brief A DistanceField implementation that only stores the cells
+ * within the maximum distance of an obstacle.
+ *
+ * The volume is divided into blocks of BLOCK_SIZE^3 cells, which are
+ * kept in a hash map and allocated only when one of their cells gets
+ * closer than the maximum distance to an obstacle cell.  All other
+ * cells implicitly have the maximum distance.  The memory therefore
+ * scales with the surface of the obstacles instead of the volume of
+ * the workspace, which makes large workspaces at fine resolutions
+ * feasible where a dense \ref PropagationDistanceField is not.
+ *
+ * Distances are propagated outward from the obstacle cells to the
+ * maximum distance through a bucket queue, carrying the closest
+ * obstacle cell along, in the same way as the positive distances of
+ * \ref PropagationDistanceField.  Only unsigned distances are
+ * supported: all obstacle cells have zero distance.
+ */
+class SparseDistanceField : public DistanceField
+{
+public:
+  /** \brief The number of cells along each side of a block */
+  static const int BLOCK_SIZE = 8;
+
+  /**
+   * \brief Constructor that initializes the entire distance field to
+   * empty - all cells will be assigned maximum distance values, and no
+   * memory is allocated for them.
+   *
+   * @param [in] size_x The X dimension in meters of the volume to represent
+   * @param [in] size_y The Y dimension in meters of the volume to represent
+   * @param [in] size_z The Z dimension in meters of the volume to represent
+   * @param [in] resolution The resolution in meters of the volume
+   * @param [in] origin_x The minimum X point of the volume
+   * @param [in] origin_y The minimum Y point of the volume
+   * @param [in] origin_z The minimum Z point of the volume
+   *
+   * @param [in] max_distance The maximum distance to which to
+   * propagate distance values.  Cells that are greater than this
+   * distance will be assigned the maximum distance value.
+   */
+  SparseDistanceField(double size_x, double size_y, double size_z, double resolution, double origin_x,
+                      double origin_y, double origin_z, double max_distance);
+
+  /**
+   * \brief Constructor that reads the contents of a saved distance
+   * field from \e stream, see \ref readFromStream.
+   *
+   * @param [in] stream The stream from which to read the data
+   * @param [in] max_distance The maximum distance to which to propagate distance values
+   */
+  SparseDistanceField(std::istream& stream, double max_distance);
+
+  ~SparseDistanceField() override;
+
+  void addPointsToField(const EigenSTL::vector_Vector3d& points) override;
+
+  /**
+   * \brief Remove a set of obstacle points from the distance field.
+   *
+   * Cells whose closest obstacle cell was removed are reset and
+   * propagated again from the remaining obstacle cells.  Blocks that
+   * are no longer within the maximum distance of any obstacle are
+   * freed.
+   *
+   * @param [in] points The set of obstacle points that will be set as free
+   */
+  void removePointsFromField(const EigenSTL::vector_Vector3d& points) override;
+
+  void updatePointsInField(const EigenSTL::vector_Vector3d& old_points,
+                           const EigenSTL::vector_Vector3d& new_points) override;
+
+  /**
+   * \brief Frees all blocks, so all cells have the maximum distance.
+   */
+  void reset() override;
+
+  double getDistance(double x, double y, double z) const override;
+  double getDistance(int x, int y, int z) const override;
+  bool isCellValid(int x, int y, int z) const override;
+  int getXNumCells() const override;
+  int getYNumCells() const override;
+  int getZNumCells() const override;
+  bool gridToWorld(int x, int y, int z, double& world_x, double& world_y, double& world_z) const override;
+  bool worldToGrid(double world_x, double world_y, double world_z, int& x, int& y, int& z) const override;
+
+  /**
+   * \brief Writes the parameters of the distance field in ASCII,
+   * followed by the zlib compressed indices of the obstacle cells.
+   * The max_distance is not written and the distances are recreated
+   * on load.
+   *
+   * @param [out] stream The stream to which to write the distance field contents.
+   *
+   * @return True
+   */
+  bool writeToStream(std::ostream& stream) const override;
+
+  /**
+   * \brief Reads, parameterizes, and populates the distance field
+   * from data written by \ref writeToStream, keeping the current
+   * max_distance.
+   *
+   * @param [in] stream The stream from which to read
+   *
+   * @return True if reading, parameterizing, and populating the
+   * distance field is successful; otherwise False.
+   */
+  bool readFromStream(std::istream& stream) override;
+
+  double getUninitializedDistance() const override
+  {
+    return max_distance_;
+  }
+
+  /**
+   * \brief Gets the squared distance in cells of a cell to its
+   * closest obstacle cell, and that cell.
+   *
+   * @param [in] x The integer X location
+   * @param [in] y The integer Y location
+   * @param [in] z The integer Z location
+   * @param [out] closest_point The closest obstacle cell, if any
+   *
+   * @return The squared distance, or the maximum distance squared if
+   * there is no obstacle cell within the maximum distance.
+   */
+  int getDistanceSquared(int x, int y, int z, Eigen::Vector3i& closest_point) const;
+
+  /**
+   * \brief Gets the maximum distance squared value in cells.
+   *
+   * @return The maximum distance squared.
+   */
+  int getMaximumDistanceSquared() const
+  {
+    return max_distance_sq_;
+  }
+
+  /**
+   * \brief Gets the number of allocated blocks.
+   *
+   * @return The number of blocks of BLOCK_SIZE^3 cells in memory
+   */
+  std::size_t getBlockCount() const
+  {
+    return blocks_.size();
+  }
+
+  /**
+   * \brief Gets an estimate of the memory used by the distance field,
+   * including the blocks, the hash map, and the propagation queues.
+   *
+   * @return The memory use in bytes
+   */
+  std::size_t getMemoryUsage() const;
+
+private:
+  /** \brief The data of BLOCK_SIZE^3 cells, indexed by (x * BLOCK_SIZE + y) * BLOCK_SIZE + z within the block */
+  struct Block
+  {
+    /** \brief Squared distance in cells to the closest obstacle cell */
+    int distance_square_[BLOCK_SIZE * BLOCK_SIZE * BLOCK_SIZE];
+
+    /** \brief Closest obstacle cell, only meaningful if the distance is less than the maximum */
+    Eigen::Vector3i closest_point_[BLOCK_SIZE * BLOCK_SIZE * BLOCK_SIZE];
+  };
+
+  /** \brief Initializes the queues and the sqrt lookup table for max_distance_, and frees all blocks */
+  void initialize();
+
+  /** \brief Gets the key of the block containing a valid cell */
+  std::int64_t getBlockKey(const Eigen::Vector3i& cell) const;
+
+  /** \brief Gets the index of a cell within its block */
+  static int getIndexInBlock(const Eigen::Vector3i& cell);
+
+  /** \brief Gets the block of a valid cell, or null if it is not allocated */
+  const Block* getBlock(const Eigen::Vector3i& cell) const;
+
+  /** \brief Gets the block of a valid cell, allocating it with all cells at the maximum distance if needed */
+  Block& getOrCreateBlock(const Eigen::Vector3i& cell);
+
+  /** \brief Adds a set of valid obstacle cells and propagates their distances */
+  void addObstacleCells(const EigenSTL::vector_Vector3i& cells);
+
+  /** \brief Removes a set of valid obstacle cells and repropagates the distances of the cells that referred to them */
+  void removeObstacleCells(const EigenSTL::vector_Vector3i& cells);
+
+  /** \brief Propagates the distances from the cells in \ref bucket_queue_ and clears it */
+  void propagate();
+
+  double max_distance_; /**< \brief Holds maximum distance  */
+  int max_distance_sq_; /**< \brief Holds maximum distance squared in cells */
+  int num_cells_[3];    /**< \brief The number of cells along each dimension */
+  int num_blocks_[3];   /**< \brief The number of blocks along each dimension */
+
+  std::unordered_map<std::int64_t, std::unique_ptr<Block>> blocks_; /**< \brief The allocated blocks */
+
+  std::vector<EigenSTL::vector_Vector3i> bucket_queue_; /**< \brief Cells from which to propagate, by squared
+                                                              distance */
+
+  std::vector<double> sqrt_table_; /**< \brief Precomputed square root table for faster distance lookups */
+};
+}  // namespace distance_field
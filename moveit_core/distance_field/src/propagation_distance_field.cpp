@@ -35,19 +35,72 @@
 /* Author: Mrinal Kalakrishnan, Ken Anderson */
 
 #include <moveit/distance_field/propagation_distance_field.h>
+#include <moveit/background_processing/thread_pool.h>
 #include <visualization_msgs/Marker.h>
 #include <ros/console.h>
 #include <boost/iostreams/filtering_stream.hpp>
 #include <boost/iostreams/copy.hpp>
 #include <boost/iostreams/filter/zlib.hpp>
+#include <atomic>
+#include <limits>
 
 namespace distance_field
 {
+namespace
+{
+const int EDT_INFINITY = std::numeric_limits<int>::max();
+
+/**
+ * \brief One dimensional squared distance transform of a line of \e n
+ * cells: out[p] = min_q (p - q)^2 + f[q], computed as the lower
+ * envelope of parabolas (Felzenszwalb and Huttenlocher).  Cells with
+ * f[q] == EDT_INFINITY are ignored; if there are none, all outputs
+ * are EDT_INFINITY.  \e arg receives the minimizing q, \e v and \e z
+ * are buffers of at least n and n + 1 elements.
+ */
+void distanceTransform1D(const int* f, int n, int* out, int* arg, int* v, double* z)
+{
+  int k = -1;
+  for (int q = 0; q < n; ++q)
+  {
+    if (f[q] == EDT_INFINITY)
+      continue;
+    double s = 0.0;
+    while (k >= 0)
+    {
+      s = (double(f[q]) + q * q - (double(f[v[k]]) + v[k] * v[k])) / (2.0 * (q - v[k]));
+      if (s > z[k])
+        break;
+      --k;
+    }
+    ++k;
+    v[k] = q;
+    z[k] = k == 0 ? -std::numeric_limits<double>::infinity() : s;
+  }
+
+  if (k < 0)
+  {
+    std::fill(out, out + n, EDT_INFINITY);
+    return;
+  }
+  int j = 0;
+  for (int p = 0; p < n; ++p)
+  {
+    while (j < k && z[j + 1] < p)
+      ++j;
+    out[p] = (p - v[j]) * (p - v[j]) + f[v[j]];
+    arg[p] = v[j];
+  }
+}
+}  // namespace
+
 PropagationDistanceField::PropagationDistanceField(double size_x, double size_y, double size_z, double resolution,
                                                    double origin_x, double origin_y, double origin_z,
-                                                   double max_distance, bool propagate_negative)
+                                                   double max_distance, bool propagate_negative,
+                                                   PropagationMethod method)
   : DistanceField(size_x, size_y, size_z, resolution, origin_x, origin_y, origin_z)
   , propagate_negative_(propagate_negative)
+  , method_(method)
   , max_distance_(max_distance)
 {
   initialize();
@@ -55,10 +108,11 @@ PropagationDistanceField::PropagationDistanceField(double size_x, double size_y,
 
 PropagationDistanceField::PropagationDistanceField(const octomap::OcTree& octree, const octomap::point3d& bbx_min,
                                                    const octomap::point3d& bbx_max, double max_distance,
-                                                   bool propagate_negative_distances)
+                                                   bool propagate_negative_distances, PropagationMethod method)
   : DistanceField(bbx_max.x() - bbx_min.x(), bbx_max.y() - bbx_min.y(), bbx_max.z() - bbx_min.z(),
                   octree.getResolution(), bbx_min.x(), bbx_min.y(), bbx_min.z())
   , propagate_negative_(propagate_negative_distances)
+  , method_(method)
   , max_distance_(max_distance)
   , max_distance_sq_(0)  // avoid gcc warning about uninitialized value
 {
@@ -67,8 +121,11 @@ PropagationDistanceField::PropagationDistanceField(const octomap::OcTree& octree
 }
 
 PropagationDistanceField::PropagationDistanceField(std::istream& is, double max_distance,
-                                                   bool propagate_negative_distances)
-  : DistanceField(0, 0, 0, 0, 0, 0, 0), propagate_negative_(propagate_negative_distances), max_distance_(max_distance)
+                                                   bool propagate_negative_distances, PropagationMethod method)
+  : DistanceField(0, 0, 0, 0, 0, 0, 0)
+  , propagate_negative_(propagate_negative_distances)
+  , method_(method)
+  , max_distance_(max_distance)
 {
   readFromStream(is);
 }
@@ -160,6 +217,19 @@ void PropagationDistanceField::updatePointsInField(const EigenSTL::vector_Vector
     // ROS_INFO_NAMED("distance_field", "Adding obstacle voxel %d %d %d", (*it).x(), (*it).y(), (*it).z());
   }
 
+  if (method_ == PropagationMethod::SEPARABLE_EDT)
+  {
+    // update the obstacle cells of both sets and recompute all distances only once
+    if (old_not_new.empty() && new_not_in_current.empty())
+      return;
+    for (const Eigen::Vector3i& voxel_loc : old_not_new)
+      voxel_grid_->getCell(voxel_loc.x(), voxel_loc.y(), voxel_loc.z()).distance_square_ = max_distance_sq_;
+    for (const Eigen::Vector3i& voxel_loc : new_not_in_current)
+      voxel_grid_->getCell(voxel_loc.x(), voxel_loc.y(), voxel_loc.z()).distance_square_ = 0;
+    computeDistanceTransform();
+    return;
+  }
+
   removeObstacleVoxels(old_not_new);
   addNewObstacleVoxels(new_not_in_current);
 
@@ -218,6 +288,16 @@ void PropagationDistanceField::removePointsFromField(const EigenSTL::vector_Vect
 
 void PropagationDistanceField::addNewObstacleVoxels(const EigenSTL::vector_Vector3i& voxel_points)
 {
+  if (method_ == PropagationMethod::SEPARABLE_EDT)
+  {
+    if (voxel_points.empty())
+      return;
+    for (const Eigen::Vector3i& voxel_point : voxel_points)
+      voxel_grid_->getCell(voxel_point.x(), voxel_point.y(), voxel_point.z()).distance_square_ = 0;
+    computeDistanceTransform();
+    return;
+  }
+
   int initial_update_direction = getDirectionNumber(0, 0, 0);
   bucket_queue_[0].reserve(voxel_points.size());
   EigenSTL::vector_Vector3i negative_stack;
@@ -301,6 +381,16 @@ void PropagationDistanceField::addNewObstacleVoxels(const EigenSTL::vector_Vecto
 void PropagationDistanceField::removeObstacleVoxels(const EigenSTL::vector_Vector3i& voxel_points)
 // const VoxelSet& locations )
 {
+  if (method_ == PropagationMethod::SEPARABLE_EDT)
+  {
+    if (voxel_points.empty())
+      return;
+    for (const Eigen::Vector3i& voxel_point : voxel_points)
+      voxel_grid_->getCell(voxel_point.x(), voxel_point.y(), voxel_point.z()).distance_square_ = max_distance_sq_;
+    computeDistanceTransform();
+    return;
+  }
+
   EigenSTL::vector_Vector3i stack;
   EigenSTL::vector_Vector3i negative_stack;
   int initial_update_direction = getDirectionNumber(0, 0, 0);
@@ -503,6 +593,100 @@ void PropagationDistanceField::propagateNegative()
   }
 }
 
+void PropagationDistanceField::computeDistanceTransform()
+{
+  // the obstacle cells keep a zero distance_square_ throughout, so the negative transform still sees them
+  computeDistanceTransform(false);
+  if (propagate_negative_)
+    computeDistanceTransform(true);
+}
+
+void PropagationDistanceField::computeDistanceTransform(bool negative)
+{
+  const int num_x = getXNumCells();
+  const int num_y = getYNumCells();
+  const int num_z = getZNumCells();
+  const int stride_y = num_z;
+  const int stride_x = num_y * num_z;
+  const int max_length = std::max(num_x, std::max(num_y, num_z));
+  edt_distance_.resize(num_x * stride_x);
+  edt_closest_.resize(num_x * stride_x);
+
+  // The sites are the obstacle cells, or the free cells for negative distances. Intermediate distances are kept in
+  // the compact edt_distance_ / edt_closest_ arrays; since the squared distances of the passes only add up, values
+  // beyond max_distance_sq_ can be dropped after every pass.
+  for (int x = 0; x < num_x; ++x)
+    for (int y = 0; y < num_y; ++y)
+      for (int z = 0; z < num_z; ++z)
+      {
+        const int index = x * stride_x + y * stride_y + z;
+        edt_distance_[index] = (voxel_grid_->getCell(x, y, z).distance_square_ == 0) != negative ? 0 : EDT_INFINITY;
+        edt_closest_[index] = index;
+      }
+
+  // One pass along each axis, starting with the contiguous z axis. The lines along the axis of a pass are
+  // independent, so slices of lines are distributed over the threads.
+  const int passes[3][5] = {
+    // num_slices, slice stride, num_lines, line stride, cell stride
+    { num_x, stride_x, num_y, stride_y, 1 },
+    { num_x, stride_x, num_z, 1, stride_y },
+    { num_y, stride_y, num_z, 1, stride_x },
+  };
+  const int lengths[3] = { num_z, num_y, num_x };
+  for (int pass = 0; pass < 3; ++pass)
+  {
+    const int* p = passes[pass];
+    const int n = lengths[pass];
+    std::atomic<int> next_slice(0);
+    moveit::tools::ThreadPool::getGlobal().run([&](unsigned int /*thread*/) {
+      std::vector<int> f(max_length), out(max_length), arg(max_length), closest(max_length), v(max_length);
+      std::vector<double> z(max_length + 1);
+      for (int slice; (slice = next_slice++) < p[0];)
+        for (int line = 0; line < p[2]; ++line)
+        {
+          const int base = slice * p[1] + line * p[3];
+          for (int i = 0, index = base; i < n; ++i, index += p[4])
+          {
+            f[i] = edt_distance_[index];
+            closest[i] = edt_closest_[index];
+          }
+          distanceTransform1D(f.data(), n, out.data(), arg.data(), v.data(), z.data());
+          for (int i = 0, index = base; i < n; ++i, index += p[4])
+            if (out[i] > max_distance_sq_)
+              edt_distance_[index] = EDT_INFINITY;
+            else
+            {
+              edt_distance_[index] = out[i];
+              edt_closest_[index] = closest[arg[i]];
+            }
+        }
+    });
+  }
+
+  int PropDistanceFieldVoxel::*distance =
+      negative ? &PropDistanceFieldVoxel::negative_distance_square_ : &PropDistanceFieldVoxel::distance_square_;
+  Eigen::Vector3i PropDistanceFieldVoxel::*closest_point =
+      negative ? &PropDistanceFieldVoxel::closest_negative_point_ : &PropDistanceFieldVoxel::closest_point_;
+  for (int x = 0; x < num_x; ++x)
+    for (int y = 0; y < num_y; ++y)
+      for (int z = 0; z < num_z; ++z)
+      {
+        const int index = x * stride_x + y * stride_y + z;
+        PropDistanceFieldVoxel& voxel = voxel_grid_->getCell(x, y, z);
+        if (edt_distance_[index] == EDT_INFINITY)
+        {
+          voxel.*distance = max_distance_sq_;
+          (voxel.*closest_point).setConstant(PropDistanceFieldVoxel::UNINITIALIZED);
+        }
+        else
+        {
+          const int closest = edt_closest_[index];
+          voxel.*distance = edt_distance_[index];
+          voxel.*closest_point = Eigen::Vector3i(closest / stride_x, (closest % stride_x) / stride_y, closest % stride_y);
+        }
+      }
+}
+
 void PropagationDistanceField::reset()
 {
   voxel_grid_->reset(PropDistanceFieldVoxel(max_distance_sq_, 0));
@@ -0,0 +1,438 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, MoveIt maintainers
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/distance_field/sparse_distance_field.h>
+#include <ros/console.h>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/filter/zlib.hpp>
+#include <algorithm>
+#include <cmath>
+#include <set>
+
+namespace distance_field
+{
+SparseDistanceField::SparseDistanceField(double size_x, double size_y, double size_z, double resolution,
+                                         double origin_x, double origin_y, double origin_z, double max_distance)
+  : DistanceField(size_x, size_y, size_z, resolution, origin_x, origin_y, origin_z), max_distance_(max_distance)
+{
+  initialize();
+}
+
+SparseDistanceField::SparseDistanceField(std::istream& stream, double max_distance)
+  : DistanceField(0, 0, 0, 0, 0, 0, 0), max_distance_(max_distance)
+{
+  readFromStream(stream);
+}
+
+SparseDistanceField::~SparseDistanceField() = default;
+
+void SparseDistanceField::initialize()
+{
+  max_distance_sq_ = ceil(max_distance_ / resolution_) * ceil(max_distance_ / resolution_);
+  const double sizes[3] = { size_x_, size_y_, size_z_ };
+  for (int i = DIM_X; i <= DIM_Z; ++i)
+  {
+    num_cells_[i] = sizes[i] / resolution_;
+    num_blocks_[i] = (num_cells_[i] + BLOCK_SIZE - 1) / BLOCK_SIZE;
+  }
+
+  bucket_queue_.resize(max_distance_sq_ + 1);
+  sqrt_table_.resize(max_distance_sq_ + 1);
+  for (int i = 0; i <= max_distance_sq_; ++i)
+    sqrt_table_[i] = sqrt(double(i)) * resolution_;
+
+  reset();
+}
+
+void SparseDistanceField::reset()
+{
+  blocks_.clear();
+}
+
+std::int64_t SparseDistanceField::getBlockKey(const Eigen::Vector3i& cell) const
+{
+  return (std::int64_t(cell.x() / BLOCK_SIZE) * num_blocks_[DIM_Y] + cell.y() / BLOCK_SIZE) * num_blocks_[DIM_Z] +
+         cell.z() / BLOCK_SIZE;
+}
+
+int SparseDistanceField::getIndexInBlock(const Eigen::Vector3i& cell)
+{
+  return ((cell.x() % BLOCK_SIZE) * BLOCK_SIZE + cell.y() % BLOCK_SIZE) * BLOCK_SIZE + cell.z() % BLOCK_SIZE;
+}
+
+const SparseDistanceField::Block* SparseDistanceField::getBlock(const Eigen::Vector3i& cell) const
+{
+  auto it = blocks_.find(getBlockKey(cell));
+  return it == blocks_.end() ? nullptr : it->second.get();
+}
+
+SparseDistanceField::Block& SparseDistanceField::getOrCreateBlock(const Eigen::Vector3i& cell)
+{
+  std::unique_ptr<Block>& block = blocks_[getBlockKey(cell)];
+  if (!block)
+  {
+    block = std::make_unique<Block>();
+    std::fill(block->distance_square_, block->distance_square_ + BLOCK_SIZE * BLOCK_SIZE * BLOCK_SIZE,
+              max_distance_sq_);
+  }
+  return *block;
+}
+
+void SparseDistanceField::addPointsToField(const EigenSTL::vector_Vector3d& points)
+{
+  EigenSTL::vector_Vector3i cells;
+  cells.reserve(points.size());
+  for (const Eigen::Vector3d& point : points)
+  {
+    Eigen::Vector3i cell;
+    if (worldToGrid(point.x(), point.y(), point.z(), cell.x(), cell.y(), cell.z()))
+      cells.push_back(cell);
+  }
+  addObstacleCells(cells);
+}
+
+void SparseDistanceField::removePointsFromField(const EigenSTL::vector_Vector3d& points)
+{
+  EigenSTL::vector_Vector3i cells;
+  cells.reserve(points.size());
+  for (const Eigen::Vector3d& point : points)
+  {
+    Eigen::Vector3i cell;
+    if (worldToGrid(point.x(), point.y(), point.z(), cell.x(), cell.y(), cell.z()))
+      cells.push_back(cell);
+  }
+  removeObstacleCells(cells);
+}
+
+void SparseDistanceField::updatePointsInField(const EigenSTL::vector_Vector3d& old_points,
+                                              const EigenSTL::vector_Vector3d& new_points)
+{
+  typedef std::set<Eigen::Vector3i, CompareEigenVector3i, Eigen::aligned_allocator<Eigen::Vector3i>> VoxelSet;
+  VoxelSet old_cells, new_cells;
+  Eigen::Vector3i cell;
+  for (const Eigen::Vector3d& point : old_points)
+    if (worldToGrid(point.x(), point.y(), point.z(), cell.x(), cell.y(), cell.z()))
+      old_cells.insert(cell);
+  for (const Eigen::Vector3d& point : new_points)
+    if (worldToGrid(point.x(), point.y(), point.z(), cell.x(), cell.y(), cell.z()))
+      new_cells.insert(cell);
+
+  CompareEigenVector3i comp;
+  EigenSTL::vector_Vector3i old_not_new, new_not_old;
+  std::set_difference(old_cells.begin(), old_cells.end(), new_cells.begin(), new_cells.end(),
+                      std::back_inserter(old_not_new), comp);
+  std::set_difference(new_cells.begin(), new_cells.end(), old_cells.begin(), old_cells.end(),
+                      std::back_inserter(new_not_old), comp);
+  removeObstacleCells(old_not_new);
+  addObstacleCells(new_not_old);
+}
+
+void SparseDistanceField::addObstacleCells(const EigenSTL::vector_Vector3i& cells)
+{
+  for (const Eigen::Vector3i& cell : cells)
+  {
+    Block& block = getOrCreateBlock(cell);
+    const int index = getIndexInBlock(cell);
+    if (block.distance_square_[index] == 0)
+      continue;
+    block.distance_square_[index] = 0;
+    block.closest_point_[index] = cell;
+    bucket_queue_[0].push_back(cell);
+  }
+  propagate();
+}
+
+void SparseDistanceField::removeObstacleCells(const EigenSTL::vector_Vector3i& cells)
+{
+  EigenSTL::vector_Vector3i stack;
+  std::set<std::int64_t> reset_blocks;
+  for (const Eigen::Vector3i& cell : cells)
+  {
+    const Block* block = getBlock(cell);
+    const int index = getIndexInBlock(cell);
+    if (!block || block->distance_square_[index] != 0)
+      continue;
+    Block& mutable_block = getOrCreateBlock(cell);
+    mutable_block.distance_square_[index] = max_distance_sq_;
+    reset_blocks.insert(getBlockKey(cell));
+    stack.push_back(cell);
+  }
+
+  // Reset all cells whose closest obstacle cell is gone, and queue the cells bordering them that still have a valid
+  // closest obstacle cell, so their distances propagate into the reset region.
+  while (!stack.empty())
+  {
+    const Eigen::Vector3i loc = stack.back();
+    stack.pop_back();
+    for (int dx = -1; dx <= 1; ++dx)
+      for (int dy = -1; dy <= 1; ++dy)
+        for (int dz = -1; dz <= 1; ++dz)
+        {
+          const Eigen::Vector3i nloc(loc.x() + dx, loc.y() + dy, loc.z() + dz);
+          if (!isCellValid(nloc.x(), nloc.y(), nloc.z()))
+            continue;
+          auto it = blocks_.find(getBlockKey(nloc));
+          if (it == blocks_.end())
+            continue;
+          Block& nblock = *it->second;
+          const int nindex = getIndexInBlock(nloc);
+          const int ndistance = nblock.distance_square_[nindex];
+          if (ndistance >= max_distance_sq_)
+            continue;
+
+          Eigen::Vector3i closest;
+          if (getDistanceSquared(nblock.closest_point_[nindex].x(), nblock.closest_point_[nindex].y(),
+                                 nblock.closest_point_[nindex].z(), closest) != 0)
+          {
+            nblock.distance_square_[nindex] = max_distance_sq_;
+            reset_blocks.insert(it->first);
+            stack.push_back(nloc);
+          }
+          else
+            bucket_queue_[ndistance].push_back(nloc);
+        }
+  }
+  propagate();
+
+  // free the blocks that are not within the maximum distance of an obstacle anymore
+  for (std::int64_t key : reset_blocks)
+  {
+    auto it = blocks_.find(key);
+    const int* distances = it->second->distance_square_;
+    if (std::all_of(distances, distances + BLOCK_SIZE * BLOCK_SIZE * BLOCK_SIZE,
+                    [this](int distance) { return distance >= max_distance_sq_; }))
+      blocks_.erase(it);
+  }
+}
+
+void SparseDistanceField::propagate()
+{
+  // the block of the last neighbor, as neighbors mostly fall into the same block
+  std::int64_t cached_key = -1;
+  Block* cached_block = nullptr;
+
+  for (int i = 0; i <= max_distance_sq_; ++i)
+  {
+    // cells can be queued at the distance currently being processed, so the bucket may grow while iterating
+    for (std::size_t j = 0; j < bucket_queue_[i].size(); ++j)
+    {
+      const Eigen::Vector3i loc = bucket_queue_[i][j];
+      const Block* block = getBlock(loc);
+      const int index = getIndexInBlock(loc);
+      // skip cells that were queued again with a smaller distance
+      if (block->distance_square_[index] != i)
+        continue;
+      const Eigen::Vector3i closest = block->closest_point_[index];
+
+      for (int dx = -1; dx <= 1; ++dx)
+        for (int dy = -1; dy <= 1; ++dy)
+          for (int dz = -1; dz <= 1; ++dz)
+          {
+            const Eigen::Vector3i nloc(loc.x() + dx, loc.y() + dy, loc.z() + dz);
+            if (!isCellValid(nloc.x(), nloc.y(), nloc.z()))
+              continue;
+            const int new_distance_sq = (closest - nloc).squaredNorm();
+            if (new_distance_sq >= max_distance_sq_)
+              continue;
+
+            const std::int64_t key = getBlockKey(nloc);
+            if (key != cached_key)
+            {
+              cached_block = &getOrCreateBlock(nloc);
+              cached_key = key;
+            }
+            const int nindex = getIndexInBlock(nloc);
+            if (new_distance_sq < cached_block->distance_square_[nindex])
+            {
+              cached_block->distance_square_[nindex] = new_distance_sq;
+              cached_block->closest_point_[nindex] = closest;
+              bucket_queue_[new_distance_sq].push_back(nloc);
+            }
+          }
+    }
+    // release the memory of the bucket, the field is meant to stay small between updates
+    EigenSTL::vector_Vector3i().swap(bucket_queue_[i]);
+  }
+}
+
+int SparseDistanceField::getDistanceSquared(int x, int y, int z, Eigen::Vector3i& closest_point) const
+{
+  if (!isCellValid(x, y, z))
+    return max_distance_sq_;
+  const Eigen::Vector3i cell(x, y, z);
+  const Block* block = getBlock(cell);
+  if (!block)
+    return max_distance_sq_;
+  const int index = getIndexInBlock(cell);
+  closest_point = block->closest_point_[index];
+  return block->distance_square_[index];
+}
+
+double SparseDistanceField::getDistance(double x, double y, double z) const
+{
+  int cell_x, cell_y, cell_z;
+  if (!worldToGrid(x, y, z, cell_x, cell_y, cell_z))
+    return max_distance_;
+  return getDistance(cell_x, cell_y, cell_z);
+}
+
+double SparseDistanceField::getDistance(int x, int y, int z) const
+{
+  Eigen::Vector3i closest;
+  return sqrt_table_[getDistanceSquared(x, y, z, closest)];
+}
+
+bool SparseDistanceField::isCellValid(int x, int y, int z) const
+{
+  return x >= 0 && x < num_cells_[DIM_X] && y >= 0 && y < num_cells_[DIM_Y] && z >= 0 && z < num_cells_[DIM_Z];
+}
+
+int SparseDistanceField::getXNumCells() const
+{
+  return num_cells_[DIM_X];
+}
+
+int SparseDistanceField::getYNumCells() const
+{
+  return num_cells_[DIM_Y];
+}
+
+int SparseDistanceField::getZNumCells() const
+{
+  return num_cells_[DIM_Z];
+}
+
+bool SparseDistanceField::gridToWorld(int x, int y, int z, double& world_x, double& world_y, double& world_z) const
+{
+  world_x = origin_x_ + resolution_ * double(x);
+  world_y = origin_y_ + resolution_ * double(y);
+  world_z = origin_z_ + resolution_ * double(z);
+  return true;
+}
+
+bool SparseDistanceField::worldToGrid(double world_x, double world_y, double world_z, int& x, int& y, int& z) const
+{
+  // the rounded quantized location, as in VoxelGrid
+  x = int(floor((world_x - origin_x_) / resolution_ + 0.5));
+  y = int(floor((world_y - origin_y_) / resolution_ + 0.5));
+  z = int(floor((world_z - origin_z_) / resolution_ + 0.5));
+  return isCellValid(x, y, z);
+}
+
+std::size_t SparseDistanceField::getMemoryUsage() const
+{
+  // each hash map node holds the key, the block pointer and the link to the next node
+  std::size_t bytes = sizeof(*this) + blocks_.bucket_count() * sizeof(void*) +
+                      blocks_.size() * (sizeof(Block) + sizeof(std::int64_t) + 2 * sizeof(void*));
+  bytes += sqrt_table_.capacity() * sizeof(double);
+  bytes += bucket_queue_.capacity() * sizeof(EigenSTL::vector_Vector3i);
+  for (const EigenSTL::vector_Vector3i& bucket : bucket_queue_)
+    bytes += bucket.capacity() * sizeof(Eigen::Vector3i);
+  return bytes;
+}
+
+bool SparseDistanceField::writeToStream(std::ostream& os) const
+{
+  os << "resolution: " << resolution_ << std::endl;
+  os << "size_x: " << size_x_ << std::endl;
+  os << "size_y: " << size_y_ << std::endl;
+  os << "size_z: " << size_z_ << std::endl;
+  os << "origin_x: " << origin_x_ << std::endl;
+  os << "origin_y: " << origin_y_ << std::endl;
+  os << "origin_z: " << origin_z_ << std::endl;
+
+  EigenSTL::vector_Vector3i obstacles;
+  for (const auto& block : blocks_)
+    for (int i = 0; i < BLOCK_SIZE * BLOCK_SIZE * BLOCK_SIZE; ++i)
+      if (block.second->distance_square_[i] == 0)
+        obstacles.push_back(block.second->closest_point_[i]);
+
+  boost::iostreams::filtering_ostream out;
+  out.push(boost::iostreams::zlib_compressor());
+  out.push(os);
+  const std::uint32_t count = obstacles.size();
+  out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+  for (const Eigen::Vector3i& obstacle : obstacles)
+    out.write(reinterpret_cast<const char*>(obstacle.data()), 3 * sizeof(int));
+  out.flush();
+  return true;
+}
+
+bool SparseDistanceField::readFromStream(std::istream& is)
+{
+  if (!is.good())
+    return false;
+
+  std::string temp;
+  const char* names[] = { "resolution:", "size_x:", "size_y:", "size_z:", "origin_x:", "origin_y:", "origin_z:" };
+  double* values[] = { &resolution_, &size_x_, &size_y_, &size_z_, &origin_x_, &origin_y_, &origin_z_ };
+  for (std::size_t i = 0; i < 7; ++i)
+  {
+    is >> temp;
+    if (temp != names[i])
+      return false;
+    is >> *values[i];
+  }
+  inv_twice_resolution_ = 1.0 / (2.0 * resolution_);
+
+  // previous value for max_distance_ will be used
+  initialize();
+
+  // this should be newline
+  char nl;
+  is.get(nl);
+
+  boost::iostreams::filtering_istream in;
+  in.push(boost::iostreams::zlib_decompressor());
+  in.push(is);
+
+  std::uint32_t count;
+  if (!in.read(reinterpret_cast<char*>(&count), sizeof(count)))
+    return false;
+  EigenSTL::vector_Vector3i obstacles(count);
+  for (Eigen::Vector3i& obstacle : obstacles)
+  {
+    if (!in.read(reinterpret_cast<char*>(obstacle.data()), 3 * sizeof(int)))
+      return false;
+    if (!isCellValid(obstacle.x(), obstacle.y(), obstacle.z()))
+    {
+      ROS_ERROR_NAMED("distance_field", "Invalid obstacle cell %d %d %d in stream", obstacle.x(), obstacle.y(),
+                      obstacle.z());
+      return false;
+    }
+  }
+  addObstacleCells(obstacles);
+  return true;
+}
+}  // namespace distance_field
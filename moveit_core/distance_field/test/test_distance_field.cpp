@@ -648,6 +648,75 @@ TEST(TestSignedPropagationDistanceField, TestShape)
   ASSERT_TRUE(areDistanceFieldsDistancesEqual(df, test_df));
 }
 
+// compares the separable distance transform to the brute force closest obstacle and free cells
+void check_exact_distance_field(const PropagationDistanceField& df)
+{
+  const int max_dsq = df.getMaximumDistanceSquared();
+  for (int x = 0; x < df.getXNumCells(); x++)
+  {
+    for (int y = 0; y < df.getYNumCells(); y++)
+    {
+      for (int z = 0; z < df.getZNumCells(); z++)
+      {
+        int dsq = max_dsq;
+        int ndsq = max_dsq;
+        for (int ox = 0; ox < df.getXNumCells(); ox++)
+          for (int oy = 0; oy < df.getYNumCells(); oy++)
+            for (int oz = 0; oz < df.getZNumCells(); oz++)
+            {
+              if (df.getCell(ox, oy, oz).distance_square_ == 0)
+                dsq = std::min(dsq, dist_sq(ox - x, oy - y, oz - z));
+              else
+                ndsq = std::min(ndsq, dist_sq(ox - x, oy - y, oz - z));
+            }
+        const PropDistanceFieldVoxel& cell = df.getCell(x, y, z);
+        ASSERT_EQ(cell.distance_square_, dsq) << "Cell " << x << " " << y << " " << z;
+        ASSERT_EQ(cell.negative_distance_square_, dsq == 0 ? ndsq : 0) << "Cell " << x << " " << y << " " << z;
+        if (dsq > 0 && dsq < max_dsq)
+          ASSERT_EQ((cell.closest_point_ - Eigen::Vector3i(x, y, z)).squaredNorm(), dsq);
+      }
+    }
+  }
+}
+
+TEST(TestSignedPropagationDistanceField, TestSeparableEDT)
+{
+  PropagationDistanceField df(WIDTH, HEIGHT, DEPTH, RESOLUTION, ORIGIN_X, ORIGIN_Y, ORIGIN_Z, MAX_DIST, true,
+                              PropagationMethod::SEPARABLE_EDT);
+  EXPECT_EQ(df.getPropagationMethod(), PropagationMethod::SEPARABLE_EDT);
+
+  shapes::Sphere sphere(.25);
+  Eigen::Isometry3d p = Eigen::Translation3d(0.5, 0.5, 0.5) * Eigen::Quaterniond(0.0, 0.0, 0.0, 1.0);
+  Eigen::Isometry3d np = Eigen::Translation3d(0.7, 0.7, 0.7) * Eigen::Quaterniond(0.0, 0.0, 0.0, 1.0);
+
+  EigenSTL::vector_Vector3d points;
+  points.push_back(POINT1);
+  points.push_back(POINT2);
+  points.push_back(POINT3);
+  df.addPointsToField(points);
+  df.addShapeToField(&sphere, p);
+  check_exact_distance_field(df);
+
+  // the bucket queue propagation never reports smaller distances than the exact transform
+  PropagationDistanceField bucket_df(WIDTH, HEIGHT, DEPTH, RESOLUTION, ORIGIN_X, ORIGIN_Y, ORIGIN_Z, MAX_DIST, true);
+  bucket_df.addPointsToField(points);
+  bucket_df.addShapeToField(&sphere, p);
+  for (int x = 0; x < df.getXNumCells(); x++)
+    for (int y = 0; y < df.getYNumCells(); y++)
+      for (int z = 0; z < df.getZNumCells(); z++)
+        ASSERT_GE(bucket_df.getDistance(x, y, z), df.getDistance(x, y, z) - 1e-9);
+
+  df.removePointsFromField(points);
+  df.moveShapeInField(&sphere, p, np);
+  check_exact_distance_field(df);
+
+  // should be equivalent to just adding the moved shape
+  PropagationDistanceField test_df(WIDTH, HEIGHT, DEPTH, RESOLUTION, ORIGIN_X, ORIGIN_Y, ORIGIN_Z, MAX_DIST, true,
+                                   PropagationMethod::SEPARABLE_EDT);
+  test_df.addShapeToField(&sphere, np);
+  EXPECT_TRUE(areDistanceFieldsDistancesEqual(df, test_df));
+}
+
 static const double PERF_WIDTH = 3.0;
 static const double PERF_HEIGHT = 3.0;
 static const double PERF_DEPTH = 4.0;
@@ -784,6 +853,42 @@ TEST(TestSignedPropagationDistanceField, TestPerformance)
          wd.toSec() / (bad_vec.size() * 1.0));
 }
 
+TEST(TestSignedPropagationDistanceField, TestSeparableEDTPerformance)
+{
+  // a dense update, as for an octomap of a cluttered workspace
+  EigenSTL::vector_Vector3d points;
+  for (double x = PERF_RESOLUTION; x < PERF_WIDTH; x += UNIFORM_DISTANCE * PERF_RESOLUTION)
+    for (double y = PERF_RESOLUTION; y < PERF_HEIGHT; y += UNIFORM_DISTANCE * PERF_RESOLUTION)
+      for (double z = PERF_RESOLUTION; z < PERF_DEPTH; z += UNIFORM_DISTANCE * PERF_RESOLUTION)
+        points.push_back(Eigen::Vector3d(x, y, z));
+  shapes::Box big_table(2.0, 2.0, .5);
+  Eigen::Isometry3d p = Eigen::Translation3d(PERF_WIDTH / 2.0, PERF_DEPTH / 2.0, PERF_HEIGHT / 2.0) *
+                        Eigen::Quaterniond(0.0, 0.0, 0.0, 1.0);
+
+  for (bool negative : { false, true })
+  {
+    PropagationDistanceField bucket_df(PERF_WIDTH, PERF_HEIGHT, PERF_DEPTH, PERF_RESOLUTION, PERF_ORIGIN_X,
+                                       PERF_ORIGIN_Y, PERF_ORIGIN_Z, PERF_MAX_DIST, negative);
+    PropagationDistanceField edt_df(PERF_WIDTH, PERF_HEIGHT, PERF_DEPTH, PERF_RESOLUTION, PERF_ORIGIN_X,
+                                    PERF_ORIGIN_Y, PERF_ORIGIN_Z, PERF_MAX_DIST, negative,
+                                    PropagationMethod::SEPARABLE_EDT);
+
+    ros::WallTime dt = ros::WallTime::now();
+    bucket_df.addPointsToField(points);
+    bucket_df.addShapeToField(&big_table, p);
+    double bucket_time = (ros::WallTime::now() - dt).toSec();
+
+    dt = ros::WallTime::now();
+    edt_df.addPointsToField(points);
+    edt_df.addShapeToField(&big_table, p);
+    double edt_time = (ros::WallTime::now() - dt).toSec();
+
+    printf("Adding %u points to %s field: bucket queue %g s, separable EDT %g s\n", (unsigned int)points.size(),
+           negative ? "signed" : "unsigned", bucket_time, edt_time);
+    EXPECT_EQ(countOccupiedCells(bucket_df), countOccupiedCells(edt_df));
+  }
+}
+
 TEST(TestSignedPropagationDistanceField, TestOcTree)
 {
   PropagationDistanceField df(PERF_WIDTH, PERF_HEIGHT, PERF_DEPTH, PERF_RESOLUTION, PERF_ORIGIN_X, PERF_ORIGIN_Y,
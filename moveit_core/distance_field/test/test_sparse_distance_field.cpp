@@ -0,0 +1,200 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, MoveIt maintainers
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <moveit/distance_field/sparse_distance_field.h>
+#include <moveit/distance_field/propagation_distance_field.h>
+#include <geometric_shapes/shapes.h>
+#include <sstream>
+
+using namespace distance_field;
+
+static const double WIDTH = 1.0;
+static const double HEIGHT = 1.2;
+static const double DEPTH = 0.8;
+static const double RESOLUTION = 0.02;
+static const double MAX_DIST = 0.2;
+
+// a box and a few scattered cells
+EigenSTL::vector_Vector3d boxPoints()
+{
+  EigenSTL::vector_Vector3d points;
+  for (double x = 0.3; x < 0.6; x += RESOLUTION)
+    for (double y = 0.3; y < 0.7; y += RESOLUTION)
+      for (double z = 0.2; z < 0.4; z += RESOLUTION)
+        points.push_back(Eigen::Vector3d(x, y, z));
+  return points;
+}
+
+EigenSTL::vector_Vector3d scatteredPoints()
+{
+  EigenSTL::vector_Vector3d points;
+  for (int i = 0; i < 50; ++i)
+    points.push_back(Eigen::Vector3d(0.02 * ((i * 7) % 50), 0.02 * ((i * 13) % 60), 0.02 * ((i * 17) % 40)));
+  return points;
+}
+
+// the propagated distances never underestimate the exact distances and overestimate them by at most one cell
+void expectNearExact(const SparseDistanceField& df, const PropagationDistanceField& exact)
+{
+  ASSERT_EQ(df.getXNumCells(), exact.getXNumCells());
+  ASSERT_EQ(df.getYNumCells(), exact.getYNumCells());
+  ASSERT_EQ(df.getZNumCells(), exact.getZNumCells());
+  for (int x = 0; x < df.getXNumCells(); ++x)
+    for (int y = 0; y < df.getYNumCells(); ++y)
+      for (int z = 0; z < df.getZNumCells(); ++z)
+      {
+        Eigen::Vector3i closest;
+        const int dsq = df.getDistanceSquared(x, y, z, closest);
+        ASSERT_GE(dsq, exact.getCell(x, y, z).distance_square_) << "Cell " << x << " " << y << " " << z;
+        ASSERT_NEAR(df.getDistance(x, y, z), exact.getDistance(x, y, z), RESOLUTION)
+            << "Cell " << x << " " << y << " " << z;
+        if (dsq < df.getMaximumDistanceSquared())
+          ASSERT_EQ((closest - Eigen::Vector3i(x, y, z)).squaredNorm(), dsq);
+      }
+}
+
+TEST(TestSparseDistanceField, TestAddRemovePoints)
+{
+  SparseDistanceField df(WIDTH, HEIGHT, DEPTH, RESOLUTION, 0.0, 0.0, 0.0, MAX_DIST);
+  PropagationDistanceField exact(WIDTH, HEIGHT, DEPTH, RESOLUTION, 0.0, 0.0, 0.0, MAX_DIST, false,
+                                 PropagationMethod::SEPARABLE_EDT);
+  EXPECT_EQ(df.getBlockCount(), 0u);
+  EXPECT_NEAR(df.getDistance(0.5, 0.5, 0.5), MAX_DIST, 1e-9);
+  EXPECT_NEAR(df.getDistance(1000.0, 1000.0, 1000.0), MAX_DIST, 1e-9);
+
+  df.addPointsToField(boxPoints());
+  df.addPointsToField(scatteredPoints());
+  exact.addPointsToField(boxPoints());
+  exact.addPointsToField(scatteredPoints());
+  expectNearExact(df, exact);
+  EXPECT_NEAR(df.getDistance(0.4, 0.4, 0.3), 0.0, 1e-9);
+
+  // removing the scattered cells leaves the distances of the box
+  df.removePointsFromField(scatteredPoints());
+  PropagationDistanceField box_exact(WIDTH, HEIGHT, DEPTH, RESOLUTION, 0.0, 0.0, 0.0, MAX_DIST, false,
+                                     PropagationMethod::SEPARABLE_EDT);
+  box_exact.addPointsToField(boxPoints());
+  expectNearExact(df, box_exact);
+
+  // blocks are only allocated within the maximum distance of the box
+  const int margin = MAX_DIST / RESOLUTION;
+  const int box_blocks_x = (0.3 / RESOLUTION + 2 * margin) / SparseDistanceField::BLOCK_SIZE + 2;
+  const int box_blocks_y = (0.4 / RESOLUTION + 2 * margin) / SparseDistanceField::BLOCK_SIZE + 2;
+  const int box_blocks_z = (0.2 / RESOLUTION + 2 * margin) / SparseDistanceField::BLOCK_SIZE + 2;
+  EXPECT_LE(df.getBlockCount(), std::size_t(box_blocks_x * box_blocks_y * box_blocks_z));
+
+  df.removePointsFromField(boxPoints());
+  EXPECT_EQ(df.getBlockCount(), 0u);
+  EXPECT_NEAR(df.getDistance(0.4, 0.4, 0.3), MAX_DIST, 1e-9);
+}
+
+TEST(TestSparseDistanceField, TestGradient)
+{
+  SparseDistanceField df(WIDTH, HEIGHT, DEPTH, RESOLUTION, 0.0, 0.0, 0.0, MAX_DIST);
+  shapes::Box box(0.3, 0.3, 0.3);
+  df.addShapeToField(&box, Eigen::Isometry3d(Eigen::Translation3d(0.5, 0.6, 0.4)));
+
+  // next to the +x face of the box, the gradient points away from it along x
+  double gradient_x, gradient_y, gradient_z;
+  bool in_bounds;
+  const double distance = df.getDistanceGradient(0.76, 0.6, 0.4, gradient_x, gradient_y, gradient_z, in_bounds);
+  EXPECT_TRUE(in_bounds);
+  EXPECT_NEAR(distance, 0.11, RESOLUTION);
+  EXPECT_GT(gradient_x, 0.0);
+  EXPECT_GT(gradient_x, std::abs(gradient_y));
+  EXPECT_GT(gradient_x, std::abs(gradient_z));
+
+  // far from the box the distance is the maximum distance and the gradient vanishes
+  EXPECT_NEAR(df.getDistanceGradient(0.05, 0.05, 0.05, gradient_x, gradient_y, gradient_z, in_bounds), MAX_DIST,
+              1e-9);
+  EXPECT_NEAR(gradient_x, 0.0, 1e-9);
+}
+
+TEST(TestSparseDistanceField, TestUpdatePoints)
+{
+  SparseDistanceField df(WIDTH, HEIGHT, DEPTH, RESOLUTION, 0.0, 0.0, 0.0, MAX_DIST);
+  df.addPointsToField(scatteredPoints());
+  df.updatePointsInField(scatteredPoints(), boxPoints());
+
+  PropagationDistanceField exact(WIDTH, HEIGHT, DEPTH, RESOLUTION, 0.0, 0.0, 0.0, MAX_DIST, false,
+                                 PropagationMethod::SEPARABLE_EDT);
+  exact.addPointsToField(boxPoints());
+  expectNearExact(df, exact);
+}
+
+TEST(TestSparseDistanceField, TestReadWrite)
+{
+  SparseDistanceField df(WIDTH, HEIGHT, DEPTH, RESOLUTION, 0.0, 0.0, 0.0, MAX_DIST);
+  df.addPointsToField(boxPoints());
+  df.addPointsToField(scatteredPoints());
+
+  std::stringstream stream;
+  ASSERT_TRUE(df.writeToStream(stream));
+  SparseDistanceField df2(stream, MAX_DIST);
+  ASSERT_EQ(df.getBlockCount(), df2.getBlockCount());
+  for (int x = 0; x < df.getXNumCells(); ++x)
+    for (int y = 0; y < df.getYNumCells(); ++y)
+      for (int z = 0; z < df.getZNumCells(); ++z)
+        ASSERT_EQ(df.getDistance(x, y, z), df2.getDistance(x, y, z));
+}
+
+TEST(TestSparseDistanceField, TestMemoryUsage)
+{
+  // two walls in a 20 x 20 x 3 m workspace at 2 cm, which would need billions of bytes as a dense grid
+  SparseDistanceField df(20.0, 20.0, 3.0, RESOLUTION, 0.0, 0.0, 0.0, MAX_DIST);
+  EigenSTL::vector_Vector3d points;
+  for (double x = 5.0; x < 15.0; x += RESOLUTION)
+    for (double z = 0.0; z < 2.0; z += RESOLUTION)
+    {
+      points.push_back(Eigen::Vector3d(x, 5.0, z));
+      points.push_back(Eigen::Vector3d(x, 10.0, z));
+    }
+  df.addPointsToField(points);
+
+  const std::size_t dense_bytes =
+      std::size_t(df.getXNumCells()) * df.getYNumCells() * df.getZNumCells() * sizeof(PropDistanceFieldVoxel);
+  std::cout << "Sparse distance field uses " << df.getMemoryUsage() / (1024 * 1024) << " MB in "
+            << df.getBlockCount() << " blocks, a dense field " << dense_bytes / (1024 * 1024) << " MB" << std::endl;
+  EXPECT_LT(df.getMemoryUsage(), dense_bytes / 50);
+  EXPECT_NEAR(df.getDistance(10.0, 5.1, 1.0), 0.1, 1e-9);
+  EXPECT_NEAR(df.getDistance(10.0, 7.5, 1.0), MAX_DIST, 1e-9);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
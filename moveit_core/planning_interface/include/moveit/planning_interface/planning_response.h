@@ -54,6 +54,11 @@ struct MotionPlanResponse
   robot_trajectory::RobotTrajectoryPtr trajectory_;
   double planning_time_;
   moveit_msgs::MoveItErrorCodes error_code_;
+
+  /** \brief The description of each planning request adapter that processed the request, in the order they were
+      applied, with the wall time (in seconds) spent in that adapter itself, excluding the adapters and the planner
+      it called. Filled in by planning_request_adapter::PlanningRequestAdapterChain */
+  std::vector<std::pair<std::string, double> > adapter_processing_time_;
 };
 
 struct MotionPlanDetailedResponse
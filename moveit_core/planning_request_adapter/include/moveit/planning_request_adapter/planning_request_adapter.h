@@ -90,6 +90,14 @@ public:
                             const planning_interface::MotionPlanRequest& req,
                             planning_interface::MotionPlanResponse& res,
                             std::vector<std::size_t>& added_path_index) const = 0;
+
+protected:
+  /** \brief Get the start state specified by \e req, completed with the current state of \e planning_scene.
+      When called from within a PlanningRequestAdapterChain, the state is computed only once and then shared by all
+      adapters that receive the same request, until one of them passes a modified request on. The returned state
+      must not be modified; adapters that need to change it have to make a copy. */
+  static moveit::core::RobotStateConstPtr getStartState(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                                                        const planning_interface::MotionPlanRequest& req);
 };
 
 /// Apply a sequence of adapters to a motion plan
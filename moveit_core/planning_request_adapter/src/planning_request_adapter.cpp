@@ -35,6 +35,8 @@
 /* Author: Ioan Sucan */
 
 #include <moveit/planning_request_adapter/planning_request_adapter.h>
+#include <moveit/robot_state/conversions.h>
+#include <ros/time.h>
 #include <boost/bind.hpp>
 #include <algorithm>
 
@@ -55,68 +57,122 @@ bool callPlannerInterfaceSolve(const planning_interface::PlannerManager* planner
   else
     return false;
 }
-}  // namespace
 
-bool PlanningRequestAdapter::adaptAndPlan(const planning_interface::PlannerManagerPtr& planner,
-                                          const planning_scene::PlanningSceneConstPtr& planning_scene,
-                                          const planning_interface::MotionPlanRequest& req,
-                                          planning_interface::MotionPlanResponse& res,
-                                          std::vector<std::size_t>& added_path_index) const
+// The request context threaded through a running adapter chain: one entry per nesting level, holding the request
+// that level received and, once some adapter asked for it, the start state decoded from that request
+struct RequestContext
+{
+  const planning_interface::MotionPlanRequest* req_;
+  const planning_scene::PlanningScene* planning_scene_;
+  moveit::core::RobotStateConstPtr start_state_;
+};
+
+thread_local std::vector<RequestContext> request_contexts;
+
+// Enter a level of the adapter chain for the duration of an adapter call
+class RequestContextScope
+{
+public:
+  RequestContextScope(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                      const planning_interface::MotionPlanRequest& req)
+  {
+    request_contexts.push_back(RequestContext{ &req, planning_scene.get(), moveit::core::RobotStateConstPtr() });
+  }
+
+  ~RequestContextScope()
+  {
+    request_contexts.pop_back();
+  }
+};
+
+moveit::core::RobotStatePtr computeStartState(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                                              const planning_interface::MotionPlanRequest& req)
 {
-  return adaptAndPlan(boost::bind(&callPlannerInterfaceSolve, planner.get(), _1, _2, _3), planning_scene, req, res,
-                      added_path_index);
+  moveit::core::RobotStatePtr start_state(new moveit::core::RobotState(planning_scene->getCurrentState()));
+  moveit::core::robotStateMsgToRobotState(planning_scene->getTransforms(), req.start_state, *start_state);
+  start_state->update();
+  return start_state;
 }
+}  // namespace
 
-bool PlanningRequestAdapter::adaptAndPlan(const planning_interface::PlannerManagerPtr& planner,
-                                          const planning_scene::PlanningSceneConstPtr& planning_scene,
-                                          const planning_interface::MotionPlanRequest& req,
-                                          planning_interface::MotionPlanResponse& res) const
+moveit::core::RobotStateConstPtr
+PlanningRequestAdapter::getStartState(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                                      const planning_interface::MotionPlanRequest& req)
 {
-  std::vector<std::size_t> dummy;
-  return adaptAndPlan(planner, planning_scene, req, res, dummy);
+  if (request_contexts.empty() || request_contexts.back().req_ != &req ||
+      request_contexts.back().planning_scene_ != planning_scene.get())
+    return computeStartState(planning_scene, req);
+
+  // consecutive levels that passed the request on unchanged share the state stored at the outermost of them
+  std::size_t level = request_contexts.size() - 1;
+  while (level > 0 && request_contexts[level - 1].req_ == &req &&
+         request_contexts[level - 1].planning_scene_ == planning_scene.get())
+    --level;
+  if (!request_contexts[level].start_state_)
+    request_contexts[level].start_state_ = computeStartState(planning_scene, req);
+  return request_contexts[level].start_state_;
 }
 
 namespace
 {
 // boost bind is not happy with overloading, so we add intermediate function objects
 
-bool callAdapter1(const PlanningRequestAdapter* adapter, const planning_interface::PlannerManagerPtr& planner,
-                  const planning_scene::PlanningSceneConstPtr& planning_scene,
-                  const planning_interface::MotionPlanRequest& req, planning_interface::MotionPlanResponse& res,
-                  std::vector<std::size_t>& added_path_index)
+bool callTimedPlannerInterfaceSolve(const planning_interface::PlannerManagerPtr& planner, double* elapsed,
+                                    const planning_scene::PlanningSceneConstPtr& planning_scene,
+                                    const planning_interface::MotionPlanRequest& req,
+                                    planning_interface::MotionPlanResponse& res)
 {
-  try
-  {
-    return adapter->adaptAndPlan(planner, planning_scene, req, res, added_path_index);
-  }
-  catch (std::exception& ex)
-  {
-    ROS_ERROR_NAMED("planning_request_adapter", "Exception caught executing *final* adapter '%s': %s",
-                    adapter->getDescription().c_str(), ex.what());
-    added_path_index.clear();
-    return callPlannerInterfaceSolve(planner.get(), planning_scene, req, res);
-  }
+  ros::WallTime start = ros::WallTime::now();
+  bool result = callPlannerInterfaceSolve(planner.get(), planning_scene, req, res);
+  *elapsed += (ros::WallTime::now() - start).toSec();
+  return result;
 }
 
-bool callAdapter2(const PlanningRequestAdapter* adapter, const PlanningRequestAdapter::PlannerFn& planner,
-                  const planning_scene::PlanningSceneConstPtr& planning_scene,
-                  const planning_interface::MotionPlanRequest& req, planning_interface::MotionPlanResponse& res,
-                  std::vector<std::size_t>& added_path_index)
+bool callAdapter(const PlanningRequestAdapter* adapter, const PlanningRequestAdapter::PlannerFn& planner,
+                 double* elapsed, const planning_scene::PlanningSceneConstPtr& planning_scene,
+                 const planning_interface::MotionPlanRequest& req, planning_interface::MotionPlanResponse& res,
+                 std::vector<std::size_t>& added_path_index)
 {
+  RequestContextScope scope(planning_scene, req);
+  ros::WallTime start = ros::WallTime::now();
+  bool result;
   try
   {
-    return adapter->adaptAndPlan(planner, planning_scene, req, res, added_path_index);
+    result = adapter->adaptAndPlan(planner, planning_scene, req, res, added_path_index);
   }
   catch (std::exception& ex)
   {
-    ROS_ERROR_NAMED("planning_request_adapter", "Exception caught executing *next* adapter '%s': %s",
+    ROS_ERROR_NAMED("planning_request_adapter", "Exception caught executing adapter '%s': %s",
                     adapter->getDescription().c_str(), ex.what());
     added_path_index.clear();
-    return planner(planning_scene, req, res);
+    result = planner(planning_scene, req, res);
   }
+  *elapsed += (ros::WallTime::now() - start).toSec();
+  return result;
 }
 }  // namespace
 
+bool PlanningRequestAdapter::adaptAndPlan(const planning_interface::PlannerManagerPtr& planner,
+                                          const planning_scene::PlanningSceneConstPtr& planning_scene,
+                                          const planning_interface::MotionPlanRequest& req,
+                                          planning_interface::MotionPlanResponse& res,
+                                          std::vector<std::size_t>& added_path_index) const
+{
+  // run as the only level of a chain, so getStartState() shares the start state with the adapter
+  double elapsed = 0.0;
+  return callAdapter(this, boost::bind(&callPlannerInterfaceSolve, planner.get(), _1, _2, _3), &elapsed,
+                     planning_scene, req, res, added_path_index);
+}
+
+bool PlanningRequestAdapter::adaptAndPlan(const planning_interface::PlannerManagerPtr& planner,
+                                          const planning_scene::PlanningSceneConstPtr& planning_scene,
+                                          const planning_interface::MotionPlanRequest& req,
+                                          planning_interface::MotionPlanResponse& res) const
+{
+  std::vector<std::size_t> dummy;
+  return adaptAndPlan(planner, planning_scene, req, res, dummy);
+}
+
 bool PlanningRequestAdapterChain::adaptAndPlan(const planning_interface::PlannerManagerPtr& planner,
                                                const planning_scene::PlanningSceneConstPtr& planning_scene,
                                                const planning_interface::MotionPlanRequest& req,
@@ -136,22 +192,36 @@ bool PlanningRequestAdapterChain::adaptAndPlan(const planning_interface::Planner
   if (adapters_.empty())
   {
     added_path_index.clear();
+    res.adapter_processing_time_.clear();
     return callPlannerInterfaceSolve(planner.get(), planning_scene, req, res);
   }
   else
   {
     // the index values added by each adapter
     std::vector<std::vector<std::size_t> > added_path_index_each(adapters_.size());
+    // the wall time spent in each adapter, including all nested calls; the last entry is the time spent in the planner
+    std::vector<double> elapsed(adapters_.size() + 1, 0.0);
 
     // if there are adapters, construct a function pointer for each, in order,
     // so that in the end we have a nested sequence of function pointers that call the adapters in the correct order.
-    PlanningRequestAdapter::PlannerFn fn = boost::bind(&callAdapter1, adapters_.back().get(), planner, _1, _2, _3,
-                                                       boost::ref(added_path_index_each.back()));
-    for (int i = adapters_.size() - 2; i >= 0; --i)
-      fn = boost::bind(&callAdapter2, adapters_[i].get(), fn, _1, _2, _3, boost::ref(added_path_index_each[i]));
+    PlanningRequestAdapter::PlannerFn fn =
+        boost::bind(&callTimedPlannerInterfaceSolve, planner, &elapsed.back(), _1, _2, _3);
+    for (int i = adapters_.size() - 1; i >= 0; --i)
+      fn = boost::bind(&callAdapter, adapters_[i].get(), fn, &elapsed[i], _1, _2, _3,
+                       boost::ref(added_path_index_each[i]));
     bool result = fn(planning_scene, req, res);
     added_path_index.clear();
 
+    // report the time spent in each adapter itself
+    res.adapter_processing_time_.clear();
+    for (std::size_t i = 0; i < adapters_.size(); ++i)
+    {
+      res.adapter_processing_time_.emplace_back(adapters_[i]->getDescription(),
+                                                std::max(0.0, elapsed[i] - elapsed[i + 1]));
+      ROS_DEBUG_NAMED("planning_request_adapter", "Adapter '%s' took %lf seconds",
+                      adapters_[i]->getDescription().c_str(), res.adapter_processing_time_.back().second);
+    }
+
     // merge the index values from each adapter
     for (std::vector<std::size_t>& added_states_by_each_adapter : added_path_index_each)
       for (std::size_t& added_index : added_states_by_each_adapter)
@@ -287,6 +287,10 @@ public:
     return world_const_;
   }
 
+  /** \brief Get the memory held by the worlds of this scene and of all its parents. Objects and shapes that the
+      worlds share are counted once. */
+  collision_detection::World::MemoryUsage getWorldMemoryUsage() const;
+
   // brief Get the representation of the world
   const collision_detection::WorldPtr& getWorldNonConst()
   {
@@ -369,6 +373,13 @@ public:
   bool isStateColliding(const moveit::core::RobotState& state, const std::string& group = "",
                         bool verbose = false) const;
 
+  /** \brief Check which of the given states are in collision (with the environment or self collision), in parallel.
+      The same checks as in isStateColliding() are performed. It is expected that the link transforms of \e states are
+      up to date. If \e first_collision_only is true, states after the first colliding one may remain unchecked and are
+      reported as not colliding. Returns the index of the first colliding state, -1 if no state is in collision. */
+  int areStatesColliding(const std::vector<const moveit::core::RobotState*>& states, std::vector<bool>& colliding,
+                         const std::string& group = "", bool verbose = false, bool first_collision_only = false) const;
+
   /** \brief Check if a given state is in collision (with the environment or self collision)
       If a group name is specified, collision checking is done for that group only. */
   bool isStateColliding(const moveit_msgs::RobotState& state, const std::string& group = "", bool verbose = false) const;
@@ -685,6 +696,16 @@ public:
      */
   void getPlanningSceneDiffMsg(moveit_msgs::PlanningScene& scene) const;
 
+  /** \brief Fill the message \e scene with the differences of this scene's world to \e reference, a copy of this
+      scene's world taken earlier (e.g. when the scene was last published). Objects that are the same as in \e reference
+      are left out, objects whose shapes did not change are sent as MOVE operations without their geometry, and shapes
+      are compared by content, so re-adding an identical object does not resend it. The octomap is included if it was
+      replaced or if \e include_octomap is true, since the octree may be modified in place. All other parts of the
+      scene are included completely, as in getPlanningSceneMsg().
+      Returns false if the differences cannot be expressed as a diff message (the octomap was removed). */
+  bool getPlanningSceneDeltaMsg(moveit_msgs::PlanningScene& scene, const collision_detection::World& reference,
+                                bool include_octomap = false) const;
+
   /** \brief Construct a message (\e scene) with all the necessary data so that the scene can be later reconstructed to
      be
       exactly the same using setPlanningSceneMsg() */
@@ -894,7 +915,11 @@ public:
 
   /** \brief Check if a given path is valid. Each state is checked for validity (collision avoidance, feasibility and
    * constraint satisfaction). It is also checked that the goal constraints are satisfied by the last state on the
-   * passed in trajectory. */
+   * passed in trajectory.
+   *
+   * Collisions are checked in parallel with areStatesColliding(). If \e invalid_index is not requested, the check stops
+   * at the first invalid waypoint. Path constraints and the feasibility predicate are evaluated in the calling thread,
+   * so the predicate does not need to be thread-safe. */
   bool isPathValid(const robot_trajectory::RobotTrajectory& trajectory,
                    const moveit_msgs::Constraints& path_constraints,
                    const std::vector<moveit_msgs::Constraints>& goal_constraints, const std::string& group = "",
@@ -790,6 +790,73 @@ bool PlanningScene::getCollisionObjectMsg(moveit_msgs::CollisionObject& collisio
   return true;
 }
 
+namespace
+{
+// check whether two shapes have the same content
+bool haveSameContent(const shapes::Shape& a, const shapes::Shape& b)
+{
+  if (&a == &b)
+    return true;
+  if (a.type != b.type)
+    return false;
+  switch (a.type)
+  {
+    case shapes::SPHERE:
+      return static_cast<const shapes::Sphere&>(a).radius == static_cast<const shapes::Sphere&>(b).radius;
+    case shapes::CYLINDER:
+      return static_cast<const shapes::Cylinder&>(a).radius == static_cast<const shapes::Cylinder&>(b).radius &&
+             static_cast<const shapes::Cylinder&>(a).length == static_cast<const shapes::Cylinder&>(b).length;
+    case shapes::CONE:
+      return static_cast<const shapes::Cone&>(a).radius == static_cast<const shapes::Cone&>(b).radius &&
+             static_cast<const shapes::Cone&>(a).length == static_cast<const shapes::Cone&>(b).length;
+    case shapes::BOX:
+      return std::equal(static_cast<const shapes::Box&>(a).size, static_cast<const shapes::Box&>(a).size + 3,
+                        static_cast<const shapes::Box&>(b).size);
+    case shapes::PLANE:
+    {
+      const shapes::Plane& pa = static_cast<const shapes::Plane&>(a);
+      const shapes::Plane& pb = static_cast<const shapes::Plane&>(b);
+      return pa.a == pb.a && pa.b == pb.b && pa.c == pb.c && pa.d == pb.d;
+    }
+    case shapes::MESH:
+    {
+      const shapes::Mesh& ma = static_cast<const shapes::Mesh&>(a);
+      const shapes::Mesh& mb = static_cast<const shapes::Mesh&>(b);
+      return ma.vertex_count == mb.vertex_count && ma.triangle_count == mb.triangle_count &&
+             std::equal(ma.vertices, ma.vertices + 3 * ma.vertex_count, mb.vertices) &&
+             std::equal(ma.triangles, ma.triangles + 3 * ma.triangle_count, mb.triangles);
+    }
+    default:
+      // octrees are only the same if they are the same instance
+      return false;
+  }
+}
+
+bool haveSameShapes(const collision_detection::World::Object& a, const collision_detection::World::Object& b)
+{
+  if (a.shapes_.size() != b.shapes_.size())
+    return false;
+  for (std::size_t i = 0; i < a.shapes_.size(); ++i)
+    if (!haveSameContent(*a.shapes_[i], *b.shapes_[i]))
+      return false;
+  return true;
+}
+
+bool haveSamePoses(const collision_detection::World::Object& a, const collision_detection::World::Object& b)
+{
+  for (std::size_t i = 0; i < a.shape_poses_.size(); ++i)
+    if (a.shape_poses_[i].matrix() != b.shape_poses_[i].matrix())
+      return false;
+  if (a.subframe_poses_.size() != b.subframe_poses_.size())
+    return false;
+  for (auto ita = a.subframe_poses_.begin(), itb = b.subframe_poses_.begin(); ita != a.subframe_poses_.end();
+       ++ita, ++itb)
+    if (ita->first != itb->first || ita->second.matrix() != itb->second.matrix())
+      return false;
+  return true;
+}
+}  // namespace
+
 void PlanningScene::getCollisionObjectMsgs(std::vector<moveit_msgs::CollisionObject>& collision_objs) const
 {
   collision_objs.clear();
@@ -883,6 +950,78 @@ void PlanningScene::getPlanningSceneMsg(moveit_msgs::PlanningScene& scene_msg) c
   getOctomapMsg(scene_msg.world.octomap);
 }
 
+bool PlanningScene::getPlanningSceneDeltaMsg(moveit_msgs::PlanningScene& scene_msg,
+                                             const collision_detection::World& reference, bool include_octomap) const
+{
+  collision_detection::World::ObjectConstPtr map = world_->getObject(OCTOMAP_NS);
+  collision_detection::World::ObjectConstPtr reference_map = reference.getObject(OCTOMAP_NS);
+  if (reference_map && !map)
+    return false;
+
+  scene_msg.name = name_;
+  scene_msg.is_diff = true;
+  scene_msg.robot_model_name = getRobotModel()->getName();
+  getTransforms().copyTransforms(scene_msg.fixed_frame_transforms);
+
+  moveit::core::robotStateToRobotStateMsg(getCurrentState(), scene_msg.robot_state);
+  getAllowedCollisionMatrix().getMessage(scene_msg.allowed_collision_matrix);
+  getCollisionEnv()->getPadding(scene_msg.link_padding);
+  getCollisionEnv()->getScale(scene_msg.link_scale);
+
+  getObjectColorMsgs(scene_msg.object_colors);
+
+  scene_msg.world.collision_objects.clear();
+  for (const std::pair<const std::string, collision_detection::World::ObjectPtr>& object : *world_)
+  {
+    if (object.first == OCTOMAP_NS)
+      continue;
+    // objects are copied on write, so an object that is still shared with the reference did not change
+    collision_detection::World::ObjectConstPtr previous = reference.getObject(object.first);
+    if (previous == object.second)
+      continue;
+    if (previous && haveSameShapes(*previous, *object.second))
+    {
+      if (haveSamePoses(*previous, *object.second))
+        continue;
+      // a move drops the subframes of the object, so objects with subframes are always sent completely
+      if (previous->subframe_poses_.empty() && object.second->subframe_poses_.empty())
+      {
+        moveit_msgs::CollisionObject co;
+        co.header.frame_id = getPlanningFrame();
+        co.id = object.first;
+        co.operation = moveit_msgs::CollisionObject::MOVE;
+        // receivers built the object from a message, which lists primitives, meshes and planes in this order
+        for (std::size_t i = 0; i < object.second->shapes_.size(); ++i)
+        {
+          const shapes::ShapeType type = object.second->shapes_[i]->type;
+          std::vector<geometry_msgs::Pose>& poses = type == shapes::MESH ?
+                                                        co.mesh_poses :
+                                                        (type == shapes::PLANE ? co.plane_poses : co.primitive_poses);
+          poses.push_back(tf2::toMsg(object.second->shape_poses_[i]));
+        }
+        scene_msg.world.collision_objects.push_back(co);
+        continue;
+      }
+    }
+    scene_msg.world.collision_objects.emplace_back();
+    getCollisionObjectMsg(scene_msg.world.collision_objects.back(), object.first);
+  }
+  for (const std::pair<const std::string, collision_detection::World::ObjectPtr>& object : reference)
+    if (object.first != OCTOMAP_NS && !world_->hasObject(object.first))
+    {
+      moveit_msgs::CollisionObject co;
+      co.header.frame_id = getPlanningFrame();
+      co.id = object.first;
+      co.operation = moveit_msgs::CollisionObject::REMOVE;
+      scene_msg.world.collision_objects.push_back(co);
+    }
+
+  scene_msg.world.octomap = octomap_msgs::OctomapWithPose();
+  if (map && (include_octomap || map != reference_map))
+    getOctomapMsg(scene_msg.world.octomap);
+  return true;
+}
+
 void PlanningScene::getPlanningSceneMsg(moveit_msgs::PlanningScene& scene_msg,
                                         const moveit_msgs::PlanningSceneComponents& comp) const
 {
@@ -1110,6 +1249,14 @@ void PlanningScene::setCurrentState(const moveit::core::RobotState& state)
   getCurrentStateNonConst() = state;
 }
 
+collision_detection::World::MemoryUsage PlanningScene::getWorldMemoryUsage() const
+{
+  std::vector<const collision_detection::World*> worlds;
+  for (const PlanningScene* scene = this; scene; scene = scene->parent_.get())
+    worlds.push_back(scene->world_.get());
+  return collision_detection::World::getMemoryUsage(worlds);
+}
+
 void PlanningScene::decoupleParent()
 {
   if (!parent_)
@@ -2023,6 +2170,44 @@ bool PlanningScene::isStateColliding(const moveit::core::RobotState& state, cons
   return res.collision;
 }
 
+int PlanningScene::areStatesColliding(const std::vector<const moveit::core::RobotState*>& states,
+                                      std::vector<bool>& colliding, const std::string& group, bool verbose,
+                                      bool first_collision_only) const
+{
+  collision_detection::CollisionRequest req;
+  req.verbose = verbose;
+  req.group_name = group;
+  std::vector<collision_detection::CollisionResult> results;
+  colliding.assign(states.size(), false);
+
+  // check collision with the world using the padded version
+  int first = getCollisionEnv()->checkRobotCollisionBatch(req, results, states, getAllowedCollisionMatrix(),
+                                                          first_collision_only);
+
+  // do self-collision checking with the unpadded version of the robot, for the states that still need it
+  const std::size_t end = first_collision_only && first >= 0 ? first : states.size();
+  std::vector<const moveit::core::RobotState*> remaining;
+  std::vector<std::size_t> remaining_index;
+  for (std::size_t i = 0; i < states.size(); ++i)
+    if (results[i].collision)
+      colliding[i] = true;
+    else if (i < end)
+    {
+      remaining.push_back(states[i]);
+      remaining_index.push_back(i);
+    }
+  int first_self =
+      getCollisionEnvUnpadded()->checkSelfCollisionBatch(req, results, remaining, getAllowedCollisionMatrix(),
+                                                         first_collision_only);
+  for (std::size_t i = 0; i < remaining.size(); ++i)
+    if (results[i].collision)
+      colliding[remaining_index[i]] = true;
+
+  if (first_self >= 0 && (first < 0 || static_cast<int>(remaining_index[first_self]) < first))
+    first = remaining_index[first_self];
+  return first;
+}
+
 bool PlanningScene::isStateFeasible(const moveit_msgs::RobotState& state, bool verbose) const
 {
   if (state_feasibility_)
@@ -2168,17 +2353,26 @@ bool PlanningScene::isPathValid(const robot_trajectory::RobotTrajectory& traject
   kinematic_constraints::KinematicConstraintSet ks_p(getRobotModel());
   ks_p.add(path_constraints, getTransforms());
   std::size_t n_wp = trajectory.getWayPointCount();
+
+  // Check collisions of all waypoints in parallel, with the batch checks of the collision environments. If no invalid
+  // indices are requested, all waypoints up to the first colliding one are checked, which is all the loop below needs.
+  std::vector<const moveit::core::RobotState*> waypoints(n_wp);
+  for (std::size_t i = 0; i < n_wp; ++i)
+    waypoints[i] = &trajectory.getWayPoint(i);
+  std::vector<bool> colliding;
+  areStatesColliding(waypoints, colliding, group, verbose, !invalid_index);
+
   for (std::size_t i = 0; i < n_wp; ++i)
   {
     const moveit::core::RobotState& st = trajectory.getWayPoint(i);
 
     bool this_state_valid = true;
-    if (isStateColliding(st, group, verbose))
-      this_state_valid = false;
-    if (!isStateFeasible(st, verbose))
+    if (colliding[i])
       this_state_valid = false;
     if (!ks_p.empty() && !ks_p.decide(st, verbose).satisfied)
       this_state_valid = false;
+    if (!isStateFeasible(st, verbose))
+      this_state_valid = false;
 
     if (!this_state_valid)
     {
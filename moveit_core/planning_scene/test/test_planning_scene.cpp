@@ -40,6 +40,7 @@
 #include <moveit/utils/robot_model_test_utils.h>
 #include <urdf_parser/urdf_parser.h>
 #include <fstream>
+#include <random>
 #include <sstream>
 #include <string>
 #include <boost/filesystem/path.hpp>
@@ -150,6 +151,195 @@ TEST(PlanningScene, MakeAttachedDiff)
   ps->checkCollision(req, res);
 }
 
+TEST(PlanningScene, WorldMemoryUsage)
+{
+  urdf::ModelInterfaceSharedPtr urdf_model = moveit::core::loadModelInterface("pr2");
+  srdf::ModelSharedPtr srdf_model(new srdf::Model());
+  auto ps = std::make_shared<planning_scene::PlanningScene>(urdf_model, srdf_model);
+
+  Eigen::Isometry3d id = Eigen::Isometry3d::Identity();
+  for (int i = 0; i < 20; ++i)
+    ps->getWorldNonConst()->addToObject("box" + std::to_string(i), shapes::ShapeConstPtr(new shapes::Box(1, 1, 1)),
+                                        id);
+
+  /* a diff shares all objects with its parent until it changes them */
+  planning_scene::PlanningScenePtr next = ps->diff();
+  collision_detection::World::MemoryUsage usage = next->getWorldMemoryUsage();
+  EXPECT_EQ(usage.objects, 20u);
+  EXPECT_EQ(usage.shared_objects, 20u);
+  EXPECT_EQ(usage.shapes, 20u);
+  EXPECT_EQ(usage.shared_shapes, 20u);
+
+  next->getWorldNonConst()->removeObject("box0");
+  next->getWorldNonConst()->addToObject("sphere", shapes::ShapeConstPtr(new shapes::Sphere(0.5)), id);
+  usage = next->getWorldMemoryUsage();
+  EXPECT_EQ(usage.objects, 21u);
+  EXPECT_EQ(usage.shared_objects, 19u);
+  EXPECT_EQ(usage.shapes, 21u);
+  EXPECT_EQ(usage.shared_shapes, 19u);
+
+  /* the parent alone shares nothing */
+  usage = ps->getWorldMemoryUsage();
+  EXPECT_EQ(usage.objects, 20u);
+  EXPECT_EQ(usage.shared_objects, 0u);
+}
+
+namespace
+{
+shapes::ShapeConstPtr createMesh(unsigned int triangle_count, std::mt19937& generator)
+{
+  std::uniform_real_distribution<double> coordinate(-0.1, 0.1);
+  shapes::Mesh* mesh = new shapes::Mesh(triangle_count + 2, triangle_count);
+  for (unsigned int i = 0; i < 3 * mesh->vertex_count; ++i)
+    mesh->vertices[i] = coordinate(generator);
+  for (unsigned int i = 0; i < triangle_count; ++i)
+  {
+    mesh->triangles[3 * i] = i;
+    mesh->triangles[3 * i + 1] = i + 1;
+    mesh->triangles[3 * i + 2] = i + 2;
+  }
+  return shapes::ShapeConstPtr(mesh);
+}
+}  // namespace
+
+TEST(PlanningScene, DeltaMsgReplay)
+{
+  moveit::core::RobotModelPtr robot_model = moveit::core::loadTestingRobotModel("pr2");
+  auto ps = std::make_shared<planning_scene::PlanningScene>(robot_model);
+  planning_scene::PlanningScene mirror(robot_model);
+  collision_detection::World& world = *ps->getWorldNonConst();
+
+  std::mt19937 generator(0);
+  std::uniform_real_distribution<double> position(-2.0, 2.0);
+  std::uniform_int_distribution<int> object_index(0, 99);
+  for (int i = 0; i < 100; ++i)
+    world.addToObject("mesh" + std::to_string(i), createMesh(500, generator),
+                      Eigen::Isometry3d(Eigen::Translation3d(position(generator), position(generator), 0.5)));
+  // an object mixing meshes and primitives
+  std::vector<shapes::ShapeConstPtr> mixed_shapes = { createMesh(10, generator),
+                                                      shapes::ShapeConstPtr(new shapes::Box(0.1, 0.2, 0.3)) };
+  EigenSTL::vector_Isometry3d mixed_poses = { Eigen::Isometry3d(Eigen::Translation3d(1, 0, 0)),
+                                              Eigen::Isometry3d::Identity() };
+  world.addToObject("mixed", mixed_shapes, mixed_poses);
+
+  moveit_msgs::PlanningScene msg;
+  ps->getPlanningSceneMsg(msg);
+  mirror.usePlanningSceneMsg(msg);
+  std::unique_ptr<collision_detection::World> reference(new collision_detection::World(world));
+
+  // replay a stream of scene updates, as published at 10Hz for a scene that is tracked by perception
+  const double rate = 10.0;
+  const std::size_t steps = 100;
+  std::size_t full_bytes = 0;
+  std::size_t delta_bytes = 0;
+  for (std::size_t step = 0; step < steps; ++step)
+  {
+    // a few objects move
+    for (int k = 0; k < 3; ++k)
+      world.moveObject("mesh" + std::to_string(object_index(generator)),
+                       Eigen::Isometry3d(Eigen::Translation3d(0.01, 0.0, 0.0)));
+    world.moveObject("mixed", Eigen::Isometry3d(Eigen::Translation3d(0.0, 0.01, 0.0)));
+
+    // objects appear and disappear
+    if (step % 10 == 0)
+    {
+      world.removeObject("mesh" + std::to_string(step / 10));
+      world.addToObject("new" + std::to_string(step), createMesh(500, generator), Eigen::Isometry3d::Identity());
+    }
+
+    // an object is published again, unchanged
+    if (step % 20 == 5)
+    {
+      const std::string id = "mesh" + std::to_string(50 + step / 20);
+      collision_detection::World::ObjectConstPtr obj = world.getObject(id);
+      std::vector<shapes::ShapeConstPtr> shapes;
+      for (const shapes::ShapeConstPtr& shape : obj->shapes_)
+        shapes.push_back(shapes::ShapeConstPtr(shape->clone()));
+      EigenSTL::vector_Isometry3d poses = obj->shape_poses_;
+      obj.reset();
+      world.removeObject(id);
+      world.addToObject(id, shapes, poses);
+    }
+
+    ps->getPlanningSceneMsg(msg);
+    full_bytes += ros::serialization::serializationLength(msg);
+
+    ASSERT_TRUE(ps->getPlanningSceneDeltaMsg(msg, *reference));
+    delta_bytes += ros::serialization::serializationLength(msg);
+    EXPECT_TRUE(mirror.usePlanningSceneMsg(msg));
+    reference.reset(new collision_detection::World(world));
+  }
+
+  // the scene received through the deltas is the same as the one sent
+  ASSERT_EQ(mirror.getWorld()->size(), world.size());
+  for (const std::pair<const std::string, collision_detection::World::ObjectPtr>& object : world)
+  {
+    collision_detection::World::ObjectConstPtr received = mirror.getWorld()->getObject(object.first);
+    ASSERT_TRUE(received) << object.first;
+    ASSERT_EQ(received->shapes_.size(), object.second->shapes_.size());
+    // messages list primitives before meshes, so the order of the shapes may differ
+    for (std::size_t i = 0; i < object.second->shapes_.size(); ++i)
+    {
+      bool found = false;
+      for (std::size_t j = 0; j < received->shapes_.size(); ++j)
+        found |= received->shapes_[j]->type == object.second->shapes_[i]->type &&
+                 received->shape_poses_[j].isApprox(object.second->shape_poses_[i], 1e-6);
+      EXPECT_TRUE(found) << object.first;
+    }
+  }
+
+  const double duration = steps / rate;
+  std::cout << "Replayed " << steps << " scene updates at " << rate << " Hz: complete scenes need "
+            << full_bytes / duration << " bytes/s, deltas need " << delta_bytes / duration << " bytes/s" << std::endl;
+  EXPECT_LT(delta_bytes * 10, full_bytes);
+}
+
+TEST(PlanningScene, PathValidity)
+{
+  moveit::core::RobotModelPtr robot_model = moveit::core::loadTestingRobotModel("pr2");
+  auto ps = std::make_shared<planning_scene::PlanningScene>(robot_model);
+
+  // sweep the right arm around the robot
+  robot_trajectory::RobotTrajectory trajectory(robot_model, "right_arm");
+  moveit::core::RobotState state(ps->getCurrentState());
+  const std::size_t n = 50;
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    state.setVariablePosition("r_shoulder_pan_joint", -2.0 + 2.0 * i / (n - 1));
+    state.update();
+    trajectory.addSuffixWayPoint(state, 0.1);
+  }
+  ASSERT_TRUE(ps->isPathValid(trajectory));
+
+  // put a small obstacle where the gripper passes at one waypoint
+  const Eigen::Isometry3d& palm = trajectory.getWayPoint(10).getGlobalLinkTransform("r_gripper_palm_link");
+  ps->getWorldNonConst()->addToObject("obstacle", shapes::ShapeConstPtr(new shapes::Box(0.05, 0.05, 0.05)),
+                                      Eigen::Isometry3d(Eigen::Translation3d(palm.translation())));
+
+  std::vector<std::size_t> expected;
+  for (std::size_t i = 0; i < n; ++i)
+    if (!ps->isStateValid(trajectory.getWayPoint(i)))
+      expected.push_back(i);
+  ASSERT_FALSE(expected.empty());
+
+  std::vector<std::size_t> invalid;
+  EXPECT_FALSE(ps->isPathValid(trajectory));
+  EXPECT_FALSE(ps->isPathValid(trajectory, "", false, &invalid));
+  EXPECT_EQ(invalid, expected);
+
+  // the batch check used by isPathValid() agrees with checking the waypoints one by one
+  std::vector<const moveit::core::RobotState*> waypoints;
+  for (std::size_t i = 0; i < n; ++i)
+    waypoints.push_back(&trajectory.getWayPoint(i));
+  std::vector<bool> colliding;
+  EXPECT_EQ(ps->areStatesColliding(waypoints, colliding), static_cast<int>(expected.front()));
+  ASSERT_EQ(colliding.size(), n);
+  for (std::size_t i = 0; i < n; ++i)
+    EXPECT_EQ(colliding[i], ps->isStateColliding(trajectory.getWayPoint(i))) << i;
+  EXPECT_EQ(ps->areStatesColliding(waypoints, colliding, "", false, true), static_cast<int>(expected.front()));
+  EXPECT_TRUE(colliding[expected.front()]);
+}
+
 TEST(PlanningScene, isStateValid)
 {
   moveit::core::RobotModelPtr robot_model = moveit::core::loadTestingRobotModel("pr2");
@@ -38,6 +38,11 @@
 
 #include <Eigen/Geometry>
 
+namespace shapes
+{
+class Shape;
+}
+
 namespace moveit
 {
 namespace core
@@ -48,6 +53,10 @@ class AABB : public Eigen::AlignedBox3d
 public:
   /** \brief Extend with a box transformed by the given transform. */
   void extendWithTransformedBox(const Eigen::Isometry3d& transform, const Eigen::Vector3d& box);
+
+  /** \brief Extend with the bounding box of \e shape at \e pose, grown by \e padding on every side.
+      Returns false without extending if the shape is unbounded (a plane). */
+  bool extendWithShape(const shapes::Shape& shape, const Eigen::Isometry3d& pose, double padding = 0.0);
 };
 }  // namespace core
 }  // namespace moveit
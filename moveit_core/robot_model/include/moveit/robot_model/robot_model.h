@@ -61,6 +61,11 @@ namespace core
 {
 MOVEIT_CLASS_FORWARD(RobotModel);  // Defines RobotModelPtr, ConstPtr, WeakPtr... etc
 
+/** \brief Signature of specialized functions computing the global link transforms of all descendant links of
+    a joint, given all variable positions of the robot and the (already updated) global transform of the
+    joint's parent link. See RobotModel::setLinkTransformsFunction(). */
+typedef void (*LinkTransformsFn)(const double* positions, Eigen::Isometry3d* global_link_transforms);
+
 /** \brief Definition of a kinematic model. This class is not thread
     safe, however multiple instances can be created */
 class RobotModel
@@ -435,6 +440,27 @@ public:
   /// A map of known kinematics solvers (associated to their group name)
   void setKinematicsAllocators(const std::map<std::string, SolverAllocatorFn>& allocators);
 
+  /** \brief Set a specialized function to compute the link transforms of all descendants of \e joint.
+      RobotState uses it instead of walking the kinematic tree whenever it updates the links below \e joint.
+      Such functions are typically generated for a specific model by moveit_generate_link_transforms_plugin
+      and registered by a LinkTransformsPlugin. Passing nullptr removes a registered function. */
+  void setLinkTransformsFunction(const JointModel* joint, LinkTransformsFn fn);
+
+  /** \brief Get the specialized function computing the link transforms of all descendants of \e joint,
+      or nullptr if there is none */
+  LinkTransformsFn getLinkTransformsFunction(const JointModel* joint) const
+  {
+    return link_transforms_functions_.empty() ? nullptr : link_transforms_functions_[joint->getJointIndex()];
+  }
+
+  /** \brief Keep \e owner alive as long as this model. This is meant for whatever provides the functions set with
+      setLinkTransformsFunction(), e.g. a plugin and the loader of its library, which must not be unloaded while the
+      model may still call into it. A previously set owner is released. */
+  void setLinkTransformsFunctionsOwner(std::shared_ptr<const void> owner)
+  {
+    link_transforms_functions_owner_ = std::move(owner);
+  }
+
 protected:
   /** \brief Get the transforms between link and all its rigidly attached descendants */
   void computeFixedTransforms(const LinkModel* link, const Eigen::Isometry3d& transform,
@@ -527,6 +553,12 @@ protected:
    */
   std::vector<int> common_joint_roots_;
 
+  /** \brief Specialized link transform functions, indexed by the joint they start at (empty if none is set) */
+  std::vector<LinkTransformsFn> link_transforms_functions_;
+
+  /** \brief Keeps the code of the specialized link transform functions loaded */
+  std::shared_ptr<const void> link_transforms_functions_owner_;
+
   // INDEXING
 
   /** \brief The names of the DOF that make up this state (this is just a sequence of joint variable names; not
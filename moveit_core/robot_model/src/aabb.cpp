@@ -36,6 +36,8 @@
 
 #include <moveit/robot_model/aabb.h>
 #include <geometric_shapes/check_isometry.h>
+#include <geometric_shapes/shape_operations.h>
+#include <octomap/octomap.h>
 
 void moveit::core::AABB::extendWithTransformedBox(const Eigen::Isometry3d& transform, const Eigen::Vector3d& box)
 {
@@ -57,3 +59,44 @@ void moveit::core::AABB::extendWithTransformedBox(const Eigen::Isometry3d& trans
   extend(t + v_delta);
   extend(t - v_delta);
 }
+
+bool moveit::core::AABB::extendWithShape(const shapes::Shape& shape, const Eigen::Isometry3d& pose, double padding)
+{
+  Eigen::Vector3d min, max;
+  switch (shape.type)
+  {
+    case shapes::PLANE:
+      return false;
+    case shapes::MESH:
+    {
+      // meshes are not necessarily centered at their origin
+      const shapes::Mesh& mesh = static_cast<const shapes::Mesh&>(shape);
+      if (mesh.vertex_count == 0)
+        return true;
+      min = max = Eigen::Map<const Eigen::Vector3d>(mesh.vertices);
+      for (unsigned int i = 1; i < mesh.vertex_count; ++i)
+      {
+        Eigen::Map<const Eigen::Vector3d> vertex(mesh.vertices + 3 * i);
+        min = min.cwiseMin(vertex);
+        max = max.cwiseMax(vertex);
+      }
+      break;
+    }
+    case shapes::OCTREE:
+    {
+      // neither are octrees
+      const octomap::OcTree& tree = *static_cast<const shapes::OcTree&>(shape).octree;
+      if (tree.size() == 0)
+        return true;
+      tree.getMetricMin(min.x(), min.y(), min.z());
+      tree.getMetricMax(max.x(), max.y(), max.z());
+      break;
+    }
+    default:
+      max = 0.5 * shapes::computeShapeExtents(&shape);
+      min = -max;
+  }
+  extendWithTransformedBox(pose * Eigen::Translation3d(0.5 * (min + max)),
+                           (max - min) + Eigen::Vector3d::Constant(2.0 * padding));
+  return true;
+}
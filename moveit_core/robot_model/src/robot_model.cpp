@@ -1370,6 +1370,13 @@ void RobotModel::setKinematicsAllocators(const std::map<std::string, SolverAlloc
   }
 }
 
+void RobotModel::setLinkTransformsFunction(const JointModel* joint, LinkTransformsFn fn)
+{
+  if (link_transforms_functions_.empty())
+    link_transforms_functions_.resize(joint_model_vector_.size(), nullptr);
+  link_transforms_functions_[joint->getJointIndex()] = fn;
+}
+
 void RobotModel::printModelInfo(std::ostream& out) const
 {
   out << "Model " << model_name_ << " in frame " << model_frame_ << ", using " << getVariableCount() << " variables"
@@ -1460,6 +1460,20 @@ public:
     return dirtyCollisionBodyTransforms();
   }
 
+  /** \brief Returns true if the transform of \e link changed since clearMovedLinks() was called last.
+      Links are reported once their transforms were actually recomputed, so this is typically queried after update().
+      Collision environments can use this to skip updating links that did not move. */
+  bool linkMoved(const LinkModel* link) const
+  {
+    return link_update_flags_[link->getLinkIndex()] & LINK_MOVED;
+  }
+
+  /** \brief Get all links whose transform changed since clearMovedLinks() was called last */
+  void getMovedLinkModels(std::vector<const LinkModel*>& links) const;
+
+  /** \brief Reset the information about moved links, see linkMoved() */
+  void clearMovedLinks();
+
   /** @} */
 
   /** \name Computing distances
@@ -1800,9 +1814,17 @@ private:
    */
   bool setToIKSolverFrame(Eigen::Isometry3d& pose, const std::string& ik_frame);
 
+  /** \brief Mark the transforms of all joints and links as dirty */
+  void markDirtyJointTransforms()
+  {
+    memset(dirty_joint_transforms_, 1, 2 * robot_model_->getJointModelCount() * sizeof(unsigned char));
+    dirty_link_transforms_ = robot_model_->getRootJoint();
+  }
+
   void markDirtyJointTransforms(const JointModel* joint)
   {
     dirty_joint_transforms_[joint->getJointIndex()] = 1;
+    dirty_links_below_joint_[joint->getJointIndex()] = 1;
     dirty_link_transforms_ =
         dirty_link_transforms_ == nullptr ? joint : robot_model_->getCommonRoot(dirty_link_transforms_, joint);
   }
@@ -1810,7 +1832,10 @@ private:
   void markDirtyJointTransforms(const JointModelGroup* group)
   {
     for (const JointModel* jm : group->getActiveJointModels())
+    {
       dirty_joint_transforms_[jm->getJointIndex()] = 1;
+      dirty_links_below_joint_[jm->getJointIndex()] = 1;
+    }
     dirty_link_transforms_ = dirty_link_transforms_ == nullptr ?
                                  group->getCommonRoot() :
                                  robot_model_->getCommonRoot(dirty_link_transforms_, group->getCommonRoot());
@@ -1842,6 +1867,7 @@ private:
       // as this function is always used in combination of
       // updateMimicJoint(group->getMimicJointModels()) + markDirtyJointTransforms(group);
       dirty_joint_transforms_[jm->getJointIndex()] = 1;
+      dirty_links_below_joint_[jm->getJointIndex()] = 1;
     }
   }
 
@@ -1857,7 +1883,11 @@ private:
     markDirtyJointTransforms(group);
   }
 
-  void updateLinkTransformsInternal(const JointModel* start);
+  /** \brief Update the links below \e start whose transforms changed, or all of them if \e force is true */
+  void updateLinkTransformsInternal(const JointModel* start, bool force = true);
+
+  /** \brief Walk the kinematic tree below \e start, used if the model provides no specialized function for it */
+  void updateLinkTransformsGeneric(const JointModel* start);
 
   void getMissingKeys(const std::map<std::string, double>& variable_map,
                       std::vector<std::string>& missing_variables) const;
@@ -1888,12 +1918,28 @@ private:
 
   // All the following transform variables point into aligned memory in memory_
   // They are updated lazily, based on the flags in dirty_joint_transforms_
-  // resp. the pointers dirty_link_transforms_ and dirty_collision_body_transforms_
+  // resp. the pointers dirty_link_transforms_ and dirty_collision_body_transforms_,
+  // restricted to the links flagged in dirty_links_below_joint_ resp. link_update_flags_
   Eigen::Isometry3d* variable_joint_transforms_;         ///< Local transforms of all joints
   Eigen::Isometry3d* global_link_transforms_;            ///< Transforms from model frame to link frame for each link
   Eigen::Isometry3d* global_collision_body_transforms_;  ///< Transforms from model frame to collision bodies
   unsigned char* dirty_joint_transforms_;
 
+  /** \brief Per joint: the joint changed since the transforms of the links below it were last updated.
+      This allows to update only the changed subtrees below dirty_link_transforms_. */
+  unsigned char* dirty_links_below_joint_;
+
+  /** \brief Bits of link_update_flags_ */
+  enum LinkUpdateFlags : unsigned char
+  {
+    COLLISION_BODIES_DIRTY = 1,  ///< the collision body transforms of the link are outdated
+    LINK_MOVED = 2,              ///< the link transform changed since clearMovedLinks()
+    LINK_UPDATED = 4             ///< transient: the link was updated in the current tree traversal
+  };
+
+  /** \brief Per link: a combination of LinkUpdateFlags */
+  unsigned char* link_update_flags_;
+
   /** \brief All attached bodies that are part of this state, indexed by their name */
   std::map<std::string, AttachedBody*> attached_body_map_;
 
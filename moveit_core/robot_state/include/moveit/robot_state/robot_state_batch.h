@@ -0,0 +1,155 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, MoveIt maintainers
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <moveit/robot_model/robot_model.h>
+#include <moveit/robot_state/robot_state.h>
+#include <Eigen/Core>
+
+namespace moveit
+{
+namespace core
+{
+MOVEIT_CLASS_FORWARD(RobotStateBatch);  // Defines RobotStateBatchPtr, ConstPtr, WeakPtr... etc
+
+/** \brief Forward kinematics for many states of the same robot model at once.
+
+    Where RobotState stores one configuration and computes one Eigen::Isometry3d per link,
+    a RobotStateBatch stores N configurations in structure-of-arrays layout: the values of
+    each variable are contiguous in memory across all states, and so are the 12 entries
+    (rotation and translation) of each global link transform. updateLinkTransforms() walks
+    the kinematic tree only once and evaluates every joint and link for all N states with
+    Eigen array expressions, which are vectorized across states using Eigen's packet math.
+
+    The batch only holds joint positions and global link transforms: velocities, attached
+    bodies and collision body transforms are not handled. Like for
+    RobotState::setVariablePositions(const double*), positions are expected to include the
+    values of mimic joints. */
+class RobotStateBatch
+{
+public:
+  /** \brief Construct a batch of \e size states for \e robot_model. Positions are not initialized. */
+  RobotStateBatch(const RobotModelConstPtr& robot_model, std::size_t size = 0);
+
+  /** \brief Get the robot model this batch is constructed for. */
+  const RobotModelConstPtr& getRobotModel() const
+  {
+    return robot_model_;
+  }
+
+  /** \brief Get the number of states in this batch */
+  std::size_t size() const
+  {
+    return size_;
+  }
+
+  /** \brief Change the number of states in this batch. Existing positions are not preserved. */
+  void resize(std::size_t size);
+
+  /** \brief Get a pointer to the positions of variable \e index for all states in the batch.
+      The returned array holds size() contiguous values. Link transforms are marked dirty. */
+  double* getVariablePositions(int index)
+  {
+    dirty_link_transforms_ = true;
+    return positions_.col(index).data();
+  }
+
+  /** \brief Get a pointer to the positions of variable \e index for all states in the batch. */
+  const double* getVariablePositions(int index) const
+  {
+    return positions_.col(index).data();
+  }
+
+  /** \brief Set all variable positions of state \e state_index. \e position is expected to hold
+      RobotModel::getVariableCount() values, in the order of RobotState::getVariablePositions() */
+  void setVariablePositions(std::size_t state_index, const double* position);
+
+  /** \brief Set all variable positions of state \e state_index to the ones of \e state */
+  void setVariablePositions(std::size_t state_index, const RobotState& state)
+  {
+    setVariablePositions(state_index, state.getVariablePositions());
+  }
+
+  /** \brief Copy all variable positions of state \e state_index to \e position, which needs to
+      hold RobotModel::getVariableCount() values */
+  void copyVariablePositions(std::size_t state_index, double* position) const;
+
+  /** \brief Set the variable positions of \e state to those of state \e state_index */
+  void copyToRobotState(std::size_t state_index, RobotState& state) const;
+
+  /** \brief Compute the global link transforms of all states in the batch */
+  void updateLinkTransforms();
+
+  bool dirtyLinkTransforms() const
+  {
+    return dirty_link_transforms_;
+  }
+
+  /** \brief Get the transform of \e link w.r.t. the model frame for state \e state_index.
+      updateLinkTransforms() needs to be called before. */
+  Eigen::Isometry3d getGlobalLinkTransform(const LinkModel* link, std::size_t state_index) const;
+
+  /** \brief Get the transform of \e link w.r.t. the model frame for state \e state_index.
+      updateLinkTransforms() needs to be called before. */
+  Eigen::Isometry3d getGlobalLinkTransform(const std::string& link_name, std::size_t state_index) const
+  {
+    return getGlobalLinkTransform(robot_model_->getLinkModel(link_name), state_index);
+  }
+
+  /** \brief Get the entry (\e row, \e col) of the 3x4 global transform of \e link for all states.
+      The returned array holds size() contiguous values. Rows and columns 0-2 are the rotation,
+      column 3 is the translation. updateLinkTransforms() needs to be called before. */
+  const double* getGlobalLinkTransformEntry(const LinkModel* link, int row, int col) const;
+
+private:
+  void computeJointTransforms(const JointModel* joint);
+
+  RobotModelConstPtr robot_model_;
+  std::size_t size_;
+
+  /** \brief Variable positions: one column of size_ values per variable */
+  Eigen::ArrayXXd positions_;
+
+  /** \brief Global link transforms: 12 columns of size_ values per link */
+  Eigen::ArrayXXd global_link_transforms_;
+
+  /** \brief Scratch space for the joint transforms and intermediate products: 12 columns each */
+  Eigen::ArrayXXd joint_transforms_;
+  Eigen::ArrayXXd scratch_transforms_;
+
+  bool dirty_link_transforms_;
+};
+}  // namespace core
+}  // namespace moveit
@@ -0,0 +1,80 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, MoveIt maintainers
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <cstddef>
+
+namespace moveit
+{
+namespace core
+{
+/** \brief Per-thread cache for the memory blocks backing RobotState instances.
+
+    Planners copy and destroy huge numbers of RobotStates. Instead of returning the memory of a
+    destroyed state to the heap, RobotState hands it to the free list of the calling thread,
+    keyed by block size (i.e. by robot model). The next state of the same size created on that
+    thread reuses it. Free lists are bounded by setMaxBlocksPerThread() and released when their
+    thread exits. */
+class RobotStatePool
+{
+public:
+  /** \brief Process-wide counters, e.g. to report allocations per motion plan */
+  struct Statistics
+  {
+    /// Number of blocks that were obtained from the heap
+    std::size_t heap_allocations;
+    /// Number of blocks that were taken from a free list instead
+    std::size_t reused_blocks;
+  };
+
+  /** \brief Get a block of \e bytes from the calling thread's free list, or from the heap if there is none */
+  static void* allocate(std::size_t bytes);
+
+  /** \brief Return a \e block of \e bytes obtained from allocate() to the calling thread's free list.
+      The block is freed if the list is full already. */
+  static void release(void* block, std::size_t bytes);
+
+  /** \brief Set the maximum number of blocks kept per thread and block size. 0 disables caching. */
+  static void setMaxBlocksPerThread(std::size_t count);
+
+  static std::size_t getMaxBlocksPerThread();
+
+  /** \brief Free all blocks cached by the calling thread */
+  static void clear();
+
+  static Statistics getStatistics();
+};
+}  // namespace core
+}  // namespace moveit
@@ -36,6 +36,7 @@
 /* Author: Ioan Sucan, Sachin Chitta, Acorn Pooley, Mario Prats, Dave Coleman */
 
 #include <moveit/robot_state/robot_state.h>
+#include <moveit/robot_state/robot_state_pool.h>
 #include <moveit/robot_state/cartesian_interpolator.h>
 #include <moveit/transforms/transforms.h>
 #include <geometric_shapes/check_isometry.h>
@@ -53,6 +54,26 @@ namespace core
 {
 const std::string LOGNAME = "robot_state";
 
+namespace
+{
+constexpr unsigned int EXTRA_ALIGNMENT_BYTES = EIGEN_MAX_ALIGN_BYTES - 1;
+
+/** \brief Number of doubles needed for the dirty flags: two per joint, one per link */
+int getDirtyFlagsDoubleCount(const RobotModel& model)
+{
+  return 1 + (2 * model.getJointModelCount() + model.getLinkModelCount()) / (sizeof(double) / sizeof(unsigned char));
+}
+
+/** \brief Size of the memory block allocated by every RobotState of \e model */
+std::size_t getMemoryBytes(const RobotModel& model)
+{
+  return sizeof(Eigen::Isometry3d) *
+             (model.getJointModelCount() + model.getLinkModelCount() + model.getLinkGeometryCount()) +
+         sizeof(double) * (model.getVariableCount() * 3 + getDirtyFlagsDoubleCount(model)) +
+         EXTRA_ALIGNMENT_BYTES;
+}
+}  // namespace
+
 RobotState::RobotState(const RobotModelConstPtr& robot_model)
   : robot_model_(robot_model)
   , has_velocity_(false)
@@ -76,7 +97,7 @@ RobotState::RobotState(const RobotState& other) : rng_(nullptr)
 RobotState::~RobotState()
 {
   clearAttachedBodies();
-  free(memory_);
+  RobotStatePool::release(memory_, getMemoryBytes(*robot_model_));
   if (rng_)
     delete rng_;
 }
@@ -86,26 +107,22 @@ void RobotState::allocMemory()
   static_assert((sizeof(Eigen::Isometry3d) / EIGEN_MAX_ALIGN_BYTES) * EIGEN_MAX_ALIGN_BYTES == sizeof(Eigen::Isometry3d),
                 "sizeof(Eigen::Isometry3d) should be a multiple of EIGEN_MAX_ALIGN_BYTES");
 
-  constexpr unsigned int extra_alignment_bytes = EIGEN_MAX_ALIGN_BYTES - 1;
-  // memory for the dirty joint transforms
-  const int nr_doubles_for_dirty_joint_transforms =
-      1 + robot_model_->getJointModelCount() / (sizeof(double) / sizeof(unsigned char));
-  const size_t bytes =
-      sizeof(Eigen::Isometry3d) * (robot_model_->getJointModelCount() + robot_model_->getLinkModelCount() +
-                                   robot_model_->getLinkGeometryCount()) +
-      sizeof(double) * (robot_model_->getVariableCount() * 3 + nr_doubles_for_dirty_joint_transforms) +
-      extra_alignment_bytes;
-  memory_ = malloc(bytes);
+  // memory for the dirty joint transforms, the dirty links below each joint and the link update flags
+  const int nr_doubles_for_dirty_flags = getDirtyFlagsDoubleCount(*robot_model_);
+  // reuse the memory of a previously destroyed state of this thread, if available
+  memory_ = RobotStatePool::allocate(getMemoryBytes(*robot_model_));
 
   // make the memory for transforms align at EIGEN_MAX_ALIGN_BYTES
   // https://eigen.tuxfamily.org/dox/classEigen_1_1aligned__allocator.html
-  variable_joint_transforms_ = reinterpret_cast<Eigen::Isometry3d*>(((uintptr_t)memory_ + extra_alignment_bytes) &
-                                                                    ~(uintptr_t)extra_alignment_bytes);
+  variable_joint_transforms_ = reinterpret_cast<Eigen::Isometry3d*>(((uintptr_t)memory_ + EXTRA_ALIGNMENT_BYTES) &
+                                                                    ~(uintptr_t)EXTRA_ALIGNMENT_BYTES);
   global_link_transforms_ = variable_joint_transforms_ + robot_model_->getJointModelCount();
   global_collision_body_transforms_ = global_link_transforms_ + robot_model_->getLinkModelCount();
   dirty_joint_transforms_ =
       reinterpret_cast<unsigned char*>(global_collision_body_transforms_ + robot_model_->getLinkGeometryCount());
-  position_ = reinterpret_cast<double*>(dirty_joint_transforms_) + nr_doubles_for_dirty_joint_transforms;
+  dirty_links_below_joint_ = dirty_joint_transforms_ + robot_model_->getJointModelCount();
+  link_update_flags_ = dirty_links_below_joint_ + robot_model_->getJointModelCount();
+  position_ = reinterpret_cast<double*>(dirty_joint_transforms_) + nr_doubles_for_dirty_flags;
   velocity_ = position_ + robot_model_->getVariableCount();
   // acceleration and effort share the memory (not both can be specified)
   effort_ = acceleration_ = velocity_ + robot_model_->getVariableCount();
@@ -114,9 +131,9 @@ void RobotState::allocMemory()
 void RobotState::initTransforms()
 {
   // mark all transforms as dirty
-  const int nr_doubles_for_dirty_joint_transforms =
-      1 + robot_model_->getJointModelCount() / (sizeof(double) / sizeof(unsigned char));
-  memset(dirty_joint_transforms_, 1, sizeof(double) * nr_doubles_for_dirty_joint_transforms);
+  memset(dirty_joint_transforms_, 1, 2 * robot_model_->getJointModelCount() * sizeof(unsigned char));
+  memset(link_update_flags_, COLLISION_BODIES_DIRTY | LINK_MOVED,
+         robot_model_->getLinkModelCount() * sizeof(unsigned char));
 
   // initialize last row of transformation matrices, which will not be modified by transform updates anymore
   for (size_t i = 0, end = robot_model_->getJointModelCount() + robot_model_->getLinkModelCount() +
@@ -150,18 +167,36 @@ void RobotState::copyFrom(const RobotState& other)
     // and just initialize transforms
     initTransforms();
   }
+  else if (dirty_collision_body_transforms_ == robot_model_->getRootJoint())
+  {
+    // all collision body transforms are dirty; copy joint and link transforms only
+    memcpy((void*)variable_joint_transforms_, (void*)other.variable_joint_transforms_,
+           sizeof(Eigen::Isometry3d) * (robot_model_->getJointModelCount() + robot_model_->getLinkModelCount()));
+    // the last row of the skipped transforms needs to be valid nevertheless (the memory may be reused)
+    for (size_t i = 0, end = robot_model_->getLinkGeometryCount(); i != end; ++i)
+      global_collision_body_transforms_[i].makeAffine();
+    // copy the dirty flags and positions; maybe avoid copying velocity and acceleration if possible
+    const int nr_doubles_for_dirty_flags = getDirtyFlagsDoubleCount(*robot_model_);
+    memcpy((void*)dirty_joint_transforms_, (void*)other.dirty_joint_transforms_,
+           sizeof(double) * (robot_model_->getVariableCount() *
+                                 (1 + ((has_velocity_ || has_acceleration_ || has_effort_) ? 1 : 0) +
+                                  ((has_acceleration_ || has_effort_) ? 1 : 0)) +
+                             nr_doubles_for_dirty_flags));
+    // the collision bodies of links that did not move were not copied either
+    for (size_t i = 0, end = robot_model_->getLinkModelCount(); i != end; ++i)
+      link_update_flags_[i] |= COLLISION_BODIES_DIRTY;
+  }
   else
   {
     // copy all the memory; maybe avoid copying velocity and acceleration if possible
-    const int nr_doubles_for_dirty_joint_transforms =
-        1 + robot_model_->getJointModelCount() / (sizeof(double) / sizeof(unsigned char));
+    const int nr_doubles_for_dirty_flags = getDirtyFlagsDoubleCount(*robot_model_);
     const size_t bytes =
         sizeof(Eigen::Isometry3d) * (robot_model_->getJointModelCount() + robot_model_->getLinkModelCount() +
                                      robot_model_->getLinkGeometryCount()) +
         sizeof(double) *
             (robot_model_->getVariableCount() * (1 + ((has_velocity_ || has_acceleration_ || has_effort_) ? 1 : 0) +
                                                  ((has_acceleration_ || has_effort_) ? 1 : 0)) +
-             nr_doubles_for_dirty_joint_transforms);
+             nr_doubles_for_dirty_flags);
     memcpy((void*)variable_joint_transforms_, (void*)other.variable_joint_transforms_, bytes);
   }
 
@@ -276,8 +311,7 @@ void RobotState::setToRandomPositions()
 {
   random_numbers::RandomNumberGenerator& rng = getRandomNumberGenerator();
   robot_model_->getVariableRandomPositions(rng, position_);
-  memset(dirty_joint_transforms_, 1, robot_model_->getJointModelCount() * sizeof(unsigned char));
-  dirty_link_transforms_ = robot_model_->getRootJoint();
+  markDirtyJointTransforms();
   // mimic values are correctly set in RobotModel
 }
 
@@ -341,8 +375,7 @@ void RobotState::setToDefaultValues()
   robot_model_->getVariableDefaultPositions(position_);  // mimic values are updated
   // set velocity & acceleration to 0
   memset(velocity_, 0, sizeof(double) * 2 * robot_model_->getVariableCount());
-  memset(dirty_joint_transforms_, 1, robot_model_->getJointModelCount() * sizeof(unsigned char));
-  dirty_link_transforms_ = robot_model_->getRootJoint();
+  markDirtyJointTransforms();
 }
 
 void RobotState::setVariablePositions(const double* position)
@@ -353,8 +386,7 @@ void RobotState::setVariablePositions(const double* position)
   // the full state includes mimic joint values, so no need to update mimic here
 
   // Since all joint values have potentially changed, we will need to recompute all transforms
-  memset(dirty_joint_transforms_, 1, robot_model_->getJointModelCount() * sizeof(unsigned char));
-  dirty_link_transforms_ = robot_model_->getRootJoint();
+  markDirtyJointTransforms();
 }
 
 void RobotState::setVariablePositions(const std::map<std::string, double>& variable_map)
@@ -636,8 +668,7 @@ void RobotState::update(bool force)
   // make sure we do everything from scratch if needed
   if (force)
   {
-    memset(dirty_joint_transforms_, 1, robot_model_->getJointModelCount() * sizeof(unsigned char));
-    dirty_link_transforms_ = robot_model_->getRootJoint();
+    markDirtyJointTransforms();
   }
 
   // this actually triggers all needed updates
@@ -656,6 +687,12 @@ void RobotState::updateCollisionBodyTransforms()
 
     for (const LinkModel* link : links)
     {
+      // skip links that did not move since their collision bodies were last updated
+      unsigned char& flags = link_update_flags_[link->getLinkIndex()];
+      if (!(flags & COLLISION_BODIES_DIRTY))
+        continue;
+      flags &= ~COLLISION_BODIES_DIRTY;
+
       const EigenSTL::vector_Isometry3d& ot = link->getCollisionOriginTransforms();
       const std::vector<int>& ot_id = link->areCollisionOriginTransformsIdentity();
       const int index_co = link->getFirstCollisionBodyTransformIndex();
@@ -676,7 +713,7 @@ void RobotState::updateLinkTransforms()
 {
   if (dirty_link_transforms_ != nullptr)
   {
-    updateLinkTransformsInternal(dirty_link_transforms_);
+    updateLinkTransformsInternal(dirty_link_transforms_, false);
     if (dirty_collision_body_transforms_)
       dirty_collision_body_transforms_ =
           robot_model_->getCommonRoot(dirty_collision_body_transforms_, dirty_link_transforms_);
@@ -686,12 +723,45 @@ void RobotState::updateLinkTransforms()
   }
 }
 
-void RobotState::updateLinkTransformsInternal(const JointModel* start)
+void RobotState::updateLinkTransformsInternal(const JointModel* start, bool force)
 {
-  for (const LinkModel* link : start->getDescendantLinkModels())
+  if (LinkTransformsFn fn = robot_model_->getLinkTransformsFunction(start))
+  {
+    fn(position_, global_link_transforms_);
+    for (const LinkModel* link : start->getDescendantLinkModels())
+    {
+      dirty_links_below_joint_[link->getParentJointModel()->getJointIndex()] = 0;
+      link_update_flags_[link->getLinkIndex()] |= COLLISION_BODIES_DIRTY | LINK_MOVED;
+    }
+  }
+  else
+  {
+    if (force)
+      dirty_links_below_joint_[start->getJointIndex()] = 1;
+    updateLinkTransformsGeneric(start);
+  }
+
+  // update attached bodies tf; these are usually very few, so we update them all
+  for (std::map<std::string, AttachedBody*>::const_iterator it = attached_body_map_.begin();
+       it != attached_body_map_.end(); ++it)
+    it->second->computeTransform(global_link_transforms_[it->second->getAttachedLink()->getLinkIndex()]);
+}
+
+void RobotState::updateLinkTransformsGeneric(const JointModel* start)
+{
+  const std::vector<const LinkModel*>& links = start->getDescendantLinkModels();
+  for (const LinkModel* link : links)
   {
     int idx_link = link->getLinkIndex();
     const LinkModel* parent = link->getParentLinkModel();
+
+    // only links below a changed joint need an update (links are ordered parents first)
+    unsigned char& dirty = dirty_links_below_joint_[link->getParentJointModel()->getJointIndex()];
+    if (!dirty && !(parent && (link_update_flags_[parent->getLinkIndex()] & LINK_UPDATED)))
+      continue;
+    dirty = 0;
+    link_update_flags_[idx_link] |= LINK_UPDATED | COLLISION_BODIES_DIRTY | LINK_MOVED;
+
     if (parent)  // root JointModel will not have a parent
     {
       int idx_parent = parent->getLinkIndex();
@@ -719,10 +789,8 @@ void RobotState::updateLinkTransformsInternal(const JointModel* start)
     }
   }
 
-  // update attached bodies tf; these are usually very few, so we update them all
-  for (std::map<std::string, AttachedBody*>::const_iterator it = attached_body_map_.begin();
-       it != attached_body_map_.end(); ++it)
-    it->second->computeTransform(global_link_transforms_[it->second->getAttachedLink()->getLinkIndex()]);
+  for (const LinkModel* link : links)
+    link_update_flags_[link->getLinkIndex()] &= ~LINK_UPDATED;
 }
 
 void RobotState::updateStateWithLinkAt(const LinkModel* link, const Eigen::Isometry3d& transform, bool backward)
@@ -737,6 +805,7 @@ void RobotState::updateStateWithLinkAt(const LinkModel* link, const Eigen::Isome
     dirty_collision_body_transforms_ = link->getParentJointModel();
 
   global_link_transforms_[link->getLinkIndex()] = transform;
+  link_update_flags_[link->getLinkIndex()] |= COLLISION_BODIES_DIRTY | LINK_MOVED;
 
   // update link transforms for descendant links only (leaving the transform for the current link untouched)
   const std::vector<const JointModel*>& cj = link->getChildJointModels();
@@ -756,9 +825,8 @@ void RobotState::updateStateWithLinkAt(const LinkModel* link, const Eigen::Isome
       // update the transform of the parent
       global_link_transforms_[parent_link->getLinkIndex()] =
           global_link_transforms_[child_link->getLinkIndex()] *
-          (child_link->getJointOriginTransform() *
-           variable_joint_transforms_[child_link->getParentJointModel()->getJointIndex()])
-              .inverse();
+          (child_link->getJointOriginTransform() * getJointTransform(child_link->getParentJointModel())).inverse();
+      link_update_flags_[parent_link->getLinkIndex()] |= COLLISION_BODIES_DIRTY | LINK_MOVED;
 
       // update link transforms for descendant links only (leaving the transform for the current link untouched)
       // with the exception of the child link we are coming backwards from
@@ -777,6 +845,20 @@ void RobotState::updateStateWithLinkAt(const LinkModel* link, const Eigen::Isome
     it->second->computeTransform(global_link_transforms_[it->second->getAttachedLink()->getLinkIndex()]);
 }
 
+void RobotState::getMovedLinkModels(std::vector<const LinkModel*>& links) const
+{
+  links.clear();
+  for (const LinkModel* link : robot_model_->getLinkModels())
+    if (link_update_flags_[link->getLinkIndex()] & LINK_MOVED)
+      links.push_back(link);
+}
+
+void RobotState::clearMovedLinks()
+{
+  for (std::size_t i = 0, end = robot_model_->getLinkModelCount(); i != end; ++i)
+    link_update_flags_[i] &= ~LINK_MOVED;
+}
+
 bool RobotState::satisfiesBounds(double margin) const
 {
   const std::vector<const JointModel*>& jm = robot_model_->getActiveJointModels();
@@ -904,8 +986,7 @@ void RobotState::interpolate(const RobotState& to, double t, RobotState& state)
 {
   robot_model_->interpolate(getVariablePositions(), to.getVariablePositions(), t, state.getVariablePositions());
 
-  memset(state.dirty_joint_transforms_, 1, state.robot_model_->getJointModelCount() * sizeof(unsigned char));
-  state.dirty_link_transforms_ = state.robot_model_->getRootJoint();
+  state.markDirtyJointTransforms();
 }
 
 void RobotState::interpolate(const RobotState& to, double t, RobotState& state, const JointModelGroup* joint_group) const
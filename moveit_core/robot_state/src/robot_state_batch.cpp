@@ -0,0 +1,269 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, MoveIt maintainers
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/robot_state/robot_state_batch.h>
+
+namespace moveit
+{
+namespace core
+{
+namespace
+{
+// A batch of transforms is stored in 12 columns of one value per state each:
+// the 3x3 rotation in column-major order, followed by the translation.
+constexpr int TRANSFORM_COLUMNS = 12;
+
+using TransformBlock = Eigen::Ref<Eigen::ArrayXXd>;
+using ConstTransformBlock = Eigen::Ref<const Eigen::ArrayXXd>;
+
+inline int rot(int row, int col)
+{
+  return 3 * col + row;
+}
+
+inline int trans(int row)
+{
+  return 9 + row;
+}
+
+void setConstant(const Eigen::Isometry3d& t, TransformBlock out)
+{
+  for (int r = 0; r < 3; ++r)
+  {
+    for (int c = 0; c < 3; ++c)
+      out.col(rot(r, c)).setConstant(t.linear()(r, c));
+    out.col(trans(r)).setConstant(t.translation()(r));
+  }
+}
+
+// out = a * b, with the same transform b for all states; out must not alias a
+void multiplyConstant(const ConstTransformBlock& a, const Eigen::Isometry3d& b, TransformBlock out)
+{
+  const Eigen::Matrix3d br = b.linear();
+  const Eigen::Vector3d bt = b.translation();
+  for (int r = 0; r < 3; ++r)
+  {
+    for (int c = 0; c < 3; ++c)
+      out.col(rot(r, c)) = a.col(rot(r, 0)) * br(0, c) + a.col(rot(r, 1)) * br(1, c) + a.col(rot(r, 2)) * br(2, c);
+    out.col(trans(r)) =
+        a.col(rot(r, 0)) * bt(0) + a.col(rot(r, 1)) * bt(1) + a.col(rot(r, 2)) * bt(2) + a.col(trans(r));
+  }
+}
+
+// out = a * b; out must not alias a or b
+void multiply(const ConstTransformBlock& a, const ConstTransformBlock& b, TransformBlock out)
+{
+  for (int r = 0; r < 3; ++r)
+  {
+    for (int c = 0; c < 3; ++c)
+      out.col(rot(r, c)) = a.col(rot(r, 0)) * b.col(rot(0, c)) + a.col(rot(r, 1)) * b.col(rot(1, c)) +
+                           a.col(rot(r, 2)) * b.col(rot(2, c));
+    out.col(trans(r)) = a.col(rot(r, 0)) * b.col(trans(0)) + a.col(rot(r, 1)) * b.col(trans(1)) +
+                        a.col(rot(r, 2)) * b.col(trans(2)) + a.col(trans(r));
+  }
+}
+}  // namespace
+
+RobotStateBatch::RobotStateBatch(const RobotModelConstPtr& robot_model, std::size_t size)
+  : robot_model_(robot_model), size_(0), dirty_link_transforms_(true)
+{
+  resize(size);
+}
+
+void RobotStateBatch::resize(std::size_t size)
+{
+  size_ = size;
+  positions_.resize(size, robot_model_->getVariableCount());
+  global_link_transforms_.resize(size, TRANSFORM_COLUMNS * robot_model_->getLinkModelCount());
+  joint_transforms_.resize(size, TRANSFORM_COLUMNS);
+  scratch_transforms_.resize(size, TRANSFORM_COLUMNS);
+  dirty_link_transforms_ = true;
+}
+
+void RobotStateBatch::setVariablePositions(std::size_t state_index, const double* position)
+{
+  assert(state_index < size_);
+  for (std::size_t i = 0, end = robot_model_->getVariableCount(); i != end; ++i)
+    positions_(state_index, i) = position[i];
+  dirty_link_transforms_ = true;
+}
+
+void RobotStateBatch::copyVariablePositions(std::size_t state_index, double* position) const
+{
+  assert(state_index < size_);
+  for (std::size_t i = 0, end = robot_model_->getVariableCount(); i != end; ++i)
+    position[i] = positions_(state_index, i);
+}
+
+void RobotStateBatch::copyToRobotState(std::size_t state_index, RobotState& state) const
+{
+  assert(state.getRobotModel() == robot_model_);
+  copyVariablePositions(state_index, state.getVariablePositions());
+  // positions were modified through the raw pointer, so all transforms need to be recomputed
+  state.update(true);
+}
+
+void RobotStateBatch::computeJointTransforms(const JointModel* joint)
+{
+  TransformBlock out(joint_transforms_);
+  switch (joint->getType())
+  {
+    case JointModel::FIXED:
+      setConstant(Eigen::Isometry3d::Identity(), out);
+      break;
+    case JointModel::REVOLUTE:
+    {
+      const Eigen::Vector3d& axis = static_cast<const RevoluteJointModel*>(joint)->getAxis();
+      const double x = axis.x(), y = axis.y(), z = axis.z();
+      const auto q = positions_.col(joint->getFirstVariableIndex());
+      // same closed form as RevoluteJointModel::computeTransform(), evaluated for all states at once
+      scratch_transforms_.col(0) = q.cos();
+      scratch_transforms_.col(1) = q.sin();
+      scratch_transforms_.col(2) = 1.0 - scratch_transforms_.col(0);
+      const auto c = scratch_transforms_.col(0);
+      const auto s = scratch_transforms_.col(1);
+      const auto t = scratch_transforms_.col(2);
+
+      out.col(rot(0, 0)) = t * (x * x) + c;
+      out.col(rot(1, 0)) = t * (x * y) + s * z;
+      out.col(rot(2, 0)) = t * (x * z) - s * y;
+      out.col(rot(0, 1)) = t * (x * y) - s * z;
+      out.col(rot(1, 1)) = t * (y * y) + c;
+      out.col(rot(2, 1)) = t * (y * z) + s * x;
+      out.col(rot(0, 2)) = t * (x * z) + s * y;
+      out.col(rot(1, 2)) = t * (y * z) - s * x;
+      out.col(rot(2, 2)) = t * (z * z) + c;
+      out.rightCols(3).setZero();
+      break;
+    }
+    case JointModel::PRISMATIC:
+    {
+      const Eigen::Vector3d& axis = static_cast<const PrismaticJointModel*>(joint)->getAxis();
+      const auto q = positions_.col(joint->getFirstVariableIndex());
+      setConstant(Eigen::Isometry3d::Identity(), out);
+      for (int r = 0; r < 3; ++r)
+        out.col(trans(r)) = q * axis(r);
+      break;
+    }
+    default:
+    {
+      // planar and floating joints are rare (usually only the root joint): evaluate them per state
+      const int first = joint->getFirstVariableIndex();
+      const std::size_t count = joint->getVariableCount();
+      std::vector<double> values(count);
+      Eigen::Isometry3d transform;
+      for (std::size_t i = 0; i < size_; ++i)
+      {
+        for (std::size_t v = 0; v < count; ++v)
+          values[v] = positions_(i, first + v);
+        joint->computeTransform(values.data(), transform);
+        for (int r = 0; r < 3; ++r)
+        {
+          for (int c = 0; c < 3; ++c)
+            out(i, rot(r, c)) = transform.linear()(r, c);
+          out(i, trans(r)) = transform.translation()(r);
+        }
+      }
+      break;
+    }
+  }
+}
+
+void RobotStateBatch::updateLinkTransforms()
+{
+  if (!dirty_link_transforms_)
+    return;
+
+  // same traversal as RobotState::updateLinkTransformsInternal(), starting at the root joint
+  for (const LinkModel* link : robot_model_->getRootJoint()->getDescendantLinkModels())
+  {
+    TransformBlock global = global_link_transforms_.middleCols(TRANSFORM_COLUMNS * link->getLinkIndex(),
+                                                               TRANSFORM_COLUMNS);
+    const LinkModel* parent = link->getParentLinkModel();
+    if (parent)  // root JointModel will not have a parent
+    {
+      ConstTransformBlock parent_global = global_link_transforms_.middleCols(
+          TRANSFORM_COLUMNS * parent->getLinkIndex(), TRANSFORM_COLUMNS);
+      if (link->parentJointIsFixed())  // fixed joint
+        multiplyConstant(parent_global, link->getJointOriginTransform(), global);
+      else
+      {
+        computeJointTransforms(link->getParentJointModel());
+        if (link->jointOriginTransformIsIdentity())
+          multiply(parent_global, joint_transforms_, global);
+        else
+        {
+          multiplyConstant(parent_global, link->getJointOriginTransform(), scratch_transforms_);
+          multiply(scratch_transforms_, joint_transforms_, global);
+        }
+      }
+    }
+    else  // is the origin / root / 'model frame'
+    {
+      computeJointTransforms(link->getParentJointModel());
+      if (link->jointOriginTransformIsIdentity())
+        global = joint_transforms_;
+      else
+      {
+        setConstant(link->getJointOriginTransform(), scratch_transforms_);
+        multiply(scratch_transforms_, joint_transforms_, global);
+      }
+    }
+  }
+  dirty_link_transforms_ = false;
+}
+
+Eigen::Isometry3d RobotStateBatch::getGlobalLinkTransform(const LinkModel* link, std::size_t state_index) const
+{
+  assert(!dirty_link_transforms_ && state_index < size_);
+  const int offset = TRANSFORM_COLUMNS * link->getLinkIndex();
+  Eigen::Isometry3d transform;
+  transform.makeAffine();
+  for (int r = 0; r < 3; ++r)
+  {
+    for (int c = 0; c < 3; ++c)
+      transform.linear()(r, c) = global_link_transforms_(state_index, offset + rot(r, c));
+    transform.translation()(r) = global_link_transforms_(state_index, offset + trans(r));
+  }
+  return transform;
+}
+
+const double* RobotStateBatch::getGlobalLinkTransformEntry(const LinkModel* link, int row, int col) const
+{
+  assert(!dirty_link_transforms_ && row >= 0 && row < 3 && col >= 0 && col < 4);
+  return global_link_transforms_.col(TRANSFORM_COLUMNS * link->getLinkIndex() + (col < 3 ? rot(row, col) : trans(row)))
+      .data();
+}
+}  // namespace core
+}  // namespace moveit
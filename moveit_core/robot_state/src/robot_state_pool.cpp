@@ -0,0 +1,147 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, MoveIt maintainers
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/robot_state/robot_state_pool.h>
+#include <atomic>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+
+namespace moveit
+{
+namespace core
+{
+namespace
+{
+std::atomic<std::size_t> MAX_BLOCKS_PER_THREAD(256);
+std::atomic<std::size_t> HEAP_ALLOCATIONS(0);
+std::atomic<std::size_t> REUSED_BLOCKS(0);
+
+// Set once the free lists of a thread are destroyed: RobotStates destroyed afterwards
+// (e.g. static instances) return their memory directly to the heap
+thread_local bool FREE_LISTS_DESTROYED = false;
+
+class FreeLists
+{
+public:
+  ~FreeLists()
+  {
+    clear();
+    FREE_LISTS_DESTROYED = true;
+  }
+
+  /** \brief The list of free blocks of \e bytes. There are only few distinct sizes (one per robot model in use). */
+  std::vector<void*>& get(std::size_t bytes)
+  {
+    for (std::pair<std::size_t, std::vector<void*>>& list : lists_)
+      if (list.first == bytes)
+        return list.second;
+    lists_.emplace_back(bytes, std::vector<void*>());
+    return lists_.back().second;
+  }
+
+  void clear()
+  {
+    for (std::pair<std::size_t, std::vector<void*>>& list : lists_)
+      for (void* block : list.second)
+        free(block);
+    lists_.clear();
+  }
+
+private:
+  std::vector<std::pair<std::size_t, std::vector<void*>>> lists_;
+};
+
+FreeLists* getFreeLists()
+{
+  if (FREE_LISTS_DESTROYED)
+    return nullptr;
+  thread_local FreeLists lists;
+  return &lists;
+}
+}  // namespace
+
+void* RobotStatePool::allocate(std::size_t bytes)
+{
+  if (FreeLists* lists = getFreeLists())
+  {
+    std::vector<void*>& list = lists->get(bytes);
+    if (!list.empty())
+    {
+      void* block = list.back();
+      list.pop_back();
+      REUSED_BLOCKS.fetch_add(1, std::memory_order_relaxed);
+      return block;
+    }
+  }
+  HEAP_ALLOCATIONS.fetch_add(1, std::memory_order_relaxed);
+  return malloc(bytes);
+}
+
+void RobotStatePool::release(void* block, std::size_t bytes)
+{
+  if (FreeLists* lists = getFreeLists())
+  {
+    std::vector<void*>& list = lists->get(bytes);
+    if (list.size() < MAX_BLOCKS_PER_THREAD.load(std::memory_order_relaxed))
+    {
+      list.push_back(block);
+      return;
+    }
+  }
+  free(block);
+}
+
+void RobotStatePool::setMaxBlocksPerThread(std::size_t count)
+{
+  MAX_BLOCKS_PER_THREAD = count;
+}
+
+std::size_t RobotStatePool::getMaxBlocksPerThread()
+{
+  return MAX_BLOCKS_PER_THREAD;
+}
+
+void RobotStatePool::clear()
+{
+  if (FreeLists* lists = getFreeLists())
+    lists->clear();
+}
+
+RobotStatePool::Statistics RobotStatePool::getStatistics()
+{
+  return Statistics{ HEAP_ALLOCATIONS.load(std::memory_order_relaxed), REUSED_BLOCKS.load(std::memory_order_relaxed) };
+}
+}  // namespace core
+}  // namespace moveit
@@ -35,6 +35,7 @@
 /* Author: Ioan Sucan */
 #include <moveit/robot_model/robot_model.h>
 #include <moveit/robot_state/robot_state.h>
+#include <moveit/robot_state/robot_state_pool.h>
 #include <moveit/utils/robot_model_test_utils.h>
 #include <urdf_parser/urdf_parser.h>
 #include <tf2_geometry_msgs/tf2_geometry_msgs.h>
@@ -560,6 +561,120 @@ TEST_F(OneRobot, testPrintCurrentPositionWithJointLimits)
   state.printStatePositionsWithJointLimits(joint_model_group);
 }
 
+namespace
+{
+int link_transforms_function_calls = 0;
+std::size_t link_count = 0;
+
+// stand-in for a generated function: translate all links by a fixed offset
+void offsetLinkTransforms(const double* /*positions*/, Eigen::Isometry3d* global_link_transforms)
+{
+  ++link_transforms_function_calls;
+  for (std::size_t i = 0; i < link_count; ++i)
+    global_link_transforms[i] = Eigen::Translation3d(1.0, 2.0, 3.0);
+}
+}  // namespace
+
+TEST(LinkTransformsFunction, UsedForRegisteredJoint)
+{
+  moveit::core::RobotModelPtr model = moveit::core::loadTestingRobotModel("panda");
+  link_count = model->getLinkModelCount();
+  moveit::core::RobotState state(model);
+  state.setToDefaultValues();
+  state.update();
+  const Eigen::Isometry3d expected = state.getGlobalLinkTransform("panda_hand");
+
+  model->setLinkTransformsFunction(model->getRootJoint(), &offsetLinkTransforms);
+  EXPECT_EQ(model->getLinkTransformsFunction(model->getRootJoint()), &offsetLinkTransforms);
+  state.update(true);
+  EXPECT_EQ(link_transforms_function_calls, 1);
+  EXPECT_TRUE(state.getGlobalLinkTransform("panda_hand").isApprox(Eigen::Isometry3d(Eigen::Translation3d(1, 2, 3))));
+
+  // only updates starting at the registered joint are dispatched
+  state.setVariablePosition("panda_joint7", 0.5);
+  state.update();
+  EXPECT_EQ(link_transforms_function_calls, 1);
+
+  model->setLinkTransformsFunction(model->getRootJoint(), nullptr);
+  state.setToDefaultValues();
+  state.update();
+  EXPECT_EQ(link_transforms_function_calls, 1);
+  EXPECT_TRUE(state.getGlobalLinkTransform("panda_hand").isApprox(expected));
+}
+
+TEST(LinkTransformsFunction, OwnerLivesAsLongAsModel)
+{
+  moveit::core::RobotModelPtr model = moveit::core::loadTestingRobotModel("panda");
+  auto owner = std::make_shared<int>(0);
+  std::weak_ptr<int> weak_owner = owner;
+  model->setLinkTransformsFunction(model->getRootJoint(), &offsetLinkTransforms);
+  model->setLinkTransformsFunctionsOwner(owner);
+  owner.reset();
+  EXPECT_FALSE(weak_owner.expired());
+
+  model.reset();
+  EXPECT_TRUE(weak_owner.expired());
+}
+
+TEST(RobotStatePool, ReusesMemoryOfDestroyedStates)
+{
+  moveit::core::RobotModelPtr model = moveit::core::loadTestingRobotModel("panda");
+  moveit::core::RobotState state(model);
+  state.setToRandomPositions();
+  // link transforms are up to date, collision body transforms are dirty
+  state.updateLinkTransforms();
+  ASSERT_TRUE(state.dirtyCollisionBodyTransforms());
+
+  moveit::core::RobotStatePool::clear();
+  delete new moveit::core::RobotState(state);
+  const moveit::core::RobotStatePool::Statistics before = moveit::core::RobotStatePool::getStatistics();
+  moveit::core::RobotState copy(state);
+  const moveit::core::RobotStatePool::Statistics after = moveit::core::RobotStatePool::getStatistics();
+  EXPECT_EQ(after.heap_allocations, before.heap_allocations);
+  EXPECT_EQ(after.reused_blocks, before.reused_blocks + 1);
+
+  // the copy skipped the dirty collision body transforms, but computes the same ones
+  state.update();
+  copy.update();
+  for (const moveit::core::LinkModel* link : model->getLinkModelsWithCollisionGeometry())
+    for (std::size_t i = 0; i < link->getShapes().size(); ++i)
+      EXPECT_TRUE(state.getCollisionBodyTransform(link, i).isApprox(copy.getCollisionBodyTransform(link, i)));
+}
+
+TEST(MovedLinks, OnlyLinksBelowChangedJointAreUpdated)
+{
+  moveit::core::RobotModelPtr model = moveit::core::loadTestingRobotModel("panda");
+  moveit::core::RobotState state(model);
+  state.setToRandomPositions();
+  state.update();
+  state.clearMovedLinks();
+
+  std::vector<const moveit::core::LinkModel*> moved;
+  state.getMovedLinkModels(moved);
+  EXPECT_TRUE(moved.empty());
+
+  // change a single joint
+  const moveit::core::JointModel* joint = model->getJointModel("panda_joint6");
+  double value = state.getJointPositions(joint)[0] + 0.1;
+  state.setJointPositions(joint, &value);
+  state.update();
+
+  state.getMovedLinkModels(moved);
+  EXPECT_EQ(moved, joint->getDescendantLinkModels());
+  EXPECT_FALSE(state.linkMoved(model->getLinkModel("panda_link5")));
+  EXPECT_TRUE(state.linkMoved(model->getLinkModel("panda_link7")));
+
+  // the partially updated transforms match a full update
+  moveit::core::RobotState full(model);
+  full.setVariablePositions(state.getVariablePositions());
+  full.update(true);
+  for (const moveit::core::LinkModel* link : model->getLinkModels())
+    EXPECT_TRUE(state.getGlobalLinkTransform(link).isApprox(full.getGlobalLinkTransform(link)));
+  for (const moveit::core::LinkModel* link : model->getLinkModelsWithCollisionGeometry())
+    for (std::size_t i = 0; i < link->getShapes().size(); ++i)
+      EXPECT_TRUE(state.getCollisionBodyTransform(link, i).isApprox(full.getCollisionBodyTransform(link, i)));
+}
+
 int main(int argc, char** argv)
 {
   testing::InitGoogleTest(&argc, argv);
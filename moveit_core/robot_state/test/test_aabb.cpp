@@ -44,6 +44,8 @@
 #include <tf2_geometry_msgs/tf2_geometry_msgs.h>
 #include <tf2/LinearMath/Vector3.h>
 #include <moveit/utils/robot_model_test_utils.h>
+#include <geometric_shapes/shapes.h>
+#include <octomap/octomap.h>
 
 // To visualize bbox of the PR2, set this to 1.
 #ifndef VISUALIZE_PR2_RVIZ
@@ -351,6 +353,39 @@ TEST_F(TestAABB, TestComplex)
   EXPECT_NEAR(complex_aabb[5], 2.05, 1e-4);
 }
 
+TEST(AABB, ExtendWithShape)
+{
+  const Eigen::Isometry3d pose(Eigen::Translation3d(1.0, 2.0, 3.0) *
+                              Eigen::AngleAxisd(M_PI / 2, Eigen::Vector3d::UnitZ()));
+
+  moveit::core::AABB box;
+  ASSERT_TRUE(box.extendWithShape(shapes::Box(0.2, 0.4, 0.6), pose, 0.1));
+  EXPECT_TRUE(box.min().isApprox(Eigen::Vector3d(0.7, 1.8, 2.6)));
+  EXPECT_TRUE(box.max().isApprox(Eigen::Vector3d(1.3, 2.2, 3.4)));
+
+  // meshes are bounded by their vertices, which need not be centered around the origin
+  moveit::core::AABB mesh_box;
+  shapes::Mesh mesh(3, 1);
+  const double vertices[] = { 1.0, 0.0, 0.0, 2.0, 0.0, 0.0, 1.0, 1.0, 0.5 };
+  std::copy(vertices, vertices + 9, mesh.vertices);
+  ASSERT_TRUE(mesh_box.extendWithShape(mesh, Eigen::Isometry3d::Identity()));
+  EXPECT_TRUE(mesh_box.min().isApprox(Eigen::Vector3d(1.0, 0.0, 0.0)));
+  EXPECT_TRUE(mesh_box.max().isApprox(Eigen::Vector3d(2.0, 1.0, 0.5)));
+
+  // so are octrees by their occupied cells
+  moveit::core::AABB octree_box;
+  auto octree = std::make_shared<octomap::OcTree>(0.1);
+  octree->updateNode(octomap::point3d(1.05, 1.05, 1.05), true);
+  ASSERT_TRUE(octree_box.extendWithShape(shapes::OcTree(octree), Eigen::Isometry3d::Identity()));
+  EXPECT_TRUE(octree_box.min().isApprox(Eigen::Vector3d(1.0, 1.0, 1.0), 1e-6));
+  EXPECT_TRUE(octree_box.max().isApprox(Eigen::Vector3d(1.1, 1.1, 1.1), 1e-6));
+
+  // planes are unbounded
+  moveit::core::AABB plane_box;
+  EXPECT_FALSE(plane_box.extendWithShape(shapes::Plane(0.0, 0.0, 1.0, 0.0), pose));
+  EXPECT_TRUE(plane_box.isEmpty());
+}
+
 int main(int argc, char** argv)
 {
   testing::InitGoogleTest(&argc, argv);
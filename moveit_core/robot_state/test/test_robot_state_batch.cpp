@@ -0,0 +1,102 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, MoveIt maintainers
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/robot_state/robot_state_batch.h>
+#include <moveit/utils/robot_model_test_utils.h>
+#include <gtest/gtest.h>
+
+namespace
+{
+constexpr double EPSILON = 1e-9;
+
+void checkAgainstRobotState(const moveit::core::RobotModelConstPtr& model, std::size_t size)
+{
+  moveit::core::RobotStateBatch batch(model, size);
+  std::vector<moveit::core::RobotState> states(size, moveit::core::RobotState(model));
+  for (std::size_t i = 0; i < size; ++i)
+  {
+    states[i].setToRandomPositions();
+    batch.setVariablePositions(i, states[i]);
+  }
+  EXPECT_TRUE(batch.dirtyLinkTransforms());
+  batch.updateLinkTransforms();
+  EXPECT_FALSE(batch.dirtyLinkTransforms());
+
+  for (std::size_t i = 0; i < size; ++i)
+  {
+    states[i].updateLinkTransforms();
+    for (const moveit::core::LinkModel* link : model->getLinkModels())
+    {
+      const Eigen::Isometry3d expected = states[i].getGlobalLinkTransform(link);
+      const Eigen::Isometry3d actual = batch.getGlobalLinkTransform(link, i);
+      EXPECT_TRUE(expected.isApprox(actual, EPSILON)) << "link " << link->getName() << ", state " << i;
+      EXPECT_NEAR(expected.translation().z(), batch.getGlobalLinkTransformEntry(link, 2, 3)[i], EPSILON);
+    }
+  }
+}
+}  // namespace
+
+TEST(RobotStateBatch, MatchesRobotStatePanda)
+{
+  checkAgainstRobotState(moveit::core::loadTestingRobotModel("panda"), 33);
+}
+
+TEST(RobotStateBatch, MatchesRobotStatePR2)
+{
+  // the PR2 has a planar root joint and prismatic joints (torso)
+  checkAgainstRobotState(moveit::core::loadTestingRobotModel("pr2"), 17);
+}
+
+TEST(RobotStateBatch, CopyPositions)
+{
+  moveit::core::RobotModelConstPtr model = moveit::core::loadTestingRobotModel("panda");
+  moveit::core::RobotStateBatch batch(model, 4);
+  moveit::core::RobotState state(model);
+  state.setToRandomPositions();
+  batch.setVariablePositions(2, state);
+
+  moveit::core::RobotState copy(model);
+  batch.copyToRobotState(2, copy);
+  for (std::size_t v = 0; v < model->getVariableCount(); ++v)
+  {
+    EXPECT_EQ(state.getVariablePosition(v), copy.getVariablePosition(v));
+    EXPECT_EQ(state.getVariablePosition(v), batch.getVariablePositions(v)[2]);
+  }
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,165 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, MoveIt maintainers
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <moveit/macros/class_forward.h>
+#include <ompl/base/StateStorage.h>
+#include <boost/serialization/map.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace boost
+{
+namespace interprocess
+{
+class file_mapping;
+class mapped_region;
+}  // namespace interprocess
+}  // namespace boost
+
+namespace ompl_interface
+{
+/** For each state: the indices of the states it is connected to, and for each connected state the range of stored
+    states making up the motion to it (when motions are stored explicitly) */
+typedef std::pair<std::vector<std::size_t>, std::map<std::size_t, std::pair<std::size_t, std::size_t> > >
+    ConstrainedStateMetadata;
+typedef ompl::base::StateStorageWithMetadata<ConstrainedStateMetadata> ConstraintApproximationStateStorage;
+
+MOVEIT_CLASS_FORWARD(ConstraintApproximationDatabase);  // Defines ConstraintApproximationDatabasePtr, ConstPtr...
+
+/** @class ConstraintApproximationDatabase
+    @brief The states and connections of a constraint approximation, in a flat binary layout.
+
+    The layout is the same in memory and on disk: a header, the states serialized by their state space (one fixed size
+    record each), and the connections between the milestones in compressed sparse row form, followed by the ranges of
+    stored states that make up each connection if motions are stored explicitly. A database saved to a file can
+    therefore be memory mapped and used directly; states are only deserialized one at a time, when they are
+    accessed. Files are in the byte order of the machine that wrote them. */
+class ConstraintApproximationDatabase
+{
+public:
+  ~ConstraintApproximationDatabase();
+
+  /** @brief Build a database from the first \e milestones states of \e storage (all of them if 0) and their
+      connections, and the remaining states which make up explicitly stored motions */
+  static ConstraintApproximationDatabasePtr fromStateStorage(const ConstraintApproximationStateStorage& storage,
+                                                             std::size_t milestones = 0);
+
+  /** @brief Memory map the database stored in \e filename. Returns null if the file is not a valid database */
+  static ConstraintApproximationDatabasePtr map(const std::string& filename);
+
+  /** @brief Check whether \e filename starts like a database file (as opposed to a state storage archive) */
+  static bool isDatabaseFile(const std::string& filename);
+
+  bool save(const std::string& filename) const;
+
+  /** @brief The number of stored states, milestones and explicit motion states */
+  std::size_t size() const
+  {
+    return state_count_;
+  }
+
+  std::size_t getMilestoneCount() const
+  {
+    return milestone_count_;
+  }
+
+  /** @brief The total number of connections, counting each direction */
+  std::size_t getConnectionCount() const
+  {
+    return neighbor_offsets_[milestone_count_];
+  }
+
+  bool hasExplicitMotions() const
+  {
+    return motions_ != nullptr;
+  }
+
+  /** @brief The size of a state serialized by the state space the database was built with */
+  std::size_t getRecordSize() const
+  {
+    return record_size_;
+  }
+
+  /** @brief Deserialize the state at \e index into \e state, which must belong to a state space with the same
+      serialization as the one the database was built with */
+  void copyState(const ompl::base::StateSpace* space, std::size_t index, ompl::base::State* state) const
+  {
+    space->deserialize(state, states_ + index * record_stride_);
+  }
+
+  std::size_t getNeighborCount(std::size_t index) const
+  {
+    return index < milestone_count_ ? neighbor_offsets_[index + 1] - neighbor_offsets_[index] : 0;
+  }
+
+  /** @brief The indices of the milestones connected to milestone \e index */
+  const std::uint64_t* getNeighbors(std::size_t index) const
+  {
+    return neighbors_ + neighbor_offsets_[index];
+  }
+
+  /** @brief Get the range [first, last) of stored states that make up the motion from milestone \e from to
+      milestone \e to. Returns false if the two are not connected or motions are not stored */
+  bool getMotion(std::size_t from, std::size_t to, std::size_t& first, std::size_t& last) const;
+
+private:
+  ConstraintApproximationDatabase() = default;
+
+  /** @brief Check the layout of the \e size bytes at \e data and point the accessors into it */
+  bool setData(const char* data, std::size_t size);
+
+  // storage of a database built in memory; 64 bit words keep all sections aligned
+  std::vector<std::uint64_t> buffer_;
+
+  // storage of a database mapped from a file
+  std::unique_ptr<boost::interprocess::file_mapping> file_;
+  std::unique_ptr<boost::interprocess::mapped_region> region_;
+
+  const char* data_ = nullptr;
+  std::size_t data_size_ = 0;
+  std::size_t record_size_ = 0;
+  std::size_t record_stride_ = 0;
+  std::size_t state_count_ = 0;
+  std::size_t milestone_count_ = 0;
+  const char* states_ = nullptr;
+  const std::uint64_t* neighbor_offsets_ = nullptr;
+  const std::uint64_t* neighbors_ = nullptr;
+  const std::uint64_t* motions_ = nullptr;
+};
+}  // namespace ompl_interface
@@ -38,16 +38,11 @@
 
 #include <moveit/macros/class_forward.h>
 #include <moveit/ompl_interface/model_based_planning_context.h>
+#include <moveit/ompl_interface/detail/constraint_approximation_database.h>
 #include <moveit/kinematic_constraints/kinematic_constraint.h>
-#include <ompl/base/StateStorage.h>
-#include <boost/serialization/map.hpp>
 
 namespace ompl_interface
 {
-typedef std::pair<std::vector<std::size_t>, std::map<std::size_t, std::pair<std::size_t, std::size_t> > >
-    ConstrainedStateMetadata;
-typedef ompl::base::StateStorageWithMetadata<ConstrainedStateMetadata> ConstraintApproximationStateStorage;
-
 MOVEIT_CLASS_FORWARD(ConstraintApproximation)
 
 class ConstraintApproximation
@@ -57,6 +52,11 @@ public:
                           moveit_msgs::Constraints msg, std::string filename, ompl::base::StateStoragePtr storage,
                           std::size_t milestones = 0);
 
+  /** @brief Construct an approximation from a database that was saved before, typically memory mapped from a file */
+  ConstraintApproximation(std::string group, std::string state_space_parameterization, bool explicit_motions,
+                          moveit_msgs::Constraints msg, std::string filename, ompl::base::StateSpacePtr state_space,
+                          ConstraintApproximationDatabasePtr database, std::size_t milestones = 0);
+
   virtual ~ConstraintApproximation()
   {
   }
@@ -100,17 +100,25 @@ public:
     return constraint_msg_;
   }
 
+  /** @brief The states the approximation was constructed from; null if it was loaded from a database file */
   const ompl::base::StateStoragePtr& getStateStorage() const
   {
     return state_storage_ptr_;
   }
 
+  const ConstraintApproximationDatabasePtr& getDatabase() const
+  {
+    return database_;
+  }
+
   const std::string& getFilename() const
   {
     return ompldb_filename_;
   }
 
 protected:
+  void initialize();
+
   std::string group_;
   std::string state_space_parameterization_;
   bool explicit_motions_;
@@ -120,8 +128,9 @@ protected:
   std::vector<int> space_signature_;
 
   std::string ompldb_filename_;
+  ompl::base::StateSpacePtr state_space_;
   ompl::base::StateStoragePtr state_storage_ptr_;
-  ConstraintApproximationStateStorage* state_storage_;
+  ConstraintApproximationDatabasePtr database_;
   std::size_t milestones_;
 };
 
@@ -134,6 +143,7 @@ struct ConstraintApproximationConstructionOptions
     , explicit_motions(false)
     , explicit_points_resolution(0.0)
     , max_explicit_points(0)
+    , threads(0)
   {
   }
 
@@ -144,6 +154,8 @@ struct ConstraintApproximationConstructionOptions
   bool explicit_motions;
   double explicit_points_resolution;
   unsigned int max_explicit_points;
+  /// number of threads sampling states and connecting them; 0 uses all cores
+  unsigned int threads;
 };
 
 struct ConstraintApproximationConstructionResults
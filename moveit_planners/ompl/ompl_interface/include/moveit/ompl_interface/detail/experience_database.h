@@ -0,0 +1,141 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, MoveIt maintainers
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <moveit/macros/class_forward.h>
+#include <moveit/robot_model/joint_model_group.h>
+#include <ompl/datastructures/NearestNeighbors.h>
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace ompl_interface
+{
+MOVEIT_CLASS_FORWARD(ExperienceDatabase);  // Defines ExperienceDatabasePtr, ConstPtr, WeakPtr... etc
+
+/** @class ExperienceDatabase
+    @brief A store of previously computed solution paths, indexed by their start and goal states.
+
+    Paths are kept per joint model group in a nearest neighbor structure, using as distance between two experiences
+    the sum of the distances between their start states and between their goal states. Each group holds at most a
+    fixed number of experiences; when that number is exceeded, the oldest ones are forgotten first. Paths are stored
+    as the joint values of the group at each waypoint, so they do not depend on the planning scene they were computed
+    in and have to be validated (and possibly repaired) before they are used again. */
+class ExperienceDatabase
+{
+public:
+  /** @brief A solution path of a group, as the joint values of the group at each waypoint */
+  struct Experience
+  {
+    const moveit::core::JointModelGroup* group_;
+    std::vector<std::vector<double> > states_;
+  };
+  typedef std::shared_ptr<const Experience> ExperienceConstPtr;
+
+  /** @brief How a planning request that consulted the database was answered */
+  enum Outcome
+  {
+    /** @brief A stored path was valid in the current scene and was used as is */
+    HIT,
+    /** @brief A stored path was used after invalid parts of it were replanned */
+    REPAIR,
+    /** @brief No stored path could be used; the answer (if any) came from planning from scratch */
+    FALLBACK
+  };
+
+  struct Statistics
+  {
+    std::size_t queries_ = 0;
+    std::size_t hits_ = 0;
+    std::size_t repairs_ = 0;
+    std::size_t fallbacks_ = 0;
+    std::size_t experiences_ = 0;
+
+    /** @brief The fraction of queries that were answered with a stored path, repaired or not */
+    double getRecallRate() const
+    {
+      return queries_ > 0 ? static_cast<double>(hits_ + repairs_) / static_cast<double>(queries_) : 0.0;
+    }
+  };
+
+  /** @brief Construct a database that keeps at most \e max_experiences paths per group. Paths whose start and goal
+      are within \e min_separation of those of a stored path are not stored again */
+  ExperienceDatabase(std::size_t max_experiences = 1000, double min_separation = 1e-3);
+
+  std::size_t getMaximumExperiences() const
+  {
+    return max_experiences_;
+  }
+
+  /** @brief Store the path \e states (joint values of \e group at each waypoint). Returns false if the path has less
+      than two waypoints or a path with nearly the same start and goal is already stored */
+  bool addExperience(const moveit::core::JointModelGroup* group, std::vector<std::vector<double> > states);
+
+  /** @brief Get the \e k stored paths of \e group whose start and goal are closest to \e start and \e goal, closest
+      first */
+  std::vector<ExperienceConstPtr> getNearestExperiences(const moveit::core::JointModelGroup* group,
+                                                        const std::vector<double>& start,
+                                                        const std::vector<double>& goal, std::size_t k) const;
+
+  /** @brief Count a query answered with \e outcome in the statistics */
+  void recordOutcome(Outcome outcome);
+
+  Statistics getStatistics() const;
+
+  /** @brief Forget all stored paths and reset the statistics */
+  void clear();
+
+private:
+  struct GroupExperiences
+  {
+    std::shared_ptr<ompl::NearestNeighbors<ExperienceConstPtr> > nn_;
+    // the stored experiences in the order they were added, for evicting the oldest ones
+    std::deque<ExperienceConstPtr> order_;
+  };
+
+  GroupExperiences& getGroupExperiences(const moveit::core::JointModelGroup* group);
+
+  std::size_t max_experiences_;
+  double min_separation_;
+
+  std::map<std::string, GroupExperiences> groups_;
+  Statistics statistics_;
+  mutable std::mutex lock_;
+};
+}  // namespace ompl_interface
@@ -0,0 +1,137 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, MoveIt maintainers
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <moveit/collision_detection/world.h>
+#include <moveit/ompl_interface/parameterization/model_based_state_space.h>
+#include <ompl/base/State.h>
+#include <boost/graph/adjacency_list.hpp>
+#include <boost/range/iterator_range.hpp>
+#include <functional>
+
+namespace ompl_interface
+{
+/** @class SceneAwareRoadmap
+    @brief Interface of multi-query planners whose roadmap is kept across changes of the planning scene.
+
+    The roadmap remembers the world (and a signature of the rest of the scene) its validity information refers to.
+    When only world objects changed since then, just the vertices and edges whose swept volume intersects the changed
+    objects are marked as unchecked; they are validated again lazily, once a query uses them. The validity cached in
+    the states of unchecked vertices (see ModelBasedStateSpace::StateType) is cleared as well. */
+class SceneAwareRoadmap
+{
+public:
+  using VertexPredicate = std::function<bool(const ompl::base::State*)>;
+  using EdgePredicate = std::function<bool(const ompl::base::State*, const ompl::base::State*)>;
+
+  virtual ~SceneAwareRoadmap() = default;
+
+  /** @brief Mark the checked vertices for which \e vertex_affected returns true and the checked edges for which
+      \e edge_affected returns true as unchecked. Returns the number of edges that were invalidated */
+  virtual std::size_t invalidate(const VertexPredicate& vertex_affected, const EdgePredicate& edge_affected) = 0;
+
+  /** @brief Mark all vertices and edges of the roadmap as unchecked */
+  virtual void invalidateAll() = 0;
+
+  /** @brief The world the validity information of the roadmap refers to; null if it refers to no known world */
+  const collision_detection::WorldConstPtr& getValidatedWorld() const
+  {
+    return validated_world_;
+  }
+
+  /** @brief The signature of the scene apart from its world objects (allowed collisions, attached bodies, ...)
+      the validity information of the roadmap refers to */
+  std::size_t getValidatedSceneSignature() const
+  {
+    return validated_scene_signature_;
+  }
+
+  void setValidatedScene(const collision_detection::WorldConstPtr& world, std::size_t scene_signature)
+  {
+    validated_world_ = world;
+    validated_scene_signature_ = scene_signature;
+  }
+
+private:
+  collision_detection::WorldConstPtr validated_world_;
+  std::size_t validated_scene_signature_ = 0;
+};
+
+/** @class SceneAwareLazyPRM
+    @brief A LazyPRM (or LazyPRMstar) whose roadmap can be selectively invalidated when the scene changes */
+template <class LazyPlanner>
+class SceneAwareLazyPRM : public LazyPlanner, public SceneAwareRoadmap
+{
+public:
+  using LazyPlanner::LazyPlanner;
+
+  std::size_t invalidate(const VertexPredicate& vertex_affected, const EdgePredicate& edge_affected) override
+  {
+    // the state validity checker trusts the validity cached in a state, so it is cleared along with the vertex
+    for (const typename LazyPlanner::Vertex v : boost::make_iterator_range(boost::vertices(this->g_)))
+    {
+      auto* state = this->stateProperty_[v]->template as<ModelBasedStateSpace::StateType>();
+      if ((this->vertexValidityProperty_[v] != LazyPlanner::VALIDITY_UNKNOWN || state->isValidityKnown()) &&
+          vertex_affected(state))
+      {
+        this->vertexValidityProperty_[v] = LazyPlanner::VALIDITY_UNKNOWN;
+        state->clearKnownInformation();
+      }
+    }
+
+    std::size_t count = 0;
+    for (const typename LazyPlanner::Edge e : boost::make_iterator_range(boost::edges(this->g_)))
+      if (this->edgeValidityProperty_[e] != LazyPlanner::VALIDITY_UNKNOWN &&
+          edge_affected(this->stateProperty_[boost::source(e, this->g_)],
+                        this->stateProperty_[boost::target(e, this->g_)]))
+      {
+        this->edgeValidityProperty_[e] = LazyPlanner::VALIDITY_UNKNOWN;
+        ++count;
+      }
+    return count;
+  }
+
+  void invalidateAll() override
+  {
+    for (const typename LazyPlanner::Vertex v : boost::make_iterator_range(boost::vertices(this->g_)))
+    {
+      this->vertexValidityProperty_[v] = LazyPlanner::VALIDITY_UNKNOWN;
+      this->stateProperty_[v]->template as<ModelBasedStateSpace::StateType>()->clearKnownInformation();
+    }
+    for (const typename LazyPlanner::Edge e : boost::make_iterator_range(boost::edges(this->g_)))
+      this->edgeValidityProperty_[e] = LazyPlanner::VALIDITY_UNKNOWN;
+  }
+};
+}  // namespace ompl_interface
@@ -0,0 +1,120 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, MoveIt maintainers
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <moveit/macros/class_forward.h>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace ompl_interface
+{
+MOVEIT_CLASS_FORWARD(StateValidityCache);  // Defines StateValidityCachePtr, ConstPtr, WeakPtr... etc
+
+/** @class StateValidityCache
+    @brief A bounded cache of state validity results, keyed by joint values quantized to a fixed resolution.
+
+    The cache is a fixed size, direct mapped hash table split into shards, each with its own hit and miss counters.
+    Entries are single atomic words, so lookups and insertions never block; an insertion simply replaces whatever
+    entry occupied the slot before. The key also includes a revision number, so all entries are invalidated in
+    constant time by clear() when the planning problem (scene, constraints) changes. */
+class StateValidityCache
+{
+public:
+  struct Statistics
+  {
+    std::size_t hits_ = 0;
+    std::size_t misses_ = 0;
+    std::size_t insertions_ = 0;
+
+    /** @brief The fraction of lookups that were answered by the cache */
+    double getHitRate() const
+    {
+      return hits_ + misses_ > 0 ? static_cast<double>(hits_) / static_cast<double>(hits_ + misses_) : 0.0;
+    }
+  };
+
+  /** @brief Construct a cache holding at most \e capacity entries (rounded up to a power of two). Joint values that
+      round to the same multiple of \e resolution share an entry */
+  StateValidityCache(std::size_t capacity, double resolution);
+
+  std::size_t getCapacity() const
+  {
+    return capacity_;
+  }
+
+  double getResolution() const
+  {
+    return resolution_;
+  }
+
+  /** @brief Invalidate all entries and reset the statistics */
+  void clear();
+
+  /** @brief Compute the key of the \e count joint values in \e values for the current revision */
+  std::uint64_t getKey(const double* values, std::size_t count) const;
+
+  /** @brief Look up the validity stored for \e key. Returns false if it is not known */
+  bool lookup(std::uint64_t key, bool& valid) const;
+
+  /** @brief Store the validity of the state with key \e key */
+  void insert(std::uint64_t key, bool valid);
+
+  Statistics getStatistics() const;
+
+private:
+  struct Shard
+  {
+    std::unique_ptr<std::atomic<std::uint64_t>[]> entries_;
+    mutable std::atomic<std::size_t> hits_{ 0 };
+    mutable std::atomic<std::size_t> misses_{ 0 };
+    std::atomic<std::size_t> insertions_{ 0 };
+    // keep the counters of different shards on different cache lines
+    char padding_[64];
+  };
+
+  const Shard& getShard(std::uint64_t key) const
+  {
+    return shards_[(key >> 32) & shard_mask_];
+  }
+
+  std::size_t capacity_;
+  double resolution_;
+  std::size_t shard_mask_;
+  std::size_t slot_mask_;
+  std::unique_ptr<Shard[]> shards_;
+  std::atomic<std::uint64_t> revision_;
+};
+}  // namespace ompl_interface
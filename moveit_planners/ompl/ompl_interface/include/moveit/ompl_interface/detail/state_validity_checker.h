@@ -70,8 +70,12 @@ public:
   void setVerbose(bool flag);
 
 protected:
+  /** @brief Check path constraints, feasibility and collisions of a state that is known to be within bounds */
+  bool checkState(const ompl::base::State* state, bool verbose) const;
+
   const ModelBasedPlanningContext* planning_context_;
   std::string group_name_;
+  std::size_t variable_count_;
   TSStateStorage tss_;
   collision_detection::CollisionRequest collision_request_simple_;
   collision_detection::CollisionRequest collision_request_with_distance_;
@@ -37,11 +37,17 @@
 #pragma once
 
 #include <moveit/robot_state/robot_state.h>
+#include <cstdint>
 #include <thread>
 #include <mutex>
 
 namespace ompl_interface
 {
+/** @class TSStateStorage
+    @brief Provides each thread with its own copy of a robot state.
+
+    The state of the calling thread is remembered in a small thread local cache, so the common case of a thread
+    repeatedly asking for its state does not take the lock shared by all threads. */
 class TSStateStorage
 {
 public:
@@ -52,6 +58,8 @@ public:
   moveit::core::RobotState* getStateStorage() const;
 
 private:
+  /// unique among all instances ever created, so entries of destroyed instances in thread local caches never match
+  const std::uint64_t id_;
   moveit::core::RobotState start_state_;
   mutable std::map<std::thread::id, moveit::core::RobotState*> thread_states_;
   mutable std::mutex lock_;
@@ -38,12 +38,13 @@
 
 #include <moveit/ompl_interface/parameterization/model_based_state_space.h>
 #include <moveit/ompl_interface/detail/constrained_valid_state_sampler.h>
+#include <moveit/ompl_interface/detail/state_validity_cache.h>
+#include <moveit/ompl_interface/detail/experience_database.h>
 #include <moveit/constraint_samplers/constraint_sampler_manager.h>
 #include <moveit/planning_interface/planning_interface.h>
 
 #include <ompl/geometric/SimpleSetup.h>
 #include <ompl/tools/benchmark/Benchmark.h>
-#include <ompl/tools/multiplan/ParallelPlan.h>
 #include <ompl/base/StateStorage.h>
 
 namespace ompl_interface
@@ -254,6 +255,25 @@ public:
     return constraints_library_;
   }
 
+  /** @brief The cache of state validity results, if enabled by the 'state_validity_cache_size' configuration
+   * parameter. It is invalidated whenever the context is configured for a new request */
+  const StateValidityCachePtr& getStateValidityCache() const
+  {
+    return state_validity_cache_;
+  }
+
+  /** @brief Set the database of previously solved paths to consult and extend when the 'use_experience'
+   * configuration parameter is set */
+  void setExperienceDatabase(const ExperienceDatabasePtr& experience_database)
+  {
+    experience_database_ = experience_database;
+  }
+
+  const ExperienceDatabasePtr& getExperienceDatabase() const
+  {
+    return experience_database_;
+  }
+
   bool simplifySolutions() const
   {
     return simplify_solutions_;
@@ -333,6 +353,32 @@ protected:
   void preSolve();
   void postSolve();
 
+  /** @brief If the planner keeps a scene aware roadmap (multi-query planning), invalidate the parts of it that the
+      changes of the planning scene since its last use may have made invalid */
+  void updateRoadmapValidity();
+
+  /** @brief A signature of the parts of the planning scene other than the world objects that affect validity */
+  std::size_t computeSceneSignature() const;
+
+  /** @brief Run \e count planners on the problem, on at most max_planning_threads_ threads, and (if enabled)
+      hybridize the solutions they find */
+  bool solveInParallel(const ob::PlannerTerminationCondition& ptc, unsigned int count);
+
+  /** @brief Race planning from scratch against retrieving (and repairing) a stored path for the current request,
+      and keep whichever solution is found first */
+  bool solveWithExperience(const ob::PlannerTerminationCondition& ptc);
+
+  /** @brief Look for a stored path that can be adapted to the current request. Sets \e repaired if parts of it had
+      to be replanned */
+  bool retrieveExperience(const ob::PlannerTerminationCondition& ptc, og::PathGeometric& path, bool& repaired);
+
+  /** @brief Make \e path valid in the current planning scene by dropping invalid waypoints and replanning the
+      motions between the remaining ones that are in collision. Sets \e repaired if anything was changed */
+  bool repairExperience(const ob::PlannerTerminationCondition& ptc, og::PathGeometric& path, bool& repaired);
+
+  /** @brief Add the current solution to the experience database, unless it was retrieved from there unchanged */
+  void storeExperience();
+
   void startSampling();
   void stopSampling();
 
@@ -382,9 +428,6 @@ protected:
   /// the OMPL tool for benchmarking planners
   ot::Benchmark ompl_benchmark_;
 
-  /// tool used to compute multiple plans in parallel; this uses the problem definition maintained by ompl_simple_setup_
-  ot::ParallelPlan ompl_parallel_plan_;
-
   std::vector<int> space_signature_;
 
   kinematic_constraints::KinematicConstraintSetPtr path_constraints_;
@@ -427,6 +470,18 @@ protected:
 
   ConstraintsLibraryPtr constraints_library_;
 
+  /// cache of state validity results shared by the state validity checkers of this context; null when disabled
+  StateValidityCachePtr state_validity_cache_;
+
+  /// database of previously solved paths shared by the contexts of a planning context manager
+  ExperienceDatabasePtr experience_database_;
+
+  /// race retrieval of stored paths against planning from scratch (when an experience database is set)
+  bool use_experience_;
+
+  /// true if the current solution is a stored path that was used unchanged
+  bool solution_from_experience_;
+
   bool simplify_solutions_;
 
   // if false the final solution is not interpolated
@@ -169,6 +169,12 @@ public:
     return robot_model_;
   }
 
+  /** \brief The database of solved paths that planning configurations with 'use_experience' enabled reuse */
+  const ExperienceDatabasePtr& getExperienceDatabase() const
+  {
+    return experience_database_;
+  }
+
   /** \brief Returns a planning context to OMPLInterface, which in turn passes it to OMPLPlannerManager.
    *
    * This function checks the input and reads planner specific configurations.
@@ -265,6 +271,9 @@ protected:
   /// Multi-query planner allocator
   MultiQueryPlannerAllocator planner_allocator_;
 
+  /// solved paths, shared by all planning contexts
+  ExperienceDatabasePtr experience_database_;
+
 private:
   MOVEIT_STRUCT_FORWARD(CachedContexts);
   CachedContextsPtr cached_contexts_;
@@ -73,6 +73,9 @@ struct GenerateStateDatabaseParameters
     construction_opts.explicit_points_resolution = nh.param("explicit_points_resolution", 0.05);
     construction_opts.max_explicit_points = nh.param("max_explicit_points", 200);
 
+    // threads sampling and connecting states, 0 for one per core
+    construction_opts.threads = nh.param("threads", 0);
+
     // local planning in JointModel state space
     construction_opts.state_space_parameterization =
         nh.param<std::string>("state_space_parameterization", "JointModel");
@@ -0,0 +1,269 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, MoveIt maintainers
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/ompl_interface/detail/constraint_approximation_database.h>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <ros/console.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace ompl_interface
+{
+constexpr char LOGNAME[] = "constraint_approximation_database";
+
+namespace
+{
+// "MVCADB01" when read in the byte order the file was written in
+constexpr std::uint64_t MAGIC = 0x313042444143564dULL;
+constexpr std::uint64_t VERSION = 1;
+
+struct Header
+{
+  std::uint64_t magic;
+  std::uint64_t version;
+  std::uint64_t record_size;
+  std::uint64_t state_count;
+  std::uint64_t milestone_count;
+  std::uint64_t connection_count;
+  // offsets of the sections from the start of the data, in bytes; motions_offset is 0 if motions are not stored
+  std::uint64_t states_offset;
+  std::uint64_t neighbor_offsets_offset;
+  std::uint64_t neighbors_offset;
+  std::uint64_t motions_offset;
+  std::uint64_t size;
+};
+
+std::size_t roundUpToWord(std::size_t bytes)
+{
+  return (bytes + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t) * sizeof(std::uint64_t);
+}
+
+bool inRange(std::uint64_t offset, std::uint64_t length, std::uint64_t size)
+{
+  return offset % sizeof(std::uint64_t) == 0 && offset <= size && length <= size - offset;
+}
+}  // namespace
+}  // namespace ompl_interface
+
+ompl_interface::ConstraintApproximationDatabase::~ConstraintApproximationDatabase() = default;
+
+ompl_interface::ConstraintApproximationDatabasePtr
+ompl_interface::ConstraintApproximationDatabase::fromStateStorage(const ConstraintApproximationStateStorage& storage,
+                                                                  std::size_t milestones)
+{
+  const ompl::base::StateSpacePtr& space = storage.getStateSpace();
+  if (milestones == 0 || milestones > storage.size())
+    milestones = storage.size();
+
+  Header header;
+  header.magic = MAGIC;
+  header.version = VERSION;
+  header.record_size = space->getSerializationLength();
+  header.state_count = storage.size();
+  header.milestone_count = milestones;
+  header.connection_count = 0;
+  bool explicit_motions = false;
+  for (std::size_t i = 0; i < milestones; ++i)
+  {
+    header.connection_count += storage.getMetadata(i).first.size();
+    explicit_motions = explicit_motions || !storage.getMetadata(i).second.empty();
+  }
+
+  const std::size_t record_stride = roundUpToWord(header.record_size);
+  header.states_offset = sizeof(Header);
+  header.neighbor_offsets_offset = header.states_offset + header.state_count * record_stride;
+  header.neighbors_offset = header.neighbor_offsets_offset + (milestones + 1) * sizeof(std::uint64_t);
+  header.motions_offset = header.neighbors_offset + header.connection_count * sizeof(std::uint64_t);
+  header.size = header.motions_offset + (explicit_motions ? 2 * header.connection_count * sizeof(std::uint64_t) : 0);
+  if (!explicit_motions)
+    header.motions_offset = 0;
+
+  ConstraintApproximationDatabasePtr database(new ConstraintApproximationDatabase());
+  std::vector<std::uint64_t>& buffer = database->buffer_;
+  buffer.resize(header.size / sizeof(std::uint64_t), 0);
+  char* data = reinterpret_cast<char*>(buffer.data());
+  std::memcpy(data, &header, sizeof(Header));
+
+  for (std::size_t i = 0; i < storage.size(); ++i)
+    space->serialize(data + header.states_offset + i * record_stride, storage.getState(i));
+
+  auto* neighbor_offsets = reinterpret_cast<std::uint64_t*>(data + header.neighbor_offsets_offset);
+  auto* neighbors = reinterpret_cast<std::uint64_t*>(data + header.neighbors_offset);
+  auto* motions = explicit_motions ? reinterpret_cast<std::uint64_t*>(data + header.motions_offset) : nullptr;
+  std::size_t k = 0;
+  for (std::size_t i = 0; i < milestones; ++i)
+  {
+    neighbor_offsets[i] = k;
+    const ConstrainedStateMetadata& md = storage.getMetadata(i);
+    for (std::size_t neighbor : md.first)
+    {
+      neighbors[k] = neighbor;
+      if (motions)
+      {
+        auto it = md.second.find(neighbor);
+        if (it != md.second.end())
+        {
+          motions[2 * k] = it->second.first;
+          motions[2 * k + 1] = it->second.second;
+        }
+      }
+      ++k;
+    }
+  }
+  neighbor_offsets[milestones] = k;
+
+  database->setData(data, header.size);
+  return database;
+}
+
+ompl_interface::ConstraintApproximationDatabasePtr
+ompl_interface::ConstraintApproximationDatabase::map(const std::string& filename)
+{
+  ConstraintApproximationDatabasePtr database(new ConstraintApproximationDatabase());
+  try
+  {
+    database->file_.reset(new boost::interprocess::file_mapping(filename.c_str(), boost::interprocess::read_only));
+    database->region_.reset(new boost::interprocess::mapped_region(*database->file_, boost::interprocess::read_only));
+  }
+  catch (boost::interprocess::interprocess_exception& ex)
+  {
+    ROS_ERROR_NAMED(LOGNAME, "Unable to map constraint approximation database '%s': %s", filename.c_str(), ex.what());
+    return ConstraintApproximationDatabasePtr();
+  }
+  if (!database->setData(static_cast<const char*>(database->region_->get_address()), database->region_->get_size()))
+  {
+    ROS_ERROR_NAMED(LOGNAME, "File '%s' is not a valid constraint approximation database", filename.c_str());
+    return ConstraintApproximationDatabasePtr();
+  }
+  return database;
+}
+
+bool ompl_interface::ConstraintApproximationDatabase::isDatabaseFile(const std::string& filename)
+{
+  std::ifstream in(filename.c_str(), std::ios::binary);
+  std::uint64_t magic = 0;
+  return in.read(reinterpret_cast<char*>(&magic), sizeof(magic)) && magic == MAGIC;
+}
+
+bool ompl_interface::ConstraintApproximationDatabase::save(const std::string& filename) const
+{
+  // write next to the destination and rename, so a database currently mapped from filename stays intact
+  const std::string temp_filename = filename + ".tmp";
+  {
+    std::ofstream out(temp_filename.c_str(), std::ios::binary | std::ios::trunc);
+    out.write(data_, data_size_);
+    if (!out.good())
+    {
+      ROS_ERROR_NAMED(LOGNAME, "Unable to write constraint approximation database '%s'", filename.c_str());
+      std::remove(temp_filename.c_str());
+      return false;
+    }
+  }
+  if (std::rename(temp_filename.c_str(), filename.c_str()) != 0)
+  {
+    ROS_ERROR_NAMED(LOGNAME, "Unable to write constraint approximation database '%s'", filename.c_str());
+    std::remove(temp_filename.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool ompl_interface::ConstraintApproximationDatabase::getMotion(std::size_t from, std::size_t to, std::size_t& first,
+                                                                std::size_t& last) const
+{
+  if (!motions_ || from >= milestone_count_)
+    return false;
+  for (std::uint64_t k = neighbor_offsets_[from]; k < neighbor_offsets_[from + 1]; ++k)
+    if (neighbors_[k] == to)
+    {
+      first = motions_[2 * k];
+      last = motions_[2 * k + 1];
+      return true;
+    }
+  return false;
+}
+
+bool ompl_interface::ConstraintApproximationDatabase::setData(const char* data, std::size_t size)
+{
+  if (size < sizeof(Header))
+    return false;
+  Header header;
+  std::memcpy(&header, data, sizeof(Header));
+  if (header.magic != MAGIC || header.version != VERSION || header.size != size ||
+      header.milestone_count > header.state_count)
+    return false;
+
+  const std::size_t record_stride = roundUpToWord(header.record_size);
+  // bound the counts by the size before multiplying, so the section lengths below cannot overflow
+  if ((record_stride != 0 && header.state_count > size / record_stride) ||
+      header.milestone_count >= size / sizeof(std::uint64_t) ||
+      header.connection_count > size / (2 * sizeof(std::uint64_t)))
+    return false;
+  if (!inRange(header.states_offset, header.state_count * record_stride, size) ||
+      !inRange(header.neighbor_offsets_offset, (header.milestone_count + 1) * sizeof(std::uint64_t), size) ||
+      !inRange(header.neighbors_offset, header.connection_count * sizeof(std::uint64_t), size) ||
+      (header.motions_offset != 0 &&
+       !inRange(header.motions_offset, 2 * header.connection_count * sizeof(std::uint64_t), size)))
+    return false;
+
+  data_ = data;
+  data_size_ = size;
+  record_size_ = header.record_size;
+  record_stride_ = record_stride;
+  state_count_ = header.state_count;
+  milestone_count_ = header.milestone_count;
+  states_ = data + header.states_offset;
+  neighbor_offsets_ = reinterpret_cast<const std::uint64_t*>(data + header.neighbor_offsets_offset);
+  neighbors_ = reinterpret_cast<const std::uint64_t*>(data + header.neighbors_offset);
+  motions_ =
+      header.motions_offset != 0 ? reinterpret_cast<const std::uint64_t*>(data + header.motions_offset) : nullptr;
+
+  // check the connections once here, so the accessors can index the states and neighbors without bounds checks
+  if (neighbor_offsets_[0] != 0 || neighbor_offsets_[milestone_count_] != header.connection_count)
+    return false;
+  for (std::size_t i = 0; i < milestone_count_; ++i)
+    if (neighbor_offsets_[i] > neighbor_offsets_[i + 1])
+      return false;
+  for (std::uint64_t k = 0; k < header.connection_count; ++k)
+  {
+    if (neighbors_[k] >= state_count_)
+      return false;
+    if (motions_ && (motions_[2 * k] > motions_[2 * k + 1] || motions_[2 * k + 1] > state_count_))
+      return false;
+  }
+  return true;
+}
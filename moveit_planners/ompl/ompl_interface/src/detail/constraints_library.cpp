@@ -36,11 +36,16 @@
 
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/filesystem.hpp>
+#include <algorithm>
+#include <atomic>
 #include <fstream>
+#include <iterator>
 #include <moveit/ompl_interface/detail/constrained_sampler.h>
 #include <moveit/ompl_interface/detail/constraints_library.h>
+#include <moveit/ompl_interface/parameterization/work_space/pose_model_state_space.h>
 #include <moveit/profiler/profiler.h>
 #include <ompl/tools/config/SelfConfig.h>
+#include <thread>
 #include <utility>
 
 namespace ompl_interface
@@ -79,22 +84,63 @@ void hexToMsg(const std::string& hex, T& msg)
   ros::serialization::IStream stream_arg(buffer_arg.get(), serial_size_arg);
   ros::serialization::deserialize(stream_arg, msg);
 }
+
+/** Reads states back from a database. Only the joint values of a state are serialized, so the flags of a read state
+    are reset to those of a newly allocated one and, in a pose parameterization, the poses are recomputed */
+class StoredStateReader
+{
+public:
+  StoredStateReader(const ConstraintApproximationDatabase* database, const ob::StateSpace* space)
+    : database_(database), space_(space), pose_space_(dynamic_cast<const PoseModelStateSpace*>(space))
+  {
+    ob::State* state = space->allocState();
+    flags_ = state->as<ModelBasedStateSpace::StateType>()->flags;
+    space->freeState(state);
+  }
+
+  void copyState(std::size_t index, ob::State* state) const
+  {
+    database_->copyState(space_, index, state);
+    state->as<ModelBasedStateSpace::StateType>()->flags = flags_;
+    if (pose_space_)
+      pose_space_->computeStateFK(state);
+  }
+
+  const ConstraintApproximationDatabase* getDatabase() const
+  {
+    return database_;
+  }
+
+private:
+  const ConstraintApproximationDatabase* database_;
+  const ob::StateSpace* space_;
+  const PoseModelStateSpace* pose_space_;
+  int flags_;
+};
 }  // namespace
 
 class ConstraintApproximationStateSampler : public ob::StateSampler
 {
 public:
-  ConstraintApproximationStateSampler(const ob::StateSpace* space,
-                                      const ConstraintApproximationStateStorage* state_storage, std::size_t milestones)
-    : ob::StateSampler(space), state_storage_(state_storage)
+  ConstraintApproximationStateSampler(const ob::StateSpace* space, const ConstraintApproximationDatabase* database,
+                                      std::size_t milestones)
+    : ob::StateSampler(space)
+    , database_(database)
+    , reader_(database, space)
+    , stored_state_(space->allocState())
   {
     max_index_ = milestones - 1;
     inv_dim_ = space->getDimension() > 0 ? 1.0 / (double)space->getDimension() : 1.0;
   }
 
+  ~ConstraintApproximationStateSampler() override
+  {
+    space_->freeState(stored_state_);
+  }
+
   void sampleUniform(ob::State* state) override
   {
-    space_->copyState(state, state_storage_->getState(rng_.uniformInt(0, max_index_)));
+    reader_.copyState(rng_.uniformInt(0, max_index_), state);
   }
 
   void sampleUniformNear(ob::State* state, const ob::State* near, const double distance) override
@@ -104,16 +150,17 @@ public:
 
     if (tag >= 0)
     {
-      const ConstrainedStateMetadata& md = state_storage_->getMetadata(tag);
-      if (!md.first.empty())
+      const std::size_t neighbor_count = database_->getNeighborCount(tag);
+      if (neighbor_count > 0)
       {
-        std::size_t matt = md.first.size() / 3;
+        const std::uint64_t* neighbors = database_->getNeighbors(tag);
+        std::size_t matt = neighbor_count / 3;
         std::size_t att = 0;
         do
         {
-          index = md.first[rng_.uniformInt(0, md.first.size() - 1)];
+          index = neighbors[rng_.uniformInt(0, neighbor_count - 1)];
         } while (dirty_.find(index) != dirty_.end() && ++att < matt);
-        if (att >= matt)
+        if (att >= matt || static_cast<std::size_t>(index) >= database_->size())
           index = -1;
         else
           dirty_.insert(index);
@@ -122,15 +169,16 @@ public:
     if (index < 0)
       index = rng_.uniformInt(0, max_index_);
 
-    double dist = space_->distance(near, state_storage_->getState(index));
+    reader_.copyState(index, stored_state_);
+    double dist = space_->distance(near, stored_state_);
 
     if (dist > distance)
     {
       double d = pow(rng_.uniform01(), inv_dim_) * distance;
-      space_->interpolate(near, state_storage_->getState(index), d / dist, state);
+      space_->interpolate(near, stored_state_, d / dist, state);
     }
     else
-      space_->copyState(state, state_storage_->getState(index));
+      space_->copyState(state, stored_state_);
   }
 
   void sampleGaussian(ob::State* state, const ob::State* mean, const double stdDev) override
@@ -140,13 +188,16 @@ public:
 
 protected:
   /** \brief The states to sample from */
-  const ConstraintApproximationStateStorage* state_storage_;
+  const ConstraintApproximationDatabase* database_;
+  StoredStateReader reader_;
+  /** \brief Scratch space for a state read from the database */
+  ob::State* stored_state_;
   std::set<std::size_t> dirty_;
   unsigned int max_index_;
   double inv_dim_;
 };
 
-bool interpolateUsingStoredStates(const ConstraintApproximationStateStorage* state_storage, const ob::State* from,
+bool interpolateUsingStoredStates(const StoredStateReader& reader, const ob::StateSpace* space, const ob::State* from,
                                   const ob::State* to, const double t, ob::State* state)
 {
   int tag_from = from->as<ModelBasedStateSpace::StateType>()->tag;
@@ -156,26 +207,23 @@ bool interpolateUsingStoredStates(const ConstraintApproximationStateStorage* sta
     return false;
 
   if (tag_from == tag_to)
-    state_storage->getStateSpace()->copyState(state, to);
+    space->copyState(state, to);
   else
   {
-    const ConstrainedStateMetadata& md = state_storage->getMetadata(tag_from);
-
-    auto it = md.second.find(tag_to);
-    if (it == md.second.end())
+    std::size_t first, last;
+    if (!reader.getDatabase()->getMotion(tag_from, tag_to, first, last))
       return false;
-    const std::pair<std::size_t, std::size_t>& istates = it->second;
-    std::size_t index = (std::size_t)((istates.second - istates.first + 2) * t + 0.5);
+    std::size_t index = (std::size_t)((last - first + 2) * t + 0.5);
 
     if (index == 0)
-      state_storage->getStateSpace()->copyState(state, from);
+      space->copyState(state, from);
     else
     {
       --index;
-      if (index >= istates.second - istates.first)
-        state_storage->getStateSpace()->copyState(state, to);
+      if (index >= last - first)
+        space->copyState(state, to);
       else
-        state_storage->getStateSpace()->copyState(state, state_storage->getState(istates.first + index));
+        reader.copyState(first + index, state);
     }
   }
   return true;
@@ -183,23 +231,23 @@ bool interpolateUsingStoredStates(const ConstraintApproximationStateStorage* sta
 
 ompl_interface::InterpolationFunction ompl_interface::ConstraintApproximation::getInterpolationFunction() const
 {
-  if (explicit_motions_ && milestones_ > 0 && milestones_ < state_storage_->size())
-    return std::bind(&interpolateUsingStoredStates, state_storage_, std::placeholders::_1, std::placeholders::_2,
-                     std::placeholders::_3, std::placeholders::_4);
+  if (explicit_motions_ && milestones_ > 0 && milestones_ < database_->size())
+    return std::bind(&interpolateUsingStoredStates, StoredStateReader(database_.get(), state_space_.get()),
+                     state_space_.get(), std::placeholders::_1, std::placeholders::_2, std::placeholders::_3,
+                     std::placeholders::_4);
   return InterpolationFunction();
 }
 
 ompl::base::StateSamplerPtr
 allocConstraintApproximationStateSampler(const ob::StateSpace* space, const std::vector<int>& expected_signature,
-                                         const ConstraintApproximationStateStorage* state_storage,
-                                         std::size_t milestones)
+                                         const ConstraintApproximationDatabase* database, std::size_t milestones)
 {
   std::vector<int> sig;
   space->computeSignature(sig);
   if (sig != expected_signature)
     return ompl::base::StateSamplerPtr();
   else
-    return ompl::base::StateSamplerPtr(new ConstraintApproximationStateSampler(space, state_storage, milestones));
+    return ompl::base::StateSamplerPtr(new ConstraintApproximationStateSampler(space, database, milestones));
 }
 }  // namespace ompl_interface
 
@@ -211,22 +259,45 @@ ompl_interface::ConstraintApproximation::ConstraintApproximation(
   , explicit_motions_(explicit_motions)
   , constraint_msg_(std::move(msg))
   , ompldb_filename_(std::move(filename))
+  , state_space_(storage->getStateSpace())
   , state_storage_ptr_(std::move(storage))
   , milestones_(milestones)
 {
-  state_storage_ = static_cast<ConstraintApproximationStateStorage*>(state_storage_ptr_.get());
-  state_storage_->getStateSpace()->computeSignature(space_signature_);
-  if (milestones_ == 0)
-    milestones_ = state_storage_->size();
+  database_ = ConstraintApproximationDatabase::fromStateStorage(
+      *static_cast<ConstraintApproximationStateStorage*>(state_storage_ptr_.get()), milestones_);
+  initialize();
+}
+
+ompl_interface::ConstraintApproximation::ConstraintApproximation(
+    std::string group, std::string state_space_parameterization, bool explicit_motions, moveit_msgs::Constraints msg,
+    std::string filename, ompl::base::StateSpacePtr state_space, ConstraintApproximationDatabasePtr database,
+    std::size_t milestones)
+  : group_(std::move(group))
+  , state_space_parameterization_(std::move(state_space_parameterization))
+  , explicit_motions_(explicit_motions)
+  , constraint_msg_(std::move(msg))
+  , ompldb_filename_(std::move(filename))
+  , state_space_(std::move(state_space))
+  , database_(std::move(database))
+  , milestones_(milestones)
+{
+  initialize();
+}
+
+void ompl_interface::ConstraintApproximation::initialize()
+{
+  state_space_->computeSignature(space_signature_);
+  if (milestones_ == 0 || milestones_ > database_->getMilestoneCount())
+    milestones_ = database_->getMilestoneCount();
 }
 
 ompl::base::StateSamplerAllocator
 ompl_interface::ConstraintApproximation::getStateSamplerAllocator(const moveit_msgs::Constraints& /*unused*/) const
 {
-  if (state_storage_->size() == 0)
+  if (database_->size() == 0)
     return ompl::base::StateSamplerAllocator();
-  return std::bind(&allocConstraintApproximationStateSampler, std::placeholders::_1, space_signature_, state_storage_,
-                   milestones_);
+  return std::bind(&allocConstraintApproximationStateSampler, std::placeholders::_1, space_signature_,
+                   database_.get(), milestones_);
 }
 /*
 void ompl_interface::ConstraintApproximation::visualizeDistribution(const
@@ -324,23 +395,39 @@ void ompl_interface::ConstraintsLibrary::loadConstraintApproximations(const std:
                    state_space_parameterization.c_str(), group.c_str(), filename.c_str());
     moveit_msgs::Constraints msg;
     hexToMsg(serialization, msg);
-    auto* cass = new ConstraintApproximationStateStorage(context_->getOMPLSimpleSetup()->getStateSpace());
-    cass->load((std::string{ path }.append("/").append(filename)).c_str());
-    ConstraintApproximationPtr cap(new ConstraintApproximation(group, state_space_parameterization, explicit_motions,
-                                                               msg, filename, ompl::base::StateStoragePtr(cass),
-                                                               milestones));
+    const ob::StateSpacePtr& space = context_->getOMPLSimpleSetup()->getStateSpace();
+    const std::string full_filename = std::string{ path }.append("/").append(filename);
+    ConstraintApproximationPtr cap;
+    if (ConstraintApproximationDatabase::isDatabaseFile(full_filename))
+    {
+      ConstraintApproximationDatabasePtr database = ConstraintApproximationDatabase::map(full_filename);
+      if (!database || database->getRecordSize() != space->getSerializationLength())
+      {
+        ROS_ERROR_NAMED(LOGNAME, "Unable to use constraint approximation database '%s'", full_filename.c_str());
+        continue;
+      }
+      cap = std::make_shared<ConstraintApproximation>(group, state_space_parameterization, explicit_motions, msg,
+                                                      filename, space, database, milestones);
+    }
+    else
+    {
+      // state storage archives written before the database format was introduced
+      auto* cass = new ConstraintApproximationStateStorage(space);
+      cass->load(full_filename.c_str());
+      cap = std::make_shared<ConstraintApproximation>(group, state_space_parameterization, explicit_motions, msg,
+                                                      filename, ompl::base::StateStoragePtr(cass), milestones);
+    }
     if (constraint_approximations_.find(cap->getName()) != constraint_approximations_.end())
       ROS_WARN_NAMED(LOGNAME, "Overwriting constraint approximation named '%s'", cap->getName().c_str());
     constraint_approximations_[cap->getName()] = cap;
-    std::size_t sum = 0;
-    for (std::size_t i = 0; i < cass->size(); ++i)
-      sum += cass->getMetadata(i).first.size();
+    std::size_t sum = cap->getDatabase()->getConnectionCount();
     ROS_INFO_NAMED(LOGNAME,
                    "Loaded %lu states (%lu milestones) and %lu "
                    "connections (%0.1lf per state) "
                    "for constraint named '%s'%s",
-                   cass->size(), cap->getMilestoneCount(), sum, (double)sum / (double)cap->getMilestoneCount(),
-                   msg.name.c_str(), explicit_motions ? ". Explicit motions included." : "");
+                   cap->getDatabase()->size(), cap->getMilestoneCount(), sum,
+                   (double)sum / (double)cap->getMilestoneCount(), msg.name.c_str(),
+                   explicit_motions ? ". Explicit motions included." : "");
   }
   ROS_INFO_NAMED(LOGNAME, "Done loading constrained space approximations.");
 }
@@ -370,8 +457,7 @@ void ompl_interface::ConstraintsLibrary::saveConstraintApproximations(const std:
       msgToHex(it->second->getConstraintsMsg(), serialization);
       fout << serialization << std::endl;
       fout << it->second->getFilename() << std::endl;
-      if (it->second->getStateStorage())
-        it->second->getStateStorage()->store((path + "/" + it->second->getFilename()).c_str());
+      it->second->getDatabase()->save(path + "/" + it->second->getFilename());
     }
   else
     ROS_ERROR_NAMED(LOGNAME, "Unable to save constraint approximation to '%s'", path.c_str());
@@ -458,6 +544,29 @@ ompl_interface::ConstraintsLibrary::addConstraintApproximation(const moveit_msgs
   return res;
 }
 
+namespace ompl_interface
+{
+namespace
+{
+// Take one of the edges_per_sample connection slots of a milestone, if any is left
+bool reserveConnection(std::atomic<unsigned int>& degree, unsigned int edges_per_sample)
+{
+  unsigned int current = degree.load();
+  while (current < edges_per_sample)
+    if (degree.compare_exchange_weak(current, current + 1))
+      return true;
+  return false;
+}
+
+struct ConstructedEdge
+{
+  std::size_t from;
+  std::size_t to;
+  std::vector<ob::State*> states;
+};
+}  // namespace
+}  // namespace ompl_interface
+
 ompl::base::StateStoragePtr ompl_interface::ConstraintsLibrary::constructConstraintApproximation(
     ModelBasedPlanningContext* pcontext, const moveit_msgs::Constraints& constr_sampling,
     const moveit_msgs::Constraints& constr_hard, const ConstraintApproximationConstructionOptions& options,
@@ -467,81 +576,105 @@ ompl::base::StateStoragePtr ompl_interface::ConstraintsLibrary::constructConstra
   ConstraintApproximationStateStorage* cass = new ConstraintApproximationStateStorage(pcontext->getOMPLStateSpace());
   ob::StateStoragePtr state_storage(cass);
 
-  // construct a sampler for the sampling constraints
-  kinematic_constraints::KinematicConstraintSet kset(pcontext->getRobotModel());
-  moveit::core::Transforms no_transforms(pcontext->getRobotModel()->getModelFrame());
-  kset.add(constr_hard, no_transforms);
-
+  const ModelBasedStateSpacePtr& space = pcontext->getOMPLStateSpace();
   const moveit::core::RobotState& default_state = pcontext->getCompleteInitialRobotState();
-
-  unsigned int attempts = 0;
+  const unsigned int thread_count =
+      options.threads > 0 ? options.threads : std::max(1u, std::thread::hardware_concurrency());
 
   double bounds_val = std::numeric_limits<double>::max() / 2.0 - 1.0;
-  pcontext->getOMPLStateSpace()->setPlanningVolume(-bounds_val, bounds_val, -bounds_val, bounds_val, -bounds_val,
-                                                   bounds_val);
-  pcontext->getOMPLStateSpace()->setup();
+  space->setPlanningVolume(-bounds_val, bounds_val, -bounds_val, bounds_val, -bounds_val, bounds_val);
+  space->setup();
+
+  // construct the constrained states; every thread has its own sampler, constraint set and robot state
+  std::vector<std::vector<ob::State*> > sampled_states(thread_count);
+  std::vector<double> sampling_rates(thread_count, -1.0);
+  std::atomic<unsigned int> kept(0);
+  std::atomic<unsigned int> attempts(0);
+  std::atomic<int> done(-1);
+  std::atomic<bool> slow_warn(false);
+  std::atomic<bool> failed(false);
+
+  auto sample_states = [&](unsigned int thread_index) {
+    kinematic_constraints::KinematicConstraintSet kset(pcontext->getRobotModel());
+    moveit::core::Transforms no_transforms(pcontext->getRobotModel()->getModelFrame());
+    kset.add(constr_hard, no_transforms);
+    moveit::core::RobotState robot_state(default_state);
+
+    const constraint_samplers::ConstraintSamplerManagerPtr& csmng = pcontext->getConstraintSamplerManager();
+    ConstrainedSampler* constrained_sampler = nullptr;
+    if (csmng)
+    {
+      constraint_samplers::ConstraintSamplerPtr constraint_sampler = csmng->selectSampler(
+          pcontext->getPlanningScene(), pcontext->getJointModelGroup()->getName(), constr_sampling);
+      if (constraint_sampler)
+        constrained_sampler = new ConstrainedSampler(pcontext, constraint_sampler);
+    }
+    ob::StateSamplerPtr ss(constrained_sampler ? ob::StateSamplerPtr(constrained_sampler) :
+                                                 space->allocDefaultStateSampler());
 
-  // construct the constrained states
+    ob::State* temp = space->allocState();
+    while (kept < options.samples && !failed)
+    {
+      const unsigned int attempt = ++attempts;
+      const unsigned int kept_now = std::min(kept.load(), options.samples);
+      int done_now = 100 * kept_now / options.samples;
+      int done_before = done;
+      if (done_before < done_now && done.compare_exchange_strong(done_before, done_now))
+        ROS_INFO_NAMED(LOGNAME, "%d%% complete (kept %0.1lf%% sampled states)", done_now,
+                       100.0 * (double)kept_now / (double)attempt);
+
+      if (attempt > 10 && attempt > kept_now * 100 && !slow_warn.exchange(true))
+        ROS_WARN_NAMED(LOGNAME, "Computation of valid state database is very slow...");
+
+      if (attempt > options.samples && kept_now == 0)
+      {
+        if (!failed.exchange(true))
+          ROS_ERROR_NAMED(LOGNAME, "Unable to generate any samples");
+        break;
+      }
 
-  moveit::core::RobotState robot_state(default_state);
-  const constraint_samplers::ConstraintSamplerManagerPtr& csmng = pcontext->getConstraintSamplerManager();
-  ConstrainedSampler* constrained_sampler = nullptr;
-  if (csmng)
-  {
-    constraint_samplers::ConstraintSamplerPtr constraint_sampler =
-        csmng->selectSampler(pcontext->getPlanningScene(), pcontext->getJointModelGroup()->getName(), constr_sampling);
-    if (constraint_sampler)
-      constrained_sampler = new ConstrainedSampler(pcontext, constraint_sampler);
-  }
+      ss->sampleUniform(temp);
+      space->copyToRobotState(robot_state, temp);
+      if (kset.decide(robot_state).satisfied && kept++ < options.samples)
+        sampled_states[thread_index].push_back(space->cloneState(temp));
+    }
+    space->freeState(temp);
 
-  ob::StateSamplerPtr ss(constrained_sampler ? ob::StateSamplerPtr(constrained_sampler) :
-                                               pcontext->getOMPLStateSpace()->allocDefaultStateSampler());
+    if (constrained_sampler)
+      sampling_rates[thread_index] = constrained_sampler->getConstrainedSamplingRate();
+  };
 
-  ompl::base::ScopedState<> temp(pcontext->getOMPLStateSpace());
-  int done = -1;
-  bool slow_warn = false;
   ompl::time::point start = ompl::time::now();
-  while (state_storage->size() < options.samples)
   {
-    ++attempts;
-    int done_now = 100 * state_storage->size() / options.samples;
-    if (done != done_now)
-    {
-      done = done_now;
-      ROS_INFO_NAMED(LOGNAME, "%d%% complete (kept %0.1lf%% sampled states)", done,
-                     100.0 * (double)state_storage->size() / (double)attempts);
-    }
-
-    if (!slow_warn && attempts > 10 && attempts > state_storage->size() * 100)
-    {
-      slow_warn = true;
-      ROS_WARN_NAMED(LOGNAME, "Computation of valid state database is very slow...");
-    }
+    std::vector<std::thread> threads;
+    for (unsigned int t = 0; t < thread_count; ++t)
+      threads.emplace_back(sample_states, t);
+    for (std::thread& thread : threads)
+      thread.join();
+  }
 
-    if (attempts > options.samples && state_storage->size() == 0)
+  for (std::vector<ob::State*>& states : sampled_states)
+    for (ob::State* state : states)
     {
-      ROS_ERROR_NAMED(LOGNAME, "Unable to generate any samples");
-      break;
+      state->as<ModelBasedStateSpace::StateType>()->tag = state_storage->size();
+      state_storage->addState(state);
+      space->freeState(state);
     }
 
-    ss->sampleUniform(temp.get());
-    pcontext->getOMPLStateSpace()->copyToRobotState(robot_state, temp.get());
-    if (kset.decide(robot_state).satisfied)
+  result.state_sampling_time = ompl::time::seconds(ompl::time::now() - start);
+  ROS_INFO_NAMED(LOGNAME, "Generated %u states in %lf seconds using %u threads", (unsigned int)state_storage->size(),
+                 result.state_sampling_time, thread_count);
+  std::size_t constrained_samplers = 0;
+  double sampling_rate_sum = 0.0;
+  for (double sampling_rate : sampling_rates)
+    if (sampling_rate >= 0.0)
     {
-      if (state_storage->size() < options.samples)
-      {
-        temp->as<ModelBasedStateSpace::StateType>()->tag = state_storage->size();
-        state_storage->addState(temp.get());
-      }
+      sampling_rate_sum += sampling_rate;
+      ++constrained_samplers;
     }
-  }
-
-  result.state_sampling_time = ompl::time::seconds(ompl::time::now() - start);
-  ROS_INFO_NAMED(LOGNAME, "Generated %u states in %lf seconds", (unsigned int)state_storage->size(),
-                 result.state_sampling_time);
-  if (constrained_sampler)
+  if (constrained_samplers > 0)
   {
-    result.sampling_success_rate = constrained_sampler->getConstrainedSamplingRate();
+    result.sampling_success_rate = sampling_rate_sum / (double)constrained_samplers;
     ROS_INFO_NAMED(LOGNAME, "Constrained sampling rate: %lf", result.sampling_success_rate);
   }
 
@@ -550,81 +683,130 @@ ompl::base::StateStoragePtr ompl_interface::ConstraintsLibrary::constructConstra
   {
     ROS_INFO_NAMED(LOGNAME, "Computing graph connections (max %u edges per sample) ...", options.edges_per_sample);
 
-    // construct connections
-    const ob::StateSpacePtr& space = pcontext->getOMPLSimpleSetup()->getStateSpace();
-    unsigned int milestones = state_storage->size();
-    std::vector<ob::State*> int_states(options.max_explicit_points, nullptr);
-    pcontext->getOMPLSimpleSetup()->getSpaceInformation()->allocStates(int_states);
-
-    ompl::time::point start = ompl::time::now();
-    int good = 0;
-    int done = -1;
-
-    for (std::size_t j = 0; j < milestones; ++j)
-    {
-      int done_now = 100 * j / milestones;
-      if (done != done_now)
+    // construct connections; threads take milestones in turn and check their motions to the later milestones. An
+    // edge is kept only if both its milestones still have a free connection slot, and edges are added to the state
+    // storage once all threads are done, so the stored states are only read in the meantime
+    const unsigned int milestones = state_storage->size();
+    std::unique_ptr<std::atomic<unsigned int>[]> degrees(new std::atomic<unsigned int>[milestones]);
+    for (unsigned int i = 0; i < milestones; ++i)
+      degrees[i] = 0;
+    std::vector<std::vector<ConstructedEdge> > edges(thread_count);
+    std::atomic<unsigned int> next_milestone(0);
+    std::atomic<int> done(-1);
+
+    auto connect_states = [&](unsigned int thread_index) {
+      kinematic_constraints::KinematicConstraintSet kset(pcontext->getRobotModel());
+      moveit::core::Transforms no_transforms(pcontext->getRobotModel()->getModelFrame());
+      kset.add(constr_hard, no_transforms);
+      moveit::core::RobotState robot_state(default_state);
+      std::vector<ob::State*> int_states(std::max(1u, options.max_explicit_points), nullptr);
+      pcontext->getOMPLSimpleSetup()->getSpaceInformation()->allocStates(int_states);
+
+      for (unsigned int j = next_milestone++; j < milestones; j = next_milestone++)
       {
-        done = done_now;
-        ROS_INFO_NAMED(LOGNAME, "%d%% complete", done);
-      }
-      if (cass->getMetadata(j).first.size() >= options.edges_per_sample)
-        continue;
+        int done_now = 100 * j / milestones;
+        int done_before = done;
+        if (done_before < done_now && done.compare_exchange_strong(done_before, done_now))
+          ROS_INFO_NAMED(LOGNAME, "%d%% complete", done_now);
+        if (degrees[j] >= options.edges_per_sample)
+          continue;
 
-      const ob::State* sj = state_storage->getState(j);
+        const ob::State* sj = state_storage->getState(j);
 
-      for (std::size_t i = j + 1; i < milestones; ++i)
-      {
-        if (cass->getMetadata(i).first.size() >= options.edges_per_sample)
-          continue;
-        double d = space->distance(state_storage->getState(i), sj);
-        if (d >= options.max_edge_length)
-          continue;
-        unsigned int isteps =
-            std::min<unsigned int>(options.max_explicit_points, d / options.explicit_points_resolution);
-        double step = 1.0 / (double)isteps;
-        bool ok = true;
-        space->interpolate(state_storage->getState(i), sj, step, int_states[0]);
-        for (unsigned int k = 1; k < isteps; ++k)
+        for (unsigned int i = j + 1; i < milestones; ++i)
         {
-          double this_step = step / (1.0 - (k - 1) * step);
-          space->interpolate(int_states[k - 1], sj, this_step, int_states[k]);
-          pcontext->getOMPLStateSpace()->copyToRobotState(robot_state, int_states[k]);
-          if (!kset.decide(robot_state).satisfied)
+          if (degrees[i] >= options.edges_per_sample)
+            continue;
+          double d = space->distance(state_storage->getState(i), sj);
+          if (d >= options.max_edge_length)
+            continue;
+          double max_steps = std::min<double>(int_states.size(), d / options.explicit_points_resolution);
+          unsigned int isteps = std::max(1u, static_cast<unsigned int>(max_steps));
+          double step = 1.0 / (double)isteps;
+          bool ok = true;
+          space->interpolate(state_storage->getState(i), sj, step, int_states[0]);
+          for (unsigned int k = 1; k < isteps; ++k)
           {
-            ok = false;
-            break;
+            double this_step = step / (1.0 - (k - 1) * step);
+            space->interpolate(int_states[k - 1], sj, this_step, int_states[k]);
+            space->copyToRobotState(robot_state, int_states[k]);
+            if (!kset.decide(robot_state).satisfied)
+            {
+              ok = false;
+              break;
+            }
           }
-        }
 
-        if (ok)
-        {
-          cass->getMetadata(i).first.push_back(j);
-          cass->getMetadata(j).first.push_back(i);
+          if (!ok)
+            continue;
+          if (!reserveConnection(degrees[j], options.edges_per_sample))
+            break;
+          if (!reserveConnection(degrees[i], options.edges_per_sample))
+          {
+            --degrees[j];
+            continue;
+          }
 
+          ConstructedEdge edge;
+          edge.from = j;
+          edge.to = i;
           if (options.explicit_motions)
-          {
-            cass->getMetadata(i).second[j].first = state_storage->size();
             for (unsigned int k = 0; k < isteps; ++k)
             {
-              int_states[k]->as<ModelBasedStateSpace::StateType>()->tag = -1;
-              state_storage->addState(int_states[k]);
+              edge.states.push_back(space->cloneState(int_states[k]));
+              edge.states.back()->as<ModelBasedStateSpace::StateType>()->tag = -1;
             }
-            cass->getMetadata(i).second[j].second = state_storage->size();
-            cass->getMetadata(j).second[i] = cass->getMetadata(i).second[j];
-          }
+          edges[thread_index].push_back(std::move(edge));
 
-          good++;
-          if (cass->getMetadata(j).first.size() >= options.edges_per_sample)
+          if (degrees[j] >= options.edges_per_sample)
             break;
         }
       }
+      pcontext->getOMPLSimpleSetup()->getSpaceInformation()->freeStates(int_states);
+    };
+
+    ompl::time::point start = ompl::time::now();
+    {
+      std::vector<std::thread> threads;
+      for (unsigned int t = 0; t < thread_count; ++t)
+        threads.emplace_back(connect_states, t);
+      for (std::thread& thread : threads)
+        thread.join();
+    }
+
+    // add the edges sorted by milestone, so their order does not depend on which thread found them
+    std::vector<ConstructedEdge> all_edges;
+    for (std::vector<ConstructedEdge>& thread_edges : edges)
+      std::move(thread_edges.begin(), thread_edges.end(), std::back_inserter(all_edges));
+    std::sort(all_edges.begin(), all_edges.end(), [](const ConstructedEdge& a, const ConstructedEdge& b) {
+      return a.from < b.from || (a.from == b.from && a.to < b.to);
+    });
+
+    int good = 0;
+    for (ConstructedEdge& edge : all_edges)
+    {
+      const std::size_t i = edge.to;
+      const std::size_t j = edge.from;
+      cass->getMetadata(i).first.push_back(j);
+      cass->getMetadata(j).first.push_back(i);
+
+      if (options.explicit_motions)
+      {
+        cass->getMetadata(i).second[j].first = state_storage->size();
+        for (ob::State* state : edge.states)
+        {
+          state_storage->addState(state);
+          space->freeState(state);
+        }
+        cass->getMetadata(i).second[j].second = state_storage->size();
+        cass->getMetadata(j).second[i] = cass->getMetadata(i).second[j];
+      }
+      good++;
     }
 
     result.state_connection_time = ompl::time::seconds(ompl::time::now() - start);
     ROS_INFO_NAMED(LOGNAME, "Computed possible connections in %lf seconds. Added %d connections",
                    result.state_connection_time, good);
-    pcontext->getOMPLSimpleSetup()->getSpaceInformation()->freeStates(int_states);
 
     return state_storage;
   }
@@ -0,0 +1,143 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, MoveIt maintainers
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/ompl_interface/detail/experience_database.h>
+#include <ompl/datastructures/NearestNeighborsGNAT.h>
+
+#include <algorithm>
+
+namespace ompl_interface
+{
+namespace
+{
+double experienceDistance(const ExperienceDatabase::ExperienceConstPtr& a,
+                          const ExperienceDatabase::ExperienceConstPtr& b)
+{
+  return a->group_->distance(a->states_.front().data(), b->states_.front().data()) +
+         a->group_->distance(a->states_.back().data(), b->states_.back().data());
+}
+}  // namespace
+}  // namespace ompl_interface
+
+ompl_interface::ExperienceDatabase::ExperienceDatabase(std::size_t max_experiences, double min_separation)
+  : max_experiences_(std::max<std::size_t>(max_experiences, 1)), min_separation_(min_separation)
+{
+}
+
+ompl_interface::ExperienceDatabase::GroupExperiences&
+ompl_interface::ExperienceDatabase::getGroupExperiences(const moveit::core::JointModelGroup* group)
+{
+  GroupExperiences& experiences = groups_[group->getName()];
+  if (!experiences.nn_)
+  {
+    experiences.nn_ = std::make_shared<ompl::NearestNeighborsGNAT<ExperienceConstPtr> >();
+    experiences.nn_->setDistanceFunction(&experienceDistance);
+  }
+  return experiences;
+}
+
+bool ompl_interface::ExperienceDatabase::addExperience(const moveit::core::JointModelGroup* group,
+                                                       std::vector<std::vector<double> > states)
+{
+  if (states.size() < 2)
+    return false;
+  auto experience = std::make_shared<Experience>();
+  experience->group_ = group;
+  experience->states_ = std::move(states);
+
+  std::unique_lock<std::mutex> slock(lock_);
+  GroupExperiences& experiences = getGroupExperiences(group);
+  if (experiences.nn_->size() > 0 &&
+      experienceDistance(experiences.nn_->nearest(experience), experience) < min_separation_)
+    return false;
+
+  experiences.nn_->add(experience);
+  experiences.order_.push_back(experience);
+  ++statistics_.experiences_;
+  while (experiences.order_.size() > max_experiences_)
+  {
+    experiences.nn_->remove(experiences.order_.front());
+    experiences.order_.pop_front();
+    --statistics_.experiences_;
+  }
+  return true;
+}
+
+std::vector<ompl_interface::ExperienceDatabase::ExperienceConstPtr>
+ompl_interface::ExperienceDatabase::getNearestExperiences(const moveit::core::JointModelGroup* group,
+                                                          const std::vector<double>& start,
+                                                          const std::vector<double>& goal, std::size_t k) const
+{
+  std::vector<ExperienceConstPtr> nearest;
+  auto query = std::make_shared<Experience>();
+  query->group_ = group;
+  query->states_ = { start, goal };
+
+  std::unique_lock<std::mutex> slock(lock_);
+  auto it = groups_.find(group->getName());
+  if (it != groups_.end() && k > 0)
+    it->second.nn_->nearestK(query, k, nearest);
+  return nearest;
+}
+
+void ompl_interface::ExperienceDatabase::recordOutcome(Outcome outcome)
+{
+  std::unique_lock<std::mutex> slock(lock_);
+  ++statistics_.queries_;
+  switch (outcome)
+  {
+    case HIT:
+      ++statistics_.hits_;
+      break;
+    case REPAIR:
+      ++statistics_.repairs_;
+      break;
+    case FALLBACK:
+      ++statistics_.fallbacks_;
+      break;
+  }
+}
+
+ompl_interface::ExperienceDatabase::Statistics ompl_interface::ExperienceDatabase::getStatistics() const
+{
+  std::unique_lock<std::mutex> slock(lock_);
+  return statistics_;
+}
+
+void ompl_interface::ExperienceDatabase::clear()
+{
+  std::unique_lock<std::mutex> slock(lock_);
+  groups_.clear();
+  statistics_ = Statistics();
+}
@@ -0,0 +1,139 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, MoveIt maintainers
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/ompl_interface/detail/state_validity_cache.h>
+#include <algorithm>
+#include <cmath>
+
+namespace ompl_interface
+{
+namespace
+{
+constexpr std::size_t MAX_SHARD_COUNT = 16;
+
+// the lowest bit of an entry holds the validity; the second bit is always set, so no tag is ever 0 (empty)
+constexpr std::uint64_t VALID_BIT = 1;
+constexpr std::uint64_t TAG_BIT = 2;
+
+std::uint64_t mix(std::uint64_t h)
+{
+  // the finalizer of splitmix64
+  h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+  return h ^ (h >> 31);
+}
+
+std::size_t roundUpToPowerOfTwo(std::size_t n)
+{
+  std::size_t p = 1;
+  while (p < n)
+    p <<= 1;
+  return p;
+}
+}  // namespace
+}  // namespace ompl_interface
+
+ompl_interface::StateValidityCache::StateValidityCache(std::size_t capacity, double resolution)
+  : capacity_(roundUpToPowerOfTwo(std::max<std::size_t>(capacity, 1)))
+  , resolution_(resolution > 0.0 ? resolution : 1e-6)
+  , revision_(0)
+{
+  std::size_t shard_count = std::min(capacity_, MAX_SHARD_COUNT);
+  std::size_t shard_capacity = capacity_ / shard_count;
+  shard_mask_ = shard_count - 1;
+  slot_mask_ = shard_capacity - 1;
+  shards_.reset(new Shard[shard_count]);
+  for (std::size_t i = 0; i < shard_count; ++i)
+  {
+    shards_[i].entries_.reset(new std::atomic<std::uint64_t>[shard_capacity]);
+    for (std::size_t j = 0; j < shard_capacity; ++j)
+      shards_[i].entries_[j].store(0, std::memory_order_relaxed);
+  }
+}
+
+void ompl_interface::StateValidityCache::clear()
+{
+  revision_.fetch_add(1, std::memory_order_relaxed);
+  for (std::size_t i = 0; i <= shard_mask_; ++i)
+  {
+    shards_[i].hits_.store(0, std::memory_order_relaxed);
+    shards_[i].misses_.store(0, std::memory_order_relaxed);
+    shards_[i].insertions_.store(0, std::memory_order_relaxed);
+  }
+}
+
+std::uint64_t ompl_interface::StateValidityCache::getKey(const double* values, std::size_t count) const
+{
+  std::uint64_t h = mix(revision_.load(std::memory_order_relaxed) + 0x9e3779b97f4a7c15ULL);
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    auto q = static_cast<std::int64_t>(std::llround(values[i] / resolution_));
+    h = mix(h ^ (static_cast<std::uint64_t>(q) + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2)));
+  }
+  return h;
+}
+
+bool ompl_interface::StateValidityCache::lookup(std::uint64_t key, bool& valid) const
+{
+  const Shard& shard = getShard(key);
+  std::uint64_t entry = shard.entries_[(key >> 2) & slot_mask_].load(std::memory_order_relaxed);
+  if ((entry & ~VALID_BIT) != ((key & ~VALID_BIT) | TAG_BIT))
+  {
+    shard.misses_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  shard.hits_.fetch_add(1, std::memory_order_relaxed);
+  valid = entry & VALID_BIT;
+  return true;
+}
+
+void ompl_interface::StateValidityCache::insert(std::uint64_t key, bool valid)
+{
+  Shard& shard = shards_[(key >> 32) & shard_mask_];
+  shard.entries_[(key >> 2) & slot_mask_].store((key & ~VALID_BIT) | TAG_BIT | (valid ? VALID_BIT : 0),
+                                                std::memory_order_relaxed);
+  shard.insertions_.fetch_add(1, std::memory_order_relaxed);
+}
+
+ompl_interface::StateValidityCache::Statistics ompl_interface::StateValidityCache::getStatistics() const
+{
+  Statistics stats;
+  for (std::size_t i = 0; i <= shard_mask_; ++i)
+  {
+    stats.hits_ += shards_[i].hits_.load(std::memory_order_relaxed);
+    stats.misses_ += shards_[i].misses_.load(std::memory_order_relaxed);
+    stats.insertions_ += shards_[i].insertions_.load(std::memory_order_relaxed);
+  }
+  return stats;
+}
@@ -48,6 +48,7 @@ ompl_interface::StateValidityChecker::StateValidityChecker(const ModelBasedPlann
   : ompl::base::StateValidityChecker(pc->getOMPLSimpleSetup()->getSpaceInformation())
   , planning_context_(pc)
   , group_name_(pc->getGroupName())
+  , variable_count_(pc->getJointModelGroup()->getVariableCount())
   , tss_(pc->getCompleteInitialRobotState())
   , verbose_(false)
 {
@@ -87,36 +88,51 @@ bool ompl_interface::StateValidityChecker::isValid(const ompl::base::State* stat
     return false;
   }
 
+  // Use the validity of a previously checked state with the same quantized joint values, if it is cached
+  const StateValidityCachePtr& cache = planning_context_->getStateValidityCache();
+  std::uint64_t cache_key = 0;
+  if (cache && !verbose)
+  {
+    bool valid;
+    cache_key = cache->getKey(state->as<ModelBasedStateSpace::StateType>()->values, variable_count_);
+    if (cache->lookup(cache_key, valid))
+    {
+      if (valid)
+        const_cast<ob::State*>(state)->as<ModelBasedStateSpace::StateType>()->markValid();
+      else
+        const_cast<ob::State*>(state)->as<ModelBasedStateSpace::StateType>()->markInvalid();
+      return valid;
+    }
+  }
+
+  bool valid = checkState(state, verbose);
+  if (valid)
+    const_cast<ob::State*>(state)->as<ModelBasedStateSpace::StateType>()->markValid();
+  else
+    const_cast<ob::State*>(state)->as<ModelBasedStateSpace::StateType>()->markInvalid();
+  if (cache && !verbose)
+    cache->insert(cache_key, valid);
+  return valid;
+}
+
+bool ompl_interface::StateValidityChecker::checkState(const ompl::base::State* state, bool verbose) const
+{
   moveit::core::RobotState* robot_state = tss_.getStateStorage();
   planning_context_->getOMPLStateSpace()->copyToRobotState(*robot_state, state);
 
   // check path constraints
   const kinematic_constraints::KinematicConstraintSetPtr& kset = planning_context_->getPathConstraints();
   if (kset && !kset->decide(*robot_state, verbose).satisfied)
-  {
-    const_cast<ob::State*>(state)->as<ModelBasedStateSpace::StateType>()->markInvalid();
     return false;
-  }
 
   // check feasibility
   if (!planning_context_->getPlanningScene()->isStateFeasible(*robot_state, verbose))
-  {
-    const_cast<ob::State*>(state)->as<ModelBasedStateSpace::StateType>()->markInvalid();
     return false;
-  }
 
   // check collision avoidance
   collision_detection::CollisionResult res;
   planning_context_->getPlanningScene()->checkCollision(
       verbose ? collision_request_simple_verbose_ : collision_request_simple_, res, *robot_state);
-  if (!res.collision)
-  {
-    const_cast<ob::State*>(state)->as<ModelBasedStateSpace::StateType>()->markValid();
-  }
-  else
-  {
-    const_cast<ob::State*>(state)->as<ModelBasedStateSpace::StateType>()->markInvalid();
-  }
   return !res.collision;
 }
 
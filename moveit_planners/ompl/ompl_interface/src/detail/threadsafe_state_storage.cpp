@@ -35,14 +35,34 @@
 /* Author: Ioan Sucan */
 
 #include <moveit/ompl_interface/detail/threadsafe_state_storage.h>
+#include <atomic>
+
+namespace ompl_interface
+{
+namespace
+{
+std::atomic<std::uint64_t> next_storage_id(1);
+
+// the states most recently used by this thread, as (storage id, state) pairs
+constexpr std::size_t THREAD_CACHE_SIZE = 4;
+struct ThreadCache
+{
+  std::uint64_t ids_[THREAD_CACHE_SIZE] = {};
+  moveit::core::RobotState* states_[THREAD_CACHE_SIZE] = {};
+  std::size_t next_ = 0;
+};
+thread_local ThreadCache thread_cache;
+}  // namespace
+}  // namespace ompl_interface
 
 ompl_interface::TSStateStorage::TSStateStorage(const moveit::core::RobotModelPtr& robot_model)
-  : start_state_(robot_model)
+  : id_(next_storage_id++), start_state_(robot_model)
 {
   start_state_.setToDefaultValues();
 }
 
-ompl_interface::TSStateStorage::TSStateStorage(const moveit::core::RobotState& start_state) : start_state_(start_state)
+ompl_interface::TSStateStorage::TSStateStorage(const moveit::core::RobotState& start_state)
+  : id_(next_storage_id++), start_state_(start_state)
 {
 }
 
@@ -54,16 +74,26 @@ ompl_interface::TSStateStorage::~TSStateStorage()
 
 moveit::core::RobotState* ompl_interface::TSStateStorage::getStateStorage() const
 {
+  ThreadCache& cache = thread_cache;
+  for (std::size_t i = 0; i < THREAD_CACHE_SIZE; ++i)
+    if (cache.ids_[i] == id_)
+      return cache.states_[i];
+
   moveit::core::RobotState* st = nullptr;
-  std::unique_lock<std::mutex> slock(lock_);  /// \todo use Thread Local Storage?
-  std::map<std::thread::id, moveit::core::RobotState*>::const_iterator it =
-      thread_states_.find(std::this_thread::get_id());
-  if (it == thread_states_.end())
   {
-    st = new moveit::core::RobotState(start_state_);
-    thread_states_[std::this_thread::get_id()] = st;
+    std::unique_lock<std::mutex> slock(lock_);
+    std::map<std::thread::id, moveit::core::RobotState*>::const_iterator it =
+        thread_states_.find(std::this_thread::get_id());
+    if (it == thread_states_.end())
+    {
+      st = new moveit::core::RobotState(start_state_);
+      thread_states_[std::this_thread::get_id()] = st;
+    }
+    else
+      st = it->second;
   }
-  else
-    st = it->second;
+  cache.ids_[cache.next_] = id_;
+  cache.states_[cache.next_] = st;
+  cache.next_ = (cache.next_ + 1) % THREAD_CACHE_SIZE;
   return st;
 }
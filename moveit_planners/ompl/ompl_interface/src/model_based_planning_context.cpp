@@ -44,10 +44,16 @@
 #include <moveit/ompl_interface/detail/goal_union.h>
 #include <moveit/ompl_interface/detail/projection_evaluators.h>
 #include <moveit/ompl_interface/detail/constraints_library.h>
+#include <moveit/ompl_interface/detail/scene_aware_roadmap.h>
 
 #include <moveit/kinematic_constraints/utils.h>
 #include <moveit/profiler/profiler.h>
 #include <moveit/utils/lexical_casts.h>
+#include <moveit/robot_model/aabb.h>
+
+#include <geometric_shapes/shapes.h>
+#include <ros/serialization.h>
+#include <boost/functional/hash.hpp>
 
 #include <ompl/config.h>
 #include <ompl/base/samplers/UniformValidStateSampler.h>
@@ -71,10 +77,52 @@
 #include "ompl/base/objectives/StateCostIntegralObjective.h"
 #include "ompl/base/objectives/MaximizeMinClearanceObjective.h"
 #include <ompl/geometric/planners/prm/LazyPRM.h>
+#include <ompl/geometric/planners/rrt/RRTConnect.h>
+#include <ompl/geometric/PathHybridization.h>
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
 
 namespace ompl_interface
 {
 constexpr char LOGNAME[] = "model_based_planning_context";
+
+// number of stored paths closest to a request that are tried before giving up on the experience database
+constexpr std::size_t MAX_EXPERIENCE_CANDIDATES = 5;
+
+namespace
+{
+// Add the bounding boxes of the shapes of object to boxes. Returns false if some shape is unbounded.
+bool addObjectBoxes(const collision_detection::World::Object& object, std::vector<moveit::core::AABB>& boxes)
+{
+  for (std::size_t i = 0; i < object.shapes_.size(); ++i)
+  {
+    boxes.emplace_back();
+    if (!boxes.back().extendWithShape(*object.shapes_[i], object.shape_poses_[i]))
+      return false;
+  }
+  return true;
+}
+
+// Octrees are updated in place (see PlanningScene::processOctomapPtr()), so an object holding one may have changed even
+// though it is still shared with the validated world
+bool hasOcTree(const collision_detection::World::Object& object)
+{
+  return std::any_of(object.shapes_.begin(), object.shapes_.end(),
+                     [](const shapes::ShapeConstPtr& shape) { return shape->type == shapes::OCTREE; });
+}
+
+template <typename M>
+void hashMessage(std::size_t& seed, const M& msg)
+{
+  uint32_t size = ros::serialization::serializationLength(msg);
+  std::vector<uint8_t> buffer(size);
+  ros::serialization::OStream stream(buffer.data(), size);
+  ros::serialization::serialize(stream, msg);
+  boost::hash_combine(seed, boost::hash_range(buffer.begin(), buffer.end()));
+}
+}  // namespace
 }  // namespace ompl_interface
 
 ompl_interface::ModelBasedPlanningContext::ModelBasedPlanningContext(const std::string& name,
@@ -84,7 +132,6 @@ ompl_interface::ModelBasedPlanningContext::ModelBasedPlanningContext(const std::
   , complete_initial_robot_state_(spec.state_space_->getRobotModel())
   , ompl_simple_setup_(spec.ompl_simple_setup_)
   , ompl_benchmark_(*ompl_simple_setup_)
-  , ompl_parallel_plan_(ompl_simple_setup_->getProblemDefinition())
   , ptc_(nullptr)
   , last_plan_time_(0.0)
   , last_simplify_time_(0.0)
@@ -95,6 +142,8 @@ ompl_interface::ModelBasedPlanningContext::ModelBasedPlanningContext(const std::
   , max_solution_segment_length_(0.0)
   , minimum_waypoint_count_(0)
   , multi_query_planning_enabled_(false)  // maintain "old" behavior by default
+  , use_experience_(false)
+  , solution_from_experience_(false)
   , simplify_solutions_(true)
   , interpolate_(true)
   , hybridize_(true)
@@ -134,6 +183,9 @@ void ompl_interface::ModelBasedPlanningContext::configure(const ros::NodeHandle&
   }
 
   useConfig();
+  // the scene or the constraints may have changed since the last request
+  if (state_validity_cache_)
+    state_validity_cache_->clear();
   if (ompl_simple_setup_->getGoal())
     ompl_simple_setup_->setup();
 }
@@ -353,6 +405,35 @@ void ompl_interface::ModelBasedPlanningContext::useConfig()
     cfg.erase(it);
   }
 
+  // check whether previously solved paths should be reused
+  it = cfg.find("use_experience");
+  if (it != cfg.end())
+  {
+    use_experience_ = boost::lexical_cast<bool>(it->second);
+    cfg.erase(it);
+  }
+
+  // check whether state validity results should be cached, and with which resolution
+  std::size_t cache_size = 0;
+  double cache_resolution = 1e-4;
+  it = cfg.find("state_validity_cache_size");
+  if (it != cfg.end())
+  {
+    cache_size = boost::lexical_cast<std::size_t>(it->second);
+    cfg.erase(it);
+  }
+  it = cfg.find("state_validity_cache_resolution");
+  if (it != cfg.end())
+  {
+    cache_resolution = moveit::core::toDouble(it->second);
+    cfg.erase(it);
+  }
+  if (cache_size == 0)
+    state_validity_cache_.reset();
+  else if (!state_validity_cache_ || state_validity_cache_->getCapacity() < cache_size ||
+           state_validity_cache_->getResolution() != cache_resolution)
+    state_validity_cache_.reset(new StateValidityCache(cache_size, cache_resolution));
+
   // remove the 'type' parameter; the rest are parameters for the planner itself
   it = cfg.find("type");
   if (it == cfg.end())
@@ -559,10 +640,12 @@ void ompl_interface::ModelBasedPlanningContext::clear()
   {
     // For LazyPRM and LazyPRMstar we assume that the environment *could* have changed
     // This means that we need to reset the validity flags for every node and edge in
-    // the roadmap. For PRM and PRMstar we assume that the environment is static. If
-    // this is not the case, then multi-query planning should not be enabled.
+    // the roadmap, unless the roadmap is scene aware: then only the parts affected by
+    // scene changes are reset before the next solve(). For PRM and PRMstar we assume
+    // that the environment is static. If this is not the case, then multi-query
+    // planning should not be enabled.
     auto planner = dynamic_cast<ompl::geometric::LazyPRM*>(ompl_simple_setup_->getPlanner().get());
-    if (planner != nullptr)
+    if (planner != nullptr && dynamic_cast<SceneAwareRoadmap*>(planner) == nullptr)
       planner->clearValidity();
   }
 #endif
@@ -659,16 +742,165 @@ void ompl_interface::ModelBasedPlanningContext::preSolve()
   const ob::PlannerPtr planner = ompl_simple_setup_->getPlanner();
   if (planner && !multi_query_planning_enabled_)
     planner->clear();
+  else if (planner)
+    updateRoadmapValidity();
   startSampling();
   ompl_simple_setup_->getSpaceInformation()->getMotionValidator()->resetMotionCounter();
 }
 
+std::size_t ompl_interface::ModelBasedPlanningContext::computeSceneSignature() const
+{
+  std::size_t seed = 0;
+
+  moveit_msgs::AllowedCollisionMatrix acm;
+  getPlanningScene()->getAllowedCollisionMatrix().getMessage(acm);
+  hashMessage(seed, acm);
+  hashMessage(seed, path_constraints_msg_);
+  for (const std::pair<const std::string, double>& padding : getPlanningScene()->getCollisionEnv()->getLinkPadding())
+  {
+    boost::hash_combine(seed, padding.first);
+    boost::hash_combine(seed, padding.second);
+  }
+  for (const std::pair<const std::string, double>& scale : getPlanningScene()->getCollisionEnv()->getLinkScale())
+  {
+    boost::hash_combine(seed, scale.first);
+    boost::hash_combine(seed, scale.second);
+  }
+
+  // the joints outside of the planning group and the attached bodies stay fixed while planning
+  const moveit::core::RobotState& state = getCompleteInitialRobotState();
+  std::vector<bool> in_group(getRobotModel()->getVariableCount(), false);
+  for (int index : getJointModelGroup()->getVariableIndexList())
+    in_group[index] = true;
+  for (std::size_t i = 0; i < in_group.size(); ++i)
+    if (!in_group[i])
+      boost::hash_combine(seed, state.getVariablePosition(i));
+
+  std::vector<const moveit::core::AttachedBody*> attached_bodies;
+  state.getAttachedBodies(attached_bodies);
+  for (const moveit::core::AttachedBody* body : attached_bodies)
+  {
+    boost::hash_combine(seed, body->getName());
+    boost::hash_combine(seed, body->getAttachedLinkName());
+    boost::hash_combine(seed, body->getShapes().size());
+    for (const Eigen::Isometry3d& transform : body->getFixedTransforms())
+      boost::hash_combine(seed, boost::hash_range(transform.data(), transform.data() + 16));
+    for (const std::string& touch_link : body->getTouchLinks())
+      boost::hash_combine(seed, touch_link);
+  }
+  return seed;
+}
+
+void ompl_interface::ModelBasedPlanningContext::updateRoadmapValidity()
+{
+  SceneAwareRoadmap* roadmap = dynamic_cast<SceneAwareRoadmap*>(ompl_simple_setup_->getPlanner().get());
+  if (!roadmap)
+    return;
+
+  // the copy shares all objects with the scene's world, so it is cheap to make and cheap to compare to
+  collision_detection::WorldConstPtr world(new collision_detection::World(*getPlanningScene()->getWorld()));
+  std::size_t scene_signature = computeSceneSignature();
+  const collision_detection::WorldConstPtr& validated_world = roadmap->getValidatedWorld();
+
+  // collect the bounding boxes of the objects that were added, removed or changed, before and after the change
+  std::vector<moveit::core::AABB> changed_boxes;
+  bool bounded = validated_world && roadmap->getValidatedSceneSignature() == scene_signature;
+  if (bounded)
+  {
+    for (const auto& object : *world)
+    {
+      auto it = validated_world->find(object.first);
+      if (it != validated_world->end() && it->second == object.second && !hasOcTree(*object.second))
+        continue;
+      bounded = bounded && addObjectBoxes(*object.second, changed_boxes);
+      if (it != validated_world->end() && it->second != object.second)
+        bounded = bounded && addObjectBoxes(*it->second, changed_boxes);
+    }
+    for (const auto& object : *validated_world)
+      if (world->find(object.first) == world->end())
+        bounded = bounded && addObjectBoxes(*object.second, changed_boxes);
+  }
+
+  if (!bounded)
+  {
+    ROS_DEBUG_NAMED(LOGNAME, "%s: The planning scene changed; the complete roadmap will be checked again",
+                    name_.c_str());
+    roadmap->invalidateAll();
+  }
+  else if (!changed_boxes.empty())
+  {
+    // the collision geometry that moves with the group, as checked by the collision environment
+    const collision_detection::CollisionEnvConstPtr& env = getPlanningScene()->getCollisionEnv();
+    const std::vector<const moveit::core::LinkModel*>& links = getJointModelGroup()->getUpdatedLinkModelsWithGeometry();
+    std::vector<Eigen::Vector3d> link_extents;
+    link_extents.reserve(links.size());
+    for (const moveit::core::LinkModel* link : links)
+      link_extents.push_back(link->getShapeExtentsAtOrigin() * env->getLinkScale(link->getName()) +
+                             Eigen::Vector3d::Constant(2.0 * env->getLinkPadding(link->getName())));
+
+    moveit::core::RobotState robot_state(getCompleteInitialRobotState());
+    std::vector<const moveit::core::AttachedBody*> attached_bodies;
+    robot_state.getAttachedBodies(attached_bodies);
+
+    const auto intersects_changes = [&changed_boxes](const moveit::core::AABB& box) {
+      for (const moveit::core::AABB& changed_box : changed_boxes)
+        if (box.intersects(changed_box))
+          return true;
+      return false;
+    };
+    const auto vertex_affected = [&](const ob::State* state) {
+      spec_.state_space_->copyToRobotState(robot_state, state);
+      for (std::size_t i = 0; i < links.size(); ++i)
+      {
+        Eigen::Isometry3d transform = robot_state.getGlobalLinkTransform(links[i]);
+        transform.translate(links[i]->getCenteredBoundingBoxOffset());
+        moveit::core::AABB box;
+        box.extendWithTransformedBox(transform, link_extents[i]);
+        if (intersects_changes(box))
+          return true;
+      }
+      for (const moveit::core::AttachedBody* body : attached_bodies)
+        for (std::size_t k = 0; k < body->getShapes().size(); ++k)
+        {
+          moveit::core::AABB box;
+          if (!box.extendWithShape(*body->getShapes()[k], body->getGlobalCollisionBodyTransforms()[k]) ||
+              intersects_changes(box))
+            return true;
+        }
+      return false;
+    };
+    // edges are checked at the resolution of the motion validator
+    ob::ScopedState<> intermediate(spec_.state_space_);
+    const auto edge_affected = [&](const ob::State* from, const ob::State* to) {
+      unsigned int segments = std::max(1u, spec_.state_space_->validSegmentCount(from, to));
+      for (unsigned int i = 0; i <= segments; ++i)
+      {
+        spec_.state_space_->interpolate(from, to, static_cast<double>(i) / segments, intermediate.get());
+        if (vertex_affected(intermediate.get()))
+          return true;
+      }
+      return false;
+    };
+
+    std::size_t invalidated = roadmap->invalidate(vertex_affected, edge_affected);
+    ROS_DEBUG_NAMED(LOGNAME, "%s: %zu roadmap edges may be affected by scene changes and will be checked again",
+                    name_.c_str(), invalidated);
+  }
+  roadmap->setValidatedScene(world, scene_signature);
+}
+
 void ompl_interface::ModelBasedPlanningContext::postSolve()
 {
   stopSampling();
   int v = ompl_simple_setup_->getSpaceInformation()->getMotionValidator()->getValidMotionCount();
   int iv = ompl_simple_setup_->getSpaceInformation()->getMotionValidator()->getInvalidMotionCount();
   ROS_DEBUG_NAMED(LOGNAME, "There were %d valid motions and %d invalid motions.", v, iv);
+  if (state_validity_cache_)
+  {
+    StateValidityCache::Statistics stats = state_validity_cache_->getStatistics();
+    ROS_DEBUG_NAMED(LOGNAME, "State validity cache: %zu hits, %zu misses (hit rate %.1f%%), %zu insertions.",
+                    stats.hits_, stats.misses_, 100.0 * stats.getHitRate(), stats.insertions_);
+  }
 
   if (ompl_simple_setup_->getProblemDefinition()->hasApproximateSolution())
     ROS_WARN_NAMED(LOGNAME, "Computed solution is approximate");
@@ -684,6 +916,7 @@ bool ompl_interface::ModelBasedPlanningContext::solve(planning_interface::Motion
       simplifySolution(request_.allowed_planning_time - ptime);
       ptime += getLastSimplifyTime();
     }
+    storeExperience();
 
     if (interpolate_)
       interpolateSolution();
@@ -729,6 +962,7 @@ bool ompl_interface::ModelBasedPlanningContext::solve(planning_interface::Motion
       res.trajectory_.back().reset(new robot_trajectory::RobotTrajectory(getRobotModel(), getGroupName()));
       getSolutionPath(*res.trajectory_.back());
     }
+    storeExperience();
 
     if (interpolate_)
     {
@@ -759,6 +993,7 @@ bool ompl_interface::ModelBasedPlanningContext::solve(double timeout, unsigned i
   moveit::tools::Profiler::ScopedBlock sblock("PlanningContext:Solve");
   ompl::time::point start = ompl::time::now();
   preSolve();
+  solution_from_experience_ = false;
 
   bool result = false;
   if (count <= 1 || multi_query_planning_enabled_)  // multi-query planners should always run in single instances
@@ -766,71 +1001,270 @@ bool ompl_interface::ModelBasedPlanningContext::solve(double timeout, unsigned i
     ROS_DEBUG_NAMED(LOGNAME, "%s: Solving the planning problem once...", name_.c_str());
     ob::PlannerTerminationCondition ptc = constructPlannerTerminationCondition(timeout, start);
     registerTerminationCondition(ptc);
-    result = ompl_simple_setup_->solve(ptc) == ompl::base::PlannerStatus::EXACT_SOLUTION;
-    last_plan_time_ = ompl_simple_setup_->getLastPlanComputationTime();
+    if (use_experience_ && experience_database_)
+    {
+      result = solveWithExperience(ptc);
+      last_plan_time_ = ompl::time::seconds(ompl::time::now() - start);
+    }
+    else
+    {
+      result = ompl_simple_setup_->solve(ptc) == ompl::base::PlannerStatus::EXACT_SOLUTION;
+      last_plan_time_ = ompl_simple_setup_->getLastPlanComputationTime();
+    }
     unregisterTerminationCondition();
   }
   else
   {
     ROS_DEBUG_NAMED(LOGNAME, "%s: Solving the planning problem %u times...", name_.c_str(), count);
-    ompl_parallel_plan_.clearHybridizationPaths();
-    if (count <= max_planning_threads_)
-    {
-      ompl_parallel_plan_.clearPlanners();
-      if (ompl_simple_setup_->getPlannerAllocator())
-        for (unsigned int i = 0; i < count; ++i)
-          ompl_parallel_plan_.addPlannerAllocator(ompl_simple_setup_->getPlannerAllocator());
-      else
-        for (unsigned int i = 0; i < count; ++i)
-          ompl_parallel_plan_.addPlanner(ompl::tools::SelfConfig::getDefaultPlanner(ompl_simple_setup_->getGoal()));
+    ob::PlannerTerminationCondition ptc = constructPlannerTerminationCondition(timeout, start);
+    registerTerminationCondition(ptc);
+    result = solveInParallel(ptc, count);
+    last_plan_time_ = ompl::time::seconds(ompl::time::now() - start);
+    unregisterTerminationCondition();
+  }
 
-      ob::PlannerTerminationCondition ptc = constructPlannerTerminationCondition(timeout, start);
-      registerTerminationCondition(ptc);
-      result = ompl_parallel_plan_.solve(ptc, 1, count, hybridize_) == ompl::base::PlannerStatus::EXACT_SOLUTION;
-      last_plan_time_ = ompl::time::seconds(ompl::time::now() - start);
-      unregisterTerminationCondition();
-    }
-    else
+  postSolve();
+
+  return result;
+}
+
+bool ompl_interface::ModelBasedPlanningContext::solveInParallel(const ob::PlannerTerminationCondition& ptc,
+                                                                unsigned int count)
+{
+  const ob::SpaceInformationPtr& si = ompl_simple_setup_->getSpaceInformation();
+  const ob::ProblemDefinitionPtr& pdef = ompl_simple_setup_->getProblemDefinition();
+  og::PathHybridization hybridization(si);
+  std::mutex planner_lock;
+  std::atomic<unsigned int> next_run(0);
+
+  // Runs are handed out one at a time, so a thread starts its next run as soon as its previous one is done instead of
+  // waiting for a whole batch. All planners share the problem definition, and with it the goal and its pool of
+  // sampled goal states.
+  auto run_planners = [&] {
+    while (next_run++ < count && !ptc())
     {
-      ob::PlannerTerminationCondition ptc = constructPlannerTerminationCondition(timeout, start);
-      registerTerminationCondition(ptc);
-      int n = count / max_planning_threads_;
-      result = true;
-      for (int i = 0; i < n && !ptc(); ++i)
+      ob::PlannerPtr planner;
       {
-        ompl_parallel_plan_.clearPlanners();
+        std::unique_lock<std::mutex> slock(planner_lock);
         if (ompl_simple_setup_->getPlannerAllocator())
-          for (unsigned int i = 0; i < max_planning_threads_; ++i)
-            ompl_parallel_plan_.addPlannerAllocator(ompl_simple_setup_->getPlannerAllocator());
+          planner = ompl_simple_setup_->getPlannerAllocator()(si);
         else
-          for (unsigned int i = 0; i < max_planning_threads_; ++i)
-            ompl_parallel_plan_.addPlanner(ompl::tools::SelfConfig::getDefaultPlanner(ompl_simple_setup_->getGoal()));
-        bool r = ompl_parallel_plan_.solve(ptc, 1, count, hybridize_) == ompl::base::PlannerStatus::EXACT_SOLUTION;
-        result = result && r;
+          planner = ompl::tools::SelfConfig::getDefaultPlanner(pdef->getGoal());
       }
-      n = count % max_planning_threads_;
-      if (n && !ptc())
+      planner->setProblemDefinition(pdef);
+      planner->setup();
+      if (planner->solve(ptc) != ompl::base::PlannerStatus::EXACT_SOLUTION)
+        continue;
+
+      // without hybridization, the first solution found is returned
+      if (!hybridize_)
       {
-        ompl_parallel_plan_.clearPlanners();
-        if (ompl_simple_setup_->getPlannerAllocator())
-          for (int i = 0; i < n; ++i)
-            ompl_parallel_plan_.addPlannerAllocator(ompl_simple_setup_->getPlannerAllocator());
-        else
-          for (int i = 0; i < n; ++i)
-            ompl_parallel_plan_.addPlanner(ompl::tools::SelfConfig::getDefaultPlanner(ompl_simple_setup_->getGoal()));
-        bool r = ompl_parallel_plan_.solve(ptc, 1, count, hybridize_) == ompl::base::PlannerStatus::EXACT_SOLUTION;
-        result = result && r;
+        ptc.terminate();
+        break;
       }
-      last_plan_time_ = ompl::time::seconds(ompl::time::now() - start);
-      unregisterTerminationCondition();
+      std::unique_lock<std::mutex> slock(planner_lock);
+      for (const ob::PlannerSolution& solution : pdef->getSolutions())
+        if (!solution.approximate_)
+          hybridization.recordPath(solution.path_, false);
     }
+  };
+
+  std::vector<std::thread> threads;
+  const unsigned int thread_count = std::max(1u, std::min(count, max_planning_threads_));
+  for (unsigned int i = 1; i < thread_count; ++i)
+    threads.emplace_back(run_planners);
+  run_planners();
+  for (std::thread& thread : threads)
+    thread.join();
+
+  if (hybridize_ && hybridization.pathCount() > 1 && !ptc())
+  {
+    hybridization.computeHybridPath();
+    const ob::PathPtr& hybrid_path = hybridization.getHybridPath();
+    if (hybrid_path)
+      pdef->addSolutionPath(hybrid_path, false, 0.0, hybridization.getName());
   }
+  return pdef->hasExactSolution();
+}
 
-  postSolve();
+bool ompl_interface::ModelBasedPlanningContext::solveWithExperience(const ob::PlannerTerminationCondition& ptc)
+{
+  // the side of the race that finished first with a solution
+  enum Winner
+  {
+    NONE,
+    EXPERIENCE,
+    PLANNER
+  };
+  std::atomic<int> winner(NONE);
+  std::atomic<bool> planning_done(false);
+  og::PathGeometric experience_path(ompl_simple_setup_->getSpaceInformation());
+  bool repaired = false;
+
+  // each side of the race stops as soon as the other one has a solution
+  std::thread retrieval([&] {
+    ob::PlannerTerminationCondition retrieval_ptc = ob::plannerOrTerminationCondition(
+        ptc, ob::PlannerTerminationCondition([&planning_done] { return planning_done.load(); }));
+    int none = NONE;
+    if (retrieveExperience(retrieval_ptc, experience_path, repaired))
+      winner.compare_exchange_strong(none, EXPERIENCE);
+  });
+  ob::PlannerTerminationCondition planning_ptc = ob::plannerOrTerminationCondition(
+      ptc, ob::PlannerTerminationCondition([&winner] { return winner.load() == EXPERIENCE; }));
+  bool result = ompl_simple_setup_->solve(planning_ptc) == ompl::base::PlannerStatus::EXACT_SOLUTION;
+  int none = NONE;
+  if (result)
+    winner.compare_exchange_strong(none, PLANNER);
+  planning_done = true;
+  retrieval.join();
+
+  // the planner may still report a solution after it was stopped because a stored path was found first
+  if (winner == EXPERIENCE)
+  {
+    const ob::ProblemDefinitionPtr& pdef = ompl_simple_setup_->getProblemDefinition();
+    pdef->clearSolutionPaths();
+    pdef->addSolutionPath(std::make_shared<og::PathGeometric>(experience_path), false, 0.0, "experience");
+    solution_from_experience_ = !repaired;
+    result = true;
+    experience_database_->recordOutcome(repaired ? ExperienceDatabase::REPAIR : ExperienceDatabase::HIT);
+    ROS_DEBUG_NAMED(LOGNAME, "%s: Using a %s path from the experience database", name_.c_str(),
+                    repaired ? "repaired" : "stored");
+  }
+  else
+    experience_database_->recordOutcome(ExperienceDatabase::FALLBACK);
 
+  ExperienceDatabase::Statistics stats = experience_database_->getStatistics();
+  ROS_DEBUG_NAMED(LOGNAME,
+                  "Experience database: %zu queries, %zu hits, %zu repairs, %zu fallbacks (recall rate %.1f%%), "
+                  "%zu stored paths.",
+                  stats.queries_, stats.hits_, stats.repairs_, stats.fallbacks_, 100.0 * stats.getRecallRate(),
+                  stats.experiences_);
   return result;
 }
 
+bool ompl_interface::ModelBasedPlanningContext::retrieveExperience(const ob::PlannerTerminationCondition& ptc,
+                                                                   og::PathGeometric& path, bool& repaired)
+{
+  const ob::SpaceInformationPtr& si = ompl_simple_setup_->getSpaceInformation();
+  const ob::ProblemDefinitionPtr& pdef = ompl_simple_setup_->getProblemDefinition();
+  const auto* goal = dynamic_cast<const ob::GoalSampleableRegion*>(pdef->getGoal().get());
+  if (!goal || pdef->getStartStateCount() == 0)
+    return false;
+
+  // stored paths are looked up by start and goal, so wait for the goal region to provide a goal state
+  while (goal->maxSampleCount() == 0 && goal->couldSample() && !ptc())
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  if (goal->maxSampleCount() == 0 || ptc())
+    return false;
+
+  const moveit::core::JointModelGroup* jmg = getJointModelGroup();
+  const std::size_t variable_count = jmg->getVariableCount();
+  const ob::State* start_state = pdef->getStartState(0);
+  ob::ScopedState<> goal_state(si);
+  goal->sampleGoal(goal_state.get());
+  const double* start_values = start_state->as<ModelBasedStateSpace::StateType>()->values;
+  const double* goal_values = goal_state->as<ModelBasedStateSpace::StateType>()->values;
+
+  std::vector<ExperienceDatabase::ExperienceConstPtr> candidates = experience_database_->getNearestExperiences(
+      jmg, std::vector<double>(start_values, start_values + variable_count),
+      std::vector<double>(goal_values, goal_values + variable_count), MAX_EXPERIENCE_CANDIDATES);
+
+  moveit::core::RobotState robot_state(getCompleteInitialRobotState());
+  ob::ScopedState<> state(si);
+  for (const ExperienceDatabase::ExperienceConstPtr& candidate : candidates)
+  {
+    if (ptc())
+      return false;
+
+    // the stored path is attached to the start state of this request; repairing connects the two if needed
+    og::PathGeometric candidate_path(si, start_state);
+    for (const std::vector<double>& values : candidate->states_)
+    {
+      robot_state.setJointGroupPositions(jmg, values);
+      spec_.state_space_->copyToOMPLState(state.get(), robot_state);
+      candidate_path.append(state.get());
+    }
+
+    // the stored path has to end in the goal region of this request
+    robot_state.update();
+    if (std::none_of(goal_constraints_.begin(), goal_constraints_.end(),
+                     [&robot_state](const kinematic_constraints::KinematicConstraintSetPtr& constraints) {
+                       return constraints->decide(robot_state).satisfied;
+                     }))
+      continue;
+
+    bool candidate_repaired = false;
+    if (repairExperience(ptc, candidate_path, candidate_repaired))
+    {
+      path = candidate_path;
+      repaired = candidate_repaired;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ompl_interface::ModelBasedPlanningContext::repairExperience(const ob::PlannerTerminationCondition& ptc,
+                                                                 og::PathGeometric& path, bool& repaired)
+{
+  const ob::SpaceInformationPtr& si = ompl_simple_setup_->getSpaceInformation();
+  const std::vector<ob::State*>& states = path.getStates();
+  if (!si->isValid(states.front()) || !si->isValid(states.back()))
+    return false;
+
+  og::PathGeometric repaired_path(si, states.front());
+  std::size_t i = 0;
+  while (i + 1 < states.size())
+  {
+    if (ptc())
+      return false;
+
+    // skip the waypoints that are invalid in the current scene; the last one is known to be valid
+    std::size_t j = i + 1;
+    while (!si->isValid(states[j]))
+      ++j;
+
+    if (j == i + 1 && si->checkMotion(states[i], states[j]))
+      repaired_path.append(states[j]);
+    else
+    {
+      // replan the part of the path between the two valid waypoints
+      auto pdef = std::make_shared<ob::ProblemDefinition>(si);
+      pdef->setStartAndGoalStates(states[i], states[j]);
+      og::RRTConnect planner(si);
+      planner.setProblemDefinition(pdef);
+      planner.setup();
+      if (planner.solve(ptc) != ob::PlannerStatus::EXACT_SOLUTION)
+        return false;
+      const og::PathGeometric& bridge = *pdef->getSolutionPath()->as<og::PathGeometric>();
+      for (std::size_t k = 1; k < bridge.getStateCount(); ++k)
+        repaired_path.append(bridge.getState(k));
+      repaired = true;
+    }
+    i = j;
+  }
+  path = repaired_path;
+  return true;
+}
+
+void ompl_interface::ModelBasedPlanningContext::storeExperience()
+{
+  if (!use_experience_ || !experience_database_ || solution_from_experience_ ||
+      !ompl_simple_setup_->haveExactSolutionPath())
+    return;
+
+  const std::size_t variable_count = getJointModelGroup()->getVariableCount();
+  const og::PathGeometric& path = ompl_simple_setup_->getSolutionPath();
+  std::vector<std::vector<double> > states;
+  states.reserve(path.getStateCount());
+  for (const ob::State* state : path.getStates())
+  {
+    const double* values = state->as<ModelBasedStateSpace::StateType>()->values;
+    states.emplace_back(values, values + variable_count);
+  }
+  experience_database_->addExperience(getJointModelGroup(), std::move(states));
+}
+
 void ompl_interface::ModelBasedPlanningContext::registerTerminationCondition(const ob::PlannerTerminationCondition& ptc)
 {
   std::unique_lock<std::mutex> slock(ptc_lock_);
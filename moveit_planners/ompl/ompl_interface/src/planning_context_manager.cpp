@@ -35,8 +35,15 @@
 /* Author: Ioan Sucan */
 
 #include <moveit/ompl_interface/planning_context_manager.h>
+#include <moveit/ompl_interface/detail/scene_aware_roadmap.h>
 #include <moveit/robot_state/conversions.h>
 #include <moveit/profiler/profiler.h>
+#include <geometric_shapes/shape_operations.h>
+#include <boost/filesystem.hpp>
+#include <boost/functional/hash.hpp>
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
 #include <utility>
 
 #include <ompl/geometric/planners/AnytimePathShortening.h>
@@ -83,6 +90,52 @@ struct PlanningContextManager::CachedContexts
   std::mutex lock_;
 };
 
+namespace
+{
+// A hash of the kinematics and collision geometry of the robot model, so stored roadmaps are not reused for a
+// different robot
+std::size_t hashRobotModel(const moveit::core::RobotModel& robot_model)
+{
+  std::size_t seed = 0;
+  boost::hash_combine(seed, robot_model.getName());
+  for (const moveit::core::JointModel* joint : robot_model.getJointModels())
+  {
+    boost::hash_combine(seed, joint->getName());
+    boost::hash_combine(seed, static_cast<int>(joint->getType()));
+    boost::hash_combine(seed, joint->getChildLinkModel()->getName());
+    const Eigen::Isometry3d& origin = joint->getChildLinkModel()->getJointOriginTransform();
+    boost::hash_combine(seed, boost::hash_range(origin.data(), origin.data() + 16));
+    for (const moveit::core::VariableBounds& bounds : joint->getVariableBounds())
+    {
+      boost::hash_combine(seed, bounds.min_position_);
+      boost::hash_combine(seed, bounds.max_position_);
+    }
+  }
+  for (const moveit::core::LinkModel* link : robot_model.getLinkModelsWithCollisionGeometry())
+  {
+    boost::hash_combine(seed, link->getName());
+    for (std::size_t i = 0; i < link->getShapes().size(); ++i)
+    {
+      const Eigen::Isometry3d& origin = link->getCollisionOriginTransforms()[i];
+      boost::hash_combine(seed, boost::hash_range(origin.data(), origin.data() + 16));
+      const Eigen::Vector3d extents = shapes::computeShapeExtents(link->getShapes()[i].get());
+      boost::hash_combine(seed, boost::hash_range(extents.data(), extents.data() + 3));
+    }
+  }
+  return seed;
+}
+
+// The file in directory that holds the roadmap of the planner configuration named planner_name (<group>/<config>)
+std::string getPlannerDataPath(const std::string& directory, const std::string& planner_name,
+                               const moveit::core::RobotModel& robot_model)
+{
+  std::string file_name = planner_name;
+  std::replace(file_name.begin(), file_name.end(), '/', '_');
+  std::stringstream ss;
+  ss << file_name << "_" << std::hex << std::setw(16) << std::setfill('0') << hashRobotModel(robot_model) << ".graph";
+  return (boost::filesystem::path(directory) / ss.str()).string();
+}
+}  // namespace
 }  // namespace ompl_interface
 
 ompl_interface::MultiQueryPlannerAllocator::~MultiQueryPlannerAllocator()
@@ -91,6 +144,10 @@ ompl_interface::MultiQueryPlannerAllocator::~MultiQueryPlannerAllocator()
   for (const auto& entry : planner_data_storage_paths_)
   {
     ROS_INFO("Storing planner data");
+    boost::system::error_code ec;
+    boost::filesystem::path parent = boost::filesystem::path(entry.second).parent_path();
+    if (!parent.empty())
+      boost::filesystem::create_directories(parent, ec);
     ob::PlannerData data(planners_[entry.first]->getSpaceInformation());
     planners_[entry.first]->getPlannerData(data);
     storage_.store(data, entry.second.c_str());
@@ -122,15 +179,24 @@ ompl::base::PlannerPtr ompl_interface::MultiQueryPlannerAllocator::allocatePlann
     // 'store_planner_data'. The storage file path is set using the parameter 'planner_data_path'.
     // File read and write access are handled by the PlannerDataStorage class. If the file path is invalid
     // an error message is printed and the planner is constructed/destructed with default values.
+    // Instead of a file path, a directory can be set using the parameter 'planner_data_directory'. The planner data
+    // is then kept in one file per planner configuration and robot model, and it is loaded and stored by default.
+    it = cfg.find("planner_data_directory");
+    std::string planner_data_directory;
+    if (it != cfg.end())
+    {
+      planner_data_directory = it->second;
+      cfg.erase(it);
+    }
     it = cfg.find("load_planner_data");
-    bool load_planner_data = false;
+    bool load_planner_data = !planner_data_directory.empty();
     if (it != cfg.end())
     {
       load_planner_data = boost::lexical_cast<bool>(it->second);
       cfg.erase(it);
     }
     it = cfg.find("store_planner_data");
-    bool store_planner_data = false;
+    bool store_planner_data = !planner_data_directory.empty();
     if (it != cfg.end())
     {
       store_planner_data = boost::lexical_cast<bool>(it->second);
@@ -143,6 +209,8 @@ ompl::base::PlannerPtr ompl_interface::MultiQueryPlannerAllocator::allocatePlann
       planner_data_path = it->second;
       cfg.erase(it);
     }
+    else if (!planner_data_directory.empty())
+      planner_data_path = getPlannerDataPath(planner_data_directory, new_name, *spec.state_space_->getRobotModel());
     // Store planner instance for multi-query use
     planners_[new_name] =
         allocatePlannerImpl<T>(si, new_name, spec, load_planner_data, store_planner_data, planner_data_path);
@@ -162,7 +230,9 @@ ompl::base::PlannerPtr ompl_interface::MultiQueryPlannerAllocator::allocatePlann
 {
   ob::PlannerPtr planner;
   // Try to initialize planner with loaded planner data
-  if (load_planner_data)
+  if (load_planner_data && !boost::filesystem::exists(file_path))
+    ROS_INFO_NAMED(LOGNAME, "No planner data stored at '%s' yet", file_path.c_str());
+  else if (load_planner_data)
   {
     ROS_INFO("Loading planner data");
     ob::PlannerData data(si);
@@ -210,15 +280,17 @@ MultiQueryPlannerAllocator::allocatePersistentPlanner<ompl::geometric::PRMstar>(
 };
 template <>
 inline ompl::base::Planner*
-MultiQueryPlannerAllocator::allocatePersistentPlanner<ompl::geometric::LazyPRM>(const ob::PlannerData& data)
+MultiQueryPlannerAllocator::allocatePersistentPlanner<SceneAwareLazyPRM<ompl::geometric::LazyPRM> >(
+    const ob::PlannerData& data)
 {
-  return new og::LazyPRM(data);
+  return new SceneAwareLazyPRM<og::LazyPRM>(data);
 };
 template <>
 inline ompl::base::Planner*
-MultiQueryPlannerAllocator::allocatePersistentPlanner<ompl::geometric::LazyPRMstar>(const ob::PlannerData& data)
+MultiQueryPlannerAllocator::allocatePersistentPlanner<SceneAwareLazyPRM<ompl::geometric::LazyPRMstar> >(
+    const ob::PlannerData& data)
 {
-  return new og::LazyPRMstar(data);
+  return new SceneAwareLazyPRM<og::LazyPRMstar>(data);
 };
 }  // namespace ompl_interface
 #endif
@@ -233,6 +305,7 @@ ompl_interface::PlanningContextManager::PlanningContextManager(moveit::core::Rob
   , max_planning_threads_(4)
   , max_solution_segment_length_(0.0)
   , minimum_waypoint_count_(2)
+  , experience_database_(std::make_shared<ExperienceDatabase>())
 {
   cached_contexts_.reset(new CachedContexts());
   registerDefaultPlanners();
@@ -273,8 +346,8 @@ void ompl_interface::PlanningContextManager::registerDefaultPlanners()
   registerPlannerAllocatorHelper<og::EST>("geometric::EST");
   registerPlannerAllocatorHelper<og::FMT>("geometric::FMT");
   registerPlannerAllocatorHelper<og::KPIECE1>("geometric::KPIECE");
-  registerPlannerAllocatorHelper<og::LazyPRM>("geometric::LazyPRM");
-  registerPlannerAllocatorHelper<og::LazyPRMstar>("geometric::LazyPRMstar");
+  registerPlannerAllocatorHelper<SceneAwareLazyPRM<og::LazyPRM> >("geometric::LazyPRM");
+  registerPlannerAllocatorHelper<SceneAwareLazyPRM<og::LazyPRMstar> >("geometric::LazyPRMstar");
   registerPlannerAllocatorHelper<og::LazyRRT>("geometric::LazyRRT");
   registerPlannerAllocatorHelper<og::LBKPIECE1>("geometric::LBKPIECE");
   registerPlannerAllocatorHelper<og::LBTRRT>("geometric::LBTRRT");
@@ -361,6 +434,7 @@ ompl_interface::ModelBasedPlanningContextPtr ompl_interface::PlanningContextMana
   if (max_solution_segment_length_ > std::numeric_limits<double>::epsilon())
     context->setMaximumSolutionSegmentLength(max_solution_segment_length_);
   context->setMinimumWaypointCount(minimum_waypoint_count_);
+  context->setExperienceDatabase(experience_database_);
 
   context->setSpecificationConfig(config.config);
 
@@ -0,0 +1,179 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, MoveIt maintainers
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/ompl_interface/detail/constraint_approximation_database.h>
+#include <ompl/base/spaces/RealVectorStateSpace.h>
+#include <boost/filesystem.hpp>
+
+#include <fstream>
+#include <limits>
+
+#include <gtest/gtest.h>
+
+namespace ob = ompl::base;
+
+class ConstraintApproximationDatabaseTest : public testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    auto space = std::make_shared<ob::RealVectorStateSpace>(2);
+    space->setBounds(-10.0, 10.0);
+    space->setup();
+    space_ = space;
+    storage_ = std::make_shared<ompl_interface::ConstraintApproximationStateStorage>(space_);
+
+    // three milestones, 0 - 1 and 1 - 2 connected, with one explicit motion state for each connection
+    ob::State* state = space_->allocState();
+    for (double x : { 0.0, 1.0, 2.0, 0.5, 1.5 })
+    {
+      state->as<ob::RealVectorStateSpace::StateType>()->values[0] = x;
+      state->as<ob::RealVectorStateSpace::StateType>()->values[1] = -x;
+      storage_->addState(state);
+    }
+    space_->freeState(state);
+    connect(0, 1, 3);
+    connect(1, 2, 4);
+  }
+
+  void connect(std::size_t a, std::size_t b, std::size_t motion_state)
+  {
+    storage_->getMetadata(a).first.push_back(b);
+    storage_->getMetadata(b).first.push_back(a);
+    storage_->getMetadata(a).second[b] = std::make_pair(motion_state, motion_state + 1);
+    storage_->getMetadata(b).second[a] = std::make_pair(motion_state, motion_state + 1);
+  }
+
+  void checkDatabase(const ompl_interface::ConstraintApproximationDatabase& database)
+  {
+    EXPECT_EQ(database.size(), 5u);
+    EXPECT_EQ(database.getMilestoneCount(), 3u);
+    EXPECT_EQ(database.getConnectionCount(), 4u);
+    EXPECT_TRUE(database.hasExplicitMotions());
+
+    ob::State* state = space_->allocState();
+    for (std::size_t i = 0; i < database.size(); ++i)
+    {
+      database.copyState(space_.get(), i, state);
+      EXPECT_TRUE(space_->equalStates(state, storage_->getState(i)));
+    }
+    space_->freeState(state);
+
+    ASSERT_EQ(database.getNeighborCount(1), 2u);
+    EXPECT_EQ(database.getNeighbors(1)[0], 0u);
+    EXPECT_EQ(database.getNeighbors(1)[1], 2u);
+    EXPECT_EQ(database.getNeighborCount(3), 0u);
+
+    std::size_t first, last;
+    ASSERT_TRUE(database.getMotion(2, 1, first, last));
+    EXPECT_EQ(first, 4u);
+    EXPECT_EQ(last, 5u);
+    EXPECT_FALSE(database.getMotion(0, 2, first, last));
+  }
+
+  ob::StateSpacePtr space_;
+  std::shared_ptr<ompl_interface::ConstraintApproximationStateStorage> storage_;
+};
+
+TEST_F(ConstraintApproximationDatabaseTest, FromStateStorage)
+{
+  ompl_interface::ConstraintApproximationDatabasePtr database =
+      ompl_interface::ConstraintApproximationDatabase::fromStateStorage(*storage_, 3);
+  ASSERT_TRUE(database);
+  EXPECT_EQ(database->getRecordSize(), space_->getSerializationLength());
+  checkDatabase(*database);
+}
+
+TEST_F(ConstraintApproximationDatabaseTest, SaveAndMap)
+{
+  const std::string filename =
+      (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("%%%%-%%%%.ompldb")).string();
+  ASSERT_TRUE(ompl_interface::ConstraintApproximationDatabase::fromStateStorage(*storage_, 3)->save(filename));
+  EXPECT_TRUE(ompl_interface::ConstraintApproximationDatabase::isDatabaseFile(filename));
+
+  ompl_interface::ConstraintApproximationDatabasePtr database =
+      ompl_interface::ConstraintApproximationDatabase::map(filename);
+  ASSERT_TRUE(database);
+  checkDatabase(*database);
+  database.reset();
+
+  // a state storage archive is not a database
+  storage_->store(filename.c_str());
+  EXPECT_FALSE(ompl_interface::ConstraintApproximationDatabase::isDatabaseFile(filename));
+  EXPECT_FALSE(ompl_interface::ConstraintApproximationDatabase::map(filename));
+  boost::filesystem::remove(filename);
+}
+
+TEST_F(ConstraintApproximationDatabaseTest, RejectInvalidConnections)
+{
+  const std::string filename =
+      (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("%%%%-%%%%.ompldb")).string();
+  ASSERT_TRUE(ompl_interface::ConstraintApproximationDatabase::fromStateStorage(*storage_, 3)->save(filename));
+  std::vector<std::uint64_t> words(boost::filesystem::file_size(filename) / sizeof(std::uint64_t));
+  {
+    std::ifstream in(filename.c_str(), std::ios::binary);
+    ASSERT_TRUE(in.read(reinterpret_cast<char*>(words.data()), words.size() * sizeof(std::uint64_t)));
+  }
+
+  // the header stores the offsets of the neighbor offsets, the neighbors and the motions in words 7, 8 and 9
+  const std::size_t neighbor_offsets = words[7] / sizeof(std::uint64_t);
+  const std::size_t neighbors = words[8] / sizeof(std::uint64_t);
+  const std::size_t motions = words[9] / sizeof(std::uint64_t);
+  auto mapModified = [&](std::size_t index, std::uint64_t value) {
+    std::vector<std::uint64_t> modified = words;
+    modified[index] = value;
+    std::ofstream out(filename.c_str(), std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(modified.data()), modified.size() * sizeof(std::uint64_t));
+    out.close();
+    return ompl_interface::ConstraintApproximationDatabase::map(filename);
+  };
+
+  EXPECT_TRUE(mapModified(neighbors, words[neighbors]));
+  // neighbor offsets that decrease
+  EXPECT_FALSE(mapModified(neighbor_offsets + 1, 4));
+  // a neighbor beyond the stored states
+  EXPECT_FALSE(mapModified(neighbors, 5));
+  // motions ending beyond the stored states, or ending before they start
+  EXPECT_FALSE(mapModified(motions + 1, 6));
+  EXPECT_FALSE(mapModified(motions, 5));
+  // more states than fit in the file
+  EXPECT_FALSE(mapModified(3, std::numeric_limits<std::uint64_t>::max() / 2));
+  boost::filesystem::remove(filename);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
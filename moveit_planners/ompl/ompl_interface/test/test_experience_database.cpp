@@ -0,0 +1,125 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, MoveIt maintainers
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/ompl_interface/detail/experience_database.h>
+#include <moveit/utils/robot_model_test_utils.h>
+
+#include <gtest/gtest.h>
+
+class ExperienceDatabaseTest : public testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    robot_model_ = moveit::core::loadTestingRobotModel("panda");
+    group_ = robot_model_->getJointModelGroup("panda_arm");
+    ASSERT_TRUE(group_);
+  }
+
+  // a straight path of the arm from all joints at start to all joints at goal
+  std::vector<std::vector<double> > makePath(double start, double goal) const
+  {
+    const std::size_t n = group_->getVariableCount();
+    return { std::vector<double>(n, start), std::vector<double>(n, 0.5 * (start + goal)),
+             std::vector<double>(n, goal) };
+  }
+
+  moveit::core::RobotModelPtr robot_model_;
+  const moveit::core::JointModelGroup* group_;
+};
+
+TEST_F(ExperienceDatabaseTest, NearestExperiences)
+{
+  ompl_interface::ExperienceDatabase database;
+  EXPECT_TRUE(database.addExperience(group_, makePath(0.0, 0.5)));
+  EXPECT_TRUE(database.addExperience(group_, makePath(0.1, 0.6)));
+  EXPECT_TRUE(database.addExperience(group_, makePath(-0.5, -0.4)));
+  // too short to be a path, and too close to a stored one
+  EXPECT_FALSE(database.addExperience(group_, { std::vector<double>(group_->getVariableCount(), 0.0) }));
+  EXPECT_FALSE(database.addExperience(group_, makePath(0.0, 0.5)));
+
+  const std::size_t n = group_->getVariableCount();
+  std::vector<ompl_interface::ExperienceDatabase::ExperienceConstPtr> nearest =
+      database.getNearestExperiences(group_, std::vector<double>(n, 0.09), std::vector<double>(n, 0.59), 2);
+  ASSERT_EQ(nearest.size(), 2u);
+  EXPECT_DOUBLE_EQ(nearest[0]->states_.front()[0], 0.1);
+  EXPECT_DOUBLE_EQ(nearest[1]->states_.front()[0], 0.0);
+  EXPECT_EQ(nearest[0]->states_.size(), 3u);
+
+  // other groups have no experiences
+  const moveit::core::JointModelGroup* hand = robot_model_->getJointModelGroup("hand");
+  ASSERT_TRUE(hand);
+  EXPECT_TRUE(database.getNearestExperiences(hand, { 0.0 }, { 0.0 }, 1).empty());
+}
+
+TEST_F(ExperienceDatabaseTest, EvictsOldestExperiences)
+{
+  ompl_interface::ExperienceDatabase database(2);
+  EXPECT_TRUE(database.addExperience(group_, makePath(0.0, 0.5)));
+  EXPECT_TRUE(database.addExperience(group_, makePath(0.1, 0.6)));
+  EXPECT_TRUE(database.addExperience(group_, makePath(0.2, 0.7)));
+  EXPECT_EQ(database.getStatistics().experiences_, 2u);
+
+  const std::size_t n = group_->getVariableCount();
+  std::vector<ompl_interface::ExperienceDatabase::ExperienceConstPtr> nearest =
+      database.getNearestExperiences(group_, std::vector<double>(n, 0.0), std::vector<double>(n, 0.5), 3);
+  ASSERT_EQ(nearest.size(), 2u);
+  EXPECT_DOUBLE_EQ(nearest[0]->states_.front()[0], 0.1);
+  EXPECT_DOUBLE_EQ(nearest[1]->states_.front()[0], 0.2);
+}
+
+TEST_F(ExperienceDatabaseTest, Statistics)
+{
+  ompl_interface::ExperienceDatabase database;
+  database.recordOutcome(ompl_interface::ExperienceDatabase::HIT);
+  database.recordOutcome(ompl_interface::ExperienceDatabase::REPAIR);
+  database.recordOutcome(ompl_interface::ExperienceDatabase::FALLBACK);
+  database.recordOutcome(ompl_interface::ExperienceDatabase::FALLBACK);
+
+  ompl_interface::ExperienceDatabase::Statistics stats = database.getStatistics();
+  EXPECT_EQ(stats.queries_, 4u);
+  EXPECT_EQ(stats.hits_, 1u);
+  EXPECT_EQ(stats.repairs_, 1u);
+  EXPECT_EQ(stats.fallbacks_, 2u);
+  EXPECT_DOUBLE_EQ(stats.getRecallRate(), 0.5);
+
+  database.clear();
+  EXPECT_EQ(database.getStatistics().queries_, 0u);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -63,6 +63,7 @@
 #include <moveit/kinematic_constraints/utils.h>
 #include <moveit/constraint_samplers/constraint_sampler_manager.h>
 #include <moveit/ompl_interface/parameterization/joint_space/joint_model_state_space.h>
+#include <geometric_shapes/shapes.h>
 
 /** \brief Generic implementation of the tests that can be executed on different robots. **/
 class TestPlanningContext : public ompl_interface_testing::LoadTestRobot, public testing::Test
@@ -204,6 +205,79 @@ public:
     }
   }
 
+  void testExperience(const std::vector<double>& start, const std::vector<double>& goal,
+                      const std::vector<double>& detour)
+  {
+    // RRTstar keeps optimizing until it is stopped, so it is always overtaken by a stored path that can be used,
+    // even though it reports an exact solution then
+    planning_interface::PlannerConfigurationSettings pconfig_settings;
+    pconfig_settings.group = group_name_;
+    pconfig_settings.name = group_name_;
+    pconfig_settings.config = { { "enforce_joint_model_state_space", "0" },
+                                { "use_experience", "1" },
+                                { "type", "geometric::RRTstar" } };
+
+    planning_interface::PlannerConfigurationMap pconfig_map{ { pconfig_settings.name, pconfig_settings } };
+    moveit_msgs::MoveItErrorCodes error_code;
+    planning_interface::MotionPlanRequest request = createRequest(start, goal);
+
+    // setup the planning context manager and store a path from start to goal, with a detour
+    ompl_interface::PlanningContextManager pcm(robot_model_, constraint_sampler_manager_);
+    pcm.setPlannerConfigurations(pconfig_map);
+    const ompl_interface::ExperienceDatabasePtr& experience_database = pcm.getExperienceDatabase();
+    ASSERT_TRUE(experience_database->addExperience(joint_model_group_, { start, detour, goal }));
+
+    // HIT
+    // ***********************
+    auto pc = pcm.getPlanningContext(planning_scene_, request, error_code, node_handle_, false);
+    planning_interface::MotionPlanDetailedResponse response;
+    ASSERT_TRUE(pc->solve(response));
+
+    // the stored path is valid in the empty scene and is used as is
+    ompl_interface::ExperienceDatabase::Statistics stats = experience_database->getStatistics();
+    EXPECT_EQ(stats.queries_, 1u);
+    EXPECT_EQ(stats.hits_, 1u);
+    EXPECT_EQ(stats.repairs_, 0u);
+    EXPECT_EQ(stats.fallbacks_, 0u);
+    EXPECT_LT(pc->getLastPlanTime(), request.allowed_planning_time);
+
+    // REPAIR
+    // ***********************
+    // put an obstacle around the end-effector at the detour
+    robot_state_->setToDefaultValues();
+    robot_state_->setJointGroupPositions(joint_model_group_, detour);
+    robot_state_->update();
+    planning_scene_->getWorldNonConst()->addToObject("box", std::make_shared<shapes::Box>(0.1, 0.1, 0.1),
+                                                     robot_state_->getGlobalLinkTransform(ee_link_name_));
+    ASSERT_TRUE(planning_scene_->isStateColliding(*robot_state_, group_name_));
+    robot_state_->setJointGroupPositions(joint_model_group_, start);
+    robot_state_->update();
+    ASSERT_FALSE(planning_scene_->isStateColliding(*robot_state_, group_name_));
+    robot_state_->setJointGroupPositions(joint_model_group_, goal);
+    robot_state_->update();
+    ASSERT_FALSE(planning_scene_->isStateColliding(*robot_state_, group_name_));
+
+    pc = pcm.getPlanningContext(planning_scene_, request, error_code, node_handle_, false);
+    planning_interface::MotionPlanDetailedResponse response2;
+    ASSERT_TRUE(pc->solve(response2));
+
+    // the detour of the stored path is replanned
+    stats = experience_database->getStatistics();
+    EXPECT_EQ(stats.queries_, 2u);
+    EXPECT_EQ(stats.hits_, 1u);
+    EXPECT_EQ(stats.repairs_, 1u);
+    EXPECT_EQ(stats.fallbacks_, 0u);
+    for (const robot_trajectory::RobotTrajectoryPtr& trajectory : response2.trajectory_)
+    {
+      for (std::size_t pt_index = { 0 }; pt_index < trajectory->getWayPointCount(); ++pt_index)
+      {
+        moveit::core::RobotState waypoint(trajectory->getWayPoint(pt_index));
+        waypoint.update();
+        EXPECT_FALSE(planning_scene_->isStateColliding(waypoint, group_name_));
+      }
+    }
+  }
+
   // /***************************************************************************
   //  * END Test implementation
   //  * ************************************************************************/
@@ -324,6 +398,12 @@ TEST_F(PandaTestPlanningContext, testPathConstraints)
   testPathConstraints({ 0, -0.785, 0, -2.356, 0, 1.571, 0.785 }, { 0, -0.785, 0, -2.356, 0, 1.571, 0.685 });
 }
 
+TEST_F(PandaTestPlanningContext, testExperience)
+{
+  testExperience({ 0, -0.785, 0, -2.356, 0, 1.571, 0.785 }, { 0, -0.785, 0, -2.356, 0, 1.571, 0.685 },
+                 { 0.8, -0.785, 0, -2.356, 0, 1.571, 0.785 });
+}
+
 /***************************************************************************
  * Run all tests on the Fanuc robot
  * ************************************************************************/
@@ -345,6 +425,11 @@ TEST_F(FanucTestPlanningContext, testPathConstraints)
   testPathConstraints({ 0, 0, 0, 0, 0, 0 }, { 0, 0, 0, 0, 0, 0.1 });
 }
 
+TEST_F(FanucTestPlanningContext, testExperience)
+{
+  testExperience({ 0, 0, 0, 0, 0, 0 }, { 0, 0, 0, 0, 0, 0.1 }, { 0.8, 0, 0, 0, 0, 0 });
+}
+
 /***************************************************************************
  * MAIN
  * ************************************************************************/
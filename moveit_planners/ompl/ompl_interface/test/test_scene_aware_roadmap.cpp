@@ -0,0 +1,211 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, MoveIt maintainers
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* This test checks that invalidating a roadmap vertex also drops the validity cached in its state,
+   which the StateValidityChecker would otherwise trust after the scene changed, and that the planning context
+   invalidates the roadmap for the scene changes that may affect it. */
+
+#include "load_test_robot.h"
+
+#include <gtest/gtest.h>
+
+#include <moveit/ompl_interface/detail/scene_aware_roadmap.h>
+#include <moveit/ompl_interface/detail/state_validity_checker.h>
+#include <moveit/ompl_interface/model_based_planning_context.h>
+#include <moveit/ompl_interface/parameterization/joint_space/joint_model_state_space.h>
+#include <moveit/planning_scene/planning_scene.h>
+
+#include <geometric_shapes/shapes.h>
+#include <octomap/octomap.h>
+#include <ompl/geometric/SimpleSetup.h>
+#include <ompl/geometric/planners/prm/LazyPRM.h>
+
+/** \brief Gives the test access to the roadmap */
+class TestRoadmap : public ompl_interface::SceneAwareLazyPRM<ompl::geometric::LazyPRM>
+{
+public:
+  using SceneAwareLazyPRM::SceneAwareLazyPRM;
+  using LazyPRM::addMilestone;
+  using LazyPRM::stateProperty_;
+  using LazyPRM::vertexValidityProperty_;
+  using LazyPRM::VALIDITY_TRUE;
+  using LazyPRM::VALIDITY_UNKNOWN;
+};
+
+/** \brief Gives the test access to the roadmap update of the planning context */
+class TestPlanningContext : public ompl_interface::ModelBasedPlanningContext
+{
+public:
+  using ModelBasedPlanningContext::ModelBasedPlanningContext;
+  using ModelBasedPlanningContext::updateRoadmapValidity;
+};
+
+class PandaRoadmap : public ompl_interface_testing::LoadTestRobot, public testing::Test
+{
+protected:
+  PandaRoadmap() : LoadTestRobot("panda", "panda_arm")
+  {
+  }
+
+  void SetUp() override
+  {
+    ompl_interface::ModelBasedStateSpaceSpecification space_spec(robot_model_, group_name_);
+    state_space_ = std::make_shared<ompl_interface::JointModelStateSpace>(space_spec);
+    state_space_->computeLocations();
+
+    planning_context_spec_.state_space_ = state_space_;
+    planning_context_spec_.ompl_simple_setup_ = std::make_shared<ompl::geometric::SimpleSetup>(state_space_);
+    planning_context_ = std::make_shared<TestPlanningContext>(group_name_, planning_context_spec_);
+
+    planning_scene_ = std::make_shared<planning_scene::PlanningScene>(robot_model_);
+    planning_context_->setPlanningScene(planning_scene_);
+    planning_context_->setCompleteInitialState(*robot_state_);
+
+    checker_ = std::make_shared<ompl_interface::StateValidityChecker>(planning_context_.get());
+    const ompl::base::SpaceInformationPtr& si = planning_context_->getOMPLSimpleSetup()->getSpaceInformation();
+    si->setStateValidityChecker(checker_);
+    roadmap_ = std::make_shared<TestRoadmap>(si);
+    roadmap_->setup();
+    planning_context_->getOMPLSimpleSetup()->setPlanner(roadmap_);
+
+    // the panda "ready" state, which is valid in the empty scene
+    robot_state_->setJointGroupPositions(joint_model_group_, { 0, -0.785, 0, -2.356, 0, 1.571, 0.785 });
+    robot_state_->update();
+  }
+
+  /** \brief Add a vertex at the "ready" state that was validated, as LazyPRM does during a query */
+  TestRoadmap::Vertex addValidatedVertex()
+  {
+    ompl::base::State* state = state_space_->allocState();
+    state_space_->copyToOMPLState(state, *robot_state_);
+    EXPECT_TRUE(checker_->isValid(state));
+    EXPECT_TRUE(state->as<ompl_interface::ModelBasedStateSpace::StateType>()->isValidityKnown());
+
+    TestRoadmap::Vertex v = roadmap_->addMilestone(state);
+    roadmap_->vertexValidityProperty_[v] = TestRoadmap::VALIDITY_TRUE;
+    return v;
+  }
+
+  /** \brief Put a box around the end-effector of the "ready" state */
+  void addObstacle()
+  {
+    planning_scene_->getWorldNonConst()->addToObject("box", std::make_shared<shapes::Box>(0.2, 0.2, 0.2),
+                                                     robot_state_->getGlobalLinkTransform(ee_link_name_));
+  }
+
+  ompl_interface::ModelBasedStateSpacePtr state_space_;
+  ompl_interface::ModelBasedPlanningContextSpecification planning_context_spec_;
+  std::shared_ptr<TestPlanningContext> planning_context_;
+  planning_scene::PlanningScenePtr planning_scene_;
+  std::shared_ptr<ompl_interface::StateValidityChecker> checker_;
+  std::shared_ptr<TestRoadmap> roadmap_;
+};
+
+TEST_F(PandaRoadmap, InvalidateClearsValidityOfAffectedStates)
+{
+  TestRoadmap::Vertex v = addValidatedVertex();
+  addObstacle();
+
+  // vertices the predicate does not select keep their validity
+  roadmap_->invalidate([](const ompl::base::State*) { return false; },
+                       [](const ompl::base::State*, const ompl::base::State*) { return false; });
+  EXPECT_EQ(roadmap_->vertexValidityProperty_[v], TestRoadmap::VALIDITY_TRUE);
+
+  roadmap_->invalidate([](const ompl::base::State*) { return true; },
+                       [](const ompl::base::State*, const ompl::base::State*) { return true; });
+  EXPECT_EQ(roadmap_->vertexValidityProperty_[v], TestRoadmap::VALIDITY_UNKNOWN);
+  EXPECT_FALSE(checker_->isValid(roadmap_->stateProperty_[v]));
+}
+
+TEST_F(PandaRoadmap, InvalidateAllClearsValidityOfAllStates)
+{
+  TestRoadmap::Vertex v = addValidatedVertex();
+  addObstacle();
+
+  roadmap_->invalidateAll();
+  EXPECT_EQ(roadmap_->vertexValidityProperty_[v], TestRoadmap::VALIDITY_UNKNOWN);
+  EXPECT_FALSE(checker_->isValid(roadmap_->stateProperty_[v]));
+}
+
+TEST_F(PandaRoadmap, UpdateRoadmapValidityInvalidatesAffectedVertices)
+{
+  // the first update has no validated scene to compare to
+  planning_context_->updateRoadmapValidity();
+  TestRoadmap::Vertex v = addValidatedVertex();
+
+  // neither an unchanged scene nor an object far from the vertex affects it
+  planning_context_->updateRoadmapValidity();
+  EXPECT_EQ(roadmap_->vertexValidityProperty_[v], TestRoadmap::VALIDITY_TRUE);
+  planning_scene_->getWorldNonConst()->addToObject("far_box", std::make_shared<shapes::Box>(0.2, 0.2, 0.2),
+                                                   Eigen::Isometry3d(Eigen::Translation3d(5.0, 0.0, 0.0)));
+  planning_context_->updateRoadmapValidity();
+  EXPECT_EQ(roadmap_->vertexValidityProperty_[v], TestRoadmap::VALIDITY_TRUE);
+
+  // an object added next to the vertex does
+  addObstacle();
+  planning_context_->updateRoadmapValidity();
+  EXPECT_EQ(roadmap_->vertexValidityProperty_[v], TestRoadmap::VALIDITY_UNKNOWN);
+
+  // changing the allowed collisions may affect any vertex
+  roadmap_->vertexValidityProperty_[v] = TestRoadmap::VALIDITY_TRUE;
+  planning_scene_->getAllowedCollisionMatrixNonConst().setEntry("box", "panda_hand", true);
+  planning_context_->updateRoadmapValidity();
+  EXPECT_EQ(roadmap_->vertexValidityProperty_[v], TestRoadmap::VALIDITY_UNKNOWN);
+
+  // an octree occupied far from the vertex does not affect it ...
+  planning_scene_->getWorldNonConst()->removeObject("box");
+  planning_context_->updateRoadmapValidity();
+  roadmap_->vertexValidityProperty_[v] = TestRoadmap::VALIDITY_TRUE;
+  auto octree = std::make_shared<octomap::OcTree>(0.1);
+  octree->updateNode(octomap::point3d(5.0, 0.0, 1.0), true);
+  planning_scene_->processOctomapPtr(octree, Eigen::Isometry3d::Identity());
+  planning_context_->updateRoadmapValidity();
+  EXPECT_EQ(roadmap_->vertexValidityProperty_[v], TestRoadmap::VALIDITY_TRUE);
+
+  // ... until it is updated in place, which keeps the world object
+  const Eigen::Vector3d ee_position = robot_state_->getGlobalLinkTransform(ee_link_name_).translation();
+  octree->updateNode(octomap::point3d(ee_position.x(), ee_position.y(), ee_position.z()), true);
+  collision_detection::World::ObjectConstPtr octomap_object =
+      planning_scene_->getWorld()->getObject(planning_scene::PlanningScene::OCTOMAP_NS);
+  planning_scene_->processOctomapPtr(octree, Eigen::Isometry3d::Identity());
+  ASSERT_EQ(planning_scene_->getWorld()->getObject(planning_scene::PlanningScene::OCTOMAP_NS), octomap_object);
+  planning_context_->updateRoadmapValidity();
+  EXPECT_EQ(roadmap_->vertexValidityProperty_[v], TestRoadmap::VALIDITY_UNKNOWN);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
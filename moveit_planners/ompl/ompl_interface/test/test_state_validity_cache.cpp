@@ -0,0 +1,122 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, MoveIt maintainers
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/ompl_interface/detail/state_validity_cache.h>
+
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+TEST(StateValidityCache, InsertAndLookup)
+{
+  ompl_interface::StateValidityCache cache(1000, 1e-3);
+  EXPECT_EQ(cache.getCapacity(), 1024u);
+
+  const double valid_state[] = { 0.1, -0.2, 0.3 };
+  const double invalid_state[] = { 1.1, -1.2, 1.3 };
+  const std::uint64_t valid_key = cache.getKey(valid_state, 3);
+  const std::uint64_t invalid_key = cache.getKey(invalid_state, 3);
+
+  bool valid;
+  EXPECT_FALSE(cache.lookup(valid_key, valid));
+  cache.insert(valid_key, true);
+  cache.insert(invalid_key, false);
+  ASSERT_TRUE(cache.lookup(valid_key, valid));
+  EXPECT_TRUE(valid);
+  ASSERT_TRUE(cache.lookup(invalid_key, valid));
+  EXPECT_FALSE(valid);
+
+  ompl_interface::StateValidityCache::Statistics stats = cache.getStatistics();
+  EXPECT_EQ(stats.hits_, 2u);
+  EXPECT_EQ(stats.misses_, 1u);
+  EXPECT_EQ(stats.insertions_, 2u);
+  EXPECT_NEAR(stats.getHitRate(), 2.0 / 3.0, 1e-12);
+}
+
+TEST(StateValidityCache, Quantization)
+{
+  ompl_interface::StateValidityCache cache(64, 1e-3);
+  const double state[] = { 0.5, 0.25 };
+  const double nearby_state[] = { 0.5 + 1e-5, 0.25 - 1e-5 };
+  const double other_state[] = { 0.5 + 1e-2, 0.25 };
+  EXPECT_EQ(cache.getKey(state, 2), cache.getKey(nearby_state, 2));
+  EXPECT_NE(cache.getKey(state, 2), cache.getKey(other_state, 2));
+}
+
+TEST(StateValidityCache, ClearInvalidatesEntries)
+{
+  ompl_interface::StateValidityCache cache(64, 1e-3);
+  const double state[] = { 0.5, 0.25 };
+  cache.insert(cache.getKey(state, 2), true);
+
+  cache.clear();
+  bool valid;
+  EXPECT_FALSE(cache.lookup(cache.getKey(state, 2), valid));
+  EXPECT_EQ(cache.getStatistics().hits_, 0u);
+  EXPECT_EQ(cache.getStatistics().insertions_, 0u);
+}
+
+TEST(StateValidityCache, ConcurrentAccess)
+{
+  ompl_interface::StateValidityCache cache(256, 1e-3);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t)
+    threads.emplace_back([&cache, t] {
+      for (int i = 0; i < 10000; ++i)
+      {
+        // the validity is a function of the state, so every hit must return the right value
+        const double state[] = { 0.01 * (i % 500), 0.1 * t };
+        const bool expected = (i % 500) % 3 == 0;
+        std::uint64_t key = cache.getKey(state, 2);
+        bool valid;
+        if (cache.lookup(key, valid))
+          EXPECT_EQ(valid, expected);
+        else
+          cache.insert(key, expected);
+      }
+    });
+  for (std::thread& thread : threads)
+    thread.join();
+
+  ompl_interface::StateValidityCache::Statistics stats = cache.getStatistics();
+  EXPECT_EQ(stats.hits_ + stats.misses_, 40000u);
+  EXPECT_GT(stats.hits_, 0u);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -39,6 +39,8 @@
 #include <ros/param.h>
 #include <sensor_msgs/JointState.h>
 #include <boost/thread.hpp>
+#include <boost/shared_ptr.hpp>
+#include <algorithm>
 #include <limits>
 
 namespace moveit_fake_controller_manager
@@ -104,7 +106,7 @@ bool LastPointController::waitForExecution(const ros::Duration& /*timeout*/)
 
 ThreadedController::ThreadedController(const std::string& name, const std::vector<std::string>& joints,
                                        const ros::Publisher& pub)
-  : BaseFakeController(name, joints, pub)
+  : BaseFakeController(name, joints, pub), cancel_(false)
 {
 }
 
@@ -121,13 +123,62 @@ void ThreadedController::cancelTrajectory()
 
 bool ThreadedController::sendTrajectory(const moveit_msgs::RobotTrajectory& t)
 {
+  ros::Time start_time = std::max(t.joint_trajectory.header.stamp, t.multi_dof_joint_trajectory.header.stamp);
+  if (thread_.joinable() && !cancel_ && start_time > ros::Time::now())
+  {
+    // like a real trajectory controller, keep executing the previous motion until the new one starts
+    {
+      boost::mutex::scoped_lock slock(splice_mutex_);
+      splice_times_.push_back(start_time);
+    }
+    boost::shared_ptr<boost::thread> previous(new boost::thread());
+    previous->swap(thread_);
+    status_ = moveit_controller_manager::ExecutionStatus::PREEMPTED;
+    thread_ = boost::thread(boost::bind(&ThreadedController::spliceTrajectory, this, previous, t));
+    return true;
+  }
+
   cancelTrajectory();  // cancel any previous fake motion
   cancel_ = false;
+  splice_times_.clear();
   status_ = moveit_controller_manager::ExecutionStatus::PREEMPTED;
   thread_ = boost::thread(boost::bind(&ThreadedController::execTrajectory, this, t));
   return true;
 }
 
+void ThreadedController::spliceTrajectory(const boost::shared_ptr<boost::thread>& previous,
+                                          const moveit_msgs::RobotTrajectory& t)
+{
+  previous->join();
+  {
+    boost::mutex::scoped_lock slock(splice_mutex_);
+    if (!splice_times_.empty())
+      splice_times_.pop_front();
+  }
+  if (!cancel_)
+    execTrajectory(t);
+}
+
+bool ThreadedController::cancelled()
+{
+  if (cancel_)
+    return true;
+  boost::mutex::scoped_lock slock(splice_mutex_);
+  return !splice_times_.empty() && ros::Time::now() >= splice_times_.front();
+}
+
+ros::Time ThreadedController::waitForStart(const moveit_msgs::RobotTrajectory& t)
+{
+  ros::Time start_time = std::max(t.joint_trajectory.header.stamp, t.multi_dof_joint_trajectory.header.stamp);
+  ros::Time now = ros::Time::now();
+  while (now < start_time && !cancelled())
+  {
+    std::min(ros::Duration(0.01), start_time - now).sleep();
+    now = ros::Time::now();
+  }
+  return std::max(now, start_time);
+}
+
 bool ThreadedController::cancelExecution()
 {
   cancelTrajectory();
@@ -165,7 +216,7 @@ void ViaPointController::execTrajectory(const moveit_msgs::RobotTrajectory& t)
 
   // publish joint states for all intermediate via points of the trajectory
   // no further interpolation
-  ros::Time start_time = ros::Time::now();
+  ros::Time start_time = waitForStart(t);
   for (std::vector<trajectory_msgs::JointTrajectoryPoint>::const_iterator via = t.joint_trajectory.points.begin(),
                                                                           end = t.joint_trajectory.points.end();
        !cancelled() && via != end; ++via)
@@ -225,12 +276,20 @@ void InterpolatingController::execTrajectory(const moveit_msgs::RobotTrajectory&
   js.header = t.joint_trajectory.header;
   js.name = t.joint_trajectory.joint_names;
 
-  const std::vector<trajectory_msgs::JointTrajectoryPoint>& points = t.joint_trajectory.points;
+  // a trajectory that does not start at time 0 is spliced: interpolate from the last published state
+  std::vector<trajectory_msgs::JointTrajectoryPoint> points = t.joint_trajectory.points;
+  if (points.front().time_from_start > ros::Duration(0.0) && last_js_.name == js.name &&
+      last_js_.position.size() == points.front().positions.size())
+  {
+    trajectory_msgs::JointTrajectoryPoint current;
+    current.positions = last_js_.position;
+    points.insert(points.begin(), current);
+  }
   std::vector<trajectory_msgs::JointTrajectoryPoint>::const_iterator prev = points.begin(),  // previous via point
       next = points.begin() + 1,  // currently targetted via point
       end = points.end();
 
-  ros::Time start_time = ros::Time::now();
+  ros::Time start_time = waitForStart(t);
   while (!cancelled())
   {
     ros::Duration elapsed = ros::Time::now() - start_time;
@@ -251,6 +310,7 @@ void InterpolatingController::execTrajectory(const moveit_msgs::RobotTrajectory&
     interpolate(js, *prev, *next, elapsed);
     js.header.stamp = ros::Time::now();
     pub_.publish(js);
+    last_js_ = js;
     rate_.sleep();
   }
   if (cancelled())
@@ -264,6 +324,7 @@ void InterpolatingController::execTrajectory(const moveit_msgs::RobotTrajectory&
   interpolate(js, *prev, *prev, prev->time_from_start);
   js.header.stamp = ros::Time::now();
   pub_.publish(js);
+  last_js_ = js;
 
   ROS_DEBUG("Fake execution of trajectory: done");
 }
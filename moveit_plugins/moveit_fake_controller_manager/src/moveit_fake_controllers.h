@@ -39,7 +39,10 @@
 #include <moveit/controller_manager/controller_manager.h>
 #include <ros/publisher.h>
 #include <ros/rate.h>
+#include <sensor_msgs/JointState.h>
 #include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <deque>
 
 #ifndef MOVEIT_FAKE_CONTROLLERS
 #define MOVEIT_FAKE_CONTROLLERS
@@ -85,19 +88,26 @@ public:
   moveit_controller_manager::ExecutionStatus getLastExecutionStatus() override;
 
 protected:
-  bool cancelled()
-  {
-    return cancel_;
-  }
+  /// True if the current motion was cancelled or a spliced trajectory takes over now
+  bool cancelled();
+
+  /// Wait until the trajectory is due to start (according to its header stamp) and return its start time
+  ros::Time waitForStart(const moveit_msgs::RobotTrajectory& t);
 
 private:
   virtual void execTrajectory(const moveit_msgs::RobotTrajectory& t) = 0;
   virtual void cancelTrajectory();
+  void spliceTrajectory(const boost::shared_ptr<boost::thread>& previous, const moveit_msgs::RobotTrajectory& t);
 
 private:
   boost::thread thread_;
   bool cancel_;
   moveit_controller_manager::ExecutionStatus status_;
+
+  // start times of trajectories that were sent while another one was still executing,
+  // each of them preempts its predecessor once its start time is reached
+  boost::mutex splice_mutex_;
+  std::deque<ros::Time> splice_times_;
 };
 
 class ViaPointController : public ThreadedController
@@ -121,6 +131,7 @@ protected:
 
 private:
   ros::WallRate rate_;
+  sensor_msgs::JointState last_js_;  // last published state, to interpolate into spliced trajectories
 };
 }  // namespace moveit_fake_controller_manager
 
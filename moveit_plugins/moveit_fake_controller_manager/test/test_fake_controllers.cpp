@@ -0,0 +1,159 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, MoveIt maintainers
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include "../src/moveit_fake_controllers.h"
+#include <ros/ros.h>
+#include <gtest/gtest.h>
+
+namespace moveit_fake_controller_manager
+{
+namespace
+{
+// a trajectory of a single joint, given as pairs of (time from start, position)
+moveit_msgs::RobotTrajectory makeTrajectory(const std::vector<std::pair<double, double> >& points)
+{
+  moveit_msgs::RobotTrajectory trajectory;
+  trajectory.joint_trajectory.joint_names.push_back("joint");
+  for (const std::pair<double, double>& point : points)
+  {
+    trajectory_msgs::JointTrajectoryPoint p;
+    p.time_from_start = ros::Duration(point.first);
+    p.positions.push_back(point.second);
+    trajectory.joint_trajectory.points.push_back(p);
+  }
+  return trajectory;
+}
+}  // namespace
+
+class FakeControllerFixture : public testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    pub_ = nh_.advertise<sensor_msgs::JointState>("fake_controller_joint_states", 100);
+    sub_ = nh_.subscribe("fake_controller_joint_states", 100, &FakeControllerFixture::jointStateCallback, this);
+
+    ros::WallTime timeout = ros::WallTime::now() + ros::WallDuration(5.0);
+    while (pub_.getNumSubscribers() == 0 && ros::WallTime::now() < timeout)
+      ros::WallDuration(0.01).sleep();
+    ASSERT_GT(pub_.getNumSubscribers(), 0u);
+  }
+
+  void jointStateCallback(const sensor_msgs::JointStateConstPtr& js)
+  {
+    boost::mutex::scoped_lock slock(states_lock_);
+    states_.push_back(*js);
+  }
+
+  // all joint states published so far (waiting a bit for the last ones to arrive)
+  std::vector<sensor_msgs::JointState> getStates()
+  {
+    ros::WallDuration(0.2).sleep();
+    boost::mutex::scoped_lock slock(states_lock_);
+    return states_;
+  }
+
+  ros::NodeHandle nh_;
+  ros::Publisher pub_;
+  ros::Subscriber sub_;
+  boost::mutex states_lock_;
+  std::vector<sensor_msgs::JointState> states_;
+};
+
+TEST_F(FakeControllerFixture, SplicedTrajectoryTakesOverAtItsStartTime)
+{
+  InterpolatingController controller("controller", { "joint" }, pub_);
+  ros::Time start = ros::Time::now();
+  ASSERT_TRUE(controller.sendTrajectory(makeTrajectory({ { 0.0, 0.0 }, { 1.0, 1.0 } })));
+
+  // sent while the first trajectory is executing, scheduled to start half way through it
+  moveit_msgs::RobotTrajectory next = makeTrajectory({ { 0.3, 2.0 } });
+  ros::Time splice_time = start + ros::Duration(0.5);
+  next.joint_trajectory.header.stamp = splice_time;
+  ASSERT_TRUE(controller.sendTrajectory(next));
+  EXPECT_TRUE(controller.waitForExecution());
+
+  std::vector<sensor_msgs::JointState> states = getStates();
+  ASSERT_FALSE(states.empty());
+
+  // the first trajectory is executed until the spliced one takes over, which continues from where the first one
+  // stopped, without jumping back
+  for (std::size_t i = 0; i < states.size(); ++i)
+  {
+    ASSERT_EQ(states[i].position.size(), 1u);
+    if (states[i].header.stamp < splice_time)
+      EXPECT_LE(states[i].position[0], 0.55);
+    if (i > 0)
+      EXPECT_GE(states[i].position[0], states[i - 1].position[0]);
+  }
+
+  // the spliced trajectory ends at its time from start, relative to its start time
+  EXPECT_NEAR(states.back().position[0], 2.0, 1e-9);
+  EXPECT_GE(states.back().header.stamp, splice_time + ros::Duration(0.3));
+  EXPECT_EQ(controller.getLastExecutionStatus().asString(), "SUCCEEDED");
+}
+
+TEST_F(FakeControllerFixture, TrajectoryWithoutStartTimeReplacesMotion)
+{
+  InterpolatingController controller("controller", { "joint" }, pub_);
+  ASSERT_TRUE(controller.sendTrajectory(makeTrajectory({ { 0.0, 0.0 }, { 1.0, 1.0 } })));
+  ros::WallDuration(0.3).sleep();
+
+  // not time stamped: the first trajectory is cancelled right away
+  ASSERT_TRUE(controller.sendTrajectory(makeTrajectory({ { 0.0, 3.0 }, { 0.2, 4.0 } })));
+  EXPECT_TRUE(controller.waitForExecution());
+
+  std::vector<sensor_msgs::JointState> states = getStates();
+  std::size_t first = 0;
+  while (first < states.size() && states[first].position[0] < 3.0)
+    EXPECT_LE(states[first++].position[0], 0.5);
+  ASSERT_LT(first, states.size());
+
+  // no more states of the first trajectory once the second one started
+  for (std::size_t i = first; i < states.size(); ++i)
+    EXPECT_GE(states[i].position[0], 3.0);
+  EXPECT_NEAR(states.back().position[0], 4.0, 1e-9);
+}
+}  // namespace moveit_fake_controller_manager
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  ros::init(argc, argv, "test_fake_controllers");
+
+  ros::AsyncSpinner spinner(1);
+  spinner.start();
+
+  return RUN_ALL_TESTS();
+}
@@ -35,6 +35,7 @@
 /* Author: Ryan Luna */
 
 #include <moveit/benchmarks/BenchmarkExecutor.h>
+#include <moveit/robot_state/robot_state_pool.h>
 #include <moveit/utils/lexical_casts.h>
 #include <moveit/version.h>
 #include <tf2_eigen/tf2_eigen.h>
@@ -791,6 +792,7 @@ void BenchmarkExecutor::runBenchmark(moveit_msgs::MotionPlanRequest request,
           pre_event_fn(request);
 
         // Solve problem
+        const moveit::core::RobotStatePool::Statistics pool_start = moveit::core::RobotStatePool::getStatistics();
         ros::WallTime start = ros::WallTime::now();
         if (use_planning_context)
         {
@@ -810,10 +812,17 @@ void BenchmarkExecutor::runBenchmark(moveit_msgs::MotionPlanRequest request,
           }
         }
         double total_time = (ros::WallTime::now() - start).toSec();
+        const moveit::core::RobotStatePool::Statistics pool_end = moveit::core::RobotStatePool::getStatistics();
 
         // Collect data
         start = ros::WallTime::now();
 
+        // RobotState memory blocks taken from the heap resp. reused from the per-thread pools while planning
+        planner_data[j]["robot_state_allocations INTEGER"] =
+            boost::lexical_cast<std::string>(pool_end.heap_allocations - pool_start.heap_allocations);
+        planner_data[j]["robot_state_reuses INTEGER"] =
+            boost::lexical_cast<std::string>(pool_end.reused_blocks - pool_start.reused_blocks);
+
         // Post-run events
         for (PostRunEventFunction& post_event_fn : post_event_fns_)
           post_event_fn(request, responses[j], planner_data[j]);
@@ -38,6 +38,7 @@
 
 #include <moveit/macros/class_forward.h>
 #include <moveit/plan_execution/plan_representation.h>
+#include <moveit/plan_execution/swept_volume_index.h>
 #include <moveit/trajectory_execution_manager/trajectory_execution_manager.h>
 #include <moveit/planning_scene_monitor/planning_scene_monitor.h>
 #include <moveit/planning_scene_monitor/trajectory_monitor.h>
@@ -126,13 +127,45 @@ public:
     return default_max_replan_attempts_;
   }
 
+  /// Statistics of the scene-change triggered revalidation of the executed path, for the last executeAndMonitor()
+  struct MonitoringStatistics
+  {
+    MonitoringStatistics()
+      : scene_updates_(0), skipped_scene_updates_(0), waypoint_checks_(0), avoided_waypoint_checks_(0), duration_(0.0)
+    {
+    }
+
+    /// Number of scene updates that were evaluated
+    std::size_t scene_updates_;
+
+    /// Number of scene updates that did not touch the remaining swept volume and required no check at all
+    std::size_t skipped_scene_updates_;
+
+    /// Number of waypoints that were checked for collisions
+    std::size_t waypoint_checks_;
+
+    /// Number of waypoint checks a full check of the remaining path would have done in addition
+    std::size_t avoided_waypoint_checks_;
+
+    /// Duration of the monitored execution (in seconds)
+    double duration_;
+  };
+
+  const MonitoringStatistics& getMonitoringStatistics() const
+  {
+    return monitoring_statistics_;
+  }
+
   void planAndExecute(ExecutableMotionPlan& plan, const Options& opt);
   void planAndExecute(ExecutableMotionPlan& plan, const moveit_msgs::PlanningScene& scene_diff, const Options& opt);
 
   /** \brief Execute and monitor a previously created \e plan.
 
       In case there is no \e planning_scene or \e planning_scene_monitor set in the \e plan they will be set at the
-      start of the method. They are then used to monitor the execution. */
+      start of the method. They are then used to monitor the execution. After a first full check of the remaining path
+      of a trajectory component, scene updates only trigger checks of the waypoints whose swept volume overlaps a
+      changed object or the octomap (see getMonitoringStatistics()). Changes of the allowed collisions or of the
+      transforms trigger a full check again. */
   moveit_msgs::MoveItErrorCodes executeAndMonitor(ExecutableMotionPlan& plan);
 
   void stop();
@@ -142,6 +175,7 @@ public:
 private:
   void planAndExecuteHelper(ExecutableMotionPlan& plan, const Options& opt);
   bool isRemainingPathValid(const ExecutableMotionPlan& plan, const std::pair<int, int>& path_segment);
+  bool isRemainingPathStillValid(const ExecutableMotionPlan& plan, const std::pair<int, int>& path_segment);
 
   void planningSceneUpdatedCallback(const planning_scene_monitor::PlanningSceneMonitor::SceneUpdateType update_type);
   void doneWithTrajectoryExecution(const moveit_controller_manager::ExecutionStatus& status);
@@ -160,6 +194,15 @@ private:
   bool execution_complete_;
   bool path_became_invalid_;
 
+  // swept volume of the monitored trajectory component and the world, allowed collisions and transforms its remaining
+  // path was last validated against
+  SweptVolumeIndex swept_volume_;
+  int swept_volume_component_;
+  collision_detection::WorldConstPtr validated_world_;
+  collision_detection::CompiledAllowedCollisionMatrixConstPtr validated_acm_;
+  moveit::core::FixedTransformsMap validated_transforms_;
+  MonitoringStatistics monitoring_statistics_;
+
   class DynamicReconfigureImpl;
   DynamicReconfigureImpl* reconfigure_impl_;
 };
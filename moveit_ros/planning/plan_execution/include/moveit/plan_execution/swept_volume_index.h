@@ -0,0 +1,105 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, MoveIt maintainers
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <moveit/collision_detection/collision_env.h>
+#include <moveit/collision_detection/world.h>
+#include <moveit/robot_model/aabb.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace plan_execution
+{
+/** \brief A spatial index of the volume swept by the robot along a trajectory.
+
+    The bounding boxes of the links and attached bodies at every waypoint are hashed into a uniform grid. This allows
+    to find the waypoints that may be affected by a change of the world without looking at the whole trajectory. */
+class SweptVolumeIndex
+{
+public:
+  /** \brief Construct an empty index with grid cells of \e cell_size meters */
+  SweptVolumeIndex(double cell_size = 0.1);
+
+  /** \brief Index the waypoints of \e trajectory, using the link padding and scaling of \e env.
+      The link transforms of the waypoints are expected to be up to date. */
+  void build(const robot_trajectory::RobotTrajectory& trajectory, const collision_detection::CollisionEnv& env);
+
+  void clear();
+
+  bool empty() const
+  {
+    return boxes_.empty();
+  }
+
+  /** \brief The number of indexed waypoints */
+  std::size_t getWayPointCount() const
+  {
+    return boxes_.size();
+  }
+
+  /** \brief Mark the waypoints (from \e first on) whose swept volume overlaps \e box in \e affected */
+  void query(const moveit::core::AABB& box, std::size_t first, std::vector<bool>& affected) const;
+
+  /** \brief Get the indices of the waypoints (from \e first on) whose swept volume overlaps an object of \e world
+      that was added or changed since \e reference_world. Objects are compared by identity: with copy-on-write
+      worlds, an object that was not touched is shared by both. Objects holding an octree are always considered
+      changed, since the octomap is updated in place; only their occupied cells within the swept volume are looked
+      at. Removed objects are not considered, as they cannot cause new collisions. */
+  void getAffectedWaypoints(const collision_detection::World& world, const collision_detection::World& reference_world,
+                            std::size_t first, std::vector<std::size_t>& waypoints) const;
+
+private:
+  using CellKey = std::uint64_t;
+  CellKey getCellKey(int x, int y, int z) const;
+  void queryObject(const collision_detection::World::Object& object, std::size_t first,
+                   std::vector<bool>& affected) const;
+
+  double cell_size_;
+
+  /// the bounds of the whole swept volume
+  moveit::core::AABB bounds_;
+
+  /// the bounding boxes of the links and attached bodies, for each waypoint
+  std::vector<std::vector<moveit::core::AABB>> boxes_;
+
+  /// waypoints that need to be checked for any change, because they carry unbounded attached shapes
+  std::vector<std::size_t> unbounded_;
+
+  /// the waypoints (in increasing order) with a bounding box that overlaps a grid cell
+  std::unordered_map<CellKey, std::vector<std::size_t>> cells_;
+};
+}  // namespace plan_execution
@@ -85,6 +85,7 @@ plan_execution::PlanExecution::PlanExecution(
 
   preempt_requested_ = false;
   new_scene_update_ = false;
+  swept_volume_component_ = -1;
 
   // we want to be notified when new information is available
   planning_scene_monitor_->addUpdateCallback(boost::bind(&PlanExecution::planningSceneUpdatedCallback, this, _1));
@@ -261,6 +262,45 @@ void plan_execution::PlanExecution::planAndExecuteHelper(ExecutableMotionPlan& p
                     getErrorCodeString(plan.error_code_).c_str());
 }
 
+namespace
+{
+bool isWaypointValid(const planning_scene::PlanningScene& scene, const robot_trajectory::RobotTrajectory& t,
+                     const collision_detection::AllowedCollisionMatrix* acm, std::size_t index)
+{
+  collision_detection::CollisionRequest req;
+  req.group_name = t.getGroupName();
+  collision_detection::CollisionResult res;
+  if (acm)
+    scene.checkCollisionUnpadded(req, res, t.getWayPoint(index), *acm);
+  else
+    scene.checkCollisionUnpadded(req, res, t.getWayPoint(index));
+
+  if (res.collision || !scene.isStateFeasible(t.getWayPoint(index), false))
+  {
+    // call the same functions again, in verbose mode, to show what issues have been detected
+    scene.isStateFeasible(t.getWayPoint(index), true);
+    req.verbose = true;
+    res.clear();
+    if (acm)
+      scene.checkCollisionUnpadded(req, res, t.getWayPoint(index), *acm);
+    else
+      scene.checkCollisionUnpadded(req, res, t.getWayPoint(index));
+    return false;
+  }
+  return true;
+}
+
+bool haveSameTransforms(const moveit::core::FixedTransformsMap& a, const moveit::core::FixedTransformsMap& b)
+{
+  return a.size() == b.size() &&
+         std::equal(a.begin(), a.end(), b.begin(),
+                    [](const moveit::core::FixedTransformsMap::value_type& x,
+                       const moveit::core::FixedTransformsMap::value_type& y) {
+                      return x.first == y.first && x.second.isApprox(y.second);
+                    });
+}
+}  // namespace
+
 bool plan_execution::PlanExecution::isRemainingPathValid(const ExecutableMotionPlan& plan,
                                                          const std::pair<int, int>& path_segment)
 {
@@ -276,30 +316,68 @@ bool plan_execution::PlanExecution::isRemainingPathValid(const ExecutableMotionP
     const collision_detection::AllowedCollisionMatrix* acm =
         plan.plan_components_[path_segment.first].allowed_collision_matrix_.get();
     std::size_t wpc = t.getWayPointCount();
-    collision_detection::CollisionRequest req;
-    req.group_name = t.getGroupName();
     for (std::size_t i = std::max(path_segment.second - 1, 0); i < wpc; ++i)
-    {
-      collision_detection::CollisionResult res;
-      if (acm)
-        plan.planning_scene_->checkCollisionUnpadded(req, res, t.getWayPoint(i), *acm);
-      else
-        plan.planning_scene_->checkCollisionUnpadded(req, res, t.getWayPoint(i));
+      if (!isWaypointValid(*plan.planning_scene_, t, acm, i))
+        return false;
+  }
+  return true;
+}
 
-      if (res.collision || !plan.planning_scene_->isStateFeasible(t.getWayPoint(i), false))
-      {
-        // call the same functions again, in verbose mode, to show what issues have been detected
-        plan.planning_scene_->isStateFeasible(t.getWayPoint(i), true);
-        req.verbose = true;
-        res.clear();
-        if (acm)
-          plan.planning_scene_->checkCollisionUnpadded(req, res, t.getWayPoint(i), *acm);
-        else
-          plan.planning_scene_->checkCollisionUnpadded(req, res, t.getWayPoint(i));
+bool plan_execution::PlanExecution::isRemainingPathStillValid(const ExecutableMotionPlan& plan,
+                                                              const std::pair<int, int>& path_segment)
+{
+  if (path_segment.first < 0 || !plan.plan_components_[path_segment.first].trajectory_monitoring_)
+    return true;
+
+  planning_scene_monitor::LockedPlanningSceneRO lscene(plan.planning_scene_monitor_);
+  const robot_trajectory::RobotTrajectory& t = *plan.plan_components_[path_segment.first].trajectory_;
+  const collision_detection::AllowedCollisionMatrix* acm =
+      plan.plan_components_[path_segment.first].allowed_collision_matrix_.get();
+  const std::size_t first = std::max(path_segment.second - 1, 0);
+  const std::size_t wpc = t.getWayPointCount();
+  ++monitoring_statistics_.scene_updates_;
+
+  // the compiled matrix is cached by the ACM until it is modified, so its identity tells whether the ACM changed
+  const collision_detection::AllowedCollisionMatrix& used_acm =
+      acm ? *acm : plan.planning_scene_->getAllowedCollisionMatrix();
+  collision_detection::CompiledAllowedCollisionMatrixConstPtr compiled_acm =
+      used_acm.getCompiled(plan.planning_scene_->getRobotModel());
+  const moveit::core::FixedTransformsMap& transforms = plan.planning_scene_->getTransforms().getAllTransforms();
+
+  if (swept_volume_component_ != path_segment.first || !validated_world_ || compiled_acm != validated_acm_ ||
+      !haveSameTransforms(transforms, validated_transforms_))
+  {
+    // the first check of a component covers its whole remaining path, as does a check after the allowed collisions or
+    // the transforms changed; other checks only cover what changed in the world since the last check
+    for (std::size_t i = first; i < wpc; ++i)
+    {
+      ++monitoring_statistics_.waypoint_checks_;
+      if (!isWaypointValid(*plan.planning_scene_, t, acm, i))
         return false;
-      }
     }
+    swept_volume_.build(t, *plan.planning_scene_->getCollisionEnvUnpadded());
+    swept_volume_component_ = path_segment.first;
   }
+  else
+  {
+    // only the waypoints whose swept volume overlaps an object that changed since the last check can have become
+    // invalid (the world is copy-on-write, unchanged objects are shared with the validated world)
+    std::vector<std::size_t> waypoints;
+    swept_volume_.getAffectedWaypoints(*plan.planning_scene_->getWorld(), *validated_world_, first, waypoints);
+    if (waypoints.empty())
+      ++monitoring_statistics_.skipped_scene_updates_;
+    if (first < wpc)
+      monitoring_statistics_.avoided_waypoint_checks_ += wpc - first - waypoints.size();
+    for (std::size_t i : waypoints)
+    {
+      ++monitoring_statistics_.waypoint_checks_;
+      if (!isWaypointValid(*plan.planning_scene_, t, acm, i))
+        return false;
+    }
+  }
+  validated_world_ = std::make_shared<const collision_detection::World>(*plan.planning_scene_->getWorld());
+  validated_acm_ = compiled_acm;
+  validated_transforms_ = transforms;
   return true;
 }
 
@@ -399,6 +477,13 @@ moveit_msgs::MoveItErrorCodes plan_execution::PlanExecution::executeAndMonitor(E
   // wait for path to be done, while checking that the path does not become invalid
   ros::Rate r(100);
   path_became_invalid_ = false;
+  swept_volume_.clear();
+  swept_volume_component_ = -1;
+  validated_world_.reset();
+  validated_acm_.reset();
+  validated_transforms_.clear();
+  monitoring_statistics_ = MonitoringStatistics();
+  ros::WallTime monitoring_start = ros::WallTime::now();
   while (node_handle_.ok() && !execution_complete_ && !preempt_requested_ && !path_became_invalid_)
   {
     r.sleep();
@@ -407,7 +492,7 @@ moveit_msgs::MoveItErrorCodes plan_execution::PlanExecution::executeAndMonitor(E
     {
       new_scene_update_ = false;
       std::pair<int, int> current_index = trajectory_execution_manager_->getCurrentExpectedTrajectoryIndex();
-      if (!isRemainingPathValid(plan, current_index))
+      if (!isRemainingPathStillValid(plan, current_index))
       {
         ROS_INFO_NAMED("plan_execution", "Trajectory component '%s' is invalid after scene update",
                        plan.plan_components_[current_index.first].description_.c_str());
@@ -417,6 +502,15 @@ moveit_msgs::MoveItErrorCodes plan_execution::PlanExecution::executeAndMonitor(E
     }
   }
 
+  monitoring_statistics_.duration_ = (ros::WallTime::now() - monitoring_start).toSec();
+  if (monitoring_statistics_.scene_updates_ > 0)
+    ROS_DEBUG_NAMED("plan_execution",
+                    "Path monitoring evaluated %zu scene updates (%zu required no check) with %zu waypoint checks, "
+                    "avoiding %zu checks (%.1f per second)",
+                    monitoring_statistics_.scene_updates_, monitoring_statistics_.skipped_scene_updates_,
+                    monitoring_statistics_.waypoint_checks_, monitoring_statistics_.avoided_waypoint_checks_,
+                    monitoring_statistics_.avoided_waypoint_checks_ / std::max(monitoring_statistics_.duration_, 1e-3));
+
   // stop execution if needed
   if (preempt_requested_)
   {
@@ -0,0 +1,238 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, MoveIt maintainers
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/plan_execution/swept_volume_index.h>
+#include <geometric_shapes/shapes.h>
+#include <octomap/octomap.h>
+#include <algorithm>
+#include <cmath>
+
+namespace plan_execution
+{
+namespace
+{
+// Octrees are updated in place (see PlanningScene::processOctomapPtr()), so an object holding one may have changed even
+// though it is still shared with the reference world
+bool hasOcTree(const collision_detection::World::Object& object)
+{
+  return std::any_of(object.shapes_.begin(), object.shapes_.end(),
+                     [](const shapes::ShapeConstPtr& shape) { return shape->type == shapes::OCTREE; });
+}
+}  // namespace
+
+SweptVolumeIndex::SweptVolumeIndex(double cell_size) : cell_size_(cell_size)
+{
+}
+
+SweptVolumeIndex::CellKey SweptVolumeIndex::getCellKey(int x, int y, int z) const
+{
+  // 21 bits per axis, which covers +-100km with 10cm cells
+  static const int OFFSET = 1 << 20;
+  static const CellKey MASK = (CellKey(1) << 21) - 1;
+  return ((CellKey(x + OFFSET) & MASK) << 42) | ((CellKey(y + OFFSET) & MASK) << 21) | (CellKey(z + OFFSET) & MASK);
+}
+
+void SweptVolumeIndex::clear()
+{
+  bounds_.setEmpty();
+  boxes_.clear();
+  unbounded_.clear();
+  cells_.clear();
+}
+
+void SweptVolumeIndex::build(const robot_trajectory::RobotTrajectory& trajectory,
+                             const collision_detection::CollisionEnv& env)
+{
+  clear();
+
+  // the padded and scaled extents of the links, as used by the collision checks
+  const std::vector<const moveit::core::LinkModel*>& links =
+      trajectory.getRobotModel()->getLinkModelsWithCollisionGeometry();
+  std::vector<Eigen::Vector3d> link_extents;
+  link_extents.reserve(links.size());
+  for (const moveit::core::LinkModel* link : links)
+    link_extents.push_back(link->getShapeExtentsAtOrigin() * env.getLinkScale(link->getName()) +
+                           Eigen::Vector3d::Constant(2.0 * env.getLinkPadding(link->getName())));
+
+  std::vector<const moveit::core::AttachedBody*> attached_bodies;
+  boxes_.resize(trajectory.getWayPointCount());
+  for (std::size_t i = 0; i < boxes_.size(); ++i)
+  {
+    const moveit::core::RobotState& state = trajectory.getWayPoint(i);
+    std::vector<moveit::core::AABB>& boxes = boxes_[i];
+    boxes.resize(links.size());
+    for (std::size_t j = 0; j < links.size(); ++j)
+    {
+      Eigen::Isometry3d transform = state.getGlobalLinkTransform(links[j]);  // intentional copy, we will translate
+      transform.translate(links[j]->getCenteredBoundingBoxOffset());
+      boxes[j].extendWithTransformedBox(transform, link_extents[j]);
+    }
+
+    state.getAttachedBodies(attached_bodies);
+    for (const moveit::core::AttachedBody* body : attached_bodies)
+    {
+      const double padding = env.getLinkPadding(body->getAttachedLinkName());
+      boxes.emplace_back();
+      for (std::size_t k = 0; k < body->getShapes().size(); ++k)
+        if (!boxes.back().extendWithShape(*body->getShapes()[k], body->getGlobalCollisionBodyTransforms()[k], padding))
+        {
+          if (unbounded_.empty() || unbounded_.back() != i)
+            unbounded_.push_back(i);
+        }
+    }
+
+    // hash the boxes into the grid
+    for (const moveit::core::AABB& box : boxes)
+    {
+      if (box.isEmpty())
+        continue;
+      bounds_.extend(box);
+      const Eigen::Vector3i min = (box.min() / cell_size_).array().floor().cast<int>();
+      const Eigen::Vector3i max = (box.max() / cell_size_).array().floor().cast<int>();
+      for (int x = min.x(); x <= max.x(); ++x)
+        for (int y = min.y(); y <= max.y(); ++y)
+          for (int z = min.z(); z <= max.z(); ++z)
+          {
+            std::vector<std::size_t>& waypoints = cells_[getCellKey(x, y, z)];
+            if (waypoints.empty() || waypoints.back() != i)
+              waypoints.push_back(i);
+          }
+    }
+  }
+}
+
+void SweptVolumeIndex::query(const moveit::core::AABB& box, std::size_t first, std::vector<bool>& affected) const
+{
+  if (box.isEmpty() || !bounds_.intersects(box))
+    return;
+
+  // only the part of the box that overlaps the swept volume is relevant
+  const Eigen::AlignedBox3d overlap = box.intersection(bounds_);
+  const Eigen::Vector3i min = (overlap.min() / cell_size_).array().floor().cast<int>();
+  const Eigen::Vector3i max = (overlap.max() / cell_size_).array().floor().cast<int>();
+  for (int x = min.x(); x <= max.x(); ++x)
+    for (int y = min.y(); y <= max.y(); ++y)
+      for (int z = min.z(); z <= max.z(); ++z)
+      {
+        std::unordered_map<CellKey, std::vector<std::size_t>>::const_iterator cell = cells_.find(getCellKey(x, y, z));
+        if (cell == cells_.end())
+          continue;
+        for (std::vector<std::size_t>::const_reverse_iterator it = cell->second.rbegin();
+             it != cell->second.rend() && *it >= first; ++it)
+        {
+          if (affected[*it])
+            continue;
+          // the cell is only a coarse approximation, check the actual boxes of the waypoint
+          for (const moveit::core::AABB& waypoint_box : boxes_[*it])
+            if (waypoint_box.intersects(box))
+            {
+              affected[*it] = true;
+              break;
+            }
+        }
+      }
+}
+
+void SweptVolumeIndex::queryObject(const collision_detection::World::Object& object, std::size_t first,
+                                   std::vector<bool>& affected) const
+{
+  for (std::size_t i = 0; i < object.shapes_.size(); ++i)
+  {
+    const shapes::Shape& shape = *object.shapes_[i];
+    const Eigen::Isometry3d& pose = object.shape_poses_[i];
+    if (shape.type == shapes::OCTREE)
+    {
+      // the octree as a whole usually spans the complete swept volume, so look at its occupied cells instead
+      const octomap::OcTree& tree = *static_cast<const shapes::OcTree&>(shape).octree;
+      if (tree.size() == 0)
+        continue;
+      moveit::core::AABB swept;
+      swept.extendWithTransformedBox(pose.inverse() * Eigen::Translation3d(bounds_.center()), bounds_.sizes());
+      Eigen::Vector3d tree_min, tree_max;
+      tree.getMetricMin(tree_min.x(), tree_min.y(), tree_min.z());
+      tree.getMetricMax(tree_max.x(), tree_max.y(), tree_max.z());
+      const Eigen::AlignedBox3d local = swept.intersection(Eigen::AlignedBox3d(tree_min, tree_max));
+      if (local.isEmpty())
+        continue;
+      for (octomap::OcTree::leaf_bbx_iterator it = tree.begin_leafs_bbx(
+                                                  octomap::point3d(local.min().x(), local.min().y(), local.min().z()),
+                                                  octomap::point3d(local.max().x(), local.max().y(), local.max().z())),
+                                              end = tree.end_leafs_bbx();
+           it != end; ++it)
+        if (tree.isNodeOccupied(*it))
+        {
+          moveit::core::AABB box;
+          box.extendWithTransformedBox(pose * Eigen::Translation3d(it.getX(), it.getY(), it.getZ()),
+                                       Eigen::Vector3d::Constant(it.getSize()));
+          query(box, first, affected);
+        }
+    }
+    else
+    {
+      moveit::core::AABB box;
+      if (box.extendWithShape(shape, pose))
+        query(box, first, affected);
+      else
+        std::fill(affected.begin() + first, affected.end(), true);
+    }
+  }
+}
+
+void SweptVolumeIndex::getAffectedWaypoints(const collision_detection::World& world,
+                                            const collision_detection::World& reference_world, std::size_t first,
+                                            std::vector<std::size_t>& waypoints) const
+{
+  waypoints.clear();
+  if (first >= boxes_.size())
+    return;
+
+  std::vector<bool> affected(boxes_.size(), false);
+  bool changed = false;
+  for (const std::pair<const std::string, collision_detection::World::ObjectPtr>& object : world)
+    if (reference_world.getObject(object.first) != object.second || hasOcTree(*object.second))
+    {
+      changed = true;
+      queryObject(*object.second, first, affected);
+    }
+  if (!changed)
+    return;
+
+  for (std::size_t index : unbounded_)
+    if (index >= first)
+      affected[index] = true;
+  for (std::size_t i = first; i < affected.size(); ++i)
+    if (affected[i])
+      waypoints.push_back(i);
+}
+}  // namespace plan_execution
@@ -0,0 +1,151 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, MoveIt maintainers
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/plan_execution/swept_volume_index.h>
+#include <moveit/planning_scene/planning_scene.h>
+#include <moveit/utils/robot_model_test_utils.h>
+#include <geometric_shapes/shapes.h>
+#include <octomap/octomap.h>
+#include <algorithm>
+
+#include <gtest/gtest.h>
+
+class SweptVolumeIndexTest : public testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    // a 20cm cube sliding along the x axis
+    moveit::core::RobotModelBuilder builder("slider", "base_link");
+    builder.addChain("base_link->cube", "prismatic");
+    geometry_msgs::Pose origin;
+    origin.orientation.w = 1.0;
+    builder.addCollisionBox("cube", { 0.2, 0.2, 0.2 }, origin);
+    builder.addGroupChain("base_link", "cube", "slider");
+    ASSERT_TRUE(builder.isValid());
+    robot_model_ = builder.build();
+    scene_ = std::make_shared<planning_scene::PlanningScene>(robot_model_);
+
+    // slide from x = -1 to x = 1 in steps of 10cm
+    trajectory_ = std::make_shared<robot_trajectory::RobotTrajectory>(robot_model_, "slider");
+    moveit::core::RobotState state(robot_model_);
+    state.setToDefaultValues();
+    for (int i = 0; i <= 20; ++i)
+    {
+      state.setVariablePosition("base_link-cube-joint", -1.0 + 0.1 * i);
+      state.update();
+      trajectory_->addSuffixWayPoint(state, 0.1);
+    }
+    index_.build(*trajectory_, *scene_->getCollisionEnvUnpadded());
+  }
+
+  // the waypoints at which the cube collides with the world
+  std::vector<std::size_t> getCollidingWaypoints() const
+  {
+    std::vector<std::size_t> colliding;
+    for (std::size_t i = 0; i < trajectory_->getWayPointCount(); ++i)
+      if (scene_->isStateColliding(trajectory_->getWayPoint(i), "slider"))
+        colliding.push_back(i);
+    return colliding;
+  }
+
+  bool contains(const std::vector<std::size_t>& all, const std::vector<std::size_t>& some) const
+  {
+    return std::all_of(some.begin(), some.end(), [&all](std::size_t index) {
+      return std::find(all.begin(), all.end(), index) != all.end();
+    });
+  }
+
+  moveit::core::RobotModelPtr robot_model_;
+  planning_scene::PlanningScenePtr scene_;
+  robot_trajectory::RobotTrajectoryPtr trajectory_;
+  plan_execution::SweptVolumeIndex index_;
+};
+
+TEST_F(SweptVolumeIndexTest, UnchangedWorld)
+{
+  ASSERT_EQ(index_.getWayPointCount(), 21u);
+  collision_detection::World reference(*scene_->getWorld());
+  std::vector<std::size_t> affected;
+  index_.getAffectedWaypoints(*scene_->getWorld(), reference, 0, affected);
+  EXPECT_TRUE(affected.empty());
+}
+
+TEST_F(SweptVolumeIndexTest, AddedObject)
+{
+  collision_detection::World reference(*scene_->getWorld());
+  scene_->getWorldNonConst()->addToObject("box", std::make_shared<const shapes::Box>(0.05, 0.05, 0.05),
+                                          Eigen::Isometry3d(Eigen::Translation3d(0.5, 0.0, 0.0)));
+  scene_->getWorldNonConst()->addToObject("far_away", std::make_shared<const shapes::Box>(0.05, 0.05, 0.05),
+                                          Eigen::Isometry3d(Eigen::Translation3d(0.0, 2.0, 0.0)));
+  const std::vector<std::size_t> colliding = getCollidingWaypoints();
+  ASSERT_FALSE(colliding.empty());
+
+  std::vector<std::size_t> affected;
+  index_.getAffectedWaypoints(*scene_->getWorld(), reference, 0, affected);
+  EXPECT_TRUE(contains(affected, colliding));
+  EXPECT_LT(affected.size(), 6u);
+
+  // waypoints before first are not reported
+  index_.getAffectedWaypoints(*scene_->getWorld(), reference, 18, affected);
+  EXPECT_TRUE(affected.empty());
+}
+
+TEST_F(SweptVolumeIndexTest, OctomapUpdatedInPlace)
+{
+  auto octree = std::make_shared<octomap::OcTree>(0.05);
+  octree->updateNode(octomap::point3d(0.0, 2.0, 0.0), true);
+  scene_->processOctomapPtr(octree, Eigen::Isometry3d::Identity());
+  ASSERT_TRUE(getCollidingWaypoints().empty());
+  collision_detection::World reference(*scene_->getWorld());
+
+  // the octomap monitor modifies the same octree and passes it to the scene again, which keeps the world object
+  octree->updateNode(octomap::point3d(0.52, 0.02, 0.02), true);
+  scene_->processOctomapPtr(octree, Eigen::Isometry3d::Identity());
+  EXPECT_EQ(scene_->getWorld()->getObject(planning_scene::PlanningScene::OCTOMAP_NS),
+            reference.getObject(planning_scene::PlanningScene::OCTOMAP_NS));
+
+  const std::vector<std::size_t> colliding = getCollidingWaypoints();
+  ASSERT_FALSE(colliding.empty());
+  std::vector<std::size_t> affected;
+  index_.getAffectedWaypoints(*scene_->getWorld(), reference, 0, affected);
+  EXPECT_TRUE(contains(affected, colliding));
+  EXPECT_LT(affected.size(), 6u);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
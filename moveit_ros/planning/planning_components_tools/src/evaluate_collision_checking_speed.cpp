@@ -35,6 +35,7 @@
 /* Author: Ioan Sucan, Sachin Chitta */
 
 #include <moveit/planning_scene_monitor/planning_scene_monitor.h>
+#include <moveit/collision_detection_fcl/collision_env_fcl.h>
 #include <boost/program_options/parsers.hpp>
 #include <boost/program_options/variables_map.hpp>
 
@@ -55,6 +56,101 @@ void runCollisionDetection(unsigned int id, unsigned int trials, const planning_
   ROS_INFO("Thread %u performed %lf collision checks per second", id, (double)trials / duration);
 }
 
+// Compare checking a sequence of states with and without keeping the robot links in a persistent broadphase
+void runBroadPhaseComparison(unsigned int trials, const planning_scene::PlanningScene* scene,
+                             const moveit::core::RobotState& start_state)
+{
+  // states along which only the last joint of the robot moves, as for a wrist motion
+  const moveit::core::JointModel* joint = scene->getRobotModel()->getActiveJointModels().back();
+  std::vector<moveit::core::RobotState> states(100, start_state);
+  for (std::size_t i = 0; i < states.size(); ++i)
+  {
+    const double value = start_state.getJointPositions(joint)[0] + 0.01 * i;
+    states[i].setJointPositions(joint, &value);
+    states[i].enforceBounds(joint);
+    states[i].update();
+  }
+
+  for (bool persistent : { false, true })
+  {
+    collision_detection::CollisionEnvFCL env(scene->getRobotModel(),
+                                             std::make_shared<collision_detection::World>(*scene->getWorld()));
+    env.setUsePersistentBroadPhase(persistent);
+    collision_detection::CollisionRequest req;
+    ros::WallTime start = ros::WallTime::now();
+    for (unsigned int i = 0; i < trials; ++i)
+    {
+      collision_detection::CollisionResult res;
+      const moveit::core::RobotState& state = states[i % states.size()];
+      env.checkSelfCollision(req, res, state, scene->getAllowedCollisionMatrix());
+      if (!res.collision)
+        env.checkRobotCollision(req, res, state, scene->getAllowedCollisionMatrix());
+    }
+    double duration = (ros::WallTime::now() - start).toSec();
+    ROS_INFO("FCL %s broadphase of the robot: %lf collision checks per second",
+             persistent ? "persistent" : "reconstructed", (double)trials / duration);
+  }
+}
+
+// Compare validating motion segments by dense discrete sampling and by continuous collision checking. The discrete
+// samples are spaced such that no point of the robot moves more than the tolerance of the continuous check between
+// two samples, so both give the same safety margin.
+void runContinuousCollisionComparison(unsigned int segments, const planning_scene::PlanningScene* scene,
+                                      const moveit::core::RobotState& start_state)
+{
+  const double tolerance = 0.01;
+  collision_detection::CollisionEnvFCL env(scene->getRobotModel(),
+                                           std::make_shared<collision_detection::World>(*scene->getWorld()));
+  env.setContinuousCollisionTolerance(tolerance);
+  const collision_detection::AllowedCollisionMatrix& acm = scene->getAllowedCollisionMatrix();
+  collision_detection::CollisionRequest req;
+
+  std::vector<moveit::core::RobotState> goals(segments, start_state);
+  for (moveit::core::RobotState& goal : goals)
+  {
+    goal.setToRandomPositions();
+    goal.update();
+  }
+
+  unsigned int discrete_checks = 0;
+  unsigned int discrete_collisions = 0;
+  moveit::core::RobotState state(start_state);
+  ros::WallTime start = ros::WallTime::now();
+  for (const moveit::core::RobotState& goal : goals)
+  {
+    const unsigned int steps = std::max(1.0, std::ceil(env.getMotionBound(start_state, goal) / tolerance));
+    for (unsigned int i = 0; i <= steps; ++i)
+    {
+      start_state.interpolate(goal, (double)i / steps, state);
+      state.update();
+      collision_detection::CollisionResult res;
+      env.checkRobotCollision(req, res, state, acm);
+      ++discrete_checks;
+      if (res.collision)
+      {
+        ++discrete_collisions;
+        break;
+      }
+    }
+  }
+  double duration = (ros::WallTime::now() - start).toSec();
+  ROS_INFO("Dense sampling: %lf segments per second, %u discrete checks, %u segments in collision",
+           (double)segments / duration, discrete_checks, discrete_collisions);
+
+  unsigned int continuous_collisions = 0;
+  start = ros::WallTime::now();
+  for (const moveit::core::RobotState& goal : goals)
+  {
+    collision_detection::CollisionResult res;
+    env.checkRobotCollision(req, res, start_state, goal, acm);
+    if (res.collision)
+      ++continuous_collisions;
+  }
+  duration = (ros::WallTime::now() - start).toSec();
+  ROS_INFO("Continuous checking: %lf segments per second, %u segments in collision", (double)segments / duration,
+           continuous_collisions);
+}
+
 int main(int argc, char** argv)
 {
   ros::init(argc, argv, "evaluate_collision_checking_speed");
@@ -125,6 +221,12 @@ int main(int argc, char** argv)
       threads[i]->join();
       delete threads[i];
     }
+
+    if (!states.empty())
+    {
+      runBroadPhaseComparison(trials, psm.getPlanningScene().get(), *states[0]);
+      runContinuousCollisionComparison(100, psm.getPlanningScene().get(), *states[0]);
+    }
   }
   else
     ROS_ERROR("Planning scene not configured");
@@ -0,0 +1,181 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, MoveIt maintainers
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/planning_scene_monitor/current_state_monitor.h>
+#include <moveit/planning_scene_monitor/planning_scene_monitor.h>
+#include <moveit/robot_model_loader/robot_model_loader.h>
+#include <ros/callback_queue.h>
+#include <boost/program_options/parsers.hpp>
+#include <boost/program_options/variables_map.hpp>
+#include <algorithm>
+#include <random>
+
+static const std::string ROBOT_DESCRIPTION = "robot_description";
+static const std::string TOPIC = "evaluate_current_state_monitor_speed/joint_states";
+
+// Continuously copies the current state, as planners and the planning scene monitor do
+void runReader(const planning_scene_monitor::CurrentStateMonitor& csm, const std::atomic<bool>& done,
+               std::atomic<std::size_t>& reads)
+{
+  moveit::core::RobotState state(csm.getRobotModel());
+  std::size_t count = 0;
+  while (!done)
+  {
+    csm.setToCurrentState(state);
+    ++count;
+  }
+  reads += count;
+}
+
+int main(int argc, char** argv)
+{
+  ros::init(argc, argv, "evaluate_current_state_monitor_speed");
+
+  unsigned int nmessages = 10000;
+  unsigned int nreaders = 2;
+  boost::program_options::options_description desc;
+  desc.add_options()("messages", boost::program_options::value<unsigned int>(&nmessages)->default_value(nmessages),
+                     "Number of joint state messages per run")(
+      "readers", boost::program_options::value<unsigned int>(&nreaders)->default_value(nreaders),
+      "Number of threads that concurrently copy the current state")("help", "this screen");
+  boost::program_options::variables_map vm;
+  boost::program_options::parsed_options po = boost::program_options::parse_command_line(argc, argv, desc);
+  boost::program_options::store(po, vm);
+  boost::program_options::notify(vm);
+
+  if (vm.count("help"))
+  {
+    std::cout << desc << std::endl;
+    return 0;
+  }
+
+  ros::AsyncSpinner spinner(1);
+  spinner.start();
+
+  robot_model_loader::RobotModelLoader rml(ROBOT_DESCRIPTION);
+  moveit::core::RobotModelConstPtr robot_model = rml.getModel();
+  if (!robot_model)
+  {
+    ROS_ERROR("Unable to load robot model");
+    return 1;
+  }
+
+  // joint state callbacks go to a private queue, so they can be executed (and timed) one by one
+  ros::CallbackQueue queue;
+  ros::NodeHandle nh;
+  nh.setCallbackQueue(&queue);
+  planning_scene_monitor::CurrentStateMonitor csm(robot_model, std::shared_ptr<tf2_ros::Buffer>(), nh);
+  csm.startStateMonitor(TOPIC);
+  ros::Publisher pub = ros::NodeHandle().advertise<sensor_msgs::JointState>(TOPIC, 1);
+  while (pub.getNumSubscribers() == 0 && ros::ok())
+    ros::WallDuration(0.01).sleep();
+
+  std::vector<const moveit::core::JointModel*> joints;
+  for (const moveit::core::JointModel* joint : robot_model->getActiveJointModels())
+    if (joint->getVariableCount() == 1 && !joint->getMimic())
+      joints.push_back(joint);
+
+  std::mt19937 generator;
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+  std::cout << "Evaluating joint state callbacks of model '" << robot_model->getName() << "' with " << joints.size()
+            << " joints using " << nmessages << " messages per run" << std::endl;
+
+  for (bool shuffle : { false, true })
+    for (unsigned int readers : { 0u, nreaders })
+    {
+      planning_scene_monitor::LatencyHistogram callback_latency;
+      std::atomic<bool> done(false);
+      std::atomic<std::size_t> reads(0);
+      std::vector<std::unique_ptr<boost::thread>> threads;
+      for (unsigned int i = 0; i < readers; ++i)
+        threads.emplace_back(
+            new boost::thread(boost::bind(&runReader, boost::cref(csm), boost::cref(done), boost::ref(reads))));
+
+      ros::WallTime start = ros::WallTime::now();
+      for (unsigned int i = 0; i < nmessages && ros::ok(); ++i)
+      {
+        // messages are published as shared pointers, so no serialization is involved
+        sensor_msgs::JointStatePtr msg(new sensor_msgs::JointState());
+        msg->header.stamp = ros::Time::now();
+        for (const moveit::core::JointModel* joint : joints)
+        {
+          const moveit::core::VariableBounds& bounds = joint->getVariableBounds()[0];
+          msg->name.push_back(joint->getName());
+          msg->position.push_back(bounds.position_bounded_ ?
+                                      bounds.min_position_ +
+                                          uniform(generator) * (bounds.max_position_ - bounds.min_position_) :
+                                      uniform(generator));
+        }
+        // a different joint order in every message defeats the cached message layout
+        if (shuffle)
+        {
+          std::vector<std::size_t> order(joints.size());
+          for (std::size_t j = 0; j < order.size(); ++j)
+            order[j] = j;
+          std::shuffle(order.begin(), order.end(), generator);
+          sensor_msgs::JointState shuffled = *msg;
+          for (std::size_t j = 0; j < order.size(); ++j)
+          {
+            msg->name[j] = shuffled.name[order[j]];
+            msg->position[j] = shuffled.position[order[j]];
+          }
+        }
+        pub.publish(msg);
+
+        while (queue.isEmpty() && ros::ok())
+          boost::this_thread::yield();
+        ros::WallTime callback_start = ros::WallTime::now();
+        queue.callOne();
+        callback_latency.add(ros::WallTime::now() - callback_start);
+      }
+      double elapsed = (ros::WallTime::now() - start).toSec();
+
+      done = true;
+      for (std::unique_ptr<boost::thread>& thread : threads)
+        thread->join();
+
+      std::cout << std::endl
+                << (shuffle ? "Changing" : "Constant") << " message layout, " << readers
+                << " concurrent readers:" << std::endl;
+      std::cout << "Joint state callback: median < " << callback_latency.getPercentile(0.5) * 1e6
+                << " us, 99th percentile < " << callback_latency.getPercentile(0.99) * 1e6 << " us, max < "
+                << callback_latency.getPercentile(1.0) * 1e6 << " us" << std::endl;
+      callback_latency.print(std::cout);
+      if (readers > 0)
+        std::cout << "setToCurrentState(): " << reads / elapsed << " calls/s across all readers" << std::endl;
+    }
+
+  csm.stopStateMonitor();
+  return 0;
+}
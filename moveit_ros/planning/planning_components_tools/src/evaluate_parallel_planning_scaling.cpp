@@ -0,0 +1,209 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, MoveIt maintainers
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+// Measures how the time to the first solution of a planner plugin scales with the number of planning threads.
+// Each request asks for as many planning attempts as there are threads, so all threads race on the same problem.
+// The planner configuration is read from the private namespace of the node, as for move_group, e.g.
+//   rosrun moveit_ros_planning moveit_evaluate_parallel_planning_scaling --group panda_arm
+//     __ns:=/move_group _planning_plugin:=ompl_interface/OMPLPlanner
+// For the OMPL plugin, hybridization of the solutions is disabled so that planning stops at the first solution.
+
+#include <moveit/planning_pipeline/planning_pipeline.h>
+#include <moveit/planning_scene_monitor/planning_scene_monitor.h>
+#include <moveit/kinematic_constraints/utils.h>
+#include <moveit/robot_state/conversions.h>
+#include <boost/program_options/parsers.hpp>
+#include <boost/program_options/variables_map.hpp>
+#include <tf2_eigen/tf2_eigen.h>
+#include <algorithm>
+#include <thread>
+
+static const std::string ROBOT_DESCRIPTION = "robot_description";
+
+struct Request
+{
+  moveit::core::RobotStatePtr start_;
+  moveit::core::RobotStatePtr goal_;
+};
+
+// Sample collision free start and goal states for the group
+std::vector<Request> sampleRequests(const planning_scene::PlanningScene& scene,
+                                    const moveit::core::JointModelGroup* jmg, unsigned int count)
+{
+  std::vector<Request> requests;
+  moveit::core::RobotState state(scene.getCurrentState());
+  unsigned int attempts = 0;
+  while (requests.size() < count && attempts++ < 1000 * count)
+  {
+    Request request;
+    for (moveit::core::RobotStatePtr* sample : { &request.start_, &request.goal_ })
+    {
+      state.setToRandomPositions(jmg);
+      state.update();
+      if (scene.isStateValid(state, jmg->getName()))
+        sample->reset(new moveit::core::RobotState(state));
+    }
+    if (request.start_ && request.goal_)
+      requests.push_back(request);
+  }
+  return requests;
+}
+
+int main(int argc, char** argv)
+{
+  ros::init(argc, argv, "evaluate_parallel_planning_scaling");
+
+  std::string group;
+  std::string planner_id;
+  unsigned int max_threads = std::max(1u, std::thread::hardware_concurrency());
+  unsigned int nrequests = 20;
+  double timeout = 10.0;
+  bool joint_goals = false;
+  boost::program_options::options_description desc;
+  desc.add_options()("group", boost::program_options::value<std::string>(&group), "Planning group")(
+      "planner_id", boost::program_options::value<std::string>(&planner_id)->default_value(planner_id),
+      "Planner configuration to use")(
+      "max_threads", boost::program_options::value<unsigned int>(&max_threads)->default_value(max_threads),
+      "Largest number of planning threads to evaluate")(
+      "requests", boost::program_options::value<unsigned int>(&nrequests)->default_value(nrequests),
+      "Number of planning requests per thread count")(
+      "timeout", boost::program_options::value<double>(&timeout)->default_value(timeout),
+      "Allowed planning time per request (seconds)")("joint_goals", "Use joint space goals instead of pose goals")(
+      "help", "this screen");
+  boost::program_options::variables_map vm;
+  boost::program_options::parsed_options po = boost::program_options::parse_command_line(argc, argv, desc);
+  boost::program_options::store(po, vm);
+  boost::program_options::notify(vm);
+  joint_goals = vm.count("joint_goals") > 0;
+
+  if (vm.count("help") || group.empty())
+  {
+    std::cout << desc << std::endl;
+    return 0;
+  }
+
+  ros::AsyncSpinner spinner(1);
+  spinner.start();
+  ros::NodeHandle nh("~");
+
+  planning_scene_monitor::PlanningSceneMonitorPtr psm(
+      new planning_scene_monitor::PlanningSceneMonitor(ROBOT_DESCRIPTION));
+  if (!psm->getPlanningScene())
+  {
+    ROS_ERROR("Planning scene not configured");
+    return 1;
+  }
+  // plan in the scene of a running move_group, if there is one
+  psm->requestPlanningSceneState();
+  planning_scene::PlanningScenePtr scene = planning_scene::PlanningScene::clone(psm->getPlanningScene());
+  const moveit::core::JointModelGroup* jmg = scene->getRobotModel()->getJointModelGroup(group);
+  if (!jmg)
+  {
+    ROS_ERROR("Unknown planning group '%s'", group.c_str());
+    return 1;
+  }
+
+  // allow the OMPL plugin to use as many threads as are evaluated
+  nh.setParam("ompl/max_planning_threads", static_cast<int>(max_threads));
+  planning_pipeline::PlanningPipeline pipeline(scene->getRobotModel(), nh);
+  const planning_interface::PlannerManagerPtr& planner = pipeline.getPlannerManager();
+  if (!planner)
+  {
+    ROS_ERROR("No planning plugin loaded");
+    return 1;
+  }
+  planning_interface::PlannerConfigurationMap configs = planner->getPlannerConfigurations();
+  for (auto& config : configs)
+    if (config.second.group == group)
+      config.second.config["hybridize"] = "0";
+  planner->setPlannerConfigurations(configs);
+
+  std::vector<Request> requests = sampleRequests(*scene, jmg, nrequests);
+  if (requests.size() < nrequests)
+    ROS_WARN("Only found %zu valid start and goal states", requests.size());
+
+  std::vector<unsigned int> thread_counts;
+  for (unsigned int n = 1; n < max_threads; n *= 2)
+    thread_counts.push_back(n);
+  thread_counts.push_back(max_threads);
+
+  std::cout << "threads\tsolved\tmean (s)\tmedian (s)\tspeedup" << std::endl;
+  double single_thread_median = 0.0;
+  for (unsigned int threads : thread_counts)
+  {
+    std::vector<double> times;
+    for (const Request& request : requests)
+    {
+      planning_interface::MotionPlanRequest req;
+      req.group_name = group;
+      req.planner_id = planner_id;
+      req.allowed_planning_time = timeout;
+      req.num_planning_attempts = threads;
+      moveit::core::robotStateToRobotStateMsg(*request.start_, req.start_state);
+      if (joint_goals)
+        req.goal_constraints.push_back(kinematic_constraints::constructGoalConstraints(*request.goal_, jmg));
+      else
+      {
+        const moveit::core::LinkModel* tip = jmg->getLinkModels().back();
+        geometry_msgs::PoseStamped pose;
+        pose.header.frame_id = scene->getPlanningFrame();
+        pose.pose = tf2::toMsg(request.goal_->getGlobalLinkTransform(tip));
+        req.goal_constraints.push_back(kinematic_constraints::constructGoalConstraints(tip->getName(), pose));
+      }
+
+      moveit_msgs::MoveItErrorCodes error_code;
+      planning_interface::PlanningContextPtr context = planner->getPlanningContext(scene, req, error_code);
+      planning_interface::MotionPlanDetailedResponse res;
+      if (context && context->solve(res) && !res.processing_time_.empty())
+        times.push_back(res.processing_time_.front());
+    }
+
+    double mean = 0.0;
+    double median = 0.0;
+    if (!times.empty())
+    {
+      for (double time : times)
+        mean += time;
+      mean /= times.size();
+      std::nth_element(times.begin(), times.begin() + times.size() / 2, times.end());
+      median = times[times.size() / 2];
+    }
+    if (threads == 1)
+      single_thread_median = median;
+    std::cout << threads << "\t" << times.size() << "/" << requests.size() << "\t" << mean << "\t" << median << "\t"
+              << (median > 0.0 ? single_thread_median / median : 0.0) << std::endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,187 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, MoveIt maintainers
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/planning_scene_monitor/planning_scene_monitor.h>
+#include <boost/program_options/parsers.hpp>
+#include <boost/program_options/variables_map.hpp>
+#include <random>
+
+static const std::string ROBOT_DESCRIPTION = "robot_description";
+
+// Moves the robot at a fixed rate, as a joint state monitor would do, and records how long each update takes
+// until it is visible to readers
+void runStateUpdates(const planning_scene_monitor::PlanningSceneMonitorPtr& psm, double rate,
+                     const std::atomic<bool>& done, planning_scene_monitor::LatencyHistogram& latency)
+{
+  std::mt19937 generator;
+  std::normal_distribution<double> step(0.0, 0.001);
+  ros::WallRate loop(rate);
+  while (!done)
+  {
+    ros::WallTime start = ros::WallTime::now();
+    {
+      planning_scene_monitor::LockedPlanningSceneRW scene(psm);
+      moveit::core::RobotState& state = scene->getCurrentStateNonConst();
+      for (const moveit::core::JointModel* joint : state.getRobotModel()->getActiveJointModels())
+        if (joint->getVariableCount() == 1)
+        {
+          const double value = state.getJointPositions(joint)[0] + step(generator);
+          state.setJointPositions(joint, &value);
+          state.enforceBounds(joint);
+        }
+      state.update();
+    }
+    psm->triggerSceneUpdateEvent(planning_scene_monitor::PlanningSceneMonitor::UPDATE_STATE);
+    latency.add(ros::WallTime::now() - start);
+    loop.sleep();
+  }
+}
+
+// Repeatedly gets hold of the scene and keeps it for the given time while checking collisions, as a planner would
+void runPlanner(const planning_scene_monitor::PlanningSceneMonitorPtr& psm, bool use_snapshots, double hold_time,
+                const std::atomic<bool>& done, planning_scene_monitor::LatencyHistogram& latency)
+{
+  collision_detection::CollisionRequest req;
+  while (!done)
+  {
+    ros::WallTime start = ros::WallTime::now();
+    if (use_snapshots)
+    {
+      planning_scene::PlanningSceneConstPtr scene = psm->getSceneSnapshot();
+      latency.add(ros::WallTime::now() - start);
+      moveit::core::RobotState state(scene->getCurrentState());
+      while ((ros::WallTime::now() - start).toSec() < hold_time)
+      {
+        collision_detection::CollisionResult res;
+        state.setToRandomPositions();
+        state.update();
+        scene->checkCollision(req, res, state);
+      }
+    }
+    else
+    {
+      planning_scene_monitor::LockedPlanningSceneRO scene(psm);
+      latency.add(ros::WallTime::now() - start);
+      moveit::core::RobotState state(scene->getCurrentState());
+      while ((ros::WallTime::now() - start).toSec() < hold_time)
+      {
+        collision_detection::CollisionResult res;
+        state.setToRandomPositions();
+        state.update();
+        scene->checkCollision(req, res, state);
+      }
+    }
+  }
+}
+
+void printHistogram(const std::string& name, const planning_scene_monitor::LatencyHistogram& histogram)
+{
+  std::cout << name << ": " << histogram.getCount() << " samples, median < " << histogram.getPercentile(0.5) * 1e6
+            << " us, 99th percentile < " << histogram.getPercentile(0.99) * 1e6 << " us, max < "
+            << histogram.getPercentile(1.0) * 1e6 << " us" << std::endl;
+  histogram.print(std::cout);
+}
+
+int main(int argc, char** argv)
+{
+  ros::init(argc, argv, "evaluate_scene_snapshot_latency");
+
+  unsigned int nreaders = 2;
+  double duration = 5.0;
+  double rate = 1000.0;
+  double hold_time = 0.1;
+  boost::program_options::options_description desc;
+  desc.add_options()("readers", boost::program_options::value<unsigned int>(&nreaders)->default_value(nreaders),
+                     "Number of threads that read the planning scene")(
+      "duration", boost::program_options::value<double>(&duration)->default_value(duration),
+      "Duration of each run (seconds)")("rate", boost::program_options::value<double>(&rate)->default_value(rate),
+                                        "Rate of the robot state updates (Hz)")(
+      "hold", boost::program_options::value<double>(&hold_time)->default_value(hold_time),
+      "Time each reader keeps the planning scene (seconds)")("help", "this screen");
+  boost::program_options::variables_map vm;
+  boost::program_options::parsed_options po = boost::program_options::parse_command_line(argc, argv, desc);
+  boost::program_options::store(po, vm);
+  boost::program_options::notify(vm);
+
+  if (vm.count("help"))
+  {
+    std::cout << desc << std::endl;
+    return 0;
+  }
+
+  ros::AsyncSpinner spinner(1);
+  spinner.start();
+
+  planning_scene_monitor::PlanningSceneMonitorPtr psm(
+      new planning_scene_monitor::PlanningSceneMonitor(ROBOT_DESCRIPTION));
+  if (!psm->getPlanningScene())
+  {
+    ROS_ERROR("Planning scene not configured");
+    return 1;
+  }
+
+  for (bool use_snapshots : { false, true })
+  {
+    psm->enableSceneSnapshots(use_snapshots);
+    planning_scene_monitor::LatencyHistogram update_latency;
+    std::vector<std::unique_ptr<planning_scene_monitor::LatencyHistogram>> read_latency(nreaders);
+    std::atomic<bool> done(false);
+
+    boost::thread writer(
+        boost::bind(&runStateUpdates, psm, rate, boost::cref(done), boost::ref(update_latency)));
+    std::vector<std::unique_ptr<boost::thread>> readers;
+    for (std::unique_ptr<planning_scene_monitor::LatencyHistogram>& latency : read_latency)
+    {
+      latency.reset(new planning_scene_monitor::LatencyHistogram());
+      readers.emplace_back(new boost::thread(
+          boost::bind(&runPlanner, psm, use_snapshots, hold_time, boost::cref(done), boost::ref(*latency))));
+    }
+
+    ros::WallDuration(duration).sleep();
+    done = true;
+    writer.join();
+    for (std::unique_ptr<boost::thread>& reader : readers)
+      reader->join();
+
+    std::cout << std::endl << (use_snapshots ? "Scene snapshots" : "Locked planning scene") << ", " << nreaders
+              << " readers, state updates at " << rate << " Hz:" << std::endl;
+    printHistogram("State update until visible to readers", update_latency);
+    for (std::size_t i = 0; i < read_latency.size(); ++i)
+      printHistogram("Scene access of reader " + std::to_string(i), *read_latency[i]);
+    if (use_snapshots)
+      printHistogram("Snapshot publication", psm->getSnapshotPublishLatency());
+  }
+
+  return 0;
+}
@@ -36,6 +36,7 @@
 
 #include <moveit/robot_model_loader/robot_model_loader.h>
 #include <moveit/robot_state/robot_state.h>
+#include <moveit/robot_state/robot_state_batch.h>
 #include <moveit/profiler/profiler.h>
 #include <ros/ros.h>
 
@@ -80,6 +81,27 @@ int main(int argc, char** argv)
       moveit::tools::Profiler::End("FK Random");
     }
 
+    printf("Evaluating FK Batch ...\n");
+    {
+      // compare FK for N random states computed one state at a time vs. all at once
+      moveit::core::RobotStateBatch batch(robot_model, N);
+      std::vector<moveit::core::RobotState> states(N, state);
+      for (int i = 0; i < N; ++i)
+      {
+        states[i].setToRandomPositions();
+        batch.setVariablePositions(i, states[i]);
+      }
+
+      moveit::tools::Profiler::Begin("FK Batch: per state");
+      for (moveit::core::RobotState& s : states)
+        s.updateLinkTransforms();
+      moveit::tools::Profiler::End("FK Batch: per state");
+
+      moveit::tools::Profiler::Begin("FK Batch: batched");
+      batch.updateLinkTransforms();
+      moveit::tools::Profiler::End("FK Batch: batched");
+    }
+
     std::vector<moveit::core::RobotState*> copies(N, (moveit::core::RobotState*)nullptr);
     printf("Evaluating Copy State ...\n");
     for (int i = 0; i < N; ++i)
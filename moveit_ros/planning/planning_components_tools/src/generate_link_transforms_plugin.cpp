@@ -0,0 +1,498 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, MoveIt maintainers
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Generates a moveit::core::LinkTransformsPlugin for the robot loaded from the parameter server:
+   one straight-line forward kinematics function per planning group (starting at the group's common root joint)
+   and one for the whole robot. Joint origins and axes are compiled in as constants, so identity rotations,
+   zero offsets and axis-aligned joints fold away instead of being multiplied at runtime. */
+
+#include <moveit/robot_model_loader/robot_model_loader.h>
+#include <ros/ros.h>
+#include <boost/algorithm/string/replace.hpp>
+#include <cctype>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <set>
+#include <sstream>
+
+static const std::string ROBOT_DESCRIPTION = "robot_description";
+
+namespace
+{
+/* Entries this close to 0 or +-1 are folded to the exact value */
+constexpr double FOLD_EPSILON = 1e-15;
+
+/** \brief A scalar of the generated code: either a numeric constant or a C++ expression */
+struct Expr
+{
+  bool constant;
+  double value;
+  std::string code;
+  bool atomic;  // code can be used as an operand without parentheses
+};
+
+Expr constant(double value)
+{
+  if (std::fabs(value) < FOLD_EPSILON)
+    value = 0.0;
+  else if (std::fabs(value - 1.0) < FOLD_EPSILON)
+    value = 1.0;
+  else if (std::fabs(value + 1.0) < FOLD_EPSILON)
+    value = -1.0;
+  return Expr{ true, value, "", true };
+}
+
+Expr symbol(const std::string& code)
+{
+  return Expr{ false, 0.0, code, true };
+}
+
+Expr compound(const std::string& code)
+{
+  return Expr{ false, 0.0, code, false };
+}
+
+std::string literal(double value)
+{
+  std::ostringstream ss;
+  ss << std::setprecision(17) << value;
+  std::string s = ss.str();
+  if (s.find_first_of(".e") == std::string::npos)
+    s += ".0";
+  return value < 0.0 ? "(" + s + ")" : s;
+}
+
+std::string str(const Expr& e)
+{
+  return e.constant ? literal(e.value) : e.code;
+}
+
+std::string operand(const Expr& e)
+{
+  return e.atomic ? str(e) : "(" + e.code + ")";
+}
+
+Expr operator*(const Expr& a, const Expr& b)
+{
+  if (a.constant && b.constant)
+    return constant(a.value * b.value);
+  if ((a.constant && a.value == 0.0) || (b.constant && b.value == 0.0))
+    return constant(0.0);
+  if (a.constant && a.value == 1.0)
+    return b;
+  if (b.constant && b.value == 1.0)
+    return a;
+  if (a.constant && a.value == -1.0)
+    return compound("-" + operand(b));
+  if (b.constant && b.value == -1.0)
+    return compound("-" + operand(a));
+  return compound(operand(a) + " * " + operand(b));
+}
+
+Expr operator+(const Expr& a, const Expr& b)
+{
+  if (a.constant && b.constant)
+    return constant(a.value + b.value);
+  if (a.constant && a.value == 0.0)
+    return b;
+  if (b.constant && b.value == 0.0)
+    return a;
+  return compound(str(a) + " + " + str(b));
+}
+
+/** \brief A symbolic rigid transform: the 3x3 rotation in column-major order, followed by the translation */
+struct Transform
+{
+  Expr e[12];
+
+  Expr& rot(int row, int col)
+  {
+    return e[3 * col + row];
+  }
+  const Expr& rot(int row, int col) const
+  {
+    return e[3 * col + row];
+  }
+  Expr& trans(int row)
+  {
+    return e[9 + row];
+  }
+  const Expr& trans(int row) const
+  {
+    return e[9 + row];
+  }
+};
+
+Transform constantTransform(const Eigen::Isometry3d& t)
+{
+  Transform result;
+  for (int r = 0; r < 3; ++r)
+  {
+    for (int c = 0; c < 3; ++c)
+      result.rot(r, c) = constant(t.linear()(r, c));
+    result.trans(r) = constant(t.translation()(r));
+  }
+  return result;
+}
+
+Transform operator*(const Transform& a, const Transform& b)
+{
+  Transform result;
+  for (int r = 0; r < 3; ++r)
+  {
+    for (int c = 0; c < 3; ++c)
+      result.rot(r, c) = a.rot(r, 0) * b.rot(0, c) + a.rot(r, 1) * b.rot(1, c) + a.rot(r, 2) * b.rot(2, c);
+    result.trans(r) = a.rot(r, 0) * b.trans(0) + a.rot(r, 1) * b.trans(1) + a.rot(r, 2) * b.trans(2) + a.trans(r);
+  }
+  return result;
+}
+
+/** \brief Emit local variables for all compound entries of \e t, so they are evaluated only once */
+void materialize(Transform& t, const std::string& name, std::ostream& out)
+{
+  for (int i = 0; i < 12; ++i)
+    if (!t.e[i].atomic)
+    {
+      const std::string var = name + "_" + std::to_string(i);
+      out << "  const double " << var << " = " << t.e[i].code << ";\n";
+      t.e[i] = symbol(var);
+    }
+}
+
+std::string position(int index)
+{
+  return "q[" + std::to_string(index) + "]";
+}
+
+/** \brief Emit the code for the local transform of \e joint and return it symbolically */
+Transform jointTransform(const moveit::core::JointModel* joint, std::ostream& out)
+{
+  Transform t = constantTransform(Eigen::Isometry3d::Identity());
+  const int vi = joint->getFirstVariableIndex();
+  const std::string id = std::to_string(joint->getJointIndex());
+  switch (joint->getType())
+  {
+    case moveit::core::JointModel::REVOLUTE:
+    {
+      const Eigen::Vector3d& axis = static_cast<const moveit::core::RevoluteJointModel*>(joint)->getAxis();
+      out << "  const double c" << id << " = std::cos(" << position(vi) << ");\n";
+      out << "  const double s" << id << " = std::sin(" << position(vi) << ");\n";
+      const Expr c = symbol("c" + id), s = symbol("s" + id);
+
+      // axis-aligned joints only need cos and sin; the rotation about axis i leaves entry (i, i) at 1
+      int aligned = -1;
+      for (int i = 0; i < 3; ++i)
+        if (std::fabs(std::fabs(axis(i)) - 1.0) < FOLD_EPSILON)
+          aligned = i;
+      Expr one_minus_c = constant(0.0);
+      if (aligned < 0)
+      {
+        out << "  const double t" << id << " = 1.0 - c" << id << ";\n";
+        one_minus_c = symbol("t" + id);
+      }
+      const double x = axis.x(), y = axis.y(), z = axis.z();
+      // same closed form as RevoluteJointModel::computeTransform()
+      t.rot(0, 0) = one_minus_c * constant(x * x) + c;
+      t.rot(1, 0) = one_minus_c * constant(x * y) + s * constant(z);
+      t.rot(2, 0) = one_minus_c * constant(x * z) + s * constant(-y);
+      t.rot(0, 1) = one_minus_c * constant(x * y) + s * constant(-z);
+      t.rot(1, 1) = one_minus_c * constant(y * y) + c;
+      t.rot(2, 1) = one_minus_c * constant(y * z) + s * constant(x);
+      t.rot(0, 2) = one_minus_c * constant(x * z) + s * constant(y);
+      t.rot(1, 2) = one_minus_c * constant(y * z) + s * constant(-x);
+      t.rot(2, 2) = one_minus_c * constant(z * z) + c;
+      if (aligned >= 0)
+        t.rot(aligned, aligned) = constant(1.0);
+      break;
+    }
+    case moveit::core::JointModel::PRISMATIC:
+    {
+      const Eigen::Vector3d& axis = static_cast<const moveit::core::PrismaticJointModel*>(joint)->getAxis();
+      for (int r = 0; r < 3; ++r)
+        t.trans(r) = constant(axis(r)) * symbol(position(vi));
+      break;
+    }
+    case moveit::core::JointModel::PLANAR:
+    {
+      // same as PlanarJointModel::computeTransform()
+      out << "  const double c" << id << " = std::cos(" << position(vi + 2) << ");\n";
+      out << "  const double s" << id << " = std::sin(" << position(vi + 2) << ");\n";
+      const Expr c = symbol("c" + id), s = symbol("s" + id);
+      t.rot(0, 0) = c;
+      t.rot(1, 0) = s;
+      t.rot(0, 1) = s * constant(-1.0);
+      t.rot(1, 1) = c;
+      t.trans(0) = symbol(position(vi));
+      t.trans(1) = symbol(position(vi + 1));
+      break;
+    }
+    case moveit::core::JointModel::FLOATING:
+    {
+      // same as FloatingJointModel::computeTransform(): normalized quaternion (x, y, z, w) to rotation matrix
+      const std::string qx = position(vi + 3), qy = position(vi + 4), qz = position(vi + 5), qw = position(vi + 6);
+      out << "  const double n" << id << " = 1.0 / std::sqrt(" << qx << " * " << qx << " + " << qy << " * " << qy
+          << " + " << qz << " * " << qz << " + " << qw << " * " << qw << ");\n";
+      out << "  const double x" << id << " = " << qx << " * n" << id << ", y" << id << " = " << qy << " * n" << id
+          << ", z" << id << " = " << qz << " * n" << id << ", w" << id << " = " << qw << " * n" << id << ";\n";
+      const std::string x = "x" + id, y = "y" + id, z = "z" + id, w = "w" + id;
+      t.rot(0, 0) = compound("1.0 - 2.0 * (" + y + " * " + y + " + " + z + " * " + z + ")");
+      t.rot(1, 0) = compound("2.0 * (" + x + " * " + y + " + " + z + " * " + w + ")");
+      t.rot(2, 0) = compound("2.0 * (" + x + " * " + z + " - " + y + " * " + w + ")");
+      t.rot(0, 1) = compound("2.0 * (" + x + " * " + y + " - " + z + " * " + w + ")");
+      t.rot(1, 1) = compound("1.0 - 2.0 * (" + x + " * " + x + " + " + z + " * " + z + ")");
+      t.rot(2, 1) = compound("2.0 * (" + y + " * " + z + " + " + x + " * " + w + ")");
+      t.rot(0, 2) = compound("2.0 * (" + x + " * " + z + " + " + y + " * " + w + ")");
+      t.rot(1, 2) = compound("2.0 * (" + y + " * " + z + " - " + x + " * " + w + ")");
+      t.rot(2, 2) = compound("1.0 - 2.0 * (" + x + " * " + x + " + " + y + " * " + y + ")");
+      for (int r = 0; r < 3; ++r)
+        t.trans(r) = symbol(position(vi + r));
+      break;
+    }
+    default:  // fixed
+      break;
+  }
+  return t;
+}
+
+/** \brief Emit a function computing the global transforms of all links below \e start */
+void generateFunction(const moveit::core::JointModel* start, const std::string& function_name, std::ostream& out)
+{
+  out << "// links below joint '" << start->getName() << "'\n";
+  out << "void " << function_name << "(const double* q, Eigen::Isometry3d* global_link_transforms)\n{\n";
+
+  std::map<const moveit::core::LinkModel*, Transform> computed;
+  const moveit::core::LinkModel* start_parent = start->getParentLinkModel();
+  if (start_parent)
+  {
+    // the transform of the parent link is computed already, read it from memory (column-major 4x4)
+    out << "  const double* p = global_link_transforms[" << start_parent->getLinkIndex() << "].data();\n";
+    Transform& p = computed[start_parent];
+    for (int r = 0; r < 3; ++r)
+    {
+      for (int c = 0; c < 3; ++c)
+        p.rot(r, c) = symbol("p[" + std::to_string(4 * c + r) + "]");
+      p.trans(r) = symbol("p[" + std::to_string(12 + r) + "]");
+    }
+  }
+
+  for (const moveit::core::LinkModel* link : start->getDescendantLinkModels())
+  {
+    const moveit::core::JointModel* joint = link->getParentJointModel();
+    const std::string id = std::to_string(link->getLinkIndex());
+    out << "\n  // link '" << link->getName() << "', joint '" << joint->getName() << "'\n";
+
+    const moveit::core::LinkModel* parent = link->getParentLinkModel();
+    Transform global = parent ? computed.at(parent) : constantTransform(Eigen::Isometry3d::Identity());
+    global = global * constantTransform(link->getJointOriginTransform());
+    if (joint->getType() != moveit::core::JointModel::FIXED)
+    {
+      materialize(global, "o" + id, out);
+      Transform local = jointTransform(joint, out);
+      materialize(local, "j" + std::to_string(joint->getJointIndex()), out);
+      global = global * local;
+    }
+    materialize(global, "l" + id, out);
+
+    out << "  {\n    double* d = global_link_transforms[" << id << "].data();\n";
+    for (int c = 0; c < 3; ++c)
+      for (int r = 0; r < 3; ++r)
+        out << "    d[" << 4 * c + r << "] = " << str(global.rot(r, c)) << ";\n";
+    for (int r = 0; r < 3; ++r)
+      out << "    d[" << 12 + r << "] = " << str(global.trans(r)) << ";\n";
+    out << "  }\n";
+    computed[link] = global;
+  }
+  out << "}\n\n";
+}
+
+std::string identifier(const std::string& name)
+{
+  std::string result;
+  for (char c : name)
+    result += std::isalnum(static_cast<unsigned char>(c)) ? c : '_';
+  if (result.empty() || std::isdigit(static_cast<unsigned char>(result[0])))
+    result = "_" + result;
+  return result;
+}
+
+std::string quoted(const std::string& s)
+{
+  return "\"" + boost::replace_all_copy(boost::replace_all_copy(s, "\\", "\\\\"), "\"", "\\\"") + "\"";
+}
+
+void generatePlugin(const moveit::core::RobotModel& model, const std::string& ns, std::ostream& out)
+{
+  out << "// Generated by moveit_generate_link_transforms_plugin for robot '" << model.getName() << "'.\n"
+      << "// Do not edit: regenerate whenever the robot description changes.\n\n"
+      << "#include <moveit/robot_model/link_transforms_plugin.h>\n"
+      << "#include <pluginlib/class_list_macros.hpp>\n"
+      << "#include <cmath>\n\n"
+      << "namespace " << ns << "\n{\nnamespace\n{\n";
+
+  // one function for the whole model and one for the common root of every group
+  std::vector<const moveit::core::JointModel*> starts(1, model.getRootJoint());
+  std::set<const moveit::core::JointModel*> seen(starts.begin(), starts.end());
+  for (const moveit::core::JointModelGroup* jmg : model.getJointModelGroups())
+    if (jmg->getCommonRoot() && seen.insert(jmg->getCommonRoot()).second)
+      starts.push_back(jmg->getCommonRoot());
+  for (const moveit::core::JointModel* start : starts)
+    generateFunction(start, "computeLinkTransforms_" + identifier(start->getName()), out);
+
+  // the model the functions were generated for, checked when the plugin is initialized
+  const std::vector<const moveit::core::LinkModel*>& links = model.getLinkModels();
+  out << "const char* const LINK_NAMES[] = {\n";
+  for (const moveit::core::LinkModel* link : links)
+    out << "  " << quoted(link->getName()) << ",\n";
+  out << "};\n\nconst char* const VARIABLE_NAMES[] = {\n";
+  for (const std::string& variable : model.getVariableNames())
+    out << "  " << quoted(variable) << ",\n";
+  out << "};\n\n// parent joint type, joint origin (rotation, translation) and joint axis of each link\n"
+      << "const int JOINT_TYPES[] = {\n";
+  for (const moveit::core::LinkModel* link : links)
+    out << "  " << link->getParentJointModel()->getType() << ",\n";
+  out << "};\n\nconst double JOINT_ORIGINS[][15] = {\n";
+  for (const moveit::core::LinkModel* link : links)
+  {
+    const Eigen::Isometry3d& origin = link->getJointOriginTransform();
+    Eigen::Vector3d axis = Eigen::Vector3d::Zero();
+    if (link->getParentJointModel()->getType() == moveit::core::JointModel::REVOLUTE)
+      axis = static_cast<const moveit::core::RevoluteJointModel*>(link->getParentJointModel())->getAxis();
+    else if (link->getParentJointModel()->getType() == moveit::core::JointModel::PRISMATIC)
+      axis = static_cast<const moveit::core::PrismaticJointModel*>(link->getParentJointModel())->getAxis();
+    out << "  {";
+    for (int c = 0; c < 3; ++c)
+      for (int r = 0; r < 3; ++r)
+        out << " " << literal(origin.linear()(r, c)) << ",";
+    for (int r = 0; r < 3; ++r)
+      out << " " << literal(origin.translation()(r)) << ",";
+    for (int r = 0; r < 3; ++r)
+      out << " " << literal(axis(r)) << ",";
+    out << " },\n";
+  }
+  out << "};\n\n";
+
+  out << "bool sameModel(const moveit::core::RobotModel& model)\n{\n"
+      << "  constexpr std::size_t LINK_COUNT = sizeof(LINK_NAMES) / sizeof(LINK_NAMES[0]);\n"
+      << "  constexpr std::size_t VARIABLE_COUNT = sizeof(VARIABLE_NAMES) / sizeof(VARIABLE_NAMES[0]);\n"
+      << "  if (model.getLinkModelCount() != LINK_COUNT || model.getVariableCount() != VARIABLE_COUNT)\n"
+      << "    return false;\n"
+      << "  for (std::size_t i = 0; i < VARIABLE_COUNT; ++i)\n"
+      << "    if (model.getVariableNames()[i] != VARIABLE_NAMES[i])\n"
+      << "      return false;\n"
+      << "  for (std::size_t i = 0; i < LINK_COUNT; ++i)\n  {\n"
+      << "    const moveit::core::LinkModel* link = model.getLinkModels()[i];\n"
+      << "    const moveit::core::JointModel* joint = link->getParentJointModel();\n"
+      << "    if (link->getName() != LINK_NAMES[i] || joint->getType() != JOINT_TYPES[i])\n"
+      << "      return false;\n"
+      << "    Eigen::Vector3d axis = Eigen::Vector3d::Zero();\n"
+      << "    if (joint->getType() == moveit::core::JointModel::REVOLUTE)\n"
+      << "      axis = static_cast<const moveit::core::RevoluteJointModel*>(joint)->getAxis();\n"
+      << "    else if (joint->getType() == moveit::core::JointModel::PRISMATIC)\n"
+      << "      axis = static_cast<const moveit::core::PrismaticJointModel*>(joint)->getAxis();\n"
+      << "    const Eigen::Isometry3d& origin = link->getJointOriginTransform();\n"
+      << "    for (int k = 0; k < 15; ++k)\n    {\n"
+      << "      const double value = k < 9 ? origin.linear()(k % 3, k / 3) : k < 12 ? origin.translation()(k - 9) : "
+         "axis(k - 12);\n"
+      << "      if (std::fabs(value - JOINT_ORIGINS[i][k]) > "
+      << literal(FOLD_EPSILON) << ")\n"
+      << "        return false;\n"
+      << "    }\n  }\n"
+      << "  return true;\n}\n"
+      << "}  // namespace\n\n";
+
+  out << "class LinkTransformsPlugin : public moveit::core::LinkTransformsPlugin\n{\npublic:\n"
+      << "  bool initialize(moveit::core::RobotModel& model) override\n  {\n"
+      << "    if (!sameModel(model))\n      return false;\n";
+  for (const moveit::core::JointModel* start : starts)
+    out << "    model.setLinkTransformsFunction(model.getJointModel(" << quoted(start->getName())
+        << "), &computeLinkTransforms_" << identifier(start->getName()) << ");\n";
+  out << "    return true;\n  }\n};\n"
+      << "}  // namespace " << ns << "\n\n"
+      << "PLUGINLIB_EXPORT_CLASS(" << ns << "::LinkTransformsPlugin, moveit::core::LinkTransformsPlugin);\n";
+}
+
+void generatePluginDescription(const std::string& ns, std::ostream& out)
+{
+  out << "<library path=\"lib/lib" << ns << "\">\n"
+      << "  <class name=\"" << ns << "/LinkTransformsPlugin\" type=\"" << ns
+      << "::LinkTransformsPlugin\" base_class_type=\"moveit::core::LinkTransformsPlugin\">\n"
+      << "    <description>Generated forward kinematics for the robot model it was created from.</description>\n"
+      << "  </class>\n</library>\n";
+}
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  ros::init(argc, argv, "generate_link_transforms_plugin");
+
+  if (argc < 2)
+  {
+    std::cerr << "Usage: moveit_generate_link_transforms_plugin <output_prefix>\n\n"
+              << "Writes <output_prefix>.cpp and <output_prefix>_description.xml for the robot in '"
+              << ROBOT_DESCRIPTION << "'.\n"
+              << "Build the .cpp into a library named <robot>_link_transforms, export the description from your\n"
+              << "package.xml (<moveit_core plugin=\"...\"/>) and set the parameter\n"
+              << ROBOT_DESCRIPTION << "_planning/link_transforms_plugin to <robot>_link_transforms/LinkTransformsPlugin"
+              << std::endl;
+    return 1;
+  }
+
+  ros::AsyncSpinner spinner(1);
+  spinner.start();
+
+  robot_model_loader::RobotModelLoader rml(ROBOT_DESCRIPTION, false);
+  const moveit::core::RobotModelPtr& model = rml.getModel();
+  if (!model)
+  {
+    ROS_ERROR("Unable to initialize robot model.");
+    return 1;
+  }
+
+  const std::string prefix = argv[1];
+  const std::string ns = identifier(model->getName()) + "_link_transforms";
+  std::ofstream cpp(prefix + ".cpp");
+  generatePlugin(*model, ns, cpp);
+  std::ofstream xml(prefix + "_description.xml");
+  generatePluginDescription(ns, xml);
+  if (!cpp || !xml)
+  {
+    ROS_ERROR("Unable to write '%s.cpp' or '%s_description.xml'", prefix.c_str(), prefix.c_str());
+    return 1;
+  }
+  ROS_INFO("Generated link transforms plugin '%s/LinkTransformsPlugin' in '%s.cpp'", ns.c_str(), prefix.c_str());
+
+  ros::shutdown();
+  return 0;
+}
@@ -40,6 +40,7 @@
 #include <moveit/planning_request_adapter/planning_request_adapter.h>
 #include <pluginlib/class_loader.hpp>
 #include <ros/ros.h>
+#include <boost/thread/mutex.hpp>
 
 #include <memory>
 
@@ -51,7 +52,16 @@ namespace planning_pipeline
     planning_interface::PlanningContext::solve() from a loaded
     planning plugin and the
     planning_request_adapter::PlanningRequestAdapter plugins, in the
-    specified order. */
+    specified order.
+
+    If a portfolio of planners is specified by the ROS parameter \e portfolio (a list of entries with a
+    \e planning_plugin and an optional \e planner_id), generatePlan() runs all of them in parallel, each on a clone of
+    the planning scene and through the adapter chain. Depending on the parameter \e portfolio_selection, the first
+    valid solution ("first", the default) or the shortest valid solution found within the allowed planning time
+    ("shortest") is returned. Planners that honor the allowed planning time still need some time to post-process
+    their solution, so they are waited for up to \e portfolio_time_margin seconds (0.5 by default) longer; planners
+    that are still running then are terminated. The result is returned without waiting for them to stop, as not all
+    planners can be interrupted: they keep the plugins and data they use alive until they return. */
 class PlanningPipeline
 {
 public:
@@ -138,7 +148,8 @@ public:
                     const planning_interface::MotionPlanRequest& req, planning_interface::MotionPlanResponse& res,
                     std::vector<std::size_t>& adapter_added_state_index) const;
 
-  /** \brief Request termination, if a generatePlan() function is currently computing plans */
+  /** \brief Request termination, if a generatePlan() function is currently computing plans. This terminates all
+      members of running portfolios as well; those that did not start to solve yet will not do so. */
   void terminate() const;
 
   /** \brief Get the name of the planning plugin used */
@@ -165,8 +176,23 @@ public:
     return robot_model_;
   }
 
+  /** \brief Check if a portfolio of planners is used */
+  bool usesPortfolio() const
+  {
+    return !portfolio_.empty();
+  }
+
 private:
+  // Give test access to private/protected methods
+  friend class PlanningPipelineFixture;
+
   void configure();
+  void configurePortfolio();
+
+  /// Run all planners of the portfolio in parallel and pick a result
+  bool solvePortfolio(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                      const planning_interface::MotionPlanRequest& req, planning_interface::MotionPlanResponse& res,
+                      std::vector<std::size_t>& adapter_added_state_index) const;
 
   ros::NodeHandle nh_;
 
@@ -179,12 +205,29 @@ private:
   bool publish_received_requests_;
   ros::Publisher received_request_publisher_;
 
-  std::unique_ptr<pluginlib::ClassLoader<planning_interface::PlannerManager> > planner_plugin_loader_;
+  // shared with portfolio members that are still running
+  std::shared_ptr<pluginlib::ClassLoader<planning_interface::PlannerManager> > planner_plugin_loader_;
   planning_interface::PlannerManagerPtr planner_instance_;
   std::string planner_plugin_name_;
 
-  std::unique_ptr<pluginlib::ClassLoader<planning_request_adapter::PlanningRequestAdapter> > adapter_plugin_loader_;
-  std::unique_ptr<planning_request_adapter::PlanningRequestAdapterChain> adapter_chain_;
+  struct PortfolioMember
+  {
+    std::string planner_plugin_name_;
+    std::string planner_id_;  // overrides the planner_id of requests, if not empty
+    planning_interface::PlannerManagerPtr planner_instance_;
+  };
+  std::vector<PortfolioMember> portfolio_;
+  bool portfolio_select_shortest_;
+  /// How long to wait for the portfolio beyond the allowed planning time (seconds)
+  double portfolio_time_margin_;
+
+  /// The portfolio runs of the generatePlan() calls in progress, so terminate() can reach their members
+  struct PortfolioRun;
+  mutable boost::mutex portfolio_runs_mutex_;
+  mutable std::vector<std::shared_ptr<PortfolioRun> > portfolio_runs_;
+
+  std::shared_ptr<pluginlib::ClassLoader<planning_request_adapter::PlanningRequestAdapter> > adapter_plugin_loader_;
+  std::shared_ptr<planning_request_adapter::PlanningRequestAdapterChain> adapter_chain_;
   std::vector<std::string> adapter_plugin_names_;
 
   moveit::core::RobotModelConstPtr robot_model_;
@@ -42,12 +42,218 @@
 #include <visualization_msgs/MarkerArray.h>
 #include <boost/tokenizer.hpp>
 #include <boost/algorithm/string/join.hpp>
+#include <boost/thread.hpp>
+#include <algorithm>
 #include <sstream>
 
 const std::string planning_pipeline::PlanningPipeline::DISPLAY_PATH_TOPIC = "display_planned_path";
 const std::string planning_pipeline::PlanningPipeline::MOTION_PLAN_REQUEST_TOPIC = "motion_plan_request";
 const std::string planning_pipeline::PlanningPipeline::MOTION_CONTACTS_TOPIC = "display_contacts";
 
+namespace planning_pipeline
+{
+namespace
+{
+class PortfolioMemberPlanner;
+
+// Context of a portfolio member that does not start to solve once the member was terminated
+// (terminating a context has no effect before it solves)
+class PortfolioMemberContext : public planning_interface::PlanningContext
+{
+public:
+  PortfolioMemberContext(const planning_interface::PlanningContextPtr& context, const PortfolioMemberPlanner* member)
+    : planning_interface::PlanningContext(context->getName(), context->getGroupName())
+    , context_(context)
+    , member_(member)
+  {
+    setPlanningScene(context->getPlanningScene());
+    setMotionPlanRequest(context->getMotionPlanRequest());
+  }
+
+  bool solve(planning_interface::MotionPlanResponse& res) override;
+
+  bool solve(planning_interface::MotionPlanDetailedResponse& res) override;
+
+  bool terminate() override
+  {
+    return context_->terminate();
+  }
+
+  void clear() override
+  {
+    context_->clear();
+  }
+
+private:
+  planning_interface::PlanningContextPtr context_;
+  const PortfolioMemberPlanner* member_;
+};
+
+// Planner manager handing out the contexts of a portfolio member, so the member can be terminated on its own
+// (PlannerManager::terminate() terminates all active contexts)
+class PortfolioMemberPlanner : public planning_interface::PlannerManager
+{
+public:
+  PortfolioMemberPlanner(const planning_interface::PlannerManagerPtr& planner) : planner_(planner), terminated_(false)
+  {
+  }
+
+  std::string getDescription() const override
+  {
+    return planner_->getDescription();
+  }
+
+  void getPlanningAlgorithms(std::vector<std::string>& algs) const override
+  {
+    planner_->getPlanningAlgorithms(algs);
+  }
+
+  planning_interface::PlanningContextPtr getPlanningContext(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                                                            const planning_interface::MotionPlanRequest& req,
+                                                            moveit_msgs::MoveItErrorCodes& error_code) const override
+  {
+    boost::mutex::scoped_lock slock(mutex_);
+    if (terminated_)
+    {
+      error_code.val = moveit_msgs::MoveItErrorCodes::PREEMPTED;
+      return planning_interface::PlanningContextPtr();
+    }
+    planning_interface::PlanningContextPtr context = planner_->getPlanningContext(planning_scene, req, error_code);
+    if (!context)
+      return context;
+    context = std::make_shared<PortfolioMemberContext>(context, this);
+    contexts_.push_back(context);
+    return context;
+  }
+
+  bool canServiceRequest(const planning_interface::MotionPlanRequest& req) const override
+  {
+    return planner_->canServiceRequest(req);
+  }
+
+  bool isTerminated() const
+  {
+    boost::mutex::scoped_lock slock(mutex_);
+    return terminated_;
+  }
+
+  void terminateMember() const
+  {
+    boost::mutex::scoped_lock slock(mutex_);
+    terminated_ = true;
+    for (const planning_interface::PlanningContextWeakPtr& weak_context : contexts_)
+      if (planning_interface::PlanningContextPtr context = weak_context.lock())
+        context->terminate();
+  }
+
+private:
+  planning_interface::PlannerManagerPtr planner_;
+  mutable boost::mutex mutex_;
+  mutable bool terminated_;
+  mutable std::vector<planning_interface::PlanningContextWeakPtr> contexts_;
+};
+
+bool PortfolioMemberContext::solve(planning_interface::MotionPlanResponse& res)
+{
+  if (member_->isTerminated())
+  {
+    res.error_code_.val = moveit_msgs::MoveItErrorCodes::PREEMPTED;
+    return false;
+  }
+  return context_->solve(res);
+}
+
+bool PortfolioMemberContext::solve(planning_interface::MotionPlanDetailedResponse& res)
+{
+  if (member_->isTerminated())
+  {
+    res.error_code_.val = moveit_msgs::MoveItErrorCodes::PREEMPTED;
+    return false;
+  }
+  return context_->solve(res);
+}
+
+struct PortfolioResult
+{
+  PortfolioResult() : solved_(false), valid_(false), length_(0.0)
+  {
+  }
+
+  planning_interface::MotionPlanResponse res_;
+  std::vector<std::size_t> adapter_added_state_index_;
+  bool solved_;
+  bool valid_;
+  double length_;
+};
+
+double getPathLength(const robot_trajectory::RobotTrajectory& trajectory)
+{
+  double length = 0.0;
+  for (std::size_t i = 1; i < trajectory.getWayPointCount(); ++i)
+    length += trajectory.getWayPoint(i - 1).distance(trajectory.getWayPoint(i));
+  return length;
+}
+
+// Run the adapter chain (if any) and the planner
+bool solve(const planning_request_adapter::PlanningRequestAdapterChain* adapter_chain,
+           const planning_interface::PlannerManagerPtr& planner,
+           const planning_scene::PlanningSceneConstPtr& planning_scene,
+           const planning_interface::MotionPlanRequest& req, planning_interface::MotionPlanResponse& res,
+           std::vector<std::size_t>& adapter_added_state_index)
+{
+  bool solved = false;
+  if (adapter_chain)
+  {
+    solved = adapter_chain->adaptAndPlan(planner, planning_scene, req, res, adapter_added_state_index);
+    if (!adapter_added_state_index.empty())
+    {
+      std::stringstream ss;
+      for (std::size_t added_index : adapter_added_state_index)
+        ss << added_index << " ";
+      ROS_INFO("Planning adapters have added states at index positions: [ %s]", ss.str().c_str());
+    }
+  }
+  else
+  {
+    planning_interface::PlanningContextPtr context = planner->getPlanningContext(planning_scene, req, res.error_code_);
+    solved = context ? context->solve(res) : false;
+  }
+  return solved;
+}
+}  // namespace
+
+// The state of one portfolio run, shared with its members. Members that are still running when the result is
+// returned keep it alive, together with the plugins they use (declared first, so they are unloaded last).
+struct PlanningPipeline::PortfolioRun
+{
+  PortfolioRun(std::size_t size) : planners_(size), results_(size), finished_(size, false)
+  {
+  }
+
+  // terminate the members that are still running; those that did not start yet will not start
+  void terminate()
+  {
+    boost::mutex::scoped_lock slock(mutex_);
+    for (std::size_t i = 0; i < planners_.size(); ++i)
+      if (!finished_[i])
+        planners_[i]->terminateMember();
+  }
+
+  std::shared_ptr<const void> planner_plugin_loader_;
+  std::shared_ptr<const void> adapter_plugin_loader_;
+  std::shared_ptr<const planning_request_adapter::PlanningRequestAdapterChain> adapter_chain_;
+  bool check_solution_paths_ = false;
+
+  std::vector<std::shared_ptr<PortfolioMemberPlanner> > planners_;
+  std::vector<PortfolioResult> results_;
+  boost::mutex mutex_;
+  boost::condition_variable condition_;
+  std::vector<bool> finished_;
+  std::size_t finished_count_ = 0;
+  int first_valid_ = -1;
+};
+}  // namespace planning_pipeline
+
 planning_pipeline::PlanningPipeline::PlanningPipeline(const moveit::core::RobotModelConstPtr& model,
                                                       const ros::NodeHandle& nh,
                                                       const std::string& planner_plugin_param_name,
@@ -81,6 +287,8 @@ planning_pipeline::PlanningPipeline::PlanningPipeline(const moveit::core::RobotM
 void planning_pipeline::PlanningPipeline::configure()
 {
   check_solution_paths_ = false;  // this is set to true below
+  portfolio_select_shortest_ = false;
+  portfolio_time_margin_ = 0.5;
   publish_received_requests_ = false;
   display_computed_motion_plans_ = false;  // this is set to true below
 
@@ -170,6 +378,73 @@ void planning_pipeline::PlanningPipeline::configure()
   }
   displayComputedMotionPlans(true);
   checkSolutionPaths(true);
+
+  configurePortfolio();
+}
+
+void planning_pipeline::PlanningPipeline::configurePortfolio()
+{
+  portfolio_.clear();
+  std::string selection;
+  nh_.param("portfolio_selection", selection, std::string("first"));
+  if (selection != "first" && selection != "shortest")
+    ROS_ERROR("Unknown portfolio selection '%s', expected 'first' or 'shortest'. Using 'first'.", selection.c_str());
+  portfolio_select_shortest_ = selection == "shortest";
+  nh_.param("portfolio_time_margin", portfolio_time_margin_, 0.5);
+  if (portfolio_time_margin_ < 0.0)
+  {
+    ROS_ERROR("Parameter 'portfolio_time_margin' should not be negative. Using 0.");
+    portfolio_time_margin_ = 0.0;
+  }
+
+  XmlRpc::XmlRpcValue portfolio;
+  if (!nh_.getParam("portfolio", portfolio))
+    return;
+  if (portfolio.getType() != XmlRpc::XmlRpcValue::TypeArray)
+  {
+    ROS_ERROR("Parameter '%s' should be a list of planners", nh_.resolveName("portfolio").c_str());
+    return;
+  }
+
+  // planners are shared between members that use the same plugin
+  std::map<std::string, planning_interface::PlannerManagerPtr> planners;
+  if (planner_instance_)
+    planners[planner_plugin_name_] = planner_instance_;
+  for (int i = 0; i < portfolio.size(); ++i)  // NOLINT(modernize-loop-convert)
+  {
+    XmlRpc::XmlRpcValue& entry = portfolio[i];
+    if (entry.getType() != XmlRpc::XmlRpcValue::TypeStruct || !entry.hasMember("planning_plugin"))
+    {
+      ROS_ERROR("Portfolio entry %d does not specify a 'planning_plugin'", i);
+      continue;
+    }
+    PortfolioMember member;
+    member.planner_plugin_name_ = static_cast<std::string>(entry["planning_plugin"]);
+    if (entry.hasMember("planner_id"))
+      member.planner_id_ = static_cast<std::string>(entry["planner_id"]);
+
+    planning_interface::PlannerManagerPtr& planner = planners[member.planner_plugin_name_];
+    if (!planner && planner_plugin_loader_)
+      try
+      {
+        planner = planner_plugin_loader_->createUniqueInstance(member.planner_plugin_name_);
+        if (!planner->initialize(robot_model_, nh_.getNamespace()))
+        {
+          ROS_ERROR_STREAM("Unable to initialize planning plugin '" << member.planner_plugin_name_ << "'");
+          planner.reset();
+        }
+      }
+      catch (pluginlib::PluginlibException& ex)
+      {
+        ROS_ERROR_STREAM("Exception while loading planner '" << member.planner_plugin_name_ << "': " << ex.what());
+      }
+    if (!planner)
+      continue;
+    member.planner_instance_ = planner;
+    ROS_INFO_STREAM("Using planning interface '" << planner->getDescription() << "' (planner '"
+                                                 << member.planner_id_ << "') in the planner portfolio");
+    portfolio_.push_back(member);
+  }
 }
 
 void planning_pipeline::PlanningPipeline::displayComputedMotionPlans(bool flag)
@@ -217,7 +492,7 @@ bool planning_pipeline::PlanningPipeline::generatePlan(const planning_scene::Pla
     received_request_publisher_.publish(req);
   adapter_added_state_index.clear();
 
-  if (!planner_instance_)
+  if (!planner_instance_ && portfolio_.empty())
   {
     ROS_ERROR("No planning plugin loaded. Cannot plan.");
     return false;
@@ -226,23 +501,10 @@ bool planning_pipeline::PlanningPipeline::generatePlan(const planning_scene::Pla
   bool solved = false;
   try
   {
-    if (adapter_chain_)
-    {
-      solved = adapter_chain_->adaptAndPlan(planner_instance_, planning_scene, req, res, adapter_added_state_index);
-      if (!adapter_added_state_index.empty())
-      {
-        std::stringstream ss;
-        for (std::size_t added_index : adapter_added_state_index)
-          ss << added_index << " ";
-        ROS_INFO("Planning adapters have added states at index positions: [ %s]", ss.str().c_str());
-      }
-    }
+    if (!portfolio_.empty())
+      solved = solvePortfolio(planning_scene, req, res, adapter_added_state_index);
     else
-    {
-      planning_interface::PlanningContextPtr context =
-          planner_instance_->getPlanningContext(planning_scene, req, res.error_code_);
-      solved = context ? context->solve(res) : false;
-    }
+      solved = solve(adapter_chain_.get(), planner_instance_, planning_scene, req, res, adapter_added_state_index);
   }
   catch (std::exception& ex)
   {
@@ -363,8 +625,129 @@ bool planning_pipeline::PlanningPipeline::generatePlan(const planning_scene::Pla
   return solved && valid;
 }
 
+bool planning_pipeline::PlanningPipeline::solvePortfolio(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                                                         const planning_interface::MotionPlanRequest& req,
+                                                         planning_interface::MotionPlanResponse& res,
+                                                         std::vector<std::size_t>& adapter_added_state_index) const
+{
+  // the members only use what the run owns, so the ones that cannot be interrupted are left behind when we return
+  std::shared_ptr<PortfolioRun> run = std::make_shared<PortfolioRun>(portfolio_.size());
+  run->planner_plugin_loader_ = planner_plugin_loader_;
+  run->adapter_plugin_loader_ = adapter_plugin_loader_;
+  run->adapter_chain_ = adapter_chain_;
+  run->check_solution_paths_ = check_solution_paths_;
+  for (std::size_t i = 0; i < portfolio_.size(); ++i)
+    run->planners_[i] = std::make_shared<PortfolioMemberPlanner>(portfolio_[i].planner_instance_);
+  {
+    boost::mutex::scoped_lock slock(portfolio_runs_mutex_);
+    portfolio_runs_.push_back(run);
+  }
+
+  // each member plans on its own clone of the scene
+  for (std::size_t i = 0; i < portfolio_.size(); ++i)
+  {
+    planning_scene::PlanningSceneConstPtr scene = planning_scene::PlanningScene::clone(planning_scene);
+    planning_interface::MotionPlanRequest member_req = req;
+    if (!portfolio_[i].planner_id_.empty())
+      member_req.planner_id = portfolio_[i].planner_id_;
+    boost::thread([run, i, scene, member_req] {
+      PortfolioResult& result = run->results_[i];
+      try
+      {
+        result.solved_ = solve(run->adapter_chain_.get(), run->planners_[i], scene, member_req, result.res_,
+                               result.adapter_added_state_index_);
+      }
+      catch (std::exception& ex)
+      {
+        ROS_ERROR("Exception caught in portfolio planner %zu: '%s'", i, ex.what());
+      }
+
+      if (result.solved_ && result.res_.trajectory_)
+      {
+        // only states added by the adapters, or an invalid start state, are acceptable
+        std::vector<std::size_t> index;
+        result.valid_ = !run->check_solution_paths_ ||
+                        scene->isPathValid(*result.res_.trajectory_, member_req.path_constraints,
+                                           member_req.group_name, false, &index) ||
+                        (index.size() == 1 && index[0] == 0) ||
+                        std::all_of(index.begin(), index.end(), [&result](std::size_t invalid) {
+                          return std::find(result.adapter_added_state_index_.begin(),
+                                           result.adapter_added_state_index_.end(),
+                                           invalid) != result.adapter_added_state_index_.end();
+                        });
+        result.length_ = getPathLength(*result.res_.trajectory_);
+      }
+
+      boost::mutex::scoped_lock slock(run->mutex_);
+      run->finished_[i] = true;
+      ++run->finished_count_;
+      if (result.valid_ && run->first_valid_ < 0)
+        run->first_valid_ = i;
+      run->condition_.notify_all();
+    })
+        .detach();
+  }
+
+  // wait for the first valid solution (or for all solutions), but not much beyond the allowed planning time: members
+  // that honor it are given the margin to post-process their solution (if it is not set, the planners use their
+  // defaults and we wait for them)
+  boost::mutex::scoped_lock slock(run->mutex_);
+  const boost::system_time deadline =
+      boost::get_system_time() +
+      boost::posix_time::microseconds(static_cast<long>((req.allowed_planning_time + portfolio_time_margin_) * 1e6));
+  while (run->finished_count_ < portfolio_.size() && (portfolio_select_shortest_ || run->first_valid_ < 0))
+  {
+    if (req.allowed_planning_time <= 0.0)
+      run->condition_.wait(slock);
+    else if (!run->condition_.timed_wait(slock, deadline))
+      break;
+  }
+
+  // cancel the planners that are still running, but do not wait for them
+  slock.unlock();
+  run->terminate();
+  {
+    boost::mutex::scoped_lock runs_lock(portfolio_runs_mutex_);
+    portfolio_runs_.erase(std::find(portfolio_runs_.begin(), portfolio_runs_.end(), run));
+  }
+  slock.lock();
+
+  // pick the first or the shortest valid solution; an invalid solution still tells what went wrong.
+  // Only the results of finished members are complete.
+  const std::vector<PortfolioResult>& results = run->results_;
+  int selected = run->first_valid_;
+  if (portfolio_select_shortest_)
+    for (std::size_t i = 0; i < results.size(); ++i)
+      if (run->finished_[i] && results[i].valid_ && (selected < 0 || results[i].length_ < results[selected].length_))
+        selected = i;
+  for (std::size_t i = 0; i < results.size() && selected < 0; ++i)
+    if (run->finished_[i] && results[i].solved_)
+      selected = i;
+  if (selected < 0)
+  {
+    ROS_DEBUG("No portfolio planner found a solution");
+    for (std::size_t i = 0; i < results.size() && selected < 0; ++i)
+      if (run->finished_[i])
+        selected = i;
+    if (selected < 0)
+    {
+      res.error_code_.val = moveit_msgs::MoveItErrorCodes::TIMED_OUT;
+      return false;
+    }
+  }
+
+  ROS_DEBUG("Using the result of portfolio planner %d ('%s' %s)", selected,
+            portfolio_[selected].planner_plugin_name_.c_str(), portfolio_[selected].planner_id_.c_str());
+  res = results[selected].res_;
+  adapter_added_state_index = results[selected].adapter_added_state_index_;
+  return results[selected].solved_;
+}
+
 void planning_pipeline::PlanningPipeline::terminate() const
 {
   if (planner_instance_)
     planner_instance_->terminate();
+  boost::mutex::scoped_lock slock(portfolio_runs_mutex_);
+  for (const std::shared_ptr<PortfolioRun>& run : portfolio_runs_)
+    run->terminate();
 }
@@ -0,0 +1,308 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, MoveIt maintainers
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/planning_pipeline/planning_pipeline.h>
+#include <moveit/planning_scene/planning_scene.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+#include <urdf_parser/urdf_parser.h>
+#include <ros/ros.h>
+#include <gtest/gtest.h>
+#include <boost/thread.hpp>
+#include <atomic>
+
+namespace planning_pipeline
+{
+namespace
+{
+const std::string URDF = R"(<?xml version="1.0"?>
+<robot name="test_robot">
+  <link name="base_link"/>
+  <link name="l1"/>
+  <joint name="j1" type="revolute"><parent link="base_link"/><child link="l1"/>
+    <limit lower="-3.14" upper="3.14" effort="10" velocity="2"/></joint>
+</robot>
+)";
+
+const std::string SRDF = R"(<?xml version="1.0"?>
+<robot name="test_robot">
+  <group name="arm"><joint name="j1"/></group>
+</robot>
+)";
+
+// A planner that takes a fixed time to find a path of the given length, unless it is terminated before
+class FixedTimePlanner : public planning_interface::PlannerManager
+{
+public:
+  FixedTimePlanner(double duration, double length) : duration_(duration), length_(length), terminated_(false)
+  {
+  }
+
+  planning_interface::PlanningContextPtr getPlanningContext(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                                                            const planning_interface::MotionPlanRequest& req,
+                                                            moveit_msgs::MoveItErrorCodes& error_code) const override;
+
+  bool canServiceRequest(const planning_interface::MotionPlanRequest& /*req*/) const override
+  {
+    return true;
+  }
+
+  // true if a context of this planner was terminated while solving
+  bool wasTerminated() const
+  {
+    return terminated_;
+  }
+
+  const double duration_;
+  const double length_;
+  mutable std::atomic<bool> terminated_;
+};
+
+class FixedTimeContext : public planning_interface::PlanningContext
+{
+public:
+  FixedTimeContext(const FixedTimePlanner* planner, const std::string& group)
+    : planning_interface::PlanningContext("fixed_time", group), planner_(planner), terminated_(false)
+  {
+  }
+
+  bool solve(planning_interface::MotionPlanResponse& res) override
+  {
+    {
+      boost::mutex::scoped_lock slock(mutex_);
+      const boost::system_time deadline =
+          boost::get_system_time() + boost::posix_time::microseconds(static_cast<long>(planner_->duration_ * 1e6));
+      while (!terminated_)
+        if (!condition_.timed_wait(slock, deadline))
+          break;
+      if (terminated_)
+      {
+        res.error_code_.val = moveit_msgs::MoveItErrorCodes::PREEMPTED;
+        return false;
+      }
+    }
+
+    // a motion of the only joint by the length of the path
+    moveit::core::RobotState state = planning_scene_->getCurrentState();
+    res.trajectory_ = std::make_shared<robot_trajectory::RobotTrajectory>(state.getRobotModel(), group_);
+    res.trajectory_->addSuffixWayPoint(state, 0.0);
+    state.setVariablePosition("j1", state.getVariablePosition("j1") + planner_->length_);
+    state.update();
+    res.trajectory_->addSuffixWayPoint(state, 1.0);
+    res.planning_time_ = planner_->duration_;
+    res.error_code_.val = moveit_msgs::MoveItErrorCodes::SUCCESS;
+    return true;
+  }
+
+  bool solve(planning_interface::MotionPlanDetailedResponse& /*res*/) override
+  {
+    return false;  // not used by the planning pipeline
+  }
+
+  bool terminate() override
+  {
+    boost::mutex::scoped_lock slock(mutex_);
+    terminated_ = true;
+    planner_->terminated_ = true;
+    condition_.notify_all();
+    return true;
+  }
+
+  void clear() override
+  {
+  }
+
+private:
+  const FixedTimePlanner* planner_;
+  boost::mutex mutex_;
+  boost::condition_variable condition_;
+  bool terminated_;
+};
+
+planning_interface::PlanningContextPtr
+FixedTimePlanner::getPlanningContext(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                                     const planning_interface::MotionPlanRequest& req,
+                                     moveit_msgs::MoveItErrorCodes& error_code) const
+{
+  planning_interface::PlanningContextPtr context = std::make_shared<FixedTimeContext>(this, req.group_name);
+  context->setPlanningScene(planning_scene);
+  context->setMotionPlanRequest(req);
+  error_code.val = moveit_msgs::MoveItErrorCodes::SUCCESS;
+  return context;
+}
+
+double getSeconds(const ros::WallTime& start)
+{
+  return (ros::WallTime::now() - start).toSec();
+}
+}  // namespace
+
+class PlanningPipelineFixture : public testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    urdf::ModelInterfaceSharedPtr urdf_model = urdf::parseURDF(URDF);
+    ASSERT_TRUE(urdf_model);
+    srdf::ModelSharedPtr srdf_model(new srdf::Model());
+    ASSERT_TRUE(srdf_model->initString(*urdf_model, SRDF));
+    robot_model_ = std::make_shared<moveit::core::RobotModel>(urdf_model, srdf_model);
+    planning_scene_ = std::make_shared<planning_scene::PlanningScene>(robot_model_);
+
+    // no planning plugin is loaded, the portfolio members are set up below
+    pipeline_ = std::make_shared<PlanningPipeline>(robot_model_, ros::NodeHandle("~"), "none",
+                                                   std::vector<std::string>());
+    pipeline_->displayComputedMotionPlans(false);
+    pipeline_->checkSolutionPaths(false);
+
+    request_.group_name = "arm";
+    request_.allowed_planning_time = 5.0;
+  }
+
+  void setPortfolio(const std::vector<std::shared_ptr<FixedTimePlanner> >& planners, bool select_shortest,
+                    double time_margin = 0.5)
+  {
+    pipeline_->portfolio_.clear();
+    for (const std::shared_ptr<FixedTimePlanner>& planner : planners)
+    {
+      PlanningPipeline::PortfolioMember member;
+      member.planner_plugin_name_ = "fixed_time";
+      member.planner_instance_ = planner;
+      pipeline_->portfolio_.push_back(member);
+    }
+    pipeline_->portfolio_select_shortest_ = select_shortest;
+    pipeline_->portfolio_time_margin_ = time_margin;
+  }
+
+  double getPathLength(const planning_interface::MotionPlanResponse& res) const
+  {
+    return res.trajectory_->getLastWayPoint().getVariablePosition("j1") -
+           res.trajectory_->getFirstWayPoint().getVariablePosition("j1");
+  }
+
+  moveit::core::RobotModelPtr robot_model_;
+  planning_scene::PlanningScenePtr planning_scene_;
+  PlanningPipelinePtr pipeline_;
+  planning_interface::MotionPlanRequest request_;
+};
+
+TEST_F(PlanningPipelineFixture, FirstSelectsFirstValidSolution)
+{
+  auto fast = std::make_shared<FixedTimePlanner>(0.1, 1.0);
+  auto slow = std::make_shared<FixedTimePlanner>(5.0, 0.5);
+  setPortfolio({ slow, fast }, false);
+  ASSERT_TRUE(pipeline_->usesPortfolio());
+
+  planning_interface::MotionPlanResponse res;
+  ros::WallTime start = ros::WallTime::now();
+  ASSERT_TRUE(pipeline_->generatePlan(planning_scene_, request_, res));
+  EXPECT_LT(getSeconds(start), 1.0);
+  EXPECT_EQ(res.error_code_.val, moveit_msgs::MoveItErrorCodes::SUCCESS);
+  EXPECT_NEAR(getPathLength(res), 1.0, 1e-6);
+
+  // the slower member is not waited for
+  EXPECT_FALSE(fast->wasTerminated());
+  EXPECT_TRUE(slow->wasTerminated());
+}
+
+TEST_F(PlanningPipelineFixture, ShortestWaitsForAllMembers)
+{
+  auto fast = std::make_shared<FixedTimePlanner>(0.1, 1.0);
+  auto slow = std::make_shared<FixedTimePlanner>(0.4, 0.5);
+  setPortfolio({ fast, slow }, true);
+
+  planning_interface::MotionPlanResponse res;
+  ros::WallTime start = ros::WallTime::now();
+  ASSERT_TRUE(pipeline_->generatePlan(planning_scene_, request_, res));
+  EXPECT_GE(getSeconds(start), 0.4);
+  EXPECT_NEAR(getPathLength(res), 0.5, 1e-6);
+  EXPECT_FALSE(fast->wasTerminated());
+  EXPECT_FALSE(slow->wasTerminated());
+}
+
+TEST_F(PlanningPipelineFixture, ShortestTerminatesMembersAfterTimeMargin)
+{
+  auto fast = std::make_shared<FixedTimePlanner>(0.1, 1.0);
+  auto slow = std::make_shared<FixedTimePlanner>(5.0, 0.5);
+  setPortfolio({ fast, slow }, true, 0.2);
+  request_.allowed_planning_time = 0.3;
+
+  planning_interface::MotionPlanResponse res;
+  ros::WallTime start = ros::WallTime::now();
+  ASSERT_TRUE(pipeline_->generatePlan(planning_scene_, request_, res));
+  EXPECT_GE(getSeconds(start), 0.5);
+  EXPECT_LT(getSeconds(start), 2.0);
+  EXPECT_NEAR(getPathLength(res), 1.0, 1e-6);
+  EXPECT_TRUE(slow->wasTerminated());
+}
+
+TEST_F(PlanningPipelineFixture, WaitsForPostProcessingWithinTimeMargin)
+{
+  // the member exceeds the allowed planning time a little, as planners that post-process their solution do
+  auto planner = std::make_shared<FixedTimePlanner>(0.4, 1.0);
+  setPortfolio({ planner }, false, 0.5);
+  request_.allowed_planning_time = 0.3;
+
+  planning_interface::MotionPlanResponse res;
+  ASSERT_TRUE(pipeline_->generatePlan(planning_scene_, request_, res));
+  EXPECT_NEAR(getPathLength(res), 1.0, 1e-6);
+  EXPECT_FALSE(planner->wasTerminated());
+}
+
+TEST_F(PlanningPipelineFixture, TerminateCancelsAllMembers)
+{
+  auto first = std::make_shared<FixedTimePlanner>(5.0, 1.0);
+  auto second = std::make_shared<FixedTimePlanner>(5.0, 0.5);
+  setPortfolio({ first, second }, true);
+
+  boost::thread terminator([this] {
+    boost::this_thread::sleep_for(boost::chrono::milliseconds(200));
+    pipeline_->terminate();
+  });
+  planning_interface::MotionPlanResponse res;
+  ros::WallTime start = ros::WallTime::now();
+  EXPECT_FALSE(pipeline_->generatePlan(planning_scene_, request_, res));
+  terminator.join();
+  EXPECT_LT(getSeconds(start), 1.0);
+  EXPECT_EQ(res.error_code_.val, moveit_msgs::MoveItErrorCodes::PREEMPTED);
+  EXPECT_TRUE(first->wasTerminated());
+  EXPECT_TRUE(second->wasTerminated());
+}
+}  // namespace planning_pipeline
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  ros::init(argc, argv, "test_planning_pipeline_portfolio");
+  return RUN_ALL_TESTS();
+}
@@ -83,9 +83,18 @@ public:
   {
     ROS_DEBUG("Running '%s'", getDescription().c_str());
 
-    // get the specified start state
-    moveit::core::RobotState start_state = planning_scene->getCurrentState();
-    moveit::core::robotStateMsgToRobotState(planning_scene->getTransforms(), req.start_state, start_state);
+    // get the specified start state; it is shared with the other adapters, so it is only copied once we need to
+    // change it
+    moveit::core::RobotStateConstPtr start_state = getStartState(planning_scene, req);
+    moveit::core::RobotStatePtr fixed_state;
+    const auto mutable_start_state = [&]() -> moveit::core::RobotState& {
+      if (!fixed_state)
+      {
+        fixed_state.reset(new moveit::core::RobotState(*start_state));
+        start_state = fixed_state;
+      }
+      return *fixed_state;
+    };
 
     const std::vector<const moveit::core::JointModel*>& jmodels =
         planning_scene->getRobotModel()->hasJointModelGroup(req.group_name) ?
@@ -105,22 +114,25 @@ public:
       {
         if (static_cast<const moveit::core::RevoluteJointModel*>(jm)->isContinuous())
         {
-          double initial = start_state.getJointPositions(jm)[0];
-          start_state.enforceBounds(jm);
-          double after = start_state.getJointPositions(jm)[0];
+          double initial = start_state->getJointPositions(jm)[0];
+          double after = initial;
+          jm->enforcePositionBounds(&after);
           if (fabs(initial - after) > std::numeric_limits<double>::epsilon())
+          {
+            mutable_start_state().setJointPositions(jm, &after);
             change_req = true;
+          }
         }
       }
       else
           // Normalize yaw; no offset needs to be remembered
           if (jm->getType() == moveit::core::JointModel::PLANAR)
       {
-        const double* p = start_state.getJointPositions(jm);
+        const double* p = start_state->getJointPositions(jm);
         double copy[3] = { p[0], p[1], p[2] };
         if (static_cast<const moveit::core::PlanarJointModel*>(jm)->normalizeRotation(copy))
         {
-          start_state.setJointPositions(jm, copy);
+          mutable_start_state().setJointPositions(jm, copy);
           change_req = true;
         }
       }
@@ -128,11 +140,11 @@ public:
           // Normalize quaternions
           if (jm->getType() == moveit::core::JointModel::FLOATING)
       {
-        const double* p = start_state.getJointPositions(jm);
+        const double* p = start_state->getJointPositions(jm);
         double copy[7] = { p[0], p[1], p[2], p[3], p[4], p[5], p[6] };
         if (static_cast<const moveit::core::FloatingJointModel*>(jm)->normalizeRotation(copy))
         {
-          start_state.setJointPositions(jm, copy);
+          mutable_start_state().setJointPositions(jm, copy);
           change_req = true;
         }
       }
@@ -142,13 +154,13 @@ public:
     moveit::core::RobotStatePtr prefix_state;
     for (const moveit::core::JointModel* jmodel : jmodels)
     {
-      if (!start_state.satisfiesBounds(jmodel))
+      if (!start_state->satisfiesBounds(jmodel))
       {
-        if (start_state.satisfiesBounds(jmodel, bounds_dist_))
+        if (start_state->satisfiesBounds(jmodel, bounds_dist_))
         {
           if (!prefix_state)
-            prefix_state.reset(new moveit::core::RobotState(start_state));
-          start_state.enforceBounds(jmodel);
+            prefix_state.reset(new moveit::core::RobotState(*start_state));
+          mutable_start_state().enforceBounds(jmodel);
           change_req = true;
           ROS_INFO("Starting state is just outside bounds (joint '%s'). Assuming within bounds.",
                    jmodel->getName().c_str());
@@ -158,7 +170,7 @@ public:
           std::stringstream joint_values;
           std::stringstream joint_bounds_low;
           std::stringstream joint_bounds_hi;
-          const double* p = start_state.getJointPositions(jmodel);
+          const double* p = start_state->getJointPositions(jmodel);
           for (std::size_t k = 0; k < jmodel->getVariableCount(); ++k)
             joint_values << p[k] << " ";
           const moveit::core::JointModel::Bounds& b = jmodel->getVariableBounds();
@@ -181,7 +193,7 @@ public:
     if (change_req)
     {
       planning_interface::MotionPlanRequest req2 = req;
-      moveit::core::robotStateToRobotStateMsg(start_state, req2.start_state);
+      moveit::core::robotStateToRobotStateMsg(*start_state, req2.start_state);
       solved = planner(planning_scene, req2, res);
     }
     else
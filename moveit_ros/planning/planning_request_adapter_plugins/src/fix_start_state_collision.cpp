@@ -99,26 +99,26 @@ public:
     ROS_DEBUG("Running '%s'", getDescription().c_str());
 
     // get the specified start state
-    moveit::core::RobotState start_state = planning_scene->getCurrentState();
-    moveit::core::robotStateMsgToRobotState(planning_scene->getTransforms(), req.start_state, start_state);
+    moveit::core::RobotStateConstPtr original_start_state = getStartState(planning_scene, req);
 
     collision_detection::CollisionRequest creq;
     creq.group_name = req.group_name;
     collision_detection::CollisionResult cres;
-    planning_scene->checkCollision(creq, cres, start_state);
+    planning_scene->checkCollision(creq, cres, *original_start_state);
     if (cres.collision)
     {
       // Rerun in verbose mode
       collision_detection::CollisionRequest vcreq = creq;
       collision_detection::CollisionResult vcres;
       vcreq.verbose = true;
-      planning_scene->checkCollision(vcreq, vcres, start_state);
+      planning_scene->checkCollision(vcreq, vcres, *original_start_state);
 
       if (creq.group_name.empty())
         ROS_INFO("Start state appears to be in collision");
       else
         ROS_INFO_STREAM("Start state appears to be in collision with respect to group " << creq.group_name);
 
+      moveit::core::RobotState start_state = *original_start_state;
       moveit::core::RobotStatePtr prefix_state(new moveit::core::RobotState(start_state));
       random_numbers::RandomNumberGenerator& rng = prefix_state->getRandomNumberGenerator();
 
@@ -66,8 +66,8 @@ public:
     ROS_DEBUG("Running '%s'", getDescription().c_str());
 
     // get the specified start state
-    moveit::core::RobotState start_state = planning_scene->getCurrentState();
-    moveit::core::robotStateMsgToRobotState(planning_scene->getTransforms(), req.start_state, start_state);
+    moveit::core::RobotStateConstPtr start_state_ptr = getStartState(planning_scene, req);
+    const moveit::core::RobotState& start_state = *start_state_ptr;
 
     // if the start state is otherwise valid but does not meet path constraints
     if (planning_scene->isStateValid(start_state, req.group_name) &&
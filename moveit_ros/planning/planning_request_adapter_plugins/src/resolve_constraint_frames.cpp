@@ -41,6 +41,22 @@
 
 namespace default_planner_request_adapters
 {
+namespace
+{
+// Only constraints on frames that are not robot links (attached bodies or subframes) are changed by
+// kinematic_constraints::resolveConstraintFrames()
+bool needsResolving(const moveit::core::RobotModel& robot_model, const moveit_msgs::Constraints& constraints)
+{
+  for (const moveit_msgs::PositionConstraint& c : constraints.position_constraints)
+    if (!robot_model.hasLinkModel(c.link_name))
+      return true;
+  for (const moveit_msgs::OrientationConstraint& c : constraints.orientation_constraints)
+    if (!robot_model.hasLinkModel(c.link_name))
+      return true;
+  return false;
+}
+}  // namespace
+
 class ResolveConstraintFrames : public planning_request_adapter::PlanningRequestAdapter
 {
 public:
@@ -62,6 +78,15 @@ public:
                     std::vector<std::size_t>& /*added_path_index*/) const override
   {
     ROS_DEBUG("Running '%s'", getDescription().c_str());
+
+    // pass the request on unchanged (and without copying it) if all constraints are already on robot links
+    const moveit::core::RobotModel& robot_model = *planning_scene->getRobotModel();
+    bool resolve = needsResolving(robot_model, req.path_constraints);
+    for (const moveit_msgs::Constraints& constraint : req.goal_constraints)
+      resolve = resolve || needsResolving(robot_model, constraint);
+    if (!resolve)
+      return planner(planning_scene, req, res);
+
     planning_interface::MotionPlanRequest modified = req;
     kinematic_constraints::resolveConstraintFrames(planning_scene->getCurrentState(), modified.path_constraints);
     for (moveit_msgs::Constraints& constraint : modified.goal_constraints)
@@ -43,6 +43,7 @@
 #include <boost/function.hpp>
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/condition_variable.hpp>
+#include <atomic>
 
 namespace planning_scene_monitor
 {
@@ -122,7 +123,8 @@ public:
    *  @return Returns the current state */
   moveit::core::RobotStatePtr getCurrentState() const;
 
-  /** @brief Set the state \e upd to the current state maintained by this class. */
+  /** @brief Set the state \e upd to the current state maintained by this class.
+   *  This reads a published snapshot of the state and never blocks the joint state callback. */
   void setToCurrentState(moveit::core::RobotState& upd) const;
 
   /** @brief Get the time stamp for the current state */
@@ -188,14 +190,60 @@ public:
   }
 
 private:
+  /** @brief A snapshot of the variables of robot_state_, published to lock-free readers.
+   *  Two of these buffers are used alternately: the writer fills the one readers are not directed to,
+   *  and the per-buffer sequence number lets readers detect (and retry) the rare case of a buffer
+   *  being overwritten while it is copied. */
+  struct StateBuffer
+  {
+    std::atomic<unsigned int> sequence{ 0 };
+    std::vector<double> position;
+    std::vector<double> velocity;
+    std::vector<double> acceleration;
+    std::vector<double> effort;
+    bool has_velocity = false;
+    bool has_acceleration = false;
+    bool has_effort = false;
+    ros::Time stamp;
+  };
+
   void jointStateCallback(const sensor_msgs::JointStateConstPtr& joint_state);
   void tfCallback();
 
+  /** @brief Recompute layout_joints_ for the joint names of a message with a new layout */
+  void updateMessageLayout(const std::vector<std::string>& names);
+
+  /** @brief Copy robot_state_ into the inactive state buffer and make it the active one.
+   *  Must be called with state_update_lock_ held. */
+  void publishState();
+
+  /** @brief Copy the most recently published state into \e upd, optionally including dynamics.
+   *  @return The time stamp of the copied state */
+  ros::Time readState(moveit::core::RobotState& upd, bool copy_dynamics) const;
+
+  /** @brief Mark the joint with index \e index as updated at time \e t */
+  void setJointTime(int index, const ros::Time& t)
+  {
+    joint_time_[index] = t;
+    joint_time_known_[index] = true;
+  }
+
   ros::NodeHandle nh_;
   std::shared_ptr<tf2_ros::Buffer> tf_buffer_;
   moveit::core::RobotModelConstPtr robot_model_;
   moveit::core::RobotState robot_state_;
-  std::map<const moveit::core::JointModel*, ros::Time> joint_time_;
+
+  // time of the last update of each joint, indexed by JointModel::getJointIndex()
+  std::vector<ros::Time> joint_time_;
+  std::vector<bool> joint_time_known_;
+
+  // joint names of the last received joint state message and the matching (single-variable) joint models,
+  // so that the common case of a publisher reusing the same layout does not require any name lookups
+  std::vector<std::string> layout_names_;
+  std::vector<const moveit::core::JointModel*> layout_joints_;
+
+  StateBuffer state_buffers_[2];
+  std::atomic<unsigned int> active_state_buffer_;
   bool state_monitor_started_;
   bool copy_dynamics_;  // Copy velocity and effort from joint_state
   ros::Time monitor_start_time_;
@@ -49,12 +49,49 @@
 #include <boost/noncopyable.hpp>
 #include <boost/thread/shared_mutex.hpp>
 #include <boost/thread/recursive_mutex.hpp>
+#include <atomic>
 #include <memory>
+#include <ostream>
 
 namespace planning_scene_monitor
 {
 MOVEIT_CLASS_FORWARD(PlanningSceneMonitor);  // Defines PlanningSceneMonitorPtr, ConstPtr, WeakPtr... etc
 
+/** \brief A histogram of latencies that can be filled from multiple threads without locking.
+    Bucket 0 counts latencies below 1us, bucket i > 0 counts latencies in [2^(i-1), 2^i) us.
+    The last bucket also counts all latencies that are longer. */
+class LatencyHistogram : private boost::noncopyable
+{
+public:
+  static const std::size_t BUCKET_COUNT = 24;
+
+  LatencyHistogram();
+
+  /** \brief Record one latency sample */
+  void add(const ros::WallDuration& latency);
+
+  /** \brief Get the total number of recorded samples */
+  std::size_t getCount() const;
+
+  /** \brief Get the number of samples in each bucket */
+  std::vector<std::size_t> getBucketCounts() const;
+
+  /** \brief Get the upper bound (in seconds) of the bucket below which a fraction \e p of the samples lies */
+  double getPercentile(double p) const;
+
+  /** \brief Get the upper bound (in seconds) of bucket \e index */
+  static double getBucketUpperBound(std::size_t index);
+
+  /** \brief Forget all recorded samples */
+  void clear();
+
+  /** \brief Print the non-empty buckets */
+  void print(std::ostream& out) const;
+
+private:
+  std::atomic<std::size_t> buckets_[BUCKET_COUNT];
+};
+
 /**
  * @brief PlanningSceneMonitor
  * Subscribes to the topic \e planning_scene */
@@ -270,6 +307,18 @@ public:
   /** \brief Set the maximum frequency at which planning scenes are being published */
   void setPlanningScenePublishingFrequency(double hz);
 
+  /** \brief When an update requires publishing the complete scene (UPDATE_SCENE), publish only what changed since the
+      last published scene instead. Unchanged objects are left out and moved objects are sent without their geometry,
+      see PlanningScene::getPlanningSceneDeltaMsg().
+
+      This is disabled by default: the published topic is not latched and the deltas carry no revision, so a subscriber
+      that joins late or misses a message cannot tell and diverges from the monitored scene. Only enable it if all
+      subscribers are known to receive every message from the start. */
+  void publishSceneDeltas(bool flag)
+  {
+    publish_scene_deltas_ = flag;
+  }
+
   /** \brief Get the maximum frequency at which planning scenes are published (Hz) */
   double getPlanningScenePublishingFrequency() const
   {
@@ -407,6 +456,37 @@ public:
    */
   void unlockSceneWrite();
 
+  /** \brief Enable or disable the publication of scene snapshots. While enabled, every update that is signaled with
+      triggerSceneUpdateEvent() also publishes an immutable copy of the maintained scene. Updates of the robot state
+      only publish a diff on top of the last full copy. All other updates publish a new full copy, derived from the
+      previous one so that the objects that did not change keep their collision geometry. */
+  void enableSceneSnapshots(bool flag);
+
+  /** \brief Check whether scene snapshots are published */
+  bool sceneSnapshotsEnabled() const
+  {
+    return snapshots_enabled_;
+  }
+
+  /** \brief Get the most recently published snapshot of the maintained scene. The snapshot is never modified, so it
+      can be used for as long as needed without holding any lock: readers do not delay scene updates and updates do
+      not delay readers. The octomap of a snapshot is a read-only copy, shared between snapshots until the monitored
+      octomap changes. If snapshots are not enabled, this makes a copy of the current scene while holding the read
+      lock. */
+  planning_scene::PlanningSceneConstPtr getSceneSnapshot();
+
+  /** \brief Latencies of getSceneSnapshot() */
+  const LatencyHistogram& getSnapshotReadLatency() const
+  {
+    return snapshot_read_latency_;
+  }
+
+  /** \brief Latencies between signaling a scene update and publishing the corresponding snapshot */
+  const LatencyHistogram& getSnapshotPublishLatency() const
+  {
+    return snapshot_publish_latency_;
+  }
+
   void clearOctomap();
 
   // Called to update the planning scene with a new message.
@@ -498,6 +578,13 @@ protected:
   SceneUpdateType publish_update_types_;
   SceneUpdateType new_scene_update_;
   boost::condition_variable_any new_scene_update_condition_;
+  bool publish_scene_deltas_;
+  /// copy of the world as it was last published, shares all objects that did not change since
+  // This field is protected by scene_update_mutex_
+  collision_detection::WorldConstPtr published_world_;
+  /// true if the octree changed since the scene was last published
+  // This field is protected by scene_update_mutex_
+  bool octomap_updated_;
 
   // subscribe to various sources of data
   ros::Subscriber planning_scene_subscriber_;
@@ -546,6 +633,9 @@ private:
   // called by state_update_timer_ when a state update it pending
   void stateUpdateTimerCallback(const ros::WallTimerEvent& event);
 
+  // build a snapshot of scene_ after an update of type update_type and make it the current snapshot
+  void publishSceneSnapshot(SceneUpdateType update_type);
+
   // Callback for a new planning scene msg
   void newPlanningSceneCallback(const moveit_msgs::PlanningSceneConstPtr& scene);
 
@@ -578,6 +668,29 @@ private:
   // Only access this from callback functions (and constructor)
   ros::WallTime last_robot_state_update_wall_time_;
 
+  /// True when every scene update also publishes a snapshot
+  std::atomic<bool> snapshots_enabled_;
+
+  /// The current snapshot. Only accessed through std::atomic_load() and std::atomic_store()
+  planning_scene::PlanningSceneConstPtr scene_snapshot_;
+
+  /// The last full snapshot, which is the parent of the snapshots published for state updates
+  // This field is protected by snapshot_publish_mutex_
+  planning_scene::PlanningSceneConstPtr scene_snapshot_base_;
+
+  /// The read-only copy of the monitored octree that the snapshots share
+  // This field is protected by snapshot_publish_mutex_
+  std::shared_ptr<const octomap::OcTree> snapshot_octree_;
+
+  /// True when the monitored octree changed since snapshot_octree_ was copied
+  std::atomic<bool> snapshot_octree_changed_;
+
+  /// Serializes the publishing of snapshots
+  boost::mutex snapshot_publish_mutex_;
+
+  LatencyHistogram snapshot_read_latency_;
+  LatencyHistogram snapshot_publish_latency_;
+
   robot_model_loader::RobotModelLoaderPtr rm_loader_;
   moveit::core::RobotModelConstPtr robot_model_;
 
@@ -39,6 +39,8 @@
 #include <tf2_eigen/tf2_eigen.h>
 #include <tf2_geometry_msgs/tf2_geometry_msgs.h>
 
+#include <algorithm>
+#include <cstring>
 #include <limits>
 
 planning_scene_monitor::CurrentStateMonitor::CurrentStateMonitor(const moveit::core::RobotModelConstPtr& robot_model,
@@ -54,11 +56,25 @@ planning_scene_monitor::CurrentStateMonitor::CurrentStateMonitor(const moveit::c
   , tf_buffer_(tf_buffer)
   , robot_model_(robot_model)
   , robot_state_(robot_model)
+  , joint_time_(robot_model->getJointModelCount())
+  , joint_time_known_(robot_model->getJointModelCount(), false)
+  , active_state_buffer_(0)
   , state_monitor_started_(false)
   , copy_dynamics_(false)
   , error_(std::numeric_limits<double>::epsilon())
 {
   robot_state_.setToDefaultValues();
+
+  // preallocate the snapshot buffers, so that publishing a state never allocates
+  const std::size_t variable_count = robot_model_->getVariableCount();
+  for (StateBuffer& buffer : state_buffers_)
+  {
+    buffer.position.resize(variable_count);
+    buffer.velocity.resize(variable_count);
+    buffer.acceleration.resize(variable_count);
+    buffer.effort.resize(variable_count);
+  }
+  publishState();
 }
 
 planning_scene_monitor::CurrentStateMonitor::~CurrentStateMonitor()
@@ -68,9 +84,9 @@ planning_scene_monitor::CurrentStateMonitor::~CurrentStateMonitor()
 
 moveit::core::RobotStatePtr planning_scene_monitor::CurrentStateMonitor::getCurrentState() const
 {
-  boost::mutex::scoped_lock slock(state_update_lock_);
-  moveit::core::RobotState* result = new moveit::core::RobotState(robot_state_);
-  return moveit::core::RobotStatePtr(result);
+  moveit::core::RobotStatePtr result(new moveit::core::RobotState(robot_model_));
+  readState(*result, true);
+  return result;
 }
 
 ros::Time planning_scene_monitor::CurrentStateMonitor::getCurrentStateTime() const
@@ -82,9 +98,9 @@ ros::Time planning_scene_monitor::CurrentStateMonitor::getCurrentStateTime() con
 std::pair<moveit::core::RobotStatePtr, ros::Time>
 planning_scene_monitor::CurrentStateMonitor::getCurrentStateAndTime() const
 {
-  boost::mutex::scoped_lock slock(state_update_lock_);
-  moveit::core::RobotState* result = new moveit::core::RobotState(robot_state_);
-  return std::make_pair(moveit::core::RobotStatePtr(result), current_state_time_);
+  moveit::core::RobotStatePtr result(new moveit::core::RobotState(robot_model_));
+  ros::Time stamp = readState(*result, true);
+  return std::make_pair(result, stamp);
 }
 
 std::map<std::string, double> planning_scene_monitor::CurrentStateMonitor::getCurrentStateValues() const
@@ -100,26 +116,63 @@ std::map<std::string, double> planning_scene_monitor::CurrentStateMonitor::getCu
 
 void planning_scene_monitor::CurrentStateMonitor::setToCurrentState(moveit::core::RobotState& upd) const
 {
-  boost::mutex::scoped_lock slock(state_update_lock_);
-  const double* pos = robot_state_.getVariablePositions();
-  upd.setVariablePositions(pos);
-  if (copy_dynamics_)
+  readState(upd, copy_dynamics_);
+}
+
+void planning_scene_monitor::CurrentStateMonitor::publishState()
+{
+  // Fill the buffer readers are currently not directed to. Its sequence number is odd while it is being written,
+  // so that a reader still copying from it (because two updates happened during its copy) notices and retries.
+  unsigned int next = 1 - active_state_buffer_.load(std::memory_order_relaxed);
+  StateBuffer& buffer = state_buffers_[next];
+  const std::size_t bytes = buffer.position.size() * sizeof(double);
+
+  unsigned int sequence = buffer.sequence.load(std::memory_order_relaxed);
+  buffer.sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  std::memcpy(buffer.position.data(), robot_state_.getVariablePositions(), bytes);
+  buffer.has_velocity = robot_state_.hasVelocities();
+  if (buffer.has_velocity)
+    std::memcpy(buffer.velocity.data(), robot_state_.getVariableVelocities(), bytes);
+  buffer.has_acceleration = robot_state_.hasAccelerations();
+  if (buffer.has_acceleration)
+    std::memcpy(buffer.acceleration.data(), robot_state_.getVariableAccelerations(), bytes);
+  buffer.has_effort = robot_state_.hasEffort();
+  if (buffer.has_effort)
+    std::memcpy(buffer.effort.data(), robot_state_.getVariableEffort(), bytes);
+  buffer.stamp = current_state_time_;
+
+  buffer.sequence.store(sequence + 2, std::memory_order_release);
+  active_state_buffer_.store(next, std::memory_order_release);
+}
+
+ros::Time planning_scene_monitor::CurrentStateMonitor::readState(moveit::core::RobotState& upd,
+                                                                 bool copy_dynamics) const
+{
+  while (true)
   {
-    if (robot_state_.hasVelocities())
+    const StateBuffer& buffer = state_buffers_[active_state_buffer_.load(std::memory_order_acquire)];
+    unsigned int sequence = buffer.sequence.load(std::memory_order_acquire);
+    if (sequence & 1)
+      continue;  // the writer already moved on to this buffer again
+
+    // anything read here may be torn by a concurrent writer; the sequence check below detects that
+    upd.setVariablePositions(buffer.position.data());
+    if (copy_dynamics)
     {
-      const double* vel = robot_state_.getVariableVelocities();
-      upd.setVariableVelocities(vel);
-    }
-    if (robot_state_.hasAccelerations())
-    {
-      const double* acc = robot_state_.getVariableAccelerations();
-      upd.setVariableAccelerations(acc);
-    }
-    if (robot_state_.hasEffort())
-    {
-      const double* eff = robot_state_.getVariableEffort();
-      upd.setVariableEffort(eff);
+      if (buffer.has_velocity)
+        upd.setVariableVelocities(buffer.velocity.data());
+      if (buffer.has_acceleration)
+        upd.setVariableAccelerations(buffer.acceleration.data());
+      if (buffer.has_effort)
+        upd.setVariableEffort(buffer.effort.data());
     }
+    ros::Time stamp = buffer.stamp;
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (buffer.sequence.load(std::memory_order_relaxed) == sequence)
+      return stamp;
   }
 }
 
@@ -138,7 +191,10 @@ void planning_scene_monitor::CurrentStateMonitor::startStateMonitor(const std::s
 {
   if (!state_monitor_started_ && robot_model_)
   {
-    joint_time_.clear();
+    std::fill(joint_time_.begin(), joint_time_.end(), ros::Time());
+    std::fill(joint_time_known_.begin(), joint_time_known_.end(), false);
+    layout_names_.clear();
+    layout_joints_.clear();
     if (joint_states_topic.empty())
       ROS_ERROR("The joint states topic cannot be an empty string");
     else
@@ -188,7 +244,7 @@ bool planning_scene_monitor::CurrentStateMonitor::haveCompleteState() const
   const std::vector<const moveit::core::JointModel*>& joints = robot_model_->getActiveJointModels();
   boost::mutex::scoped_lock slock(state_update_lock_);
   for (const moveit::core::JointModel* joint : joints)
-    if (joint_time_.find(joint) == joint_time_.end())
+    if (!joint_time_known_[joint->getJointIndex()])
     {
       if (!joint->isPassive() && !joint->getMimic())
       {
@@ -205,7 +261,7 @@ bool planning_scene_monitor::CurrentStateMonitor::haveCompleteState(std::vector<
   const std::vector<const moveit::core::JointModel*>& joints = robot_model_->getActiveJointModels();
   boost::mutex::scoped_lock slock(state_update_lock_);
   for (const moveit::core::JointModel* joint : joints)
-    if (joint_time_.find(joint) == joint_time_.end())
+    if (!joint_time_known_[joint->getJointIndex()])
       if (!joint->isPassive() && !joint->getMimic())
       {
         missing_states.push_back(joint->getName());
@@ -225,16 +281,15 @@ bool planning_scene_monitor::CurrentStateMonitor::haveCompleteState(const ros::D
   {
     if (joint->isPassive() || joint->getMimic())
       continue;
-    std::map<const moveit::core::JointModel*, ros::Time>::const_iterator it = joint_time_.find(joint);
-    if (it == joint_time_.end())
+    if (!joint_time_known_[joint->getJointIndex()])
     {
       ROS_DEBUG("Joint '%s' has never been updated", joint->getName().c_str());
       result = false;
     }
-    else if (it->second < old)
+    else if (joint_time_[joint->getJointIndex()] < old)
     {
       ROS_DEBUG("Joint '%s' was last updated %0.3lf seconds ago (older than the allowed %0.3lf seconds)",
-                joint->getName().c_str(), (now - it->second).toSec(), age.toSec());
+                joint->getName().c_str(), (now - joint_time_[joint->getJointIndex()]).toSec(), age.toSec());
       result = false;
     }
   }
@@ -253,17 +308,16 @@ bool planning_scene_monitor::CurrentStateMonitor::haveCompleteState(const ros::D
   {
     if (joint->isPassive() || joint->getMimic())
       continue;
-    std::map<const moveit::core::JointModel*, ros::Time>::const_iterator it = joint_time_.find(joint);
-    if (it == joint_time_.end())
+    if (!joint_time_known_[joint->getJointIndex()])
     {
       ROS_DEBUG("Joint '%s' has never been updated", joint->getName().c_str());
       missing_states.push_back(joint->getName());
       result = false;
     }
-    else if (it->second < old)
+    else if (joint_time_[joint->getJointIndex()] < old)
     {
       ROS_DEBUG("Joint '%s' was last updated %0.3lf seconds ago (older than the allowed %0.3lf seconds)",
-                joint->getName().c_str(), (now - it->second).toSec(), age.toSec());
+                joint->getName().c_str(), (now - joint_time_[joint->getJointIndex()]).toSec(), age.toSec());
       missing_states.push_back(joint->getName());
       result = false;
     }
@@ -345,19 +399,20 @@ void planning_scene_monitor::CurrentStateMonitor::jointStateCallback(const senso
 
   {
     boost::mutex::scoped_lock _(state_update_lock_);
+    // publishers usually send the same joints in the same order, so only look up the names when they change
+    if (joint_state->name != layout_names_)
+      updateMessageLayout(joint_state->name);
+
     // read the received values, and update their time stamps
     std::size_t n = joint_state->name.size();
     current_state_time_ = joint_state->header.stamp;
     for (std::size_t i = 0; i < n; ++i)
     {
-      const moveit::core::JointModel* jm = robot_model_->getJointModel(joint_state->name[i]);
+      const moveit::core::JointModel* jm = layout_joints_[i];
       if (!jm)
         continue;
-      // ignore fixed joints, multi-dof joints (they should not even be in the message)
-      if (jm->getVariableCount() != 1)
-        continue;
 
-      joint_time_[jm] = joint_state->header.stamp;
+      setJointTime(jm->getJointIndex(), joint_state->header.stamp);
 
       if (robot_state_.getJointPositions(jm)[0] != joint_state->position[i])
       {
@@ -400,6 +455,7 @@ void planning_scene_monitor::CurrentStateMonitor::jointStateCallback(const senso
         }
       }
     }
+    publishState();
   }
 
   // callbacks, if needed
@@ -411,6 +467,20 @@ void planning_scene_monitor::CurrentStateMonitor::jointStateCallback(const senso
   state_update_condition_.notify_all();
 }
 
+void planning_scene_monitor::CurrentStateMonitor::updateMessageLayout(const std::vector<std::string>& names)
+{
+  layout_names_ = names;
+  layout_joints_.resize(names.size());
+  for (std::size_t i = 0; i < names.size(); ++i)
+  {
+    const moveit::core::JointModel* jm = robot_model_->getJointModel(names[i]);
+    // ignore fixed joints, multi-dof joints (they should not even be in the message)
+    if (jm && jm->getVariableCount() != 1)
+      jm = nullptr;
+    layout_joints_[i] = jm;
+  }
+}
+
 void planning_scene_monitor::CurrentStateMonitor::tfCallback()
 {
   // read multi-dof joint states from TF, if needed
@@ -443,9 +513,9 @@ void planning_scene_monitor::CurrentStateMonitor::tfCallback()
       }
 
       // allow update if time is more recent or if it is a static transform (time = 0)
-      if (latest_common_time <= joint_time_[joint] && latest_common_time > ros::Time(0))
+      if (latest_common_time <= joint_time_[joint->getJointIndex()] && latest_common_time > ros::Time(0))
         continue;
-      joint_time_[joint] = latest_common_time;
+      setJointTime(joint->getJointIndex(), latest_common_time);
 
       std::vector<double> new_values(joint->getStateSpaceDimension());
       const moveit::core::LinkModel* link = joint->getChildLinkModel();
@@ -463,6 +533,8 @@ void planning_scene_monitor::CurrentStateMonitor::tfCallback()
       robot_state_.setJointPositions(joint, new_values.data());
       update = true;
     }
+    if (update)
+      publishState();
   }
 
   // callbacks, if needed
@@ -47,7 +47,9 @@
 #include <tf2_eigen/tf2_eigen.h>
 #include <tf2_geometry_msgs/tf2_geometry_msgs.h>
 #include <moveit/profiler/profiler.h>
+#include <geometric_shapes/shapes.h>
 
+#include <cmath>
 #include <memory>
 
 namespace planning_scene_monitor
@@ -106,6 +108,77 @@ private:
   dynamic_reconfigure::Server<PlanningSceneMonitorDynamicReconfigureConfig> dynamic_reconfigure_server_;
 };
 
+LatencyHistogram::LatencyHistogram()
+{
+  clear();
+}
+
+void LatencyHistogram::add(const ros::WallDuration& latency)
+{
+  int64_t us = latency.toNSec() / 1000;
+  std::size_t index = 0;
+  while (us > 0 && index + 1 < BUCKET_COUNT)
+  {
+    us >>= 1;
+    ++index;
+  }
+  buckets_[index].fetch_add(1, std::memory_order_relaxed);
+}
+
+std::size_t LatencyHistogram::getCount() const
+{
+  std::size_t count = 0;
+  for (const std::atomic<std::size_t>& bucket : buckets_)
+    count += bucket.load(std::memory_order_relaxed);
+  return count;
+}
+
+std::vector<std::size_t> LatencyHistogram::getBucketCounts() const
+{
+  std::vector<std::size_t> counts(BUCKET_COUNT);
+  for (std::size_t i = 0; i < BUCKET_COUNT; ++i)
+    counts[i] = buckets_[i].load(std::memory_order_relaxed);
+  return counts;
+}
+
+double LatencyHistogram::getPercentile(double p) const
+{
+  std::vector<std::size_t> counts = getBucketCounts();
+  std::size_t total = 0;
+  for (std::size_t count : counts)
+    total += count;
+  if (total == 0)
+    return 0.0;
+  const double threshold = std::min(std::max(p, 0.0), 1.0) * total;
+  std::size_t seen = 0;
+  for (std::size_t i = 0; i < BUCKET_COUNT; ++i)
+  {
+    seen += counts[i];
+    if (seen > 0 && seen >= threshold)
+      return getBucketUpperBound(i);
+  }
+  return getBucketUpperBound(BUCKET_COUNT - 1);
+}
+
+double LatencyHistogram::getBucketUpperBound(std::size_t index)
+{
+  return std::ldexp(1e-6, index);
+}
+
+void LatencyHistogram::clear()
+{
+  for (std::atomic<std::size_t>& bucket : buckets_)
+    bucket.store(0, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::print(std::ostream& out) const
+{
+  std::vector<std::size_t> counts = getBucketCounts();
+  for (std::size_t i = 0; i < BUCKET_COUNT; ++i)
+    if (counts[i] > 0)
+      out << "  < " << getBucketUpperBound(i) * 1e6 << " us: " << counts[i] << std::endl;
+}
+
 const std::string PlanningSceneMonitor::DEFAULT_JOINT_STATES_TOPIC = "joint_states";
 const std::string PlanningSceneMonitor::DEFAULT_ATTACHED_COLLISION_OBJECT_TOPIC = "attached_collision_object";
 const std::string PlanningSceneMonitor::DEFAULT_COLLISION_OBJECT_TOPIC = "collision_object";
@@ -172,6 +245,9 @@ PlanningSceneMonitor::~PlanningSceneMonitor()
   spinner_.reset();
   delete reconfigure_impl_;
   current_state_monitor_.reset();
+  std::atomic_store(&scene_snapshot_, planning_scene::PlanningSceneConstPtr());
+  scene_snapshot_base_.reset();
+  snapshot_octree_.reset();
   scene_const_.reset();
   scene_.reset();
   parent_scene_.reset();
@@ -237,6 +313,10 @@ void PlanningSceneMonitor::initialize(const planning_scene::PlanningScenePtr& sc
 
   publish_planning_scene_frequency_ = 2.0;
   new_scene_update_ = UPDATE_NONE;
+  publish_scene_deltas_ = false;
+  octomap_updated_ = false;
+  snapshots_enabled_ = false;
+  snapshot_octree_changed_ = false;
 
   last_update_time_ = last_robot_motion_time_ = ros::Time::now();
   last_robot_state_update_wall_time_ = ros::WallTime::now();
@@ -339,10 +419,13 @@ void PlanningSceneMonitor::scenePublishingThread()
   {
     moveit_msgs::PlanningScene msg;
     {
+      boost::unique_lock<boost::shared_mutex> ulock(scene_update_mutex_);
       occupancy_map_monitor::OccMapTree::ReadLock lock;
       if (octomap_monitor_)
         lock = octomap_monitor_->getOcTreePtr()->reading();
       scene_->getPlanningSceneMsg(msg);
+      published_world_ = std::make_shared<const collision_detection::World>(*scene_->getWorld());
+      octomap_updated_ = false;
     }
     planning_scene_publisher_.publish(msg);
     ROS_DEBUG_NAMED(LOGNAME, "Published the full planning scene: '%s'", msg.name.c_str());
@@ -399,8 +482,15 @@ void PlanningSceneMonitor::scenePublishingThread()
             occupancy_map_monitor::OccMapTree::ReadLock lock;
             if (octomap_monitor_)
               lock = octomap_monitor_->getOcTreePtr()->reading();
-            scene_->getPlanningSceneMsg(msg);
+            if (publish_scene_deltas_ && published_world_ &&
+                scene_->getPlanningSceneDeltaMsg(msg, *published_world_, octomap_updated_))
+              is_full = false;
+            else
+              scene_->getPlanningSceneMsg(msg);
           }
+          // subscribers now know the world as it is
+          published_world_ = std::make_shared<const collision_detection::World>(*scene_->getWorld());
+          octomap_updated_ = false;
           // also publish timestamp of this robot_state
           msg.robot_state.joint_state.header.stamp = last_robot_motion_time_;
           publish_msg = true;
@@ -460,6 +550,10 @@ bool PlanningSceneMonitor::updatesScene(const planning_scene::PlanningSceneConst
 
 void PlanningSceneMonitor::triggerSceneUpdateEvent(SceneUpdateType update_type)
 {
+  // publish the snapshot first, so callbacks already see the update in it
+  if (snapshots_enabled_)
+    publishSceneSnapshot(update_type);
+
   // do not modify update functions while we are calling them
   boost::recursive_mutex::scoped_lock lock(update_lock_);
 
@@ -977,6 +1071,184 @@ void PlanningSceneMonitor::unlockSceneWrite()
   scene_update_mutex_.unlock();
 }
 
+void PlanningSceneMonitor::enableSceneSnapshots(bool flag)
+{
+  if (flag == snapshots_enabled_)
+    return;
+  if (flag)
+  {
+    snapshots_enabled_ = true;
+    publishSceneSnapshot(UPDATE_SCENE);
+    ROS_INFO_NAMED(LOGNAME, "Publishing snapshots of the maintained planning scene");
+  }
+  else
+  {
+    snapshots_enabled_ = false;
+    boost::mutex::scoped_lock lock(snapshot_publish_mutex_);
+    std::atomic_store(&scene_snapshot_, planning_scene::PlanningSceneConstPtr());
+    scene_snapshot_base_.reset();
+    snapshot_octree_.reset();
+  }
+}
+
+planning_scene::PlanningSceneConstPtr PlanningSceneMonitor::getSceneSnapshot()
+{
+  ros::WallTime start = ros::WallTime::now();
+  planning_scene::PlanningSceneConstPtr snapshot = std::atomic_load(&scene_snapshot_);
+  if (!snapshot && scene_)
+  {
+    // no snapshots are published, copy the maintained scene instead
+    boost::shared_lock<boost::shared_mutex> slock(scene_update_mutex_);
+    occupancy_map_monitor::OccMapTree::ReadLock lock;
+    if (octomap_monitor_)
+      lock = octomap_monitor_->getOcTreePtr()->reading();
+    snapshot = planning_scene::PlanningScene::clone(scene_);
+  }
+  snapshot_read_latency_.add(ros::WallTime::now() - start);
+  return snapshot;
+}
+
+namespace
+{
+bool sameTransforms(const EigenSTL::vector_Isometry3d& a, const EigenSTL::vector_Isometry3d& b)
+{
+  if (a.size() != b.size())
+    return false;
+  for (std::size_t i = 0; i < a.size(); ++i)
+    if (a[i].matrix() != b[i].matrix())
+      return false;
+  return true;
+}
+
+bool sameObject(const collision_detection::World::Object& a, const collision_detection::World::Object& b)
+{
+  if (a.shapes_ != b.shapes_ || !sameTransforms(a.shape_poses_, b.shape_poses_) ||
+      a.subframe_poses_.size() != b.subframe_poses_.size())
+    return false;
+  for (const std::pair<const std::string, Eigen::Isometry3d>& subframe : a.subframe_poses_)
+  {
+    moveit::core::FixedTransformsMap::const_iterator it = b.subframe_poses_.find(subframe.first);
+    if (it == b.subframe_poses_.end() || it->second.matrix() != subframe.second.matrix())
+      return false;
+  }
+  return true;
+}
+
+// Make snapshot equal to scene, except for the object skipped_object_id. Objects that hold the same shapes at the
+// same poses in both are kept, so they share their collision geometry with the scene the snapshot was derived from.
+void updateSnapshot(planning_scene::PlanningScene& snapshot, const planning_scene::PlanningScene& scene,
+                    const std::string& skipped_object_id)
+{
+  snapshot.setName(scene.getName());
+  snapshot.setCurrentState(scene.getCurrentState());
+  snapshot.getTransformsNonConst().setAllTransforms(scene.getTransforms().getAllTransforms());
+  snapshot.getAllowedCollisionMatrixNonConst() = scene.getAllowedCollisionMatrix();
+  snapshot.getCollisionEnvNonConst()->setLinkPadding(scene.getCollisionEnv()->getLinkPadding());
+  snapshot.getCollisionEnvNonConst()->setLinkScale(scene.getCollisionEnv()->getLinkScale());
+  snapshot.propogateRobotPadding();
+
+  const collision_detection::World& world = *scene.getWorld();
+  const collision_detection::WorldPtr& snapshot_world = snapshot.getWorldNonConst();
+  for (const std::string& id : snapshot_world->getObjectIds())
+    if (id != skipped_object_id && !world.hasObject(id))
+      snapshot_world->removeObject(id);
+  for (const std::pair<const std::string, collision_detection::World::ObjectPtr>& object : world)
+  {
+    if (object.first == skipped_object_id)
+      continue;
+    collision_detection::World::ObjectConstPtr snapshot_object = snapshot_world->getObject(object.first);
+    if (snapshot_object && sameObject(*snapshot_object, *object.second))
+      continue;
+    snapshot_object.reset();
+    snapshot_world->removeObject(object.first);
+    snapshot_world->addToObject(object.first, object.second->shapes_, object.second->shape_poses_);
+    snapshot_world->setSubframesOfObject(object.first, object.second->subframe_poses_);
+  }
+
+  planning_scene::ObjectColorMap colors, snapshot_colors;
+  scene.getKnownObjectColors(colors);
+  snapshot.getKnownObjectColors(snapshot_colors);
+  for (const std::pair<const std::string, std_msgs::ColorRGBA>& color : snapshot_colors)
+    if (colors.find(color.first) == colors.end())
+      snapshot.removeObjectColor(color.first);
+  for (const std::pair<const std::string, std_msgs::ColorRGBA>& color : colors)
+    snapshot.setObjectColor(color.first, color.second);
+
+  planning_scene::ObjectTypeMap types, snapshot_types;
+  scene.getKnownObjectTypes(types);
+  snapshot.getKnownObjectTypes(snapshot_types);
+  for (const std::pair<const std::string, object_recognition_msgs::ObjectType>& type : snapshot_types)
+    if (types.find(type.first) == types.end())
+      snapshot.removeObjectType(type.first);
+  for (const std::pair<const std::string, object_recognition_msgs::ObjectType>& type : types)
+    snapshot.setObjectType(type.first, type.second);
+}
+}  // namespace
+
+void PlanningSceneMonitor::publishSceneSnapshot(SceneUpdateType update_type)
+{
+  if (!scene_)
+    return;
+
+  ros::WallTime start = ros::WallTime::now();
+  boost::mutex::scoped_lock lock(snapshot_publish_mutex_);
+  if (!snapshots_enabled_)
+    return;
+
+  planning_scene::PlanningScenePtr snapshot;
+  if (update_type == UPDATE_STATE && scene_snapshot_base_)
+  {
+    // only the robot state changed: share everything else with the last full snapshot
+    {
+      boost::shared_lock<boost::shared_mutex> slock(scene_update_mutex_);
+      snapshot = scene_snapshot_base_->diff();
+      snapshot->setCurrentState(scene_->getCurrentState());
+    }
+    snapshot->setName(scene_snapshot_base_->getName());
+  }
+  else
+  {
+    boost::shared_lock<boost::shared_mutex> slock(scene_update_mutex_);
+    occupancy_map_monitor::OccMapTree::ReadLock octree_lock;
+    if (octomap_monitor_)
+      octree_lock = octomap_monitor_->getOcTreePtr()->reading();
+
+    // the monitored octree is modified in place, so the snapshots share a read-only copy of it instead
+    const std::string& octomap_ns = planning_scene::PlanningScene::OCTOMAP_NS;
+    collision_detection::World::ObjectConstPtr map = scene_->getWorld()->getObject(octomap_ns);
+    const bool monitored_map =
+        octomap_monitor_ && map && map->shapes_.size() == 1 &&
+        static_cast<const shapes::OcTree*>(map->shapes_[0].get())->octree == octomap_monitor_->getOcTreePtr();
+
+    if (scene_snapshot_base_)
+    {
+      // derive the snapshot from the last full one, so the objects that did not change keep their collision geometry
+      snapshot = scene_snapshot_base_->diff();
+      snapshot->decoupleParent();
+      updateSnapshot(*snapshot, *scene_, monitored_map ? octomap_ns : std::string());
+    }
+    else
+      snapshot = planning_scene::PlanningScene::clone(scene_);
+
+    if (monitored_map)
+    {
+      // the copy is only made again after the octree changed
+      if (!snapshot_octree_ || snapshot_octree_changed_.exchange(false))
+        snapshot_octree_ = std::make_shared<const octomap::OcTree>(*octomap_monitor_->getOcTreePtr());
+      // nothing changes if the snapshot already holds the copy at the same pose
+      snapshot->processOctomapPtr(snapshot_octree_, map->shape_poses_[0]);
+    }
+    else
+      snapshot_octree_.reset();
+    scene_snapshot_base_ = snapshot;
+  }
+  // compute all transforms now, the snapshot is only accessed as const afterwards
+  snapshot->getCurrentStateNonConst().update();
+
+  std::atomic_store(&scene_snapshot_, planning_scene::PlanningSceneConstPtr(snapshot));
+  snapshot_publish_latency_.add(ros::WallTime::now() - start);
+}
+
 void PlanningSceneMonitor::startSceneMonitor(const std::string& scene_topic)
 {
   stopSceneMonitor();
@@ -1223,6 +1495,8 @@ void PlanningSceneMonitor::octomapUpdateCallback()
   {
     boost::unique_lock<boost::shared_mutex> ulock(scene_update_mutex_);
     last_update_time_ = ros::Time::now();
+    octomap_updated_ = true;
+    snapshot_octree_changed_ = true;
     octomap_monitor_->getOcTreePtr()->lockRead();
     try
     {
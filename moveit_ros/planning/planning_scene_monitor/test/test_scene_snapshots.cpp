@@ -0,0 +1,262 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, MoveIt maintainers
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/planning_scene_monitor/planning_scene_monitor.h>
+#include <ros/ros.h>
+#include <gtest/gtest.h>
+#include <boost/thread.hpp>
+#include <algorithm>
+#include <atomic>
+
+namespace planning_scene_monitor
+{
+namespace
+{
+const std::string URDF = R"(<?xml version="1.0"?>
+<robot name="test_robot">
+  <link name="base_link">
+    <collision><geometry><box size="0.2 0.2 0.2"/></geometry></collision>
+  </link>
+  <link name="l1">
+    <collision><origin xyz="0.5 0 0"/><geometry><box size="0.8 0.1 0.1"/></geometry></collision>
+  </link>
+  <joint name="j1" type="revolute"><parent link="base_link"/><child link="l1"/><axis xyz="0 0 1"/>
+    <origin xyz="0 0 0.5"/><limit lower="-3.14" upper="3.14" effort="10" velocity="2"/></joint>
+</robot>
+)";
+
+const std::string SRDF = R"(<?xml version="1.0"?>
+<robot name="test_robot">
+  <group name="arm"><joint name="j1"/></group>
+  <disable_collisions link1="base_link" link2="l1" reason="Adjacent"/>
+</robot>
+)";
+
+// a scene diff adding a 10cm box centered at (x, 0, 0), or removing the box
+moveit_msgs::PlanningScene makeBoxDiff(const std::string& id, double x,
+                                       int8_t operation = moveit_msgs::CollisionObject::ADD)
+{
+  moveit_msgs::CollisionObject object;
+  object.id = id;
+  object.header.frame_id = "base_link";
+  object.operation = operation;
+  if (operation == moveit_msgs::CollisionObject::ADD)
+  {
+    object.primitives.resize(1);
+    object.primitives[0].type = shape_msgs::SolidPrimitive::BOX;
+    object.primitives[0].dimensions = { 0.1, 0.1, 0.1 };
+    object.primitive_poses.resize(1);
+    object.primitive_poses[0].position.x = x;
+    object.primitive_poses[0].orientation.w = 1.0;
+  }
+
+  moveit_msgs::PlanningScene msg;
+  msg.is_diff = true;
+  msg.robot_state.is_diff = true;
+  msg.world.collision_objects.push_back(object);
+  return msg;
+}
+
+// a scene diff moving the joint of the robot
+moveit_msgs::PlanningScene makeStateDiff(double position)
+{
+  moveit_msgs::PlanningScene msg;
+  msg.is_diff = true;
+  msg.robot_state.is_diff = true;
+  msg.robot_state.joint_state.name = { "j1" };
+  msg.robot_state.joint_state.position = { position };
+  return msg;
+}
+
+bool isColliding(const planning_scene::PlanningSceneConstPtr& scene)
+{
+  collision_detection::CollisionRequest req;
+  collision_detection::CollisionResult res;
+  scene->checkCollision(req, res, scene->getCurrentState());
+  return res.collision;
+}
+}  // namespace
+
+TEST(LatencyHistogram, Buckets)
+{
+  LatencyHistogram histogram;
+  EXPECT_EQ(histogram.getCount(), 0u);
+  EXPECT_EQ(histogram.getPercentile(0.5), 0.0);
+
+  histogram.add(ros::WallDuration(0, 500));     // below 1us
+  histogram.add(ros::WallDuration(0, 1000));    // [1, 2) us
+  histogram.add(ros::WallDuration(0, 3000));    // [2, 4) us
+  histogram.add(ros::WallDuration(0, 3999));    // [2, 4) us
+  histogram.add(ros::WallDuration(3600, 0));    // beyond the last bucket
+  std::vector<std::size_t> counts = histogram.getBucketCounts();
+  ASSERT_EQ(counts.size(), static_cast<std::size_t>(LatencyHistogram::BUCKET_COUNT));
+  EXPECT_EQ(counts[0], 1u);
+  EXPECT_EQ(counts[1], 1u);
+  EXPECT_EQ(counts[2], 2u);
+  EXPECT_EQ(counts.back(), 1u);
+  EXPECT_EQ(histogram.getCount(), 5u);
+
+  EXPECT_DOUBLE_EQ(LatencyHistogram::getBucketUpperBound(0), 1e-6);
+  EXPECT_DOUBLE_EQ(LatencyHistogram::getBucketUpperBound(2), 4e-6);
+
+  histogram.clear();
+  EXPECT_EQ(histogram.getCount(), 0u);
+}
+
+TEST(LatencyHistogram, Percentiles)
+{
+  LatencyHistogram histogram;
+  for (int i = 0; i < 90; ++i)
+    histogram.add(ros::WallDuration(0, 1500));  // [1, 2) us
+  for (int i = 0; i < 10; ++i)
+    histogram.add(ros::WallDuration(0, 100000));  // [64, 128) us
+
+  EXPECT_DOUBLE_EQ(histogram.getPercentile(0.0), 2e-6);
+  EXPECT_DOUBLE_EQ(histogram.getPercentile(0.5), 2e-6);
+  EXPECT_DOUBLE_EQ(histogram.getPercentile(0.9), 2e-6);
+  EXPECT_DOUBLE_EQ(histogram.getPercentile(0.95), 128e-6);
+  EXPECT_DOUBLE_EQ(histogram.getPercentile(1.0), 128e-6);
+  // out of range fractions are clamped
+  EXPECT_DOUBLE_EQ(histogram.getPercentile(2.0), 128e-6);
+}
+
+class SceneSnapshotFixture : public testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    ros::NodeHandle nh;
+    nh.setParam("robot_description", URDF);
+    nh.setParam("robot_description_semantic", SRDF);
+    psm_ = std::make_shared<PlanningSceneMonitor>("robot_description");
+    ASSERT_TRUE(psm_->getPlanningScene());
+    psm_->enableSceneSnapshots(true);
+  }
+
+  PlanningSceneMonitorPtr psm_;
+};
+
+TEST_F(SceneSnapshotFixture, SnapshotsFollowUpdates)
+{
+  planning_scene::PlanningSceneConstPtr empty = psm_->getSceneSnapshot();
+  ASSERT_TRUE(empty);
+  EXPECT_EQ(empty->getWorld()->size(), 0u);
+  EXPECT_FALSE(isColliding(empty));
+
+  // a geometry update is visible in the next snapshot, the previous one does not change
+  ASSERT_TRUE(psm_->newPlanningSceneMessage(makeBoxDiff("box", 0.0)));
+  planning_scene::PlanningSceneConstPtr with_box = psm_->getSceneSnapshot();
+  ASSERT_NE(with_box, empty);
+  EXPECT_TRUE(with_box->getWorld()->hasObject("box"));
+  EXPECT_TRUE(isColliding(with_box));
+  EXPECT_EQ(empty->getWorld()->size(), 0u);
+  EXPECT_FALSE(isColliding(empty));
+
+  // a state update shares the world with the last full snapshot
+  ASSERT_TRUE(psm_->newPlanningSceneMessage(makeStateDiff(0.5)));
+  planning_scene::PlanningSceneConstPtr moved = psm_->getSceneSnapshot();
+  EXPECT_DOUBLE_EQ(moved->getCurrentState().getVariablePosition("j1"), 0.5);
+  EXPECT_DOUBLE_EQ(with_box->getCurrentState().getVariablePosition("j1"), 0.0);
+  EXPECT_EQ(moved->getWorld()->getObject("box"), with_box->getWorld()->getObject("box"));
+
+  // the next full snapshot keeps the objects that did not change
+  ASSERT_TRUE(psm_->newPlanningSceneMessage(makeBoxDiff("far_box", 2.0)));
+  planning_scene::PlanningSceneConstPtr two_boxes = psm_->getSceneSnapshot();
+  EXPECT_EQ(two_boxes->getWorld()->size(), 2u);
+  EXPECT_EQ(two_boxes->getWorld()->getObject("box"), with_box->getWorld()->getObject("box"));
+  EXPECT_DOUBLE_EQ(two_boxes->getCurrentState().getVariablePosition("j1"), 0.5);
+  EXPECT_TRUE(isColliding(two_boxes));
+
+  // removed objects are gone from the collision environment of the next snapshot as well
+  ASSERT_TRUE(psm_->newPlanningSceneMessage(makeBoxDiff("box", 0.0, moveit_msgs::CollisionObject::REMOVE)));
+  planning_scene::PlanningSceneConstPtr far_box = psm_->getSceneSnapshot();
+  EXPECT_FALSE(far_box->getWorld()->hasObject("box"));
+  EXPECT_TRUE(far_box->getWorld()->hasObject("far_box"));
+  EXPECT_FALSE(isColliding(far_box));
+  EXPECT_TRUE(isColliding(two_boxes));
+
+  // the last snapshot matches the monitored scene
+  LockedPlanningSceneRO scene(psm_);
+  std::vector<std::string> ids = scene->getWorld()->getObjectIds();
+  std::vector<std::string> snapshot_ids = far_box->getWorld()->getObjectIds();
+  std::sort(ids.begin(), ids.end());
+  std::sort(snapshot_ids.begin(), snapshot_ids.end());
+  EXPECT_EQ(ids, snapshot_ids);
+  EXPECT_DOUBLE_EQ(scene->getCurrentState().getVariablePosition("j1"),
+                   far_box->getCurrentState().getVariablePosition("j1"));
+
+  EXPECT_EQ(psm_->getSnapshotReadLatency().getCount(), 5u);
+  EXPECT_GE(psm_->getSnapshotPublishLatency().getCount(), 5u);
+}
+
+TEST_F(SceneSnapshotFixture, ConcurrentReadersSeeCompleteUpdates)
+{
+  const std::size_t object_count = 50;
+  std::atomic<bool> done(false);
+  std::atomic<std::size_t> failures(0);
+
+  // boxes are added in order, so every snapshot holds the first boxes and no snapshot holds fewer than an earlier one
+  boost::thread reader([&] {
+    std::size_t last_count = 0;
+    while (!done)
+    {
+      planning_scene::PlanningSceneConstPtr snapshot = psm_->getSceneSnapshot();
+      const std::size_t count = snapshot->getWorld()->size();
+      bool consistent = count >= last_count;
+      for (std::size_t i = 0; i < count; ++i)
+        consistent = consistent && snapshot->getWorld()->hasObject("box" + std::to_string(i));
+      if (!consistent)
+        ++failures;
+      last_count = count;
+    }
+  });
+
+  for (std::size_t i = 0; i < object_count; ++i)
+  {
+    ASSERT_TRUE(psm_->newPlanningSceneMessage(makeBoxDiff("box" + std::to_string(i), 2.0 + i)));
+    // the snapshot is published before the update returns
+    EXPECT_EQ(psm_->getSceneSnapshot()->getWorld()->size(), i + 1);
+  }
+  done = true;
+  reader.join();
+  EXPECT_EQ(failures, 0u);
+}
+}  // namespace planning_scene_monitor
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  ros::init(argc, argv, "test_scene_snapshots");
+  return RUN_ALL_TESTS();
+}
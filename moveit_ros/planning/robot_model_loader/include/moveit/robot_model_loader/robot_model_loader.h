@@ -40,6 +40,13 @@
 #include <moveit/robot_model/robot_model.h>
 #include <moveit/rdf_loader/rdf_loader.h>
 #include <moveit/kinematics_plugin_loader/kinematics_plugin_loader.h>
+#include <moveit/robot_model/link_transforms_plugin.h>
+
+namespace pluginlib
+{
+template <class T>
+class ClassLoader;
+}
 
 namespace robot_model_loader
 {
@@ -125,11 +132,18 @@ public:
   void loadKinematicsSolvers(const kinematics_plugin_loader::KinematicsPluginLoaderPtr& kloader =
                                  kinematics_plugin_loader::KinematicsPluginLoaderPtr());
 
+  /** @brief Load the plugin named by the <robot_description>_planning/link_transforms_plugin parameter, if any,
+      and let it register its specialized forward kinematics functions with the model.
+      This is done by the constructor if the robot description is loaded from the parameter server.
+      The model keeps the plugin and its library loaded, so it may outlive this loader. */
+  bool loadLinkTransformsPlugin();
+
 private:
   void configure(const Options& opt);
 
   moveit::core::RobotModelPtr model_;
   rdf_loader::RDFLoaderPtr rdf_loader_;
   kinematics_plugin_loader::KinematicsPluginLoaderPtr kinematics_loader_;
+  std::shared_ptr<pluginlib::ClassLoader<moveit::core::LinkTransformsPlugin> > link_transforms_loader_;
 };
 }  // namespace robot_model_loader
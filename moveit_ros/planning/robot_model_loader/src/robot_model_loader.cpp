@@ -36,6 +36,7 @@
 
 #include <moveit/robot_model_loader/robot_model_loader.h>
 #include <moveit/profiler/profiler.h>
+#include <pluginlib/class_loader.hpp>
 #include <ros/ros.h>
 #include <typeinfo>
 
@@ -67,6 +68,13 @@ RobotModelLoader::~RobotModelLoader()
 
 namespace
 {
+// The link transforms plugin together with the loader of its library, owned by the robot model that calls into it
+struct LinkTransformsPluginOwner
+{
+  std::shared_ptr<pluginlib::ClassLoader<moveit::core::LinkTransformsPlugin> > loader_;
+  moveit::core::LinkTransformsPluginPtr plugin_;  // destroyed before the loader
+};
+
 bool canSpecifyPosition(const moveit::core::JointModel* jmodel, const unsigned int index)
 {
   bool ok = false;
@@ -157,6 +165,9 @@ void RobotModelLoader::configure(const Options& opt)
     }
   }
 
+  if (model_ && !rdf_loader_->getRobotDescription().empty())
+    loadLinkTransformsPlugin();
+
   if (model_ && opt.load_kinematics_solvers_)
     loadKinematicsSolvers();
 
@@ -226,4 +237,45 @@ void RobotModelLoader::loadKinematicsSolvers(const kinematics_plugin_loader::Kin
     }
   }
 }
+
+bool RobotModelLoader::loadLinkTransformsPlugin()
+{
+  if (!model_ || !rdf_loader_)
+    return false;
+
+  ros::NodeHandle nh("~");
+  std::string plugin_name;
+  if (!nh.getParam(rdf_loader_->getRobotDescription() + "_planning/link_transforms_plugin", plugin_name) ||
+      plugin_name.empty())
+    return false;
+
+  auto owner = std::make_shared<LinkTransformsPluginOwner>();
+  try
+  {
+    if (!link_transforms_loader_)
+      link_transforms_loader_.reset(new pluginlib::ClassLoader<moveit::core::LinkTransformsPlugin>(
+          "moveit_core", "moveit::core::LinkTransformsPlugin"));
+    owner->loader_ = link_transforms_loader_;
+    owner->plugin_ = link_transforms_loader_->createUniqueInstance(plugin_name);
+  }
+  catch (pluginlib::PluginlibException& e)
+  {
+    ROS_ERROR_NAMED("robot_model_loader", "Unable to load link transforms plugin '%s': %s", plugin_name.c_str(),
+                    e.what());
+    return false;
+  }
+
+  if (!owner->plugin_->initialize(*model_))
+  {
+    ROS_ERROR_NAMED("robot_model_loader",
+                    "Link transforms plugin '%s' was generated for a different robot model. "
+                    "Regenerate it with moveit_generate_link_transforms_plugin.",
+                    plugin_name.c_str());
+    return false;
+  }
+  // the model may outlive this loader, so it keeps the plugin and its library loaded
+  model_->setLinkTransformsFunctionsOwner(owner);
+  ROS_INFO_NAMED("robot_model_loader", "Using link transforms plugin '%s'", plugin_name.c_str());
+  return true;
+}
 }  // namespace robot_model_loader
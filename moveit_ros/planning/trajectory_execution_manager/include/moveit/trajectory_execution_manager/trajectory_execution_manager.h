@@ -242,6 +242,18 @@ public:
   /// Enable or disable waiting for trajectory completion
   void setWaitForTrajectoryCompletion(bool flag);
 
+  /// Enable or disable streaming execution. When enabled, execute() sends each trajectory to its controllers before
+  /// the previous one finished, time-stamped to start exactly when the previous one is expected to end, as long as
+  /// both use the same controllers and the next one starts where the previous one ends. Otherwise, the trajectories
+  /// are executed one after the other, as usual.
+  void setStreamingExecution(bool flag);
+
+  /// When streaming execution is enabled, send the next trajectory this many seconds before the current one ends
+  void setStreamingLookahead(double lookahead);
+
+  // Give test access to private/protected methods
+  friend class TrajectoryExecutionManagerFixture;
+
 private:
   struct ControllerInformation
   {
@@ -271,6 +283,13 @@ private:
   void updateControllersState(const ros::Duration& age);
   void updateControllerState(const std::string& controller, const ros::Duration& age);
   void updateControllerState(ControllerInformation& ci, const ros::Duration& age);
+  void setControllerState(ControllerInformation& ci,
+                          const moveit_controller_manager::MoveItControllerManager::ControllerState& state,
+                          const ros::Time& stamp);
+
+  void startControllerStatePolling(double period);
+  void stopControllerStatePolling();
+  void controllerStatePollingThread(double period);
 
   bool distributeTrajectory(const moveit_msgs::RobotTrajectory& trajectory, const std::vector<std::string>& controllers,
                             std::vector<moveit_msgs::RobotTrajectory>& parts);
@@ -291,6 +310,20 @@ private:
   void executeThread(const ExecutionCompleteCallback& callback, const PathSegmentCompleteCallback& part_callback,
                      bool auto_clear);
   bool executePart(std::size_t part_index);
+  std::size_t executeStreaming(const PathSegmentCompleteCallback& part_callback);
+  bool canChain(const TrajectoryExecutionContext& current, const TrajectoryExecutionContext& next) const;
+  void blendParts(const TrajectoryExecutionContext& current, TrajectoryExecutionContext& next) const;
+
+  // building blocks of executePart(): send a part to its controllers (starting at start_time, unless it is zero),
+  // compute its expected duration and time index, wait for it to complete (or until a given time) and clean up
+  bool sendPart(std::size_t part_index, const ros::Time& start_time,
+                std::vector<moveit_controller_manager::MoveItControllerHandlePtr>& handles);
+  ros::Duration expectPart(TrajectoryExecutionContext& context, const ros::Time& current_time, ros::Time& expected_end);
+  bool waitForPart(const std::vector<moveit_controller_manager::MoveItControllerHandlePtr>& handles,
+                   const ros::Time& current_time, const ros::Duration& expected_trajectory_duration);
+  bool waitForPartUntil(const std::vector<moveit_controller_manager::MoveItControllerHandlePtr>& handles,
+                        const ros::Time& time);
+  void clearActivePart();
   bool waitForRobotToStop(const TrajectoryExecutionContext& context, double wait_time = 1.0);
   void continuousExecutionThread();
 
@@ -312,6 +345,31 @@ private:
   std::map<std::string, ControllerInformation> known_controllers_;
   bool manage_controllers_;
 
+  // incremented whenever the list of known controllers or the state of one of them changes
+  std::size_t controller_information_version_;
+
+  // the controllers selected for a set of joints among a set of available controllers,
+  // valid as long as controller_information_version_ does not change
+  struct ControllerSelection
+  {
+    std::size_t version_;
+    std::vector<std::string> controllers_;
+  };
+  std::map<std::pair<std::set<std::string>, std::vector<std::string> >, ControllerSelection> controller_selections_;
+
+  // controller states queried in the background, so updating the state of a controller does not need to wait
+  // for the controller manager
+  struct PolledControllerState
+  {
+    moveit_controller_manager::MoveItControllerManager::ControllerState state_;
+    ros::Time stamp_;  // when the query started
+  };
+  std::unique_ptr<boost::thread> controller_state_polling_thread_;
+  boost::mutex polled_controller_states_mutex_;
+  std::vector<std::string> polled_controller_names_;
+  std::map<std::string, PolledControllerState> polled_controller_states_;
+  ros::Time controllers_switched_;  // states polled before this time are outdated
+
   // thread used to execute trajectories using the execute() command
   std::unique_ptr<boost::thread> execution_thread_;
 
@@ -359,5 +417,7 @@ private:
   double allowed_start_tolerance_;  // joint tolerance for validate(): radians for revolute joints
   double execution_velocity_scaling_;
   bool wait_for_trajectory_completion_;
+  bool streaming_execution_;
+  double streaming_lookahead_;  // seconds
 };
 }  // namespace trajectory_execution_manager
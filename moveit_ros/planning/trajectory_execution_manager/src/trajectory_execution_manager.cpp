@@ -46,6 +46,8 @@ namespace trajectory_execution_manager
 const std::string TrajectoryExecutionManager::EXECUTION_EVENT_TOPIC = "trajectory_execution_event";
 
 static const ros::Duration DEFAULT_CONTROLLER_INFORMATION_VALIDITY_AGE(1.0);
+static const double DEFAULT_CONTROLLER_STATE_POLLING_PERIOD = 0.5;  // poll more often than the validity age, so
+                                                                    // states do not need to be queried synchronously
 static const double DEFAULT_CONTROLLER_GOAL_DURATION_MARGIN = 0.5;  // allow 0.5s more than the expected execution time
                                                                     // before triggering a trajectory cancel (applied
                                                                     // after scaling)
@@ -73,6 +75,8 @@ private:
     owner_->setExecutionVelocityScaling(config.execution_velocity_scaling);
     owner_->setAllowedStartTolerance(config.allowed_start_tolerance);
     owner_->setWaitForTrajectoryCompletion(config.wait_for_trajectory_completion);
+    owner_->setStreamingExecution(config.streaming_execution);
+    owner_->setStreamingLookahead(config.streaming_lookahead);
   }
 
   TrajectoryExecutionManager* owner_;
@@ -99,6 +103,7 @@ TrajectoryExecutionManager::TrajectoryExecutionManager(const moveit::core::Robot
 
 TrajectoryExecutionManager::~TrajectoryExecutionManager()
 {
+  stopControllerStatePolling();
   run_continuous_execution_thread_ = false;
   stopExecution(true);
   delete reconfigure_impl_;
@@ -116,6 +121,9 @@ void TrajectoryExecutionManager::initialize()
   execution_duration_monitoring_ = true;
   execution_velocity_scaling_ = 1.0;
   allowed_start_tolerance_ = 0.01;
+  streaming_execution_ = false;
+  streaming_lookahead_ = 0.1;
+  controller_information_version_ = 0;
 
   allowed_execution_duration_scaling_ = DEFAULT_CONTROLLER_GOAL_DURATION_SCALING;
   allowed_goal_duration_margin_ = DEFAULT_CONTROLLER_GOAL_DURATION_MARGIN;
@@ -170,6 +178,12 @@ void TrajectoryExecutionManager::initialize()
   // other configuration steps
   reloadControllerInformation();
 
+  double polling_period;
+  node_handle_.param("trajectory_execution/controller_state_polling_period", polling_period,
+                     DEFAULT_CONTROLLER_STATE_POLLING_PERIOD);
+  if (polling_period > 0.0)
+    startControllerStatePolling(polling_period);
+
   event_topic_subscriber_ =
       root_node_handle_.subscribe(EXECUTION_EVENT_TOPIC, 100, &TrajectoryExecutionManager::receiveEvent, this);
 
@@ -211,6 +225,16 @@ void TrajectoryExecutionManager::setWaitForTrajectoryCompletion(bool flag)
   wait_for_trajectory_completion_ = flag;
 }
 
+void TrajectoryExecutionManager::setStreamingExecution(bool flag)
+{
+  streaming_execution_ = flag;
+}
+
+void TrajectoryExecutionManager::setStreamingLookahead(double lookahead)
+{
+  streaming_lookahead_ = lookahead;
+}
+
 bool TrajectoryExecutionManager::isManagingControllers() const
 {
   return manage_controllers_;
@@ -514,6 +538,8 @@ void TrajectoryExecutionManager::continuousExecutionThread()
 void TrajectoryExecutionManager::reloadControllerInformation()
 {
   known_controllers_.clear();
+  controller_selections_.clear();
+  ++controller_information_version_;
   if (controller_manager_)
   {
     std::vector<std::string> names;
@@ -544,6 +570,13 @@ void TrajectoryExecutionManager::reloadControllerInformation()
           }
         }
   }
+
+  // states polled before the reload may be outdated, e.g. if controllers were switched without us
+  boost::mutex::scoped_lock slock(polled_controller_states_mutex_);
+  polled_controller_states_.clear();
+  polled_controller_names_.clear();
+  for (const std::pair<const std::string, ControllerInformation>& known_controller : known_controllers_)
+    polled_controller_names_.push_back(known_controller.first);
 }
 
 void TrajectoryExecutionManager::updateControllerState(const std::string& controller, const ros::Duration& age)
@@ -557,20 +590,85 @@ void TrajectoryExecutionManager::updateControllerState(const std::string& contro
 
 void TrajectoryExecutionManager::updateControllerState(ControllerInformation& ci, const ros::Duration& age)
 {
+  // use the state polled in the background, if it is more recent
+  if (controller_state_polling_thread_)
+  {
+    boost::mutex::scoped_lock slock(polled_controller_states_mutex_);
+    std::map<std::string, PolledControllerState>::const_iterator it = polled_controller_states_.find(ci.name_);
+    if (it != polled_controller_states_.end() && it->second.stamp_ > ci.last_update_ &&
+        it->second.stamp_ >= controllers_switched_)
+      setControllerState(ci, it->second.state_, it->second.stamp_);
+  }
+
   if (ros::Time::now() - ci.last_update_ >= age)
   {
     if (controller_manager_)
     {
       if (verbose_)
         ROS_INFO_NAMED(name_, "Updating information for controller '%s'.", ci.name_.c_str());
-      ci.state_ = controller_manager_->getControllerState(ci.name_);
-      ci.last_update_ = ros::Time::now();
+      setControllerState(ci, controller_manager_->getControllerState(ci.name_), ros::Time::now());
     }
   }
   else if (verbose_)
     ROS_INFO_NAMED(name_, "Information for controller '%s' is assumed to be up to date.", ci.name_.c_str());
 }
 
+void TrajectoryExecutionManager::setControllerState(
+    ControllerInformation& ci, const moveit_controller_manager::MoveItControllerManager::ControllerState& state,
+    const ros::Time& stamp)
+{
+  // a state change invalidates the cached controller selections
+  if (ci.state_.active_ != state.active_ || ci.state_.default_ != state.default_)
+    ++controller_information_version_;
+  ci.state_ = state;
+  ci.last_update_ = stamp;
+}
+
+void TrajectoryExecutionManager::startControllerStatePolling(double period)
+{
+  if (!controller_manager_ || controller_state_polling_thread_)
+    return;
+  controller_state_polling_thread_.reset(
+      new boost::thread(boost::bind(&TrajectoryExecutionManager::controllerStatePollingThread, this, period)));
+}
+
+void TrajectoryExecutionManager::stopControllerStatePolling()
+{
+  if (!controller_state_polling_thread_)
+    return;
+  controller_state_polling_thread_->interrupt();
+  controller_state_polling_thread_->join();
+  controller_state_polling_thread_.reset();
+}
+
+void TrajectoryExecutionManager::controllerStatePollingThread(double period)
+{
+  const boost::posix_time::milliseconds sleep_time(static_cast<long>(period * 1000.0));
+  try
+  {
+    while (true)
+    {
+      std::vector<std::string> names;
+      {
+        boost::mutex::scoped_lock slock(polled_controller_states_mutex_);
+        names = polled_controller_names_;
+      }
+      for (const std::string& name : names)
+      {
+        PolledControllerState polled;
+        polled.stamp_ = ros::Time::now();
+        polled.state_ = controller_manager_->getControllerState(name);
+        boost::mutex::scoped_lock slock(polled_controller_states_mutex_);
+        polled_controller_states_[name] = polled;
+      }
+      boost::this_thread::sleep(sleep_time);
+    }
+  }
+  catch (boost::thread_interrupted&)
+  {
+  }
+}
+
 void TrajectoryExecutionManager::updateControllersState(const ros::Duration& age)
 {
   for (std::pair<const std::string, ControllerInformation>& known_controller : known_controllers_)
@@ -773,6 +871,19 @@ bool TrajectoryExecutionManager::selectControllers(const std::set<std::string>&
                                                    const std::vector<std::string>& available_controllers,
                                                    std::vector<std::string>& selected_controllers)
 {
+  // the selection only depends on the joints, the available controllers and their states: reuse a previous selection,
+  // unless the known controllers or their states changed since
+  updateControllersState(DEFAULT_CONTROLLER_INFORMATION_VALIDITY_AGE);
+  std::pair<std::set<std::string>, std::vector<std::string> > key(actuated_joints, available_controllers);
+  std::map<std::pair<std::set<std::string>, std::vector<std::string> >, ControllerSelection>::const_iterator cached =
+      controller_selections_.find(key);
+  if (cached != controller_selections_.end() && cached->second.version_ == controller_information_version_)
+  {
+    selected_controllers = cached->second.controllers_;
+    return true;
+  }
+
+  std::size_t version = controller_information_version_;
   for (std::size_t i = 1; i <= available_controllers.size(); ++i)
     if (findControllers(actuated_joints, i, available_controllers, selected_controllers))
     {
@@ -790,6 +901,13 @@ bool TrajectoryExecutionManager::selectControllers(const std::set<std::string>&
             }
           }
       }
+      // only remember the selection if no state changed while it was computed
+      if (version == controller_information_version_)
+      {
+        ControllerSelection& selection = controller_selections_[key];
+        selection.version_ = version;
+        selection.controllers_ = selected_controllers;
+      }
       return true;
     }
   return false;
@@ -1285,17 +1403,20 @@ void TrajectoryExecutionManager::executeThread(const ExecutionCompleteCallback&
   // execute each trajectory, one after the other (executePart() is blocking) or until one fails.
   // on failure, the status is set by executePart(). Otherwise, it will remain as set above (success)
   std::size_t i = 0;
-  for (; i < trajectories_.size(); ++i)
-  {
-    bool epart = executePart(i);
-    if (epart && part_callback)
-      part_callback(i);
-    if (!epart || execution_complete_)
+  if (streaming_execution_ && !trajectories_.empty())
+    i = executeStreaming(part_callback);
+  else
+    for (; i < trajectories_.size(); ++i)
     {
-      ++i;
-      break;
+      bool epart = executePart(i);
+      if (epart && part_callback)
+        part_callback(i);
+      if (!epart || execution_complete_)
+      {
+        ++i;
+        break;
+      }
     }
-  }
 
   // only report that execution finished successfully when the robot actually stopped moving
   if (last_execution_status_ == moveit_controller_manager::ExecutionStatus::SUCCEEDED)
@@ -1320,216 +1441,370 @@ void TrajectoryExecutionManager::executeThread(const ExecutionCompleteCallback&
 
 bool TrajectoryExecutionManager::executePart(std::size_t part_index)
 {
-  TrajectoryExecutionContext& context = *trajectories_[part_index];
+  std::vector<moveit_controller_manager::MoveItControllerHandlePtr> handles;
+  if (!sendPart(part_index, ros::Time(), handles))
+    return false;
 
-  // first make sure desired controllers are active
-  if (ensureActiveControllers(context.controllers_))
+  ros::Time current_time = ros::Time::now();
+  ros::Time expected_end;
+  ros::Duration expected_trajectory_duration = expectPart(*trajectories_[part_index], current_time, expected_end);
+  bool result = waitForPart(handles, current_time, expected_trajectory_duration);
+  clearActivePart();
+  return result;
+}
+
+std::size_t TrajectoryExecutionManager::executeStreaming(const PathSegmentCompleteCallback& part_callback)
+{
+  std::vector<moveit_controller_manager::MoveItControllerHandlePtr> handles;
+  if (!sendPart(0, ros::Time(), handles))
+    return 1;
+
+  ros::Time start_time = ros::Time::now();
+  for (std::size_t i = 0; i < trajectories_.size(); ++i)
   {
-    // stop if we are already asked to do so
-    if (execution_complete_)
-      return false;
+    ros::Time expected_end;
+    ros::Duration expected_trajectory_duration = expectPart(*trajectories_[i], start_time, expected_end);
 
-    std::vector<moveit_controller_manager::MoveItControllerHandlePtr> handles;
+    if (i + 1 < trajectories_.size() && canChain(*trajectories_[i], *trajectories_[i + 1]))
     {
-      boost::mutex::scoped_lock slock(execution_state_mutex_);
-      if (!execution_complete_)
+      // send the next part ahead of time, so it starts exactly when this one is expected to end
+      if (!waitForPartUntil(handles, expected_end - ros::Duration(streaming_lookahead_)))
       {
-        // time indexing uses this member too, so we lock this mutex as well
-        time_index_mutex_.lock();
-        current_context_ = part_index;
-        time_index_mutex_.unlock();
-        active_handles_.resize(context.controllers_.size());
-        for (std::size_t i = 0; i < context.controllers_.size(); ++i)
-        {
-          moveit_controller_manager::MoveItControllerHandlePtr h;
-          try
-          {
-            h = controller_manager_->getControllerHandle(context.controllers_[i]);
-          }
-          catch (std::exception& ex)
-          {
-            ROS_ERROR_NAMED(name_, "Caught %s when retrieving controller handle", ex.what());
-          }
-          if (!h)
-          {
-            active_handles_.clear();
-            current_context_ = -1;
-            last_execution_status_ = moveit_controller_manager::ExecutionStatus::ABORTED;
-            ROS_ERROR_NAMED(name_, "No controller handle for controller '%s'. Aborting.",
-                            context.controllers_[i].c_str());
-            return false;
-          }
-          active_handles_[i] = h;
-        }
-        handles = active_handles_;  // keep a copy for later, to avoid thread safety issues
-        for (std::size_t i = 0; i < context.trajectory_parts_.size(); ++i)
-        {
-          bool ok = false;
-          try
-          {
-            ok = active_handles_[i]->sendTrajectory(context.trajectory_parts_[i]);
-          }
-          catch (std::exception& ex)
-          {
-            ROS_ERROR_NAMED(name_, "Caught %s when sending trajectory to controller", ex.what());
-          }
-          if (!ok)
-          {
-            for (std::size_t j = 0; j < i; ++j)
-              try
-              {
-                active_handles_[j]->cancelExecution();
-              }
-              catch (std::exception& ex)
-              {
-                ROS_ERROR_NAMED(name_, "Caught %s when canceling execution", ex.what());
-              }
-            ROS_ERROR_NAMED(name_, "Failed to send trajectory part %zu of %zu to controller %s", i + 1,
-                            context.trajectory_parts_.size(), active_handles_[i]->getName().c_str());
-            if (i > 0)
-              ROS_ERROR_NAMED(name_, "Cancelling previously sent trajectory parts");
-            active_handles_.clear();
-            current_context_ = -1;
-            last_execution_status_ = moveit_controller_manager::ExecutionStatus::ABORTED;
-            return false;
-          }
-        }
+        clearActivePart();
+        return i + 1;
       }
-    }
+      blendParts(*trajectories_[i], *trajectories_[i + 1]);
+      if (!sendPart(i + 1, expected_end, handles))
+        return i + 2;
 
-    // compute the expected duration of the trajectory and find the part of the trajectory that takes longest to execute
-    ros::Time current_time = ros::Time::now();
-    ros::Duration expected_trajectory_duration(0.0);
-    int longest_part = -1;
-    for (std::size_t i = 0; i < context.trajectory_parts_.size(); ++i)
-    {
-      ros::Duration d(0.0);
-      if (!(context.trajectory_parts_[i].joint_trajectory.points.empty() &&
-            context.trajectory_parts_[i].multi_dof_joint_trajectory.points.empty()))
+      // this part is done when the next one takes over
+      if (!waitForPartUntil(handles, expected_end))
       {
-        if (context.trajectory_parts_[i].joint_trajectory.header.stamp > current_time)
-          d = context.trajectory_parts_[i].joint_trajectory.header.stamp - current_time;
-        if (context.trajectory_parts_[i].multi_dof_joint_trajectory.header.stamp > current_time)
-          d = std::max(d, context.trajectory_parts_[i].multi_dof_joint_trajectory.header.stamp - current_time);
-        d += std::max(context.trajectory_parts_[i].joint_trajectory.points.empty() ?
-                          ros::Duration(0.0) :
-                          context.trajectory_parts_[i].joint_trajectory.points.back().time_from_start,
-                      context.trajectory_parts_[i].multi_dof_joint_trajectory.points.empty() ?
-                          ros::Duration(0.0) :
-                          context.trajectory_parts_[i].multi_dof_joint_trajectory.points.back().time_from_start);
-
-        if (longest_part < 0 ||
-            std::max(context.trajectory_parts_[i].joint_trajectory.points.size(),
-                     context.trajectory_parts_[i].multi_dof_joint_trajectory.points.size()) >
-                std::max(context.trajectory_parts_[longest_part].joint_trajectory.points.size(),
-                         context.trajectory_parts_[longest_part].multi_dof_joint_trajectory.points.size()))
-          longest_part = i;
+        clearActivePart();
+        return i + 2;
       }
-
-      // prefer controller-specific values over global ones if defined
-      // TODO: the controller-specific parameters are static, but override
-      //       the global ones are configurable via dynamic reconfigure
-      std::map<std::string, double>::const_iterator scaling_it =
-          controller_allowed_execution_duration_scaling_.find(context.controllers_[i]);
-      const double current_scaling = scaling_it != controller_allowed_execution_duration_scaling_.end() ?
-                                         scaling_it->second :
-                                         allowed_execution_duration_scaling_;
-
-      std::map<std::string, double>::const_iterator margin_it =
-          controller_allowed_goal_duration_margin_.find(context.controllers_[i]);
-      const double current_margin = margin_it != controller_allowed_goal_duration_margin_.end() ?
-                                        margin_it->second :
-                                        allowed_goal_duration_margin_;
-
-      // expected duration is the duration of the longest part
-      expected_trajectory_duration =
-          std::max(d * current_scaling + ros::Duration(current_margin), expected_trajectory_duration);
+      if (part_callback)
+        part_callback(i);
+      start_time = expected_end;
     }
+    else
+    {
+      bool result = waitForPart(handles, start_time, expected_trajectory_duration);
+      clearActivePart();
+      if (result && part_callback)
+        part_callback(i);
+      if (!result || execution_complete_ || i + 1 == trajectories_.size())
+        return i + 1;
+      if (!sendPart(i + 1, ros::Time(), handles))
+        return i + 2;
+      start_time = ros::Time::now();
+    }
+  }
+  return trajectories_.size();
+}
+
+bool TrajectoryExecutionManager::canChain(const TrajectoryExecutionContext& current,
+                                          const TrajectoryExecutionContext& next) const
+{
+  if (current.controllers_ != next.controllers_ || current.trajectory_parts_.size() != next.trajectory_parts_.size())
+    return false;
+  for (std::size_t i = 0; i < current.trajectory_parts_.size(); ++i)
+  {
+    const moveit_msgs::RobotTrajectory& a = current.trajectory_parts_[i];
+    const moveit_msgs::RobotTrajectory& b = next.trajectory_parts_[i];
+    // multi-dof trajectories are not chained
+    if (!a.multi_dof_joint_trajectory.points.empty() || !b.multi_dof_joint_trajectory.points.empty())
+      return false;
+    if (a.joint_trajectory.joint_names != b.joint_trajectory.joint_names || a.joint_trajectory.points.empty() ||
+        b.joint_trajectory.points.empty())
+      return false;
+
+    // the next part needs to start where the current one ends
+    const std::vector<double>& end = a.joint_trajectory.points.back().positions;
+    const std::vector<double>& start = b.joint_trajectory.points.front().positions;
+    if (end.size() != start.size())
+      return false;
+    for (std::size_t j = 0; j < end.size(); ++j)
+      if (fabs(end[j] - start[j]) > allowed_start_tolerance_)
+        return false;
+  }
+  return true;
+}
+
+void TrajectoryExecutionManager::blendParts(const TrajectoryExecutionContext& current,
+                                            TrajectoryExecutionContext& next) const
+{
+  // The first point of the next part repeats the last point of the current one (see canChain()). Since the next
+  // part starts when the current one ends, the controller is already there: drop the point, so the controller
+  // interpolates from the end of the current segment straight into the next one instead of holding still.
+  for (std::size_t i = 0; i < next.trajectory_parts_.size(); ++i)
+  {
+    std::vector<trajectory_msgs::JointTrajectoryPoint>& points = next.trajectory_parts_[i].joint_trajectory.points;
+    if (points.size() > 1 && points.front().time_from_start.isZero() &&
+        current.trajectory_parts_[i].joint_trajectory.points.back().velocities == points.front().velocities)
+      points.erase(points.begin());
+  }
+}
+
+bool TrajectoryExecutionManager::sendPart(std::size_t part_index, const ros::Time& start_time,
+                                          std::vector<moveit_controller_manager::MoveItControllerHandlePtr>& handles)
+{
+  TrajectoryExecutionContext& context = *trajectories_[part_index];
+
+  // first make sure desired controllers are active
+  if (!ensureActiveControllers(context.controllers_))
+  {
+    last_execution_status_ = moveit_controller_manager::ExecutionStatus::ABORTED;
+    return false;
+  }
+
+  // stop if we are already asked to do so
+  if (execution_complete_)
+    return false;
 
-    // construct a map from expected time to state index, for easy access to expected state location
-    if (longest_part >= 0)
+  // a part sent ahead of time only starts at the given time
+  if (!start_time.isZero())
+    for (moveit_msgs::RobotTrajectory& part : context.trajectory_parts_)
     {
-      boost::mutex::scoped_lock slock(time_index_mutex_);
+      part.joint_trajectory.header.stamp = start_time;
+      part.multi_dof_joint_trajectory.header.stamp = start_time;
+    }
 
-      if (context.trajectory_parts_[longest_part].joint_trajectory.points.size() >=
-          context.trajectory_parts_[longest_part].multi_dof_joint_trajectory.points.size())
+  boost::mutex::scoped_lock slock(execution_state_mutex_);
+  if (!execution_complete_)
+  {
+    // time indexing uses this member too, so we lock this mutex as well
+    time_index_mutex_.lock();
+    current_context_ = part_index;
+    time_index_.clear();
+    time_index_mutex_.unlock();
+    active_handles_.resize(context.controllers_.size());
+    for (std::size_t i = 0; i < context.controllers_.size(); ++i)
+    {
+      moveit_controller_manager::MoveItControllerHandlePtr h;
+      try
       {
-        ros::Duration d(0.0);
-        if (context.trajectory_parts_[longest_part].joint_trajectory.header.stamp > current_time)
-          d = context.trajectory_parts_[longest_part].joint_trajectory.header.stamp - current_time;
-        for (trajectory_msgs::JointTrajectoryPoint& point :
-             context.trajectory_parts_[longest_part].joint_trajectory.points)
-          time_index_.push_back(current_time + d + point.time_from_start);
+        h = controller_manager_->getControllerHandle(context.controllers_[i]);
       }
-      else
+      catch (std::exception& ex)
       {
-        ros::Duration d(0.0);
-        if (context.trajectory_parts_[longest_part].multi_dof_joint_trajectory.header.stamp > current_time)
-          d = context.trajectory_parts_[longest_part].multi_dof_joint_trajectory.header.stamp - current_time;
-        for (trajectory_msgs::MultiDOFJointTrajectoryPoint& point :
-             context.trajectory_parts_[longest_part].multi_dof_joint_trajectory.points)
-          time_index_.push_back(current_time + d + point.time_from_start);
+        ROS_ERROR_NAMED(name_, "Caught %s when retrieving controller handle", ex.what());
       }
+      if (!h)
+      {
+        active_handles_.clear();
+        current_context_ = -1;
+        last_execution_status_ = moveit_controller_manager::ExecutionStatus::ABORTED;
+        ROS_ERROR_NAMED(name_, "No controller handle for controller '%s'. Aborting.", context.controllers_[i].c_str());
+        return false;
+      }
+      active_handles_[i] = h;
     }
-
-    bool result = true;
-    for (moveit_controller_manager::MoveItControllerHandlePtr& handle : handles)
+    handles = active_handles_;  // keep a copy for later, to avoid thread safety issues
+    for (std::size_t i = 0; i < context.trajectory_parts_.size(); ++i)
     {
-      if (execution_duration_monitoring_)
+      bool ok = false;
+      try
       {
-        if (!handle->waitForExecution(expected_trajectory_duration))
-          if (!execution_complete_ && ros::Time::now() - current_time > expected_trajectory_duration)
-          {
-            ROS_ERROR_NAMED(name_,
-                            "Controller is taking too long to execute trajectory (the expected upper "
-                            "bound for the trajectory execution was %lf seconds). Stopping trajectory.",
-                            expected_trajectory_duration.toSec());
-            {
-              boost::mutex::scoped_lock slock(execution_state_mutex_);
-              stopExecutionInternal();  // this is really tricky. we can't call stopExecution() here, so we call the
-                                        // internal function only
-            }
-            last_execution_status_ = moveit_controller_manager::ExecutionStatus::TIMED_OUT;
-            result = false;
-            break;
-          }
+        ok = active_handles_[i]->sendTrajectory(context.trajectory_parts_[i]);
       }
-      else
-        handle->waitForExecution();
-
-      // if something made the trajectory stop, we stop this thread too
-      if (execution_complete_)
+      catch (std::exception& ex)
       {
-        result = false;
-        break;
+        ROS_ERROR_NAMED(name_, "Caught %s when sending trajectory to controller", ex.what());
       }
-      else if (handle->getLastExecutionStatus() != moveit_controller_manager::ExecutionStatus::SUCCEEDED)
+      if (!ok)
       {
-        ROS_WARN_STREAM_NAMED(name_, "Controller handle " << handle->getName() << " reports status "
-                                                          << handle->getLastExecutionStatus().asString());
-        last_execution_status_ = handle->getLastExecutionStatus();
-        result = false;
+        for (std::size_t j = 0; j < i; ++j)
+          try
+          {
+            active_handles_[j]->cancelExecution();
+          }
+          catch (std::exception& ex)
+          {
+            ROS_ERROR_NAMED(name_, "Caught %s when canceling execution", ex.what());
+          }
+        ROS_ERROR_NAMED(name_, "Failed to send trajectory part %zu of %zu to controller %s", i + 1,
+                        context.trajectory_parts_.size(), active_handles_[i]->getName().c_str());
+        if (i > 0)
+          ROS_ERROR_NAMED(name_, "Cancelling previously sent trajectory parts");
+        active_handles_.clear();
+        current_context_ = -1;
+        last_execution_status_ = moveit_controller_manager::ExecutionStatus::ABORTED;
+        return false;
       }
     }
+  }
+  return true;
+}
 
-    // clear the active handles
-    execution_state_mutex_.lock();
-    active_handles_.clear();
+ros::Duration TrajectoryExecutionManager::expectPart(TrajectoryExecutionContext& context,
+                                                     const ros::Time& current_time, ros::Time& expected_end)
+{
+  // compute the expected duration of the trajectory and find the part of the trajectory that takes longest to execute
+  ros::Duration expected_trajectory_duration(0.0);
+  ros::Duration nominal_duration(0.0);
+  int longest_part = -1;
+  for (std::size_t i = 0; i < context.trajectory_parts_.size(); ++i)
+  {
+    ros::Duration d(0.0);
+    if (!(context.trajectory_parts_[i].joint_trajectory.points.empty() &&
+          context.trajectory_parts_[i].multi_dof_joint_trajectory.points.empty()))
+    {
+      if (context.trajectory_parts_[i].joint_trajectory.header.stamp > current_time)
+        d = context.trajectory_parts_[i].joint_trajectory.header.stamp - current_time;
+      if (context.trajectory_parts_[i].multi_dof_joint_trajectory.header.stamp > current_time)
+        d = std::max(d, context.trajectory_parts_[i].multi_dof_joint_trajectory.header.stamp - current_time);
+      d += std::max(context.trajectory_parts_[i].joint_trajectory.points.empty() ?
+                        ros::Duration(0.0) :
+                        context.trajectory_parts_[i].joint_trajectory.points.back().time_from_start,
+                    context.trajectory_parts_[i].multi_dof_joint_trajectory.points.empty() ?
+                        ros::Duration(0.0) :
+                        context.trajectory_parts_[i].multi_dof_joint_trajectory.points.back().time_from_start);
+
+      if (longest_part < 0 ||
+          std::max(context.trajectory_parts_[i].joint_trajectory.points.size(),
+                   context.trajectory_parts_[i].multi_dof_joint_trajectory.points.size()) >
+              std::max(context.trajectory_parts_[longest_part].joint_trajectory.points.size(),
+                       context.trajectory_parts_[longest_part].multi_dof_joint_trajectory.points.size()))
+        longest_part = i;
+    }
+    nominal_duration = std::max(d, nominal_duration);
+
+    // prefer controller-specific values over global ones if defined
+    // TODO: the controller-specific parameters are static, but override
+    //       the global ones are configurable via dynamic reconfigure
+    std::map<std::string, double>::const_iterator scaling_it =
+        controller_allowed_execution_duration_scaling_.find(context.controllers_[i]);
+    const double current_scaling = scaling_it != controller_allowed_execution_duration_scaling_.end() ?
+                                       scaling_it->second :
+                                       allowed_execution_duration_scaling_;
+
+    std::map<std::string, double>::const_iterator margin_it =
+        controller_allowed_goal_duration_margin_.find(context.controllers_[i]);
+    const double current_margin = margin_it != controller_allowed_goal_duration_margin_.end() ?
+                                      margin_it->second :
+                                      allowed_goal_duration_margin_;
+
+    // expected duration is the duration of the longest part
+    expected_trajectory_duration =
+        std::max(d * current_scaling + ros::Duration(current_margin), expected_trajectory_duration);
+  }
+  expected_end = current_time + nominal_duration;
 
-    // clear the time index
-    time_index_mutex_.lock();
+  // construct a map from expected time to state index, for easy access to expected state location
+  if (longest_part >= 0)
+  {
+    boost::mutex::scoped_lock slock(time_index_mutex_);
     time_index_.clear();
-    current_context_ = -1;
-    time_index_mutex_.unlock();
 
-    execution_state_mutex_.unlock();
-    return result;
+    if (context.trajectory_parts_[longest_part].joint_trajectory.points.size() >=
+        context.trajectory_parts_[longest_part].multi_dof_joint_trajectory.points.size())
+    {
+      ros::Duration d(0.0);
+      if (context.trajectory_parts_[longest_part].joint_trajectory.header.stamp > current_time)
+        d = context.trajectory_parts_[longest_part].joint_trajectory.header.stamp - current_time;
+      for (trajectory_msgs::JointTrajectoryPoint& point :
+           context.trajectory_parts_[longest_part].joint_trajectory.points)
+        time_index_.push_back(current_time + d + point.time_from_start);
+    }
+    else
+    {
+      ros::Duration d(0.0);
+      if (context.trajectory_parts_[longest_part].multi_dof_joint_trajectory.header.stamp > current_time)
+        d = context.trajectory_parts_[longest_part].multi_dof_joint_trajectory.header.stamp - current_time;
+      for (trajectory_msgs::MultiDOFJointTrajectoryPoint& point :
+           context.trajectory_parts_[longest_part].multi_dof_joint_trajectory.points)
+        time_index_.push_back(current_time + d + point.time_from_start);
+    }
   }
-  else
+  return expected_trajectory_duration;
+}
+
+bool TrajectoryExecutionManager::waitForPart(
+    const std::vector<moveit_controller_manager::MoveItControllerHandlePtr>& handles, const ros::Time& current_time,
+    const ros::Duration& expected_trajectory_duration)
+{
+  bool result = true;
+  for (const moveit_controller_manager::MoveItControllerHandlePtr& handle : handles)
   {
-    last_execution_status_ = moveit_controller_manager::ExecutionStatus::ABORTED;
-    return false;
+    if (execution_duration_monitoring_)
+    {
+      if (!handle->waitForExecution(expected_trajectory_duration))
+        if (!execution_complete_ && ros::Time::now() - current_time > expected_trajectory_duration)
+        {
+          ROS_ERROR_NAMED(name_,
+                          "Controller is taking too long to execute trajectory (the expected upper "
+                          "bound for the trajectory execution was %lf seconds). Stopping trajectory.",
+                          expected_trajectory_duration.toSec());
+          {
+            boost::mutex::scoped_lock slock(execution_state_mutex_);
+            stopExecutionInternal();  // this is really tricky. we can't call stopExecution() here, so we call the
+                                      // internal function only
+          }
+          last_execution_status_ = moveit_controller_manager::ExecutionStatus::TIMED_OUT;
+          result = false;
+          break;
+        }
+    }
+    else
+      handle->waitForExecution();
+
+    // if something made the trajectory stop, we stop this thread too
+    if (execution_complete_)
+    {
+      result = false;
+      break;
+    }
+    else if (handle->getLastExecutionStatus() != moveit_controller_manager::ExecutionStatus::SUCCEEDED)
+    {
+      ROS_WARN_STREAM_NAMED(name_, "Controller handle " << handle->getName() << " reports status "
+                                                        << handle->getLastExecutionStatus().asString());
+      last_execution_status_ = handle->getLastExecutionStatus();
+      result = false;
+    }
   }
+  return result;
+}
+
+bool TrajectoryExecutionManager::waitForPartUntil(
+    const std::vector<moveit_controller_manager::MoveItControllerHandlePtr>& handles, const ros::Time& time)
+{
+  static const ros::Duration POLL_PERIOD(0.005);
+  for (ros::Time now = ros::Time::now(); now < time; now = ros::Time::now())
+  {
+    // if something made the trajectory stop, we stop this thread too
+    if (execution_complete_)
+      return false;
+    for (const moveit_controller_manager::MoveItControllerHandlePtr& handle : handles)
+    {
+      moveit_controller_manager::ExecutionStatus status = handle->getLastExecutionStatus();
+      if (status == moveit_controller_manager::ExecutionStatus::ABORTED ||
+          status == moveit_controller_manager::ExecutionStatus::FAILED)
+      {
+        ROS_WARN_STREAM_NAMED(name_, "Controller handle " << handle->getName() << " reports status "
+                                                          << status.asString());
+        last_execution_status_ = status;
+        return false;
+      }
+    }
+    std::min(POLL_PERIOD, time - now).sleep();
+  }
+  return !execution_complete_;
+}
+
+void TrajectoryExecutionManager::clearActivePart()
+{
+  // clear the active handles
+  execution_state_mutex_.lock();
+  active_handles_.clear();
+
+  // clear the time index
+  time_index_mutex_.lock();
+  time_index_.clear();
+  current_context_ = -1;
+  time_index_mutex_.unlock();
+
+  execution_state_mutex_.unlock();
 }
 
 bool TrajectoryExecutionManager::waitForRobotToStop(const TrajectoryExecutionContext& context, double wait_time)
@@ -1733,7 +2008,11 @@ bool TrajectoryExecutionManager::ensureActiveControllers(const std::vector<std::
         // reset the state update cache
         for (const std::string& controller_to_activate : controllers_to_deactivate)
           known_controllers_[controller_to_activate].last_update_ = ros::Time();
-        return controller_manager_->switchControllers(controllers_to_activate, controllers_to_deactivate);
+        bool result = controller_manager_->switchControllers(controllers_to_activate, controllers_to_deactivate);
+        // states polled before the switch completed are outdated
+        boost::mutex::scoped_lock slock(polled_controller_states_mutex_);
+        controllers_switched_ = ros::Time::now();
+        return result;
       }
       else
         return false;
@@ -35,54 +35,178 @@
 /* Author: Ioan Sucan */
 
 #include <moveit/trajectory_execution_manager/trajectory_execution_manager.h>
-#include <moveit/robot_model_loader/robot_model_loader.h>
-#include <moveit/planning_scene_monitor/planning_scene_monitor.h>
+#include <urdf_parser/urdf_parser.h>
+#include <ros/ros.h>
+#include <gtest/gtest.h>
 
-int main(int argc, char** argv)
+#include "test_moveit_controller_manager.h"
+
+namespace trajectory_execution_manager
 {
-  ros::init(argc, argv, "test_trajectory_execution_manager");
+namespace
+{
+// a robot with the joints used by the controllers of the TestMoveItControllerManager
+const std::string URDF = R"(<?xml version="1.0"?>
+<robot name="test_robot">
+  <link name="base_link"/>
+  <link name="r1"/>
+  <link name="r2"/>
+  <link name="l1"/>
+  <link name="l2"/>
+  <link name="l3"/>
+  <link name="h"/>
+  <joint name="rj1" type="revolute"><parent link="base_link"/><child link="r1"/>
+    <limit lower="-3.14" upper="3.14" effort="10" velocity="2"/></joint>
+  <joint name="rj2" type="revolute"><parent link="r1"/><child link="r2"/>
+    <limit lower="-3.14" upper="3.14" effort="10" velocity="2"/></joint>
+  <joint name="lj1" type="revolute"><parent link="base_link"/><child link="l1"/>
+    <limit lower="-3.14" upper="3.14" effort="10" velocity="2"/></joint>
+  <joint name="lj2" type="revolute"><parent link="l1"/><child link="l2"/>
+    <limit lower="-3.14" upper="3.14" effort="10" velocity="2"/></joint>
+  <joint name="lj3" type="revolute"><parent link="l2"/><child link="l3"/>
+    <limit lower="-3.14" upper="3.14" effort="10" velocity="2"/></joint>
+  <joint name="headj" type="revolute"><parent link="base_link"/><child link="h"/>
+    <limit lower="-3.14" upper="3.14" effort="10" velocity="2"/></joint>
+</robot>
+)";
 
-  ros::AsyncSpinner spinner(1);
-  spinner.start();
+const std::string SRDF = R"(<?xml version="1.0"?>
+<robot name="test_robot">
+  <virtual_joint name="basej" type="planar" parent_frame="odom" child_link="base_link"/>
+</robot>
+)";
+
+// tolerance for the times at which trajectories are sent (in seconds)
+const double TIME_TOLERANCE = 0.05;
+
+// a trajectory of the right arm, moving both joints from start to end within the given duration
+moveit_msgs::RobotTrajectory makeTrajectory(double start, double end, double duration)
+{
+  moveit_msgs::RobotTrajectory trajectory;
+  trajectory.joint_trajectory.joint_names = { "rj1", "rj2" };
+  trajectory.joint_trajectory.points.resize(2);
+  trajectory.joint_trajectory.points[0].positions = { start, start };
+  trajectory.joint_trajectory.points[0].velocities = { 0.0, 0.0 };
+  trajectory.joint_trajectory.points[1].positions = { end, end };
+  trajectory.joint_trajectory.points[1].velocities = { 0.0, 0.0 };
+  trajectory.joint_trajectory.points[1].time_from_start = ros::Duration(duration);
+  return trajectory;
+}
+
+TrajectoryExecutionManager::TrajectoryExecutionContext makeContext(const moveit_msgs::RobotTrajectory& trajectory,
+                                                                   const std::string& controller = "right_arm")
+{
+  TrajectoryExecutionManager::TrajectoryExecutionContext context;
+  context.controllers_.push_back(controller);
+  context.trajectory_parts_.push_back(trajectory);
+  return context;
+}
+}  // namespace
+
+class TrajectoryExecutionManagerFixture : public testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    urdf::ModelInterfaceSharedPtr urdf_model = urdf::parseURDF(URDF);
+    ASSERT_TRUE(urdf_model);
+    srdf::ModelSharedPtr srdf_model(new srdf::Model());
+    ASSERT_TRUE(srdf_model->initString(*urdf_model, SRDF));
+    robot_model_ = std::make_shared<moveit::core::RobotModel>(urdf_model, srdf_model);
+
+    // the start state of trajectories is not validated, so no current state monitor is needed
+    tem_ = std::make_shared<TrajectoryExecutionManager>(robot_model_, planning_scene_monitor::CurrentStateMonitorPtr(),
+                                                        true);
+    tem_->setAllowedStartTolerance(0.0);
+
+    // use the test controllers instead of a plugin
+    controller_manager_ = std::make_shared<test_moveit_controller_manager::TestMoveItControllerManager>();
+    tem_->controller_manager_ = controller_manager_;
+    tem_->reloadControllerInformation();
+  }
+
+  void TearDown() override
+  {
+    tem_.reset();
+  }
+
+  bool canChain(const TrajectoryExecutionManager::TrajectoryExecutionContext& current,
+                const TrajectoryExecutionManager::TrajectoryExecutionContext& next) const
+  {
+    return tem_->canChain(current, next);
+  }
 
-  robot_model_loader::RobotModelLoaderPtr rml(new robot_model_loader::RobotModelLoader);
-  planning_scene_monitor::PlanningSceneMonitor psm(rml);
-  trajectory_execution_manager::TrajectoryExecutionManager tem(rml->getModel(), psm.getStateMonitor(), true);
+  void blendParts(const TrajectoryExecutionManager::TrajectoryExecutionContext& current,
+                  TrajectoryExecutionManager::TrajectoryExecutionContext& next) const
+  {
+    tem_->blendParts(current, next);
+  }
 
-  std::cout << "1:\n";
-  if (!tem.ensureActiveControllersForJoints(std::vector<std::string>(1, "basej")))
-    ROS_ERROR("Fail!");
+  std::vector<std::string> selectControllers(const std::set<std::string>& joints,
+                                             const std::vector<std::string>& available)
+  {
+    std::vector<std::string> selected;
+    EXPECT_TRUE(tem_->selectControllers(joints, available, selected));
+    return selected;
+  }
 
-  std::cout << "2:\n";
-  if (!tem.ensureActiveController("arms"))
-    ROS_ERROR("Fail!");
+  bool isControllerActive(const std::string& controller, const ros::Duration& age)
+  {
+    tem_->updateControllerState(controller, age);
+    return tem_->known_controllers_[controller].state_.active_;
+  }
 
-  std::cout << "3:\n";
-  if (!tem.ensureActiveControllersForJoints(std::vector<std::string>(1, "rj2")))
-    ROS_ERROR("Fail!");
+  // poll the states of all controllers once, the next poll is far in the future
+  void pollControllerStatesOnce()
+  {
+    tem_->startControllerStatePolling(1000.0);
+    for (int i = 0; i < 100 && polledControllerStateCount() < tem_->known_controllers_.size(); ++i)
+      ros::WallDuration(0.01).sleep();
+    ASSERT_EQ(polledControllerStateCount(), tem_->known_controllers_.size());
+  }
 
-  std::cout << "4:\n";
-  if (!tem.ensureActiveControllersForJoints(std::vector<std::string>(1, "lj1")))
-    ROS_ERROR("Fail!");
+  std::size_t polledControllerStateCount()
+  {
+    boost::mutex::scoped_lock slock(tem_->polled_controller_states_mutex_);
+    return tem_->polled_controller_states_.size();
+  }
 
-  std::cout << "5:\n";
-  if (!tem.ensureActiveController("left_arm_head"))
-    ROS_ERROR("Fail!");
-  std::cout << "6:\n";
-  if (!tem.ensureActiveController("arms"))
-    ROS_ERROR("Fail!");
+  void reloadControllerInformation()
+  {
+    tem_->reloadControllerInformation();
+  }
 
+  void setManageControllers(bool flag)
+  {
+    tem_->manage_controllers_ = flag;
+  }
+
+  moveit::core::RobotModelPtr robot_model_;
+  TrajectoryExecutionManagerPtr tem_;
+  std::shared_ptr<test_moveit_controller_manager::TestMoveItControllerManager> controller_manager_;
+};
+
+TEST_F(TrajectoryExecutionManagerFixture, EnsureActiveControllers)
+{
+  EXPECT_TRUE(tem_->ensureActiveControllersForJoints(std::vector<std::string>(1, "basej")));
+  EXPECT_TRUE(tem_->ensureActiveController("arms"));
+  EXPECT_TRUE(tem_->ensureActiveControllersForJoints(std::vector<std::string>(1, "rj2")));
+  EXPECT_TRUE(tem_->ensureActiveControllersForJoints(std::vector<std::string>(1, "lj1")));
+  EXPECT_TRUE(tem_->ensureActiveController("left_arm_head"));
+  EXPECT_TRUE(tem_->ensureActiveController("arms"));
+}
+
+TEST_F(TrajectoryExecutionManagerFixture, ExecuteTrajectories)
+{
   // execute with empty set of trajectories
-  tem.execute();
-  if (!tem.waitForExecution())
-    ROS_ERROR("Fail!");
+  tem_->execute();
+  EXPECT_TRUE(tem_->waitForExecution());
 
   moveit_msgs::RobotTrajectory traj1;
   traj1.joint_trajectory.joint_names.push_back("rj1");
   traj1.joint_trajectory.points.resize(1);
   traj1.joint_trajectory.points[0].positions.push_back(0.0);
-  if (!tem.push(traj1))
-    ROS_ERROR("Fail!");
+  EXPECT_TRUE(tem_->push(traj1));
 
   moveit_msgs::RobotTrajectory traj2 = traj1;
   traj2.joint_trajectory.joint_names.push_back("lj2");
@@ -90,18 +214,186 @@ int main(int argc, char** argv)
   traj2.multi_dof_joint_trajectory.joint_names.push_back("basej");
   traj2.multi_dof_joint_trajectory.points.resize(1);
   traj2.multi_dof_joint_trajectory.points[0].transforms.resize(1);
-
-  if (!tem.push(traj2))
-    ROS_ERROR("Fail!");
+  traj2.multi_dof_joint_trajectory.points[0].transforms[0].rotation.w = 1.0;
+  EXPECT_TRUE(tem_->push(traj2));
 
   traj1.multi_dof_joint_trajectory = traj2.multi_dof_joint_trajectory;
-  if (!tem.push(traj1))
-    ROS_ERROR("Fail!");
+  EXPECT_TRUE(tem_->push(traj1));
+
+  moveit_controller_manager::ExecutionStatus::Value status = tem_->executeAndWait();
+  EXPECT_EQ(status, moveit_controller_manager::ExecutionStatus::SUCCEEDED);
+}
+
+TEST_F(TrajectoryExecutionManagerFixture, ChainSecondTrajectoryDuringExecution)
+{
+  tem_->setStreamingExecution(true);
+  tem_->setStreamingLookahead(0.2);
+  ASSERT_TRUE(tem_->push(makeTrajectory(0.0, 0.5, 0.5)));
+  ASSERT_TRUE(tem_->push(makeTrajectory(0.5, 1.0, 0.5)));
+  moveit_controller_manager::ExecutionStatus::Value status = tem_->executeAndWait();
+  EXPECT_EQ(status, moveit_controller_manager::ExecutionStatus::SUCCEEDED);
+
+  std::vector<test_moveit_controller_manager::SentTrajectory> sent = controller_manager_->getSentTrajectories();
+  ASSERT_EQ(sent.size(), 2u);
+  EXPECT_EQ(sent[0].controller_, sent[1].controller_);
+
+  // the first trajectory starts right away, the second one is sent while the first one is still executing
+  // (lookahead before its end) and is scheduled to start exactly when the first one ends
+  EXPECT_TRUE(sent[0].trajectory_.joint_trajectory.header.stamp.isZero());
+  const ros::Time& second_start = sent[1].trajectory_.joint_trajectory.header.stamp;
+  EXPECT_NEAR((second_start - sent[0].time_).toSec(), 0.5, TIME_TOLERANCE);
+  EXPECT_NEAR((second_start - sent[1].time_).toSec(), 0.2, TIME_TOLERANCE);
+}
+
+TEST_F(TrajectoryExecutionManagerFixture, SpliceTimesAndOffsets)
+{
+  tem_->setStreamingExecution(true);
+  ASSERT_TRUE(tem_->push(makeTrajectory(0.0, 0.3, 0.3)));
+  ASSERT_TRUE(tem_->push(makeTrajectory(0.3, 0.6, 0.4)));
+  ASSERT_TRUE(tem_->push(makeTrajectory(0.6, 0.9, 0.2)));
+  moveit_controller_manager::ExecutionStatus::Value status = tem_->executeAndWait();
+  EXPECT_EQ(status, moveit_controller_manager::ExecutionStatus::SUCCEEDED);
+
+  std::vector<test_moveit_controller_manager::SentTrajectory> sent = controller_manager_->getSentTrajectories();
+  ASSERT_EQ(sent.size(), 3u);
+
+  // each spliced trajectory starts exactly when the previous one is expected to end
+  EXPECT_NEAR((sent[2].trajectory_.joint_trajectory.header.stamp - sent[1].trajectory_.joint_trajectory.header.stamp)
+                  .toSec(),
+              0.4, 1e-6);
+
+  // spliced trajectories no longer repeat the end point of the previous one: the controller moves on right away
+  for (std::size_t i = 1; i < sent.size(); ++i)
+  {
+    const std::vector<trajectory_msgs::JointTrajectoryPoint>& points = sent[i].trajectory_.joint_trajectory.points;
+    ASSERT_EQ(points.size(), 1u);
+    EXPECT_GT(points[0].time_from_start, ros::Duration(0.0));
+    EXPECT_NEAR(points[0].positions[0], 0.3 * (i + 1), 1e-9);
+  }
+}
+
+TEST_F(TrajectoryExecutionManagerFixture, DoNotChainDisconnectedTrajectory)
+{
+  tem_->setStreamingExecution(true);
+  ASSERT_TRUE(tem_->push(makeTrajectory(0.0, 0.5, 0.3)));
+  // the second trajectory does not start where the first one ends
+  ASSERT_TRUE(tem_->push(makeTrajectory(0.8, 1.0, 0.3)));
+  moveit_controller_manager::ExecutionStatus::Value status = tem_->executeAndWait();
+  EXPECT_EQ(status, moveit_controller_manager::ExecutionStatus::SUCCEEDED);
+
+  // both trajectories are executed one after the other, without splicing
+  std::vector<test_moveit_controller_manager::SentTrajectory> sent = controller_manager_->getSentTrajectories();
+  ASSERT_EQ(sent.size(), 2u);
+  for (const test_moveit_controller_manager::SentTrajectory& s : sent)
+  {
+    EXPECT_TRUE(s.trajectory_.joint_trajectory.header.stamp.isZero());
+    EXPECT_EQ(s.trajectory_.joint_trajectory.points.size(), 2u);
+  }
+}
+
+TEST_F(TrajectoryExecutionManagerFixture, CanChain)
+{
+  TrajectoryExecutionManager::TrajectoryExecutionContext current = makeContext(makeTrajectory(0.0, 0.5, 0.5));
+  EXPECT_TRUE(canChain(current, makeContext(makeTrajectory(0.5, 1.0, 0.5))));
+
+  // the next part starts somewhere else
+  EXPECT_FALSE(canChain(current, makeContext(makeTrajectory(0.6, 1.0, 0.5))));
+
+  // the next part uses other controllers
+  EXPECT_FALSE(canChain(current, makeContext(makeTrajectory(0.5, 1.0, 0.5), "arms")));
+
+  // the next part moves other joints
+  moveit_msgs::RobotTrajectory other_joints = makeTrajectory(0.5, 1.0, 0.5);
+  std::swap(other_joints.joint_trajectory.joint_names[0], other_joints.joint_trajectory.joint_names[1]);
+  EXPECT_FALSE(canChain(current, makeContext(other_joints)));
+
+  // the next part is empty
+  moveit_msgs::RobotTrajectory empty = makeTrajectory(0.5, 1.0, 0.5);
+  empty.joint_trajectory.points.clear();
+  EXPECT_FALSE(canChain(current, makeContext(empty)));
+
+  // multi-dof trajectories are not chained
+  moveit_msgs::RobotTrajectory multi_dof = makeTrajectory(0.5, 1.0, 0.5);
+  multi_dof.multi_dof_joint_trajectory.joint_names.push_back("basej");
+  multi_dof.multi_dof_joint_trajectory.points.resize(1);
+  multi_dof.multi_dof_joint_trajectory.points[0].transforms.resize(1);
+  EXPECT_FALSE(canChain(current, makeContext(multi_dof)));
+}
+
+TEST_F(TrajectoryExecutionManagerFixture, BlendParts)
+{
+  TrajectoryExecutionManager::TrajectoryExecutionContext current = makeContext(makeTrajectory(0.0, 0.5, 0.5));
+
+  // the first point of the next part repeats the end of the current one and is dropped
+  TrajectoryExecutionManager::TrajectoryExecutionContext next = makeContext(makeTrajectory(0.5, 1.0, 0.5));
+  blendParts(current, next);
+  ASSERT_EQ(next.trajectory_parts_[0].joint_trajectory.points.size(), 1u);
+  EXPECT_EQ(next.trajectory_parts_[0].joint_trajectory.points[0].time_from_start, ros::Duration(0.5));
+
+  // the first point is kept if the velocity does not match the end of the current part
+  next = makeContext(makeTrajectory(0.5, 1.0, 0.5));
+  next.trajectory_parts_[0].joint_trajectory.points[0].velocities = { 0.1, 0.1 };
+  blendParts(current, next);
+  EXPECT_EQ(next.trajectory_parts_[0].joint_trajectory.points.size(), 2u);
+
+  // a single point is never dropped
+  next = makeContext(makeTrajectory(0.5, 1.0, 0.5));
+  next.trajectory_parts_[0].joint_trajectory.points.pop_back();
+  blendParts(current, next);
+  EXPECT_EQ(next.trajectory_parts_[0].joint_trajectory.points.size(), 1u);
+}
 
-  if (!tem.executeAndWait())
-    ROS_ERROR("Fail!");
+TEST_F(TrajectoryExecutionManagerFixture, SelectionFollowsControllerStates)
+{
+  // without managing controllers, active controllers are preferred even if more of them are needed
+  setManageControllers(false);
+  const std::set<std::string> joints = { "rj1", "lj1" };
+  const std::vector<std::string> available = { "arms", "left_arm", "right_arm" };
+  EXPECT_EQ(selectControllers(joints, available), std::vector<std::string>({ "arms" }));
+  EXPECT_EQ(selectControllers(joints, available), std::vector<std::string>({ "arms" }));
+
+  // once the right arm is active as well, the remembered selection is outdated
+  controller_manager_->switchControllers({ "right_arm" }, {});
+  EXPECT_TRUE(isControllerActive("right_arm", ros::Duration(0.0)));
+  EXPECT_EQ(selectControllers(joints, available), std::vector<std::string>({ "left_arm", "right_arm" }));
+
+  // the same holds if the controllers are reloaded
+  controller_manager_->switchControllers({}, { "right_arm" });
+  reloadControllerInformation();
+  EXPECT_EQ(selectControllers(joints, available), std::vector<std::string>({ "arms" }));
+}
+
+TEST_F(TrajectoryExecutionManagerFixture, UsePolledControllerStates)
+{
+  pollControllerStatesOnce();
+
+  // a recently polled state is used without asking the controller manager again
+  controller_manager_->switchControllers({ "head" }, {});
+  EXPECT_FALSE(isControllerActive("head", ros::Duration(1000.0)));
 
-  ros::waitForShutdown();
+  // an outdated state is queried again
+  EXPECT_TRUE(isControllerActive("head", ros::Duration(0.0)));
+}
+
+TEST_F(TrajectoryExecutionManagerFixture, ReloadDiscardsPolledControllerStates)
+{
+  pollControllerStatesOnce();
+
+  // controllers switched behind our back: the states polled before the reload must not be used afterwards
+  controller_manager_->switchControllers({ "head" }, {});
+  reloadControllerInformation();
+  EXPECT_EQ(polledControllerStateCount(), 0u);
+  EXPECT_TRUE(isControllerActive("head", ros::Duration(1000.0)));
+}
+}  // namespace trajectory_execution_manager
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  ros::init(argc, argv, "test_trajectory_execution_manager");
+
+  ros::AsyncSpinner spinner(1);
+  spinner.start();
 
-  return 0;
+  return RUN_ALL_TESTS();
 }
@@ -37,18 +37,40 @@
 #pragma once
 
 #include <moveit/controller_manager/controller_manager.h>
+#include <boost/thread/mutex.hpp>
 
 namespace test_moveit_controller_manager
 {
+/// A trajectory received by one of the test controllers, along with the time it was received
+struct SentTrajectory
+{
+  std::string controller_;
+  ros::Time time_;
+  moveit_msgs::RobotTrajectory trajectory_;
+};
+
+/// Record of all trajectories sent to the controllers of a TestMoveItControllerManager
+struct SentTrajectories
+{
+  boost::mutex lock_;
+  std::vector<SentTrajectory> trajectories_;
+};
+
 class TestMoveItControllerHandle : public moveit_controller_manager::MoveItControllerHandle
 {
 public:
-  TestMoveItControllerHandle(const std::string& name) : MoveItControllerHandle(name)
+  TestMoveItControllerHandle(const std::string& name, const std::shared_ptr<SentTrajectories>& sent = nullptr)
+    : MoveItControllerHandle(name), sent_(sent)
   {
   }
 
-  bool sendTrajectory(const moveit_msgs::RobotTrajectory& /*trajectory*/) override
+  bool sendTrajectory(const moveit_msgs::RobotTrajectory& trajectory) override
   {
+    if (sent_)
+    {
+      boost::mutex::scoped_lock slock(sent_->lock_);
+      sent_->trajectories_.push_back(SentTrajectory{ name_, ros::Time::now(), trajectory });
+    }
     return true;
   }
 
@@ -67,6 +89,9 @@ public:
   {
     return moveit_controller_manager::ExecutionStatus::SUCCEEDED;
   }
+
+private:
+  std::shared_ptr<SentTrajectories> sent_;
 };
 
 class TestMoveItControllerManager : public moveit_controller_manager::MoveItControllerManager
@@ -75,7 +100,7 @@ public:
   static const int ACTIVE = 1;
   static const int DEFAULT = 2;
 
-  TestMoveItControllerManager()
+  TestMoveItControllerManager() : sent_(std::make_shared<SentTrajectories>())
   {
     controllers_["right_arm"] = DEFAULT;
     controllers_["left_arm"] = ACTIVE + DEFAULT;
@@ -108,7 +133,14 @@ public:
 
   moveit_controller_manager::MoveItControllerHandlePtr getControllerHandle(const std::string& name) override
   {
-    return moveit_controller_manager::MoveItControllerHandlePtr(new TestMoveItControllerHandle(name));
+    return moveit_controller_manager::MoveItControllerHandlePtr(new TestMoveItControllerHandle(name, sent_));
+  }
+
+  /// Get the trajectories sent to the controllers so far, in the order they were sent
+  std::vector<SentTrajectory> getSentTrajectories() const
+  {
+    boost::mutex::scoped_lock slock(sent_->lock_);
+    return sent_->trajectories_;
   }
 
   void getControllersList(std::vector<std::string>& names) override
@@ -158,5 +190,6 @@ public:
 protected:
   std::map<std::string, int> controllers_;
   std::map<std::string, std::vector<std::string> > controller_joints_;
+  std::shared_ptr<SentTrajectories> sent_;
 };
 }  // namespace test_moveit_controller_manager